@@ -201,6 +201,26 @@ uint8_t can_rx(uint32_t *message_id, size_t *length, uint8_t *message,
 
 int can_init(can_speed_t speed, can_mode_t mode);
 
+/****************************************************************************
+ * Name: can_deinit
+ *
+ * Description:
+ *   This function is called before jumping to the application. It disables
+ *   the FIFO message pending interrupts enabled by can_init to wake up
+ *   timer_idle, so that the application does not receive CAN interrupts
+ *   before it has set up its own handlers. The bit rate and the filter
+ *   registers, which pass data to the application, are left intact.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned value:
+ *   None
+ *
+ ****************************************************************************/
+
+void can_deinit(void);
+
 /****************************************************************************
  * Name: can_autobaud
  *
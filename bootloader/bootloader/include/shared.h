@@ -52,6 +52,16 @@
 #define APP_DESCRIPTOR_SIGNATURE_REV '0','0'
 #define APP_DESCRIPTOR_SIGNATURE APP_DESCRIPTOR_SIGNATURE_ID, APP_DESCRIPTOR_SIGNATURE_REV
 
+/* Define the signature for the Bootloader descriptor as 'BLDesc' and a
+ * revision number of 00 used in bootloader_descriptor_t
+ */
+
+#define BOOTLOADER_DESCRIPTOR_SIGNATURE 'B','L','D','e','s','c','0','0'
+
+/* Capability flags of bootloader_descriptor_t */
+
+#define BOOTLOADER_CAPABILITY_STAGING (1u << 0) /* Installs images staged after the application */
+
 /* N.B. the .ld file must emit this sections */
 # define boot_app_shared_section __attribute__((section(".app_descriptor")))
 
@@ -134,6 +144,34 @@ typedef struct __attribute__((packed)) app_descriptor_t {
 	uint8_t reserved[6];
 } app_descriptor_t;
 
+/****************************************************************************
+ *
+ * Bootloader descriptor.
+ *
+ * This structure is located by the linker script right after the vector
+ * table of the bootloader, aligned on an 8-byte boundary.
+ *
+ * The application scans the bootloader flash for the signature to find
+ * out what the installed bootloader supports. Bootloaders that predate this
+ * structure do not have it, so its absence means no optional capabilities.
+ *
+ * If BOOTLOADER_CAPABILITY_STAGING is set, the application may download a
+ * new image into the erased flash of the application area following its own
+ * image, starting at the first page boundary past image_size of its
+ * descriptor. The bootloader installs the staged image from there on the
+ * next boot. The application must not stage an image unless the application
+ * area described here matches its own memory layout.
+ *
+****************************************************************************/
+
+typedef struct __attribute__((packed)) bootloader_descriptor_t {
+	uint8_t signature[sizeof(uint64_t)];
+	uint32_t capabilities;
+	uint32_t application_address;
+	uint32_t application_size;
+	uint8_t reserved[4];
+} bootloader_descriptor_t;
+
 /****************************************************************************
  * Global Variables
  ****************************************************************************/
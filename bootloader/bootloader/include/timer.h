@@ -142,6 +142,24 @@ extern const bl_timer_cb_t null_cb;
 
 void timer_init(void);
 
+/****************************************************************************
+ * Name: timer_deinit
+ *
+ * Description:
+ *   Called before jumping to the application to undo the sleep setup of
+ *   timer_init: SEVONPEND is cleared and a pending system tick is
+ *   discarded. The system tick must be stopped beforehand.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void timer_deinit(void);
+
 /****************************************************************************
  * Name: timer_allocate
  *
@@ -150,8 +168,8 @@ void timer_init(void);
  *   allocation as the data for the timer are compile time generated.
  *   See OPT_BL_NUMBER_TIMERS
  *
- *   There is an inherent priority to the timers in that the first timer
- *   allocated is the first timer run per tick.
+ *   Timers that expire on the same tick are run in the order they were
+ *   started.
  *
  *   There are 3 modes of operation for the timers. All modes support an
  *   optional call back on expiration.
@@ -336,6 +354,24 @@ static inline int timer_ref_expired(time_ref_t ref)
 time_ms_t timer_tic(void);
 
 
+/****************************************************************************
+ * Name: timer_idle
+ *
+ * Description:
+ *   Puts the CPU to sleep until the next event: the system tick that drives
+ *   the timers, or any interrupt becoming pending, such as a CAN frame
+ *   arrival. It should be used in place of busy waiting on a timer.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void timer_idle(void);
+
 /****************************************************************************
  * Name: timer_hrt_read
  *
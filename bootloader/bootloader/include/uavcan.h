@@ -569,6 +569,17 @@ typedef struct __attribute__((packed)) uavcan_LogMessage_t {
 
 CCASSERT(sizeof(uavcan_LogMessage_t) == PackedSizeMsgLogMessage);
 
+/****************************************
+ * Uavcan KeyValue
+ ****************************************/
+
+typedef struct __attribute__((packed)) uavcan_KeyValue_t {
+	uint32_t value; /* IEEE 754 binary32 */
+	uint8_t key[uavcan_byte_count(KeyValue, key)];
+} uavcan_KeyValue_t;
+
+CCASSERT(sizeof(uavcan_KeyValue_t) == PackedSizeMsgKeyValue);
+
 
 /****************************************
  * Uavcan Allocation
@@ -805,6 +816,25 @@ extern const uint8_t debug_log_source[uavcan_byte_count(LogMessage, source)];
 void uavcan_tx_log_message(uavcan_LogMessageConsts_t level, uint8_t stage,
 			   uint8_t status);
 
+/****************************************************************************
+ * Name: uavcan_tx_key_value
+ *
+ * Description:
+ *   This functions sends uavcan debug KeyValue type data.
+ *   The value is sent as float32, but it is passed as an integer, so that
+ *   the bootloader does not need the software floating point library.
+ *
+ * Input Parameters:
+ *   key     - The name of the value, up to 3 characters long.
+ *   value   - The value.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void uavcan_tx_key_value(const char *key, uint32_t value);
+
 /****************************************************************************
  * Name: uavcan_tx_allocation_message
  *
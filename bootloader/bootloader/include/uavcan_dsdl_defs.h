@@ -39,6 +39,13 @@
  * file
  */
 
+/* The signature column is not the 64-bit data type signature, but its
+ * CRC-16-CCITT in little endian byte order, which is the initial value of
+ * the transfer CRC. E.g. the data type signature of KeyValue is
+ * 0xe02f25d6e0c98ae0, which gives 0xdd34. The values are checked against
+ * the DSDL definitions by tools/bl_download_sim/check_dsdl_signatures.py
+ */
+
 /* Components */
 
 /* UAVCAN_DSDL_BIT_DEF(data_typ_name,                  field_name,        lsb_pos,    length,    payload_offset, payload_length) */
@@ -134,6 +141,12 @@ END_COMPONENTS
    UAVCAN_DSDL_BIT_DEF(LogMessage,                           source,              0,          8,              1,          4) // Bootloader specific uses is 4
    UAVCAN_DSDL_BIT_DEF(LogMessage,                             text,              0,          8,              5,          2) // Bootloader specific uses is 2
 
+/*UAVCAN_DSDL_TYPE_DEF(name,                dtid,              signature,  packed size    mailbox,         fifo,         inbound,        outbound) */
+  UAVCAN_DSDL_MESG_DEF(KeyValue,            16370,                0xdd34,         7,         MailBox0,     Fifo0,            NA,           SingleFrameTailInit) /* Message */
+/* UAVCAN_DSDL_BIT_DEF(data_typ_name,                    field_name,        lsb_pos,    length,    payload_offset, payload_length) */
+   UAVCAN_DSDL_BIT_DEF(KeyValue,                              value,              0,         32,              0,          4)
+   UAVCAN_DSDL_BIT_DEF(KeyValue,                                key,              0,          8,              4,          3) // Bootloader specific uses is 3
+
 
 
 
@@ -293,6 +293,16 @@ uint8_t can_rx(uint32_t *message_id, size_t *length, uint8_t *message,
 	uint32_t data[2];
 	uint8_t rv = 0;
 	const uint32_t fifos[] = { STM32_CAN1_RF0R, STM32_CAN1_RF1R };
+	const int irqs[] = { STM32_IRQ_CAN1RX0, STM32_IRQ_CAN1RX1 };
+
+	/*
+	 * The FIFO interrupt is not enabled in the NVIC, it is only used to
+	 * wake up timer_idle. Clear its pending state before checking the FIFO,
+	 * so that a frame arriving after the check wakes up the next wait.
+	 */
+
+	const int irq = irqs[fifo & 1] - STM32_IRQ_FIRST;
+	putreg32(1 << (irq & 0x1f), NVIC_IRQ_CLRPEND(irq));
 
 	if (getreg32(fifos[fifo & 1]) & CAN_RFR_FMP_MASK) {
 
@@ -492,6 +502,10 @@ int can_init(can_speed_t speed, can_mode_t mode)
 	putreg32(bitrates[speedndx] | mode << CAN_BTR_LBK_SHIFT, STM32_CAN1_BTR);
 	putreg32(CAN_MCR_ABOM | CAN_MCR_AWUM | CAN_MCR_DBF | CAN_MCR_TXFP, STM32_CAN1_MCR);
 
+	/* Pending frames wake up timer_idle; the interrupts stay disabled in the NVIC */
+
+	putreg32(CAN_IER_FMPIE0 | CAN_IER_FMPIE1, STM32_CAN1_IER);
+
 	for (timeout = INAK_TIMEOUT; timeout > 0; timeout--) {
 		if ((getreg32(STM32_CAN1_MSR) & CAN_MSR_INAK) == 0) {
 			/* We are in initialization mode */
@@ -548,6 +562,29 @@ int can_init(can_speed_t speed, can_mode_t mode)
 	return 0;
 }
 
+/****************************************************************************
+ * Name: can_deinit
+ *
+ * Description:
+ *   This function is called before jumping to the application. It disables
+ *   the FIFO message pending interrupts enabled by can_init to wake up
+ *   timer_idle, so that the application does not receive CAN interrupts
+ *   before it has set up its own handlers. The bit rate and the filter
+ *   registers, which pass data to the application, are left intact.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned value:
+ *   None
+ *
+ ****************************************************************************/
+
+void can_deinit(void)
+{
+	putreg32(0, STM32_CAN1_IER);
+}
+
 /****************************************************************************
  * Name: can_cancel_on_error
  *
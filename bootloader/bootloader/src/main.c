@@ -70,6 +70,14 @@
 #define LOGMESSAGE_RESULT_FAIL    'f'
 #define LOGMESSAGE_RESULT_OK      'o'
 
+/* Adaptive rate limiting of the file read requests, see file_read_and_program */
+
+#define READ_INTERVAL_MIN_MS        1
+#define READ_INTERVAL_MAX_MS        1000
+#define READ_INTERVAL_STEP_MS       4
+#define READ_INTERVAL_STEP_DIVISOR  4
+#define READ_LATENCY_CONGESTED_MS   (UavcanServiceTimeOutMs / 4)
+
 #if defined(DEBUG_APPLICATION_INPLACE)
 #pragma message "******** DANGER DEBUG_APPLICATION_INPLACE is DEFINED ******"
 #endif
@@ -95,9 +103,24 @@ typedef volatile struct bootloader_t {
 		uint32_t l;
 		uint8_t b[sizeof(uint32_t)];
 	} fw_word0;
+	volatile uint16_t vendor_specific_status_code;
 
 } bootloader_t;
 
+/* Firmware update statistics, see report_progress */
+
+typedef struct fw_update_stats_t {
+	uint32_t  bytes_written;
+	uint32_t  bytes_reported;
+	uint32_t  retries;
+	time_ms_t started_at;
+	time_ms_t reported_at;
+	time_ms_t erase_ms;
+	time_ms_t program_ms;
+	time_ms_t wait_ms;
+	time_ms_t limit_ms;
+} fw_update_stats_t;
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -108,6 +131,18 @@ typedef volatile struct bootloader_t {
 
 bootloader_t bootloader;
 
+/* Tells the application what this bootloader supports, see shared.h */
+
+static const bootloader_descriptor_t bootloader_descriptor
+__attribute__((used, section(".bootloader_descriptor"))) = {
+	.signature = { BOOTLOADER_DESCRIPTOR_SIGNATURE },
+	.capabilities = BOOTLOADER_CAPABILITY_STAGING,
+	.application_address = APPLICATION_LOAD_ADDRESS,
+	.application_size = APPLICATION_SIZE,
+	.reserved = { 0xFF, 0xFF, 0xFF, 0xFF }
+};
+static fw_update_stats_t fw_update_stats;
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -167,7 +202,7 @@ static void node_info_process(bl_timer_id id, void *context)
 	response.nodes_status.u8 = uavcan_pack(bootloader.sub_mode, NodeStatus, sub_mode)
 				   | uavcan_pack(bootloader.mode, NodeStatus, mode)
 				   | uavcan_pack(bootloader.health, NodeStatus, health);
-	response.nodes_status.vendor_specific_status_code = 0u;
+	response.nodes_status.vendor_specific_status_code = bootloader.vendor_specific_status_code;
 
 	board_get_hardware_version(&response.hardware_version.major,
 		&response.hardware_version.minor, response.hardware_version.unique_id,
@@ -244,33 +279,105 @@ static void node_status_process(bl_timer_id id, void *context)
 	message.u8 = uavcan_pack(bootloader.sub_mode, NodeStatus, sub_mode)
 		     | uavcan_pack(bootloader.mode, NodeStatus, mode)
 		     | uavcan_pack(bootloader.health, NodeStatus, health);
-	message.vendor_specific_status_code = 0u;
+	message.vendor_specific_status_code = bootloader.vendor_specific_status_code;
 	uavcan_tx_dsdl(DSDLMsgNodeStatus, &protocol, (const uint8_t *) &message, sizeof(uavcan_NodeStatus_t));
 }
 
+/****************************************************************************
+ * Name: report_progress
+ *
+ * Description:
+ *   This functions reports the progress of the firmware update at
+ *   OPT_PROGRESS_RATE_MS. It is called from the update loop rather than
+ *   from a timer, so that it does not compete for the mailbox with the
+ *   file read requests.
+ *
+ *   The NodeStatus vendor specific status code is set as follows:
+ *     bits 0-7  - Progress, percent of the image written.
+ *     bits 8-15 - Average throughput, in units of 256 bytes per second,
+ *                 saturated at 255.
+ *
+ *   If enabled with OPT_PROGRESS_DEBUG_MESSAGES, debug KeyValue messages
+ *   are published as well:
+ *     fwb - Bytes written.
+ *     fwi - Instantaneous throughput since the last report, bytes/s.
+ *     fwa - Average throughput, bytes/s.
+ *     fwr - Number of retried file read requests.
+ *     fwe - Time spent erasing the flash, Ms.
+ *     fwp - Time spent programming the flash, Ms.
+ *     fww - Time spent waiting for the file server responses, Ms.
+ *     fwl - Time spent waiting in the rate limit and in the back off, Ms.
+ *
+ * Input Parameters:
+ *   fw_image_size - The size the fw image file should be.
+ *   force         - Report now regardless of the rate.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void report_progress(size_t fw_image_size, bool force)
+{
+	time_ms_t now = timer_tic();
+	time_ms_t since_report = now - fw_update_stats.reported_at;
+	time_ms_t since_start = now - fw_update_stats.started_at;
+
+	if (!force && since_report < OPT_PROGRESS_RATE_MS) {
+		return;
+	}
+
+	uint32_t average = since_start ?
+			   fw_update_stats.bytes_written * 1000u / since_start : 0u;
+	uint32_t instantaneous = since_report ?
+				 (fw_update_stats.bytes_written - fw_update_stats.bytes_reported) * 1000u / since_report : 0u;
+	uint32_t percent = fw_image_size ?
+			   fw_update_stats.bytes_written * 100u / fw_image_size : 0u;
+	uint32_t average_256 = average / 256u;
+
+	bootloader.vendor_specific_status_code = (uint16_t)(percent |
+			((average_256 < 255u ? average_256 : 255u) << 8));
+
+#if OPT_PROGRESS_DEBUG_MESSAGES
+	uavcan_tx_key_value("fwb", fw_update_stats.bytes_written);
+	uavcan_tx_key_value("fwi", instantaneous);
+	uavcan_tx_key_value("fwa", average);
+	uavcan_tx_key_value("fwr", fw_update_stats.retries);
+	uavcan_tx_key_value("fwe", fw_update_stats.erase_ms);
+	uavcan_tx_key_value("fwp", fw_update_stats.program_ms);
+	uavcan_tx_key_value("fww", fw_update_stats.wait_ms);
+	uavcan_tx_key_value("fwl", fw_update_stats.limit_ms);
+#else
+	(void)instantaneous;
+#endif
+
+	fw_update_stats.reported_at = now;
+	fw_update_stats.bytes_reported = fw_update_stats.bytes_written;
+}
+
 /****************************************************************************
  * Name: find_descriptor
  *
  * Description:
- *   This functions looks through the application image in flash on 8 byte
+ *   This functions looks through a firmware image in flash on 8 byte
  *   aligned boundaries to find the Application firmware descriptor.
- *   Once it is found the bootloader.fw_image_descriptor is set to point to
- *   it.
  *
  *
  * Input Parameters:
- *   None
+ *   image      - The address of the firmware image in flash.
+ *   image_size - The size of the flash region occupied by the image.
  *
- * Returned State:
- *   If found bootloader.fw_image_descriptor points to the app_descriptor_t
- *   of the application firmware image.
- *   If not found bootloader.fw_image_descriptor = NULL
+ * Returned Value:
+ *   If found a pointer to the app_descriptor_t of the firmware image,
+ *   NULL otherwise.
  *
  ****************************************************************************/
 
-static void find_descriptor(void)
+static volatile app_descriptor_t *find_descriptor(volatile uint32_t *image,
+		size_t image_size)
 {
-	uint64_t *p = (uint64_t *)APPLICATION_LOAD_ADDRESS;
+	uint64_t *p = (uint64_t *)image;
+	uint64_t *last = (uint64_t *)((size_t)image + image_size - sizeof(uint64_t));
 	app_descriptor_t *descriptor = NULL;
 	union {
 		uint64_t ull;
@@ -284,49 +391,51 @@ static void find_descriptor(void)
 			descriptor = (app_descriptor_t *)p;
 			break;
 		}
-	} while (++p < APPLICATION_LAST_64BIT_ADDRRESS);
+	} while (++p < last);
 
-	bootloader.fw_image_descriptor = (volatile app_descriptor_t *)descriptor;
+	return (volatile app_descriptor_t *)descriptor;
 }
 
 /****************************************************************************
- * Name: is_app_valid
+ * Name: is_image_valid
  *
  * Description:
- *   This functions validates the applications image based on the validity of
- *   the Application firmware descriptor's crc and the value of the first word
- *   in the FLASH image.
+ *   This functions validates a firmware image based on the validity of
+ *   the Application firmware descriptor's crc and the value of the first
+ *   word of the image.
  *
  *
  * Input Parameters:
- *   first_word - the value read from the first word of the Application's
- *   in FLASH image.
+ *   image      - The address of the firmware image in flash.
+ *   image_size - The size of the flash region occupied by the image.
+ *   descriptor - The Application firmware descriptor of the image, may be
+ *                NULL.
+ *   first_word - the value read from the first word of the image.
  *
  * Returned Value:
- *   true if the application in flash is valid., false otherwise.
+ *   true if the image in flash is valid., false otherwise.
  *
  ****************************************************************************/
 
-static bool is_app_valid(uint32_t first_word)
+static bool is_image_valid(volatile uint32_t *image, size_t image_size,
+			   volatile app_descriptor_t *descriptor,
+			   uint32_t first_word)
 {
 	uint64_t crc;
 	size_t i, length, crc_offset;
 	uint32_t word;
 
-	find_descriptor();
-
-	if (!bootloader.fw_image_descriptor || first_word == 0xFFFFFFFFu) {
+	if (!descriptor || first_word == 0xFFFFFFFFu) {
 		return false;
 	}
 
-	length = bootloader.fw_image_descriptor->image_size;
+	length = descriptor->image_size;
 
-	if (length > APPLICATION_SIZE) {
+	if (length > image_size) {
 		return false;
 	}
 
-	crc_offset = (size_t)(&bootloader.fw_image_descriptor->image_crc) -
-		     (size_t) bootloader.fw_image;
+	crc_offset = (size_t)(&descriptor->image_crc) - (size_t) image;
 	crc_offset >>= 2u;
 	length >>= 2u;
 
@@ -338,7 +447,7 @@ static bool is_app_valid(uint32_t first_word)
 			word = 0u;
 
 		} else {
-			word = bootloader.fw_image[i];
+			word = image[i];
 		}
 
 		crc = crc64_add_word(crc, word);
@@ -346,11 +455,154 @@ static bool is_app_valid(uint32_t first_word)
 
 	crc ^= CRC64_OUTPUT_XOR;
 
+	return crc == descriptor->image_crc;
+}
+
+/****************************************************************************
+ * Name: is_app_valid
+ *
+ * Description:
+ *   This functions validates the applications image based on the validity of
+ *   the Application firmware descriptor's crc and the value of the first word
+ *   in the FLASH image.
+ *   Once the descriptor is found the bootloader.fw_image_descriptor is set
+ *   to point to it.
+ *
+ *
+ * Input Parameters:
+ *   first_word - the value read from the first word of the Application's
+ *   in FLASH image.
+ *
+ * Returned Value:
+ *   true if the application in flash is valid., false otherwise.
+ *
+ ****************************************************************************/
+
+static bool is_app_valid(uint32_t first_word)
+{
+	bootloader.fw_image_descriptor = find_descriptor(bootloader.fw_image,
+					 APPLICATION_SIZE);
+
 #if defined(DEBUG_APPLICATION_INPLACE)
-	return true;
+	return bootloader.fw_image_descriptor && first_word != 0xFFFFFFFFu;
 #endif
 
-	return crc == bootloader.fw_image_descriptor->image_crc;
+	return is_image_valid(bootloader.fw_image, APPLICATION_SIZE,
+			      bootloader.fw_image_descriptor, first_word);
+}
+
+/****************************************************************************
+ * Name: install_staged_image
+ *
+ * Description:
+ *   This functions checks whether the running application has downloaded
+ *   a valid firmware image into the free flash following its own image,
+ *   see bootloader_descriptor_t, and if so, copies it into the application
+ *   area. The staged image may overlap the area it is copied to, so the
+ *   copy proceeds page by page from the beginning, erasing each destination
+ *   page right before it is programmed; the source of a page is always
+ *   above it. The first word of the application is written last, so that
+ *   an interrupted copy leaves the application invalid, in which case the
+ *   image will be downloaded by the bootloader itself. Once the copy is
+ *   complete the remains of the staged image are erased.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   FLASH_OK if there was nothing to install or the staged image has been
+ *   installed, one of the flash_error_t otherwise.
+ *
+ ****************************************************************************/
+
+static flash_error_t install_staged_image(void)
+{
+	volatile uint32_t *staged;
+	volatile app_descriptor_t *descriptor;
+	flash_error_t status;
+	size_t staged_offset, staged_size, offset, length, page_end;
+	uint32_t word, first_word;
+
+	/* The staging area begins at the first page past the installed image */
+
+	if (!is_app_valid(bootloader.fw_image[0])) {
+		return FLASH_OK;
+	}
+
+	staged_offset = (bootloader.fw_image_descriptor->image_size + FLASH_PAGE_SIZE - 1u) &
+			~(size_t)(FLASH_PAGE_SIZE - 1u);
+
+	if (staged_offset >= APPLICATION_SIZE) {
+		return FLASH_OK;
+	}
+
+	staged_size = APPLICATION_SIZE - staged_offset;
+	staged = bootloader.fw_image + staged_offset / sizeof(uint32_t);
+	descriptor = find_descriptor(staged, staged_size);
+
+	if (!is_image_valid(staged, staged_size, descriptor, staged[0])) {
+		return FLASH_OK;
+	}
+
+	length = descriptor->image_size;
+	first_word = staged[0];
+
+	/* Skip the copy if it has already been done but not finalized */
+
+	if (bootloader.fw_image_descriptor->image_crc != descriptor->image_crc) {
+
+		board_indicate(fw_update_start);
+
+		for (offset = 0u; offset < length; offset = page_end) {
+			page_end = offset + FLASH_PAGE_SIZE;
+
+			status = bl_flash_erase(APPLICATION_LOAD_ADDRESS + offset, FLASH_PAGE_SIZE);
+
+			if (status != FLASH_OK) {
+				board_indicate(fw_update_erase_fail);
+				return status;
+			}
+
+			for (; offset < page_end && offset < length; offset += sizeof(uint32_t)) {
+				word = staged[offset / sizeof(uint32_t)];
+
+				/* Erased flash need not be programmed */
+
+				if (offset != 0u && word != 0xFFFFFFFFu) {
+					status = bl_flash_write(APPLICATION_LOAD_ADDRESS + offset,
+								(uint8_t *)&word, sizeof(word));
+
+					if (status != FLASH_OK) {
+						return status;
+					}
+				}
+			}
+		}
+
+		/* The staged copy of the first word may have been overwritten by now */
+
+		status = bl_flash_write(APPLICATION_LOAD_ADDRESS, (uint8_t *)&first_word,
+					sizeof(first_word));
+
+		if (status != FLASH_OK) {
+			return status;
+		}
+	}
+
+	/* Prevent Deja vu by erasing what is left of the staged image past the installed one */
+
+	offset = (length + FLASH_PAGE_SIZE - 1u) & ~(size_t)(FLASH_PAGE_SIZE - 1u);
+	page_end = staged_offset + offset;
+
+	if (page_end > APPLICATION_SIZE) {
+		page_end = APPLICATION_SIZE;
+	}
+
+	if (offset >= page_end) {
+		return FLASH_OK;
+	}
+
+	return bl_flash_erase(APPLICATION_LOAD_ADDRESS + offset, page_end - offset);
 }
 
 /****************************************************************************
@@ -683,6 +935,57 @@ static void file_getinfo(const uavcan_Path_t *fw_path,
 }
 
 
+/****************************************************************************
+ * Name: read_interval_increase
+ *
+ * Description:
+ *   This functions backs off the rate of the file read requests by
+ *   multiplicatively increasing the interval between the requests.
+ *
+ * Input Parameters:
+ *   read_ms - The current interval between the requests in Ms.
+ *
+ * Returned Value:
+ *   The new interval between the requests in Ms.
+ *
+ ****************************************************************************/
+
+static uint32_t read_interval_increase(uint32_t read_ms)
+{
+	read_ms *= 2u;
+	return (read_ms < READ_INTERVAL_MAX_MS) ? read_ms : READ_INTERVAL_MAX_MS;
+}
+
+/****************************************************************************
+ * Name: read_interval_decrease
+ *
+ * Description:
+ *   This functions probes for a higher rate of the file read requests by
+ *   decreasing the interval between the requests by a quarter of it, but
+ *   at least by READ_INTERVAL_STEP_MS. The decrease is proportional because
+ *   there are few requests per second at a long interval, so a fixed step
+ *   would take minutes to recover from a back off to READ_INTERVAL_MAX_MS.
+ *
+ * Input Parameters:
+ *   read_ms - The current interval between the requests in Ms.
+ *
+ * Returned Value:
+ *   The new interval between the requests in Ms.
+ *
+ ****************************************************************************/
+
+static uint32_t read_interval_decrease(uint32_t read_ms)
+{
+	uint32_t step = read_ms / READ_INTERVAL_STEP_DIVISOR;
+
+	if (step < READ_INTERVAL_STEP_MS) {
+		step = READ_INTERVAL_STEP_MS;
+	}
+
+	return (read_ms > READ_INTERVAL_MIN_MS + step) ?
+	       read_ms - step : READ_INTERVAL_MIN_MS;
+}
+
 /****************************************************************************
  * Name: file_read_and_program
  *
@@ -748,7 +1051,17 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 
 
 	/*
-	 * Rate limiting on read requests:
+	 * Rate limiting on read requests is adaptive: every timely response
+	 * decreases the interval between the requests, see
+	 * read_interval_decrease, while a failed request (a timeout or an
+	 * error response) doubles it. The interval is adapted once per request,
+	 * so a slow response that turns out to be an error is not counted twice.
+	 * A response slower than READ_LATENCY_CONGESTED_MS keeps the interval:
+	 * only one request is in flight at a time, so a slow server already
+	 * limits the rate by itself. The size of the request is fixed by the
+	 * protocol, so only the interval is adapted.
+	 *
+	 * The initial rate is conservative:
 	 *
 	 *  2/sec (500  ms) on a 125 Kbaud bus Speed = 1 1000/2
 	 *  4/sec (250  ms) on a 250 Kbaud bus Speed = 2 1000/4
@@ -757,6 +1070,8 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 	 */
 
 	uint32_t read_ms = 1000 >> bootloader.bus_speed;
+	time_ms_t sent_at;
+	time_ms_t started_at;
 	size_t length;
 
 	protocol.tail_init.u8  = 0;
@@ -770,6 +1085,7 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 		while (retries && uavcan_status != UavcanOk) {
 
 			timer_restart(tread, read_ms);
+			sent_at = timer_tic();
 
 			length = FixedSizeReadRequest + fw_path_length;
 			protocol.ser.source_node_id = g_server_node_id;
@@ -788,9 +1104,12 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 				protocol.tail.transfer_id++;
 			}
 
+			fw_update_stats.wait_ms += timer_tic() - sent_at;
+
 			if (uavcan_status != UavcanOk) {
 
 				retries--;
+				fw_update_stats.retries++;
 
 			} else {
 
@@ -802,6 +1121,7 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 					uavcan_status = UavcanError;
 
 					retries--;
+					fw_update_stats.retries++;
 
 					board_indicate(fw_update_invalid_response);
 
@@ -810,6 +1130,28 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 							      LOGMESSAGE_RESULT_FAIL);
 				}
 			}
+
+			/* Adapt the rate once per request */
+
+			if (uavcan_status != UavcanOk) {
+				read_ms = read_interval_increase(read_ms);
+
+			} else if (timer_tic() - sent_at <= READ_LATENCY_CONGESTED_MS) {
+				read_ms = read_interval_decrease(read_ms);
+			}
+
+			/* Back off before retrying */
+
+			if (retries && uavcan_status != UavcanOk) {
+				timer_restart(tread, read_ms);
+				started_at = timer_tic();
+
+				while (!timer_expired(tread)) {
+					timer_idle();
+				}
+
+				fw_update_stats.limit_ms += timer_tic() - started_at;
+			}
 		}
 
 		/* Exhausted retries */
@@ -839,23 +1181,39 @@ static flash_error_t file_read_and_program(const uavcan_Path_t *fw_path,
 			*(uint32_t *)data = 0xffffffff;
 		}
 
+		started_at = timer_tic();
+
 		flash_status = bl_flash_write(flash_address + request.offset ,
 					      data,
 					      length + (length & 1));
 
+		fw_update_stats.program_ms += timer_tic() - started_at;
+
 		request.offset  += length;
 
+		if (flash_status == FLASH_OK) {
+			fw_update_stats.bytes_written = request.offset;
+		}
+
+		report_progress(fw_image_size, false);
+
 		/* rate limit */
+		started_at = timer_tic();
+
 		while (!timer_expired(tread)) {
-			;
+			timer_idle();
 		}
 
+		fw_update_stats.limit_ms += timer_tic() - started_at;
+
 	} while (request.offset < fw_image_size &&
 		 length == sizeof(response.data)  &&
 		 flash_status == FLASH_OK);
 
 	timer_free(tread);
 
+	report_progress(fw_image_size, true);
+
 	/*
 	 * Return success if the last read succeeded, the last write succeeded, the
 	 * correct number of bytes were written, and the length of the last response
@@ -942,6 +1300,18 @@ static void application_run(size_t fw_image_size, bootloader_app_shared_t *commo
 		/* kill the systick interrupt */
 		putreg32(0, NVIC_SYSTICK_CTRL);
 
+		/*
+		 * Undo the idle sleep setup: no CAN interrupts, no wake up on
+		 * pending interrupts, and nothing left pending in the NVIC, since
+		 * the interrupts are still pended while they are disabled.
+		 */
+		can_deinit();
+		timer_deinit();
+
+		for (int irq = 0; irq < NR_IRQS - STM32_IRQ_FIRST; irq += 32) {
+			putreg32(0xffffffffu, NVIC_IRQ_CLRPEND(irq));
+		}
+
 		/* and set a specific LED pattern */
 		board_indicate(jump_to_app);
 
@@ -1063,6 +1433,10 @@ int main(int argc, char *argv[])
 	 */
 	bootloader.wait_for_getnodeinfo = board_should_wait_for_getnodeinfo();
 
+	/* Did the Application download a new image into the staging area? */
+
+	(void)install_staged_image();
+
 	/* Is the memory in the Application space occupied by a valid application? */
 
 	bootloader.app_valid = is_app_valid(bootloader.fw_image[0]);
@@ -1204,6 +1578,8 @@ int main(int argc, char *argv[])
 		if (timer_expired(tboot)) {
 			goto boot;
 		}
+
+		timer_idle();
 	}
 
 	/*
@@ -1267,8 +1643,14 @@ int main(int argc, char *argv[])
 
 	bootloader.app_valid = false;
 
+	memset(&fw_update_stats, 0, sizeof(fw_update_stats));
+	fw_update_stats.started_at = timer_tic();
+	fw_update_stats.reported_at = fw_update_stats.started_at;
+
 	status = bl_flash_erase(APPLICATION_LOAD_ADDRESS, APPLICATION_SIZE);
 
+	fw_update_stats.erase_ms = timer_tic() - fw_update_stats.started_at;
+
 	if (status != FLASH_OK) {
 		/* UAVCANBootloader_v0.3 #28.8: [Erase
 		 * Failed]:INDICATE_FW_UPDATE_ERASE_FAIL */
@@ -1334,7 +1716,7 @@ failure:
 	bl_timer_id tmr = timer_allocate(modeTimeout | modeStarted , OPT_RESTART_TIMEOUT_MS, 0);
 
 	while (!timer_expired(tmr)) {
-		;
+		timer_idle();
 	}
 
 	timer_free(tmr);
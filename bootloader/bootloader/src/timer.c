@@ -67,9 +67,15 @@ typedef struct {
 	bl_timer_cb_t         usr;
 	time_ms_t             count;
 	time_ms_t             reload;
+	time_ms_t             deadline;
 	bl_timer_ctl_t        ctl;
+	bl_timer_id           next;
 } bl_timer_t;
 
+/* Terminates the deadline queue */
+
+#define NO_TIMER ((bl_timer_id) -1)
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -81,6 +87,10 @@ typedef struct {
 static time_ms_t sys_tic;
 static bl_timer_t timers[OPT_BL_NUMBER_TIMERS];
 
+/* The running timers sorted by the deadline, the earliest first */
+
+static bl_timer_id queue_head;
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -93,6 +103,93 @@ const bl_timer_cb_t null_cb = { 0, 0 };
  * Private Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: queue_remove
+ *
+ * Description:
+ *   Removes the timer from the deadline queue if it is queued.
+ *   Must be called with the interrupts disabled.
+ *
+ * Input Parameters:
+ *   id - Returned from timer_allocate;
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void queue_remove(bl_timer_id id)
+{
+	bl_timer_id *p = &queue_head;
+
+	while (*p != NO_TIMER) {
+		if (*p == id) {
+			*p = timers[id].next;
+			break;
+		}
+
+		p = &timers[*p].next;
+	}
+
+	timers[id].next = NO_TIMER;
+}
+
+/****************************************************************************
+ * Name: queue_insert
+ *
+ * Description:
+ *   Inserts the timer into the deadline queue keeping it sorted, so that
+ *   the system tick only needs to look at the head of the queue.
+ *   Timers with the same deadline are run in the order of insertion.
+ *   Must be called with the interrupts disabled.
+ *
+ * Input Parameters:
+ *   id - Returned from timer_allocate;
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void queue_insert(bl_timer_id id)
+{
+	bl_timer_id *p = &queue_head;
+
+	while (*p != NO_TIMER &&
+	       (int32_t)(timers[*p].deadline - timers[id].deadline) <= 0) {
+		p = &timers[*p].next;
+	}
+
+	timers[id].next = *p;
+	*p = id;
+}
+
+/****************************************************************************
+ * Name: timer_arm
+ *
+ * Description:
+ *   Sets the deadline of the timer from its count and queues it.
+ *   A count of 0 leaves the timer expired.
+ *   Must be called with the interrupts disabled.
+ *
+ * Input Parameters:
+ *   id - Returned from timer_allocate;
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+static void timer_arm(bl_timer_id id)
+{
+	queue_remove(id);
+
+	if (timers[id].count != 0) {
+		timers[id].deadline = sys_tic + timers[id].count;
+		queue_insert(id);
+	}
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -120,9 +217,10 @@ time_ms_t timer_tic(void)
  * Name: sched_process_timer
  *
  * Description:
- *   Called by Nuttx on the ISR of the SysTic. This function run the list of
- *   timers. It deducts that amount of the time of a system tick from the
- *   any timers that are in use and running.
+ *   Called by Nuttx on the ISR of the SysTic. This function runs the timers
+ *   whose deadline has been reached. Since the running timers are kept in
+ *   a queue sorted by the deadline, only the head of the queue needs to be
+ *   checked on a tick when no timer expires.
  *
  *   Depending on the mode of the timer, the appropriate actions is taken on
  *   expiration.
@@ -144,74 +242,80 @@ void sched_process_timer(void)
 
 	sys_tic++;
 
+	while (queue_head != NO_TIMER &&
+	       (int32_t)(sys_tic - timers[queue_head].deadline) >= 0) {
 
-	/* todo:May need a X tick here is threads run long */
+		bl_timer_id t = queue_head;
 
-	time_ms_t ms_elapsed = (CONFIG_USEC_PER_TICK / 1000);
+		queue_head = timers[t].next;
+		timers[t].next = NO_TIMER;
 
-	/* Walk the time list from High to low and */
+		/* Mark it expired */
 
-	bl_timer_id t;
-
-	for (t =  arraySize(timers) - 1; (int8_t) t >= 0; t--) {
-
-
-		/* Timer in use and running */
+		timers[t].count = 0;
 
-		if ((timers[t].ctl & (inuse | running)) == (inuse | running)) {
+		/* Now perform action based on mode */
 
-			/* Is it NOT already expired nor about to expire ?*/
+		switch (timers[t].ctl & ~(inuse | running)) {
 
-			if (timers[t].count != 0) {
-
-				/* Is it off in future */
-				if (timers[t].count > ms_elapsed) {
+		case OneShot: {
+				bl_timer_cb_t user = timers[t].usr;
+				memset(&timers[t], 0, sizeof(timers[t]));
+				timers[t].next = NO_TIMER;
 
-					/* Just remove the amount attributed to the tick */
-
-					timers[t].count -= ms_elapsed;
-					continue;
+				if (user.cb) {
+					user.cb(t, user.context);
 				}
+			}
+			break;
 
-				/* it has expired now or less than a tick ago */
-
-				/* Mark it expired */
-
-				timers[t].count = 0;
-
-				/* Now perform action based on mode */
-
-				switch (timers[t].ctl & ~(inuse | running)) {
-
-				case OneShot: {
-						bl_timer_cb_t user = timers[t].usr;
-						memset(&timers[t], 0, sizeof(timers[t]));
+		case Repeating:
+			timers[t].count = timers[t].reload;
 
-						if (user.cb) {
-							user.cb(t, user.context);
-						}
-					}
-					break;
+			/* Advance from the deadline rather than from now to avoid drift */
 
-				case Repeating:
-					timers[t].count = timers[t].reload;
+			if (timers[t].count != 0) {
+				timers[t].deadline += timers[t].reload;
+				queue_insert(t);
+			}
 
-				/* fall through to callback */
-				case Timeout:
-					if (timers[t].usr.cb) {
-						timers[t].usr.cb(t, timers[t].usr.context);
-					}
+		/* fall through to callback */
+		case Timeout:
+			if (timers[t].usr.cb) {
+				timers[t].usr.cb(t, timers[t].usr.context);
+			}
 
-					break;
+			break;
 
-				default:
-					break;
-				}
-			}
+		default:
+			break;
 		}
 	}
 }
 
+/****************************************************************************
+ * Name: timer_idle
+ *
+ * Description:
+ *   Puts the CPU to sleep until the next event. The events are the
+ *   system tick that drives the timers and, since SEVONPEND is set by
+ *   timer_init, any interrupt becoming pending even if it is not enabled,
+ *   such as a CAN frame arrival. It is used in place of busy waiting.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void timer_idle(void)
+{
+	__asm volatile("dsb");
+	__asm volatile("wfe");
+}
+
 /****************************************************************************
  * Name: timer_allocate
  *
@@ -220,8 +324,8 @@ void sched_process_timer(void)
  *   allocation as the data for the timer are compile time generated.
  *   See OPT_BL_NUMBER_TIMERS
  *
- *   There is an inherent priority to the timers in that the first timer
- *   allocated is the first timer run per tick.
+ *   Timers that expire on the same tick are run in the order they were
+ *   started.
  *
  *   There are 3 modes of operation for the timers. All modes support an
  *   optional call back on expiration.
@@ -269,6 +373,12 @@ bl_timer_id timer_allocate(bl_timer_modes_t mode, time_ms_t msfromnow,
 			timers[t].count = msfromnow;
 			timers[t].usr = fc ? *fc : null_cb;
 			timers[t].ctl = (mode & (modeMsk | running)) | (inuse);
+			timers[t].next = NO_TIMER;
+
+			if (timers[t].ctl & running) {
+				timer_arm(t);
+			}
+
 			break;
 		}
 	}
@@ -298,7 +408,9 @@ void timer_free(bl_timer_id id)
 {
 	assert(id >= 0 && id < arraySize(timers));
 	irqstate_t s = irqsave();
+	queue_remove(id);
 	memset(&timers[id], 0, sizeof(timers[id]));
+	timers[id].next = NO_TIMER;
 	irqrestore(s);
 }
 
@@ -323,6 +435,7 @@ void timer_start(bl_timer_id id)
 	irqstate_t s = irqsave();
 	timers[id].count = timers[id].reload;
 	timers[id].ctl |= running;
+	timer_arm(id);
 	irqrestore(s);
 
 }
@@ -346,6 +459,7 @@ void timer_stop(bl_timer_id id)
 	assert(id >= 0 && id < arraySize(timers) && (timers[id].ctl & inuse));
 	irqstate_t s = irqsave();
 	timers[id].ctl &= ~running;
+	queue_remove(id);
 	irqrestore(s);
 
 }
@@ -397,6 +511,7 @@ void timer_restart(bl_timer_id id, time_ms_t ms)
 	irqstate_t s = irqsave();
 	timers[id].count = timers[id].reload = ms;
 	timers[id].ctl |= running;
+	timer_arm(id);
 	irqrestore(s);
 }
 
@@ -463,5 +578,38 @@ void timer_init(void)
 
 	sys_tic = 0;
 	memset(timers, 0, sizeof(timers));
+
+	bl_timer_id t;
+
+	for (t = 0; t < arraySize(timers); t++) {
+		timers[t].next = NO_TIMER;
+	}
+
+	queue_head = NO_TIMER;
+
+	/* Let pending interrupts wake up timer_idle even if they are disabled */
+
+	modifyreg32(NVIC_SYSCON, 0, NVIC_SYSCON_SEVONPEND);
 }
 
+/****************************************************************************
+ * Name: timer_deinit
+ *
+ * Description:
+ *   Called before jumping to the application to undo the sleep setup of
+ *   timer_init: SEVONPEND is cleared and a pending system tick is
+ *   discarded. The system tick must be stopped beforehand.
+ *
+ * Input Parameters:
+ *   None
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+
+void timer_deinit(void)
+{
+	modifyreg32(NVIC_SYSCON, NVIC_SYSCON_SEVONPEND, 0);
+	putreg32(NVIC_INTCTRL_PENDSTCLR, NVIC_INTCTRL);
+}
@@ -492,8 +492,22 @@ uavcan_error_t uavcan_rx_dsdl(uavcan_dsdl_t dsdl, uavcan_protocol_t *protocol,
 		uint8_t payload[CanPayloadLength];
 		size_t rx_length;
 
-		if (!uavcan_rx(&rx_protocol, payload, &rx_length, pdsdl->fifo)
-		    || BadTailState == (rx_protocol.tail_init.u8 & BadTailState)
+		if (!uavcan_rx(&rx_protocol, payload, &rx_length, pdsdl->fifo)) {
+
+			/*
+			 * Sleep until a frame arrives or the timeout is processed.
+			 * A zero timeout is a passive receive attempt, which is
+			 * also made from the system tick ISR, so it must not sleep.
+			 */
+
+			if (timeout_ms != 0) {
+				timer_idle();
+			}
+
+			continue;
+		}
+
+		if (BadTailState == (rx_protocol.tail_init.u8 & BadTailState)
 		    || ((rx_protocol.id.u32 ^ protocol->id.u32) & masks.id.u32)
 		    || ((rx_protocol.tail_init.u8 ^ protocol->tail_init.u8) & masks.tail_init.u8)) {
 			continue;
@@ -707,6 +721,82 @@ void uavcan_tx_log_message(uavcan_LogMessageConsts_t level, uint8_t stage,
 	uavcan_tx(&protocol, payload, frame_len, dsdl->mailbox);
 }
 
+/****************************************************************************
+ * Name: float32_from_uint32
+ *
+ * Description:
+ *   This functions converts an unsigned integer into the IEEE 754 binary32
+ *   representation using integer operations only, so that the software
+ *   floating point library is not linked into the bootloader. Values
+ *   above 2^24 are truncated to 24 significant bits.
+ *
+ * Input Parameters:
+ *   value   - The value to convert.
+ *
+ * Returned Value:
+ *   The binary32 representation of the value.
+ *
+ ****************************************************************************/
+static uint32_t float32_from_uint32(uint32_t value)
+{
+	uint32_t exponent = 31u;
+
+	if (value == 0u) {
+		return 0u;
+	}
+
+	while ((value & 0x80000000u) == 0u) {
+		value <<= 1;
+		exponent--;
+	}
+
+	/* The leading one is implied */
+
+	return ((exponent + 127u) << 23) | ((value >> 8) & 0x007fffffu);
+}
+
+/****************************************************************************
+ * Name: uavcan_tx_key_value
+ *
+ * Description:
+ *   This functions sends uavcan debug KeyValue type data. The key is
+ *   limited to 3 characters, so that the message fits in a single frame.
+ *   The value is an integer, it is converted to the float32 of the message
+ *   by float32_from_uint32.
+ *
+ * Input Parameters:
+ *   key     - The name of the value, up to 3 characters long.
+ *   value   - The value.
+ *
+ * Returned Value:
+ *   None
+ *
+ ****************************************************************************/
+void uavcan_tx_key_value(const char *key, uint32_t value)
+{
+	static uint8_t transfer_id;
+
+	uavcan_KeyValue_t message;
+	uavcan_protocol_t protocol;
+	size_t key_length;
+
+	protocol.tail.transfer_id = transfer_id++;
+
+	const dsdl_t *dsdl = load_dsdl_protocol(DSDLMsgKeyValue, MessageOut, &protocol, 0);
+
+	message.value = float32_from_uint32(value);
+
+	for (key_length = 0; key_length < sizeof(message.key) && key[key_length]; key_length++) {
+		message.key[key_length] = key[key_length];
+	}
+
+	/* The key is the last field, so its length is implied by the frame length */
+
+	uint8_t payload[CanPayloadLength];
+	memcpy(payload, &message, sizeof(message.value) + key_length);
+	uavcan_tx(&protocol, payload, sizeof(message.value) + key_length, dsdl->mailbox);
+}
+
 /****************************************************************************
  * Name: uavcan_tx_allocation_message
  *
@@ -165,6 +165,13 @@
 
 #define OPT_RESTART_TIMEOUT_MS 20000u
 
+/* Firmware update progress is reported in NodeStatus at this rate; if
+ * OPT_PROGRESS_DEBUG_MESSAGES is non zero, the detailed statistics are
+ * also published as debug KeyValue messages.
+ */
+#define OPT_PROGRESS_RATE_MS        1000
+#define OPT_PROGRESS_DEBUG_MESSAGES 1
+
 /* Reserved for the Booloader */
 #define OPT_BOOTLOADER_SIZE_IN_K (1024*16)
 
@@ -37,6 +37,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cmath>
 #include <ch.h>
 #include <hal.h>
 #include <shell.h>
@@ -44,6 +45,9 @@
 #include <unistd.h>
 #include <board/board.hpp>
 #include <motor/motor.h>
+#include <motor/bench.h>
+#include <rtos_trace.h>
+#include <thread_stats.h>
 #include <uavcan_node/uavcan_node.hpp>
 #include <zubax_chibios/util/base64.hpp>
 #include "console.hpp"
@@ -86,8 +90,41 @@ static void cmd_uavcan(BaseSequentialStream *, int, char**)
 	uavcan_node::print_status();
 }
 
+static void print_thread_stats()
+{
+	// See thread_stats.h
+	puts("Threads: the interrupts are charged to the thread they preempt; the total time is since the release");
+	for (unsigned i = 0; i < THREAD_STATS_NUM_IDS; i++) {
+		const auto id = static_cast<thread_stats_id>(i);
+		thread_stats st;
+		if (!thread_stats_get(id, &st)) {
+			continue;
+		}
+		std::printf("Thread %-6s load %.2f%%, iterations %lu, deadline misses %lu, max %lu us CPU, %lu us total\n",
+		            thread_stats_get_name(id), st.load * 100.0F, (unsigned long)st.num_iterations,
+		            (unsigned long)st.num_deadline_misses, (unsigned long)st.max_cpu_usec,
+		            (unsigned long)st.max_response_usec);
+		std::printf("    CPU us:");
+		for (unsigned b = 0; b < THREAD_STATS_NUM_BUCKETS; b++) {
+			const auto limit = thread_stats_get_bucket_limit_usec(b);
+			if (limit > 0) {
+				std::printf(" <%lu:%lu", (unsigned long)limit, (unsigned long)st.histogram[b]);
+			} else {
+				std::printf(" more:%lu", (unsigned long)st.histogram[b]);
+			}
+		}
+		std::printf("\n");
+	}
+}
+
 static void cmd_stat(BaseSequentialStream *chp, int argc, char *argv[])
 {
+	if ((argc > 0) && !strcmp(argv[0], "reset")) {
+		thread_stats_reset();
+		puts("Thread stats reset");
+		return;
+	}
+
 	float voltage = 0, current = 0;
 	motor_get_input_voltage_current(&voltage, &current);
 
@@ -95,6 +132,15 @@ static void cmd_stat(BaseSequentialStream *chp, int argc, char *argv[])
 	std::printf("RPM/DC        %-9u %f\n", motor_get_rpm(), motor_get_duty_cycle());
 	std::printf("Active limits %i\n", motor_get_limit_mask());
 	std::printf("ZC failures   %lu\n", (unsigned long)motor_get_zc_failures_since_start());
+
+	float phase_currents[3] = {};
+	if (motor_get_phase_currents(phase_currents)) {
+		std::printf("Phase A/B/C   %-9f %-9f %f\n", phase_currents[0], phase_currents[1], phase_currents[2]);
+	} else {
+		puts("Phase A/B/C   n/a");      // Only measured with sinusoidal commutation
+	}
+
+	print_thread_stats();
 }
 
 static void cmd_test(BaseSequentialStream *chp, int argc, char *argv[])
@@ -216,6 +262,125 @@ static void cmd_startstop(BaseSequentialStream *chp, int argc, char *argv[])
 	printf("Finished %d cycles of %d\n", current_cycle, num_cycles);
 }
 
+static void cmd_bench(BaseSequentialStream *chp, int argc, char *argv[])
+{
+	static const int TTL_MS = 500;
+	static const unsigned UPDATE_PERIOD_MS = 10;
+	static const float SETTLE_BAND = 0.05F;
+	static const unsigned ARM_TIMEOUT_MS = 10000;
+
+	static bench_recorder recorder;
+
+	if (argc == 0) {
+		puts("Usage:\n"
+			"  bench <scenario> [dump]\n"
+			"  bench arm    (valid for one run that starts within 10 seconds)\n"
+			"Scenarios:");
+		for (unsigned i = 0; i < bench_num_scenarios; i++) {
+			std::printf("  %-10s %s\n", bench_scenarios[i].name, bench_scenarios[i].description);
+		}
+		return;
+	}
+
+	// Safety check; a scenario runs the motor unattended for a long time, so every run has to be armed anew
+	static bool _armed = false;
+	static systime_t _armed_at = 0;
+	if (!strcmp(argv[0], "arm")) {
+		_armed = true;
+		_armed_at = chVTGetSystemTime();
+		puts("OK");
+		return;
+	}
+	const bool armed = _armed && (ST2MS(chVTTimeElapsedSinceX(_armed_at)) < ARM_TIMEOUT_MS);
+	_armed = false;
+	if (!armed) {
+		puts("Error: Not armed");
+		return;
+	}
+
+	const bench_scenario* const scenario = bench_find_scenario(argv[0]);
+	if (scenario == nullptr) {
+		puts("Error: No such scenario");
+		return;
+	}
+	const bool dump = (argc > 1) && !strcmp(argv[1], "dump");
+
+	// All scenarios start from standstill, so that the results are comparable
+	if (!motor_is_idle()) {
+		puts("Error: Motor is running");
+		return;
+	}
+
+	auto print_metric = [](float value, int width, int precision) {
+		if (std::isfinite(value)) {
+			std::printf(" %*.*f", width, precision, double(value));
+		} else {
+			std::printf(" %*s", width, "-");
+		}
+	};
+
+	std::printf("%-4s %-10s %9s %9s %9s %11s %9s %8s %7s %8s\n", "Step", "Setpoint", "RPM from", "RPM to",
+	            "Rise,s", "Overshoot,%", "Settle,s", "Peak,A", "Desyncs", "ZC fails");
+
+	for (unsigned i = 0; i < scenario->num_steps; i++) {
+		const bench_step& step = scenario->steps[i];
+
+		bench_recorder_reset(&recorder);
+		motor_set_bench_recorder(&recorder);
+
+		bool blocked = false;
+		const systime_t started_at = chVTGetSystemTime();
+		while (true) {
+			const unsigned elapsed_ms = ST2MS(chVTTimeElapsedSinceX(started_at));
+			if (elapsed_ms >= unsigned(step.ramp_ms + step.hold_ms)) {
+				break;
+			}
+
+			const float setpoint = bench_get_setpoint(scenario, i, elapsed_ms);
+			if (step.kind == BENCH_SETPOINT_DC) {
+				motor_set_duty_cycle(setpoint, TTL_MS);
+			} else {
+				motor_set_rpm(unsigned(setpoint), TTL_MS);
+			}
+
+			blocked = motor_is_blocked();
+			if (blocked) {
+				break;
+			}
+			chThdSleepMilliseconds(UPDATE_PERIOD_MS);
+		}
+
+		motor_set_bench_recorder(nullptr);
+
+		bench_metrics m;
+		bench_compute_metrics(&recorder, SETTLE_BAND, &m);
+
+		std::printf("%-4u %-3s %6.*f %9.0f %9.0f", i + 1, (step.kind == BENCH_SETPOINT_DC) ? "dc" : "rpm",
+		            (step.kind == BENCH_SETPOINT_DC) ? 2 : 0, double(step.setpoint),
+		            double(m.rpm_initial), double(m.rpm_final));
+		print_metric(m.rise_time, 9, 3);
+		print_metric(m.overshoot_pct, 11, 1);
+		print_metric(m.settling_time, 9, 3);
+		std::printf(" %8.1f %7u %8lu%s\n", double(m.peak_current), m.num_desyncs, (unsigned long)m.num_zc_failures,
+		            (step.ramp_ms > 0) ? "  ramp" : "");
+
+		if (dump) {
+			puts("time_ms,rpm,current");
+			for (unsigned k = 0; k < recorder.num_samples; k++) {
+				const bench_sample& s = recorder.samples[k];
+				std::printf("%.3f,%u,%.2f\n", double(s.time_usec) / 1e3, unsigned(s.rpm), double(s.current_10ma) / 1e2);
+			}
+		}
+
+		if (blocked) {
+			puts("ABORTED: the motor controller has given up starting");
+			break;
+		}
+	}
+
+	motor_stop();
+}
+
 static void cmd_md(BaseSequentialStream *chp, int argc, char *argv[])
 {
 	motor_print_debug_info();
@@ -226,6 +391,11 @@ static void cmd_m(BaseSequentialStream *chp, int argc, char *argv[])
 	motor_execute_cli_command(argc, (const char**)argv);
 }
 
+static void cmd_trace(BaseSequentialStream *chp, int argc, char *argv[])
+{
+	rtos_trace_execute_cli_command(argc, (const char**)argv);
+}
+
 static void cmd_zubax_id(BaseSequentialStream *chp, int argc, char *argv[])
 {
 	if (argc == 0) {
@@ -290,8 +460,10 @@ static const ShellCommand _commands[] =
 	COMMAND(dc)
 	COMMAND(rpm)
 	COMMAND(startstop)
+	COMMAND(bench)
 	COMMAND(md)
 	COMMAND(m)
+	COMMAND(trace)
 	COMMAND(zubax_id)
 	COMMAND(uavcan)
 	{NULL, NULL}
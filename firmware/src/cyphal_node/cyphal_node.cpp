@@ -0,0 +1,1059 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/*
+ * Cyphal/CAN implementation of the node interface defined in uavcan_node.hpp.
+ * This is an alternative to the UAVCAN v0 stack, selected at build time; see the Makefile.
+ * The ESC interface follows the UDRAL ESC service: the setpoint is taken from a vector indexed by esc_index,
+ * the readiness subject arms the motor, the feedback is published in response to each setpoint.
+ */
+
+#include "transport.hpp"
+#include <uavcan_node/uavcan_node.hpp>
+#include <uavcan_node/bootloader_interface.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ch.hpp>
+#include <board/board.hpp>
+#include <zubax_chibios/os.hpp>
+#include <zubax_chibios/config/config.h>	// TODO: remove dependency on the implementation details
+#include <uavcan_stm32/bxcan.hpp>
+#include <unistd.h>
+#include <motor/motor.h>
+#include <thread_stats.h>
+
+namespace uavcan_node
+{
+namespace
+{
+
+constexpr std::uint16_t SubjectIDMax = 8191;
+constexpr std::uint16_t PortIDUnset = 65535;
+
+constexpr std::uint16_t SubjectHeartbeat = 7509;
+constexpr std::uint16_t SubjectNodeIDAllocation = 8166;
+
+constexpr std::uint16_t ServiceRegisterAccess = 384;
+constexpr std::uint16_t ServiceRegisterList = 385;
+constexpr std::uint16_t ServiceGetInfo = 430;
+constexpr std::uint16_t ServiceExecuteCommand = 435;
+
+constexpr unsigned TxTimeoutMSec = 100;
+constexpr unsigned CommandTransferIDTimeoutMSec = 50;   ///< Failover backstop, shorter than cmd_ttl_ms
+constexpr unsigned ReadinessTimeoutMSec = 1000;
+constexpr unsigned PowerPublicationPeriodMSec = 100;
+
+enum class Health : std::uint8_t
+{
+	Nominal,
+	Advisory,
+	Caution,
+	Warning
+};
+
+enum class Readiness : std::uint8_t
+{
+	Sleep = 0,
+	Standby = 2,
+	Engaged = 3
+};
+
+/*
+ * The RX queue holds the frames that arrive while the node thread isn't spinning. At the full load of the bus
+ * at 1 Mbit/s, which is the worst case, a frame arrives every 67 us: the shortest frame with an extended ID and
+ * a single data byte (the tail byte) takes 67 bit times, or more with bit stuffing.
+ */
+constexpr unsigned RxQueueCapacity = 32;
+constexpr unsigned MinFrameIntervalUSec = 67;
+
+constexpr unsigned SpinDurationMSec = 10;
+/*
+ * A longer iteration of the spin loop may overflow the RX queue at the full bus load, because the frames are
+ * processed only while spinning; it means that the thread was starved, or that a background task stalled it.
+ */
+constexpr unsigned SpinDeadlineUSec = SpinDurationMSec * 1000 + RxQueueCapacity * MinFrameIntervalUSec;
+
+uavcan_stm32::CanInitHelper<RxQueueCapacity> can;
+
+const char* const ParamNameNodeID = "uavcan_node_id";
+
+os::config::Param<unsigned> param_node_id(ParamNameNodeID,     0,      0,    125);
+os::config::Param<unsigned> param_esc_index("esc_index",        0,      0,     15);
+os::config::Param<unsigned> param_cmd_ttl_ms("cmd_ttl_ms",    200,    100,   5000);
+
+/*
+ * Port identifiers; 65535 means that the port is not used.
+ * The standard register names (uavcan.sub.setpoint.id etc.) are mapped onto these parameters.
+ */
+os::config::Param<unsigned> param_sub_setpoint_id("cy_sp_id",   65535,  0,  65535);
+os::config::Param<unsigned> param_sub_readiness_id("cy_rdy_id", 65535,  0,  65535);
+os::config::Param<unsigned> param_pub_feedback_id("cy_fb_id",   65535,  0,  65535);
+os::config::Param<unsigned> param_pub_power_id("cy_pwr_id",     65535,  0,  65535);
+
+struct PortRegister
+{
+	const char* id_name;
+	const char* type_name;
+	const char* type;
+	const char* param_name;
+};
+
+const PortRegister port_registers[] = {
+	{ "uavcan.sub.setpoint.id",  "uavcan.sub.setpoint.type",
+	  "reg.udral.service.actuator.common.sp.Vector31.0.1", "cy_sp_id" },
+	{ "uavcan.sub.readiness.id", "uavcan.sub.readiness.type",
+	  "reg.udral.service.common.Readiness.0.1", "cy_rdy_id" },
+	{ "uavcan.pub.feedback.id",  "uavcan.pub.feedback.type",
+	  "reg.udral.service.actuator.common.Feedback.0.1", "cy_fb_id" },
+	{ "uavcan.pub.power.id",     "uavcan.pub.power.type",
+	  "reg.udral.physics.electricity.PowerTs.0.1", "cy_pwr_id" }
+};
+
+constexpr unsigned NumPortRegisters = sizeof(port_registers) / sizeof(port_registers[0]);
+
+const char* const RegisterNameNodeID = "uavcan.node.id";
+
+auto node_status_health = Health::Nominal;
+
+std::uint32_t active_can_bus_bit_rate = 0;
+
+std::uint16_t get_subject_id(const os::config::Param<unsigned>& param)
+{
+	const unsigned x = param.get();
+	return (x <= SubjectIDMax) ? std::uint16_t(x) : PortIDUnset;
+}
+
+/*
+ * Serialization helpers; all values are little endian.
+ */
+class Writer
+{
+	std::uint8_t* const buf_;
+	const unsigned capacity_;
+	unsigned size_ = 0;
+
+public:
+	Writer(std::uint8_t* buf, unsigned capacity)
+		: buf_(buf)
+		, capacity_(capacity)
+	{ }
+
+	void u8(std::uint8_t x)
+	{
+		if (size_ < capacity_) {
+			buf_[size_++] = x;
+		}
+	}
+
+	void u16(std::uint16_t x) { uint(x, 2); }
+	void u32(std::uint32_t x) { uint(x, 4); }
+	void u64(std::uint64_t x) { uint(x, 8); }
+
+	void uint(std::uint64_t x, unsigned num_bytes)
+	{
+		for (unsigned i = 0; i < num_bytes; i++) {
+			u8(std::uint8_t(x >> (i * 8)));
+		}
+	}
+
+	void f32(float x)
+	{
+		std::uint32_t bits = 0;
+		static_assert(sizeof(bits) == sizeof(x), "float32");
+		std::memcpy(&bits, &x, sizeof(bits));
+		u32(bits);
+	}
+
+	void bytes(const void* data, unsigned len)
+	{
+		for (unsigned i = 0; i < len; i++) {
+			u8(static_cast<const std::uint8_t*>(data)[i]);
+		}
+	}
+
+	unsigned size() const { return size_; }
+};
+
+/**
+ * Reading beyond the end of the buffer yields zeros, as required by the implicit zero extension rule.
+ */
+class Reader
+{
+	const std::uint8_t* const buf_;
+	const unsigned size_;
+	unsigned offset_ = 0;
+
+public:
+	Reader(const std::uint8_t* buf, unsigned size)
+		: buf_(buf)
+		, size_(size)
+	{ }
+
+	std::uint8_t u8()
+	{
+		const std::uint8_t x = (offset_ < size_) ? buf_[offset_] : 0;
+		offset_++;
+		return x;
+	}
+
+	std::uint16_t u16() { return std::uint16_t(uint(2)); }
+	std::uint32_t u32() { return std::uint32_t(uint(4)); }
+	std::uint64_t u64() { return uint(8); }
+
+	std::uint64_t uint(unsigned num_bytes)
+	{
+		std::uint64_t x = 0;
+		for (unsigned i = 0; i < num_bytes; i++) {
+			x |= std::uint64_t(u8()) << (i * 8);
+		}
+		return x;
+	}
+
+	float f32()
+	{
+		const std::uint32_t bits = u32();
+		float x = 0;
+		std::memcpy(&x, &bits, sizeof(x));
+		return x;
+	}
+
+	double f64()
+	{
+		const std::uint64_t bits = u64();
+		double x = 0;
+		static_assert(sizeof(bits) == sizeof(x), "float64");
+		std::memcpy(&x, &bits, sizeof(x));
+		return x;
+	}
+
+	void skip(unsigned len) { offset_ += len; }
+
+	bool isValid() const { return offset_ <= size_; }
+};
+
+float float16_to_float(std::uint16_t h)
+{
+	const int exponent = (h >> 10) & 0x1F;
+	const int mantissa = h & 0x3FF;
+
+	float x = 0.0F;
+	if (exponent == 0) {
+		x = std::ldexp(float(mantissa), -24);
+	} else if (exponent == 31) {
+		x = (mantissa == 0) ? INFINITY : NAN;
+	} else {
+		x = std::ldexp(float(mantissa | 0x400), exponent - 25);
+	}
+	return (h & 0x8000U) ? -x : x;
+}
+
+/*
+ * Register value union, uavcan.register.Value.1.0
+ */
+enum class ValueTag : std::uint8_t
+{
+	Empty,
+	String,
+	Unstructured,
+	Bit,
+	Integer64,
+	Integer32,
+	Integer16,
+	Integer8,
+	Natural64,
+	Natural32,
+	Natural16,
+	Natural8,
+	Real64,
+	Real32,
+	Real16
+};
+
+/**
+ * Extracts the first element of a numeric or boolean register value.
+ */
+bool decode_first_numeric_value(Reader& reader, float& out_value)
+{
+	const auto tag = ValueTag(reader.u8());
+
+	unsigned len = 0;
+	switch (tag) {
+	case ValueTag::Bit:
+	case ValueTag::Integer8:
+	case ValueTag::Natural8: {
+		len = reader.u16();
+		break;
+	}
+	case ValueTag::Integer64:
+	case ValueTag::Integer32:
+	case ValueTag::Integer16:
+	case ValueTag::Natural64:
+	case ValueTag::Natural32:
+	case ValueTag::Natural16:
+	case ValueTag::Real64:
+	case ValueTag::Real32:
+	case ValueTag::Real16: {
+		len = reader.u8();
+		break;
+	}
+	default: {
+		return false;
+	}
+	}
+
+	if (len == 0) {
+		return false;
+	}
+
+	switch (tag) {
+	case ValueTag::Bit:       out_value = float(reader.u8() & 1U);                          break;
+	case ValueTag::Integer64: out_value = float(std::int64_t(reader.u64()));                break;
+	case ValueTag::Integer32: out_value = float(std::int32_t(reader.u32()));                break;
+	case ValueTag::Integer16: out_value = float(std::int16_t(reader.u16()));                break;
+	case ValueTag::Integer8:  out_value = float(std::int8_t(reader.u8()));                  break;
+	case ValueTag::Natural64: out_value = float(reader.u64());                              break;
+	case ValueTag::Natural32: out_value = float(reader.u32());                              break;
+	case ValueTag::Natural16: out_value = float(reader.u16());                              break;
+	case ValueTag::Natural8:  out_value = float(reader.u8());                               break;
+	case ValueTag::Real64:    out_value = float(reader.f64());                              break;
+	case ValueTag::Real32:    out_value = reader.f32();                                     break;
+	case ValueTag::Real16:    out_value = float16_to_float(reader.u16());                   break;
+	default:                  return false;
+	}
+
+	return reader.isValid() && std::isfinite(out_value);
+}
+
+/*
+ * Node logic
+ */
+class Node : public cyphal::ITransferHandler
+{
+	static constexpr unsigned NameCapacity = 255;
+
+	cyphal::Transport transport_;
+
+	std::uint64_t unique_id_hash_ = 0;
+	std::uint32_t random_state_ = 0;
+
+	std::uint8_t tid_heartbeat_ = 0;
+	std::uint8_t tid_node_id_allocation_ = 0;
+	std::uint8_t tid_feedback_ = 0;
+	std::uint8_t tid_power_ = 0;
+
+	std::uint16_t subject_setpoint_ = PortIDUnset;
+	std::uint16_t subject_readiness_ = PortIDUnset;
+	std::uint16_t subject_feedback_ = PortIDUnset;
+	std::uint16_t subject_power_ = PortIDUnset;
+
+	unsigned self_index_ = 0;
+	unsigned command_ttl_ms_ = 0;
+
+	Readiness readiness_ = Readiness::Standby;
+	uavcan::MonotonicTime readiness_ts_;
+	bool motor_commanded_ = false;
+
+	uavcan::MonotonicTime started_at_;
+
+	std::uint8_t response_buffer_[cyphal::Transport::MaxPayloadSize];
+
+	std::uint32_t getRandom()
+	{
+		random_state_ = random_state_ * 1664525U + 1013904223U;
+		return random_state_ >> 8;
+	}
+
+	uavcan::MonotonicTime getTxDeadline() const
+	{
+		return uavcan_stm32::clock::getMonotonic() + uavcan::MonotonicDuration::fromMSec(TxTimeoutMSec);
+	}
+
+	void publish(std::uint16_t subject_id, std::uint8_t& transfer_id, const std::uint8_t* payload,
+	             unsigned size, cyphal::Priority priority = cyphal::Priority::Nominal)
+	{
+		if (subject_id > SubjectIDMax) {
+			return;
+		}
+
+		cyphal::Transfer tr;
+		tr.kind = cyphal::TransferKind::Message;
+		tr.priority = priority;
+		tr.port_id = subject_id;
+		tr.transfer_id = transfer_id;
+		tr.payload = payload;
+		tr.payload_size = size;
+
+		(void)transport_.send(tr, getTxDeadline());
+		transfer_id = (transfer_id + 1) & cyphal::TransferIDMask;
+	}
+
+	void respond(const cyphal::Transfer& request, unsigned size)
+	{
+		cyphal::Transfer tr;
+		tr.kind = cyphal::TransferKind::Response;
+		tr.priority = request.priority;
+		tr.port_id = request.port_id;
+		tr.remote_node_id = request.remote_node_id;
+		tr.transfer_id = request.transfer_id;
+		tr.payload = response_buffer_;
+		tr.payload_size = size;
+
+		(void)transport_.send(tr, getTxDeadline());
+	}
+
+	bool isEngaged(uavcan::MonotonicTime ts) const
+	{
+		if (subject_readiness_ == PortIDUnset) {
+			return true;            // Readiness control is not used
+		}
+		return (readiness_ == Readiness::Engaged) && !readiness_ts_.isZero() &&
+		       ((ts - readiness_ts_).toMSec() < ReadinessTimeoutMSec);
+	}
+
+	/*
+	 * ESC
+	 */
+	void handleSetpoint(const cyphal::Transfer& tr)
+	{
+		// Missing elements are zero per the implicit zero extension rule
+		Reader reader(tr.payload, tr.payload_size);
+		reader.skip(self_index_ * 2);
+		const float value = float16_to_float(reader.u16());
+
+		motor_commanded_ = isEngaged(tr.timestamp) && std::isfinite(value) && (value > 0.0F);
+		if (motor_commanded_) {
+			motor_set_duty_cycle(std::min(value, 1.0F), int(command_ttl_ms_));
+		} else {
+			motor_stop();
+		}
+
+		publishFeedback();
+	}
+
+	void handleReadiness(const cyphal::Transfer& tr)
+	{
+		Reader reader(tr.payload, tr.payload_size);
+		const auto new_readiness = Readiness(reader.u8() & 3U);
+
+		readiness_ts_ = tr.timestamp;
+		if (new_readiness != readiness_) {
+			os::lowsyslog("Cyphal: Readiness %u\n", unsigned(new_readiness));
+			readiness_ = new_readiness;
+		}
+		if ((readiness_ != Readiness::Engaged) && motor_commanded_) {
+			motor_commanded_ = false;
+			motor_stop();
+		}
+	}
+
+	void publishFeedback()
+	{
+		if (subject_feedback_ == PortIDUnset) {
+			return;
+		}
+
+		std::uint8_t buf[3];
+		Writer w(buf, sizeof(buf));
+		w.u8(std::uint8_t(isEngaged(uavcan_stm32::clock::getMonotonic()) ? Readiness::Engaged : readiness_));
+		w.u8(std::uint8_t(node_status_health));
+		const int demand_pct = int(std::lround(motor_get_duty_cycle() * 100.0F));
+		w.u8(std::uint8_t(std::int8_t(std::max(-128, std::min(127, demand_pct)))));
+
+		publish(subject_feedback_, tid_feedback_, buf, w.size(), cyphal::Priority::High);
+	}
+
+	void publishPower()
+	{
+		if (subject_power_ == PortIDUnset) {
+			return;
+		}
+
+		float voltage = 0.0F;
+		float current = 0.0F;
+		motor_get_input_voltage_current(&voltage, &current);
+
+		std::uint8_t buf[15];
+		Writer w(buf, sizeof(buf));
+		w.uint(0, 7);                           // Synchronized timestamp is unknown
+		w.f32(current);
+		w.f32(voltage);
+
+		publish(subject_power_, tid_power_, buf, w.size());
+	}
+
+	/*
+	 * Node services
+	 */
+	void publishHeartbeat()
+	{
+		const auto uptime = (uavcan_stm32::clock::getMonotonic() - started_at_).toMSec() / 1000;
+
+		std::uint8_t buf[7];
+		Writer w(buf, sizeof(buf));
+		w.u32(std::uint32_t(uptime));
+		w.u8(std::uint8_t(node_status_health));
+		w.u8(0);                                // Mode: operational
+		w.u8(0);                                // Vendor specific status code
+
+		publish(SubjectHeartbeat, tid_heartbeat_, buf, w.size());
+	}
+
+	void publishNodeIDAllocationRequest()
+	{
+		std::uint8_t buf[7];
+		Writer w(buf, sizeof(buf));
+		w.uint(unique_id_hash_, 6);
+		w.u8(0);                                // No preferred node ID
+
+		publish(SubjectNodeIDAllocation, tid_node_id_allocation_, buf, w.size(), cyphal::Priority::Slow);
+	}
+
+	void handleNodeIDAllocationResponse(const cyphal::Transfer& tr)
+	{
+		if (tr.remote_node_id == cyphal::NodeIDUnset) {
+			return;                         // Request from another anonymous node
+		}
+
+		Reader reader(tr.payload, tr.payload_size);
+		const auto hash = reader.uint(6);
+		const auto len = reader.u8();
+		const auto node_id = reader.u16();
+
+		if ((hash == unique_id_hash_) && (len > 0) && reader.isValid() && (node_id <= cyphal::NodeIDMax)) {
+			os::lowsyslog("Cyphal: Dynamic node ID %u allocated by %u\n",
+			              unsigned(node_id), unsigned(tr.remote_node_id));
+			transport_.setNodeID(std::uint8_t(node_id));
+		}
+	}
+
+	void handleGetInfo(const cyphal::Transfer& tr)
+	{
+		const auto swver = get_uavcan_software_version();
+		const auto hwver = board::detect_hardware_version();
+		const auto uid = board::read_unique_id();
+
+		Writer w(response_buffer_, sizeof(response_buffer_));
+		w.u8(1);                                // Protocol version
+		w.u8(0);
+		w.u8(hwver.major);
+		w.u8(hwver.minor);
+		w.u8(swver.major);
+		w.u8(swver.minor);
+		w.u64(swver.vcs_commit);
+
+		std::uint8_t unique_id[16] = {};
+		std::copy(std::begin(uid), std::end(uid), std::begin(unique_id));
+		w.bytes(unique_id, sizeof(unique_id));
+
+		const unsigned name_len = std::strlen(NODE_NAME);
+		w.u8(std::uint8_t(name_len));
+		w.bytes(NODE_NAME, name_len);
+
+		w.u8(1);                                // Software image CRC is available
+		w.u64(swver.image_crc);
+
+		board::DeviceSignature signature;
+		if (board::try_read_device_signature(signature)) {
+			w.u8(std::uint8_t(signature.size()));
+			w.bytes(signature.data(), signature.size());
+		} else {
+			w.u8(0);
+		}
+
+		respond(tr, w.size());
+	}
+
+	void handleExecuteCommand(const cyphal::Transfer& tr)
+	{
+		enum Status : std::uint8_t
+		{
+			StatusSuccess = 0,
+			StatusFailure = 1,
+			StatusBadCommand = 3,
+			StatusBadState = 5
+		};
+
+		Reader reader(tr.payload, tr.payload_size);
+		const auto command = reader.u16();
+
+		std::uint8_t status = StatusBadCommand;
+		switch (command) {
+		case 65535: {                           // Restart
+			os::lowsyslog("Cyphal: Restarting by request from %u\n", unsigned(tr.remote_node_id));
+			os::requestReboot();
+			status = StatusSuccess;
+			break;
+		}
+		case 65532:                             // Factory reset
+		case 65530: {                           // Store persistent states
+			// We can't perform flash IO when the motor controller is active
+			if (motor_is_idle()) {
+				status = (((command == 65532) ? configErase() : configSave()) >= 0) ? StatusSuccess : StatusFailure;
+			} else {
+				status = StatusBadState;
+			}
+			break;
+		}
+		case 65531: {                           // Emergency stop
+			motor_stop();
+			status = StatusSuccess;
+			break;
+		}
+		default: {
+			break;
+		}
+		}
+
+		response_buffer_[0] = status;
+		respond(tr, 1);
+	}
+
+	/*
+	 * Registers.
+	 * All configuration parameters are exposed as registers under their own names; additionally,
+	 * the standard registers of the node ID and the port IDs are mapped onto the relevant parameters.
+	 * Changes of the standard registers take effect after restart.
+	 */
+	static const char* resolveStandardRegister(const char* name, const char** out_string_value)
+	{
+		*out_string_value = nullptr;
+
+		if (std::strcmp(name, RegisterNameNodeID) == 0) {
+			return ParamNameNodeID;
+		}
+		for (auto& r : port_registers) {
+			if (std::strcmp(name, r.id_name) == 0) {
+				return r.param_name;
+			}
+			if (std::strcmp(name, r.type_name) == 0) {
+				*out_string_value = r.type;
+				return nullptr;
+			}
+		}
+		return name;
+	}
+
+	static void encodeString(Writer& w, const char* str)
+	{
+		const unsigned len = std::strlen(str);
+		w.u8(std::uint8_t(ValueTag::String));
+		w.u16(std::uint16_t(len));
+		w.bytes(str, len);
+	}
+
+	void handleRegisterAccess(const cyphal::Transfer& tr)
+	{
+		Reader reader(tr.payload, tr.payload_size);
+
+		char name[NameCapacity + 1] = {};
+		const unsigned name_len = reader.u8();
+		for (unsigned i = 0; i < name_len; i++) {
+			name[i] = char(reader.u8());
+		}
+
+		const char* string_value = nullptr;
+		const char* const param_name = resolveStandardRegister(name, &string_value);
+		const bool standard = param_name != name;
+
+		Writer w(response_buffer_, sizeof(response_buffer_));
+		w.uint(0, 7);                           // Timestamp is unknown
+
+		ConfigParam descr;
+		if (string_value != nullptr) {
+			w.u8(2);                                // Persistent, immutable
+			encodeString(w, string_value);
+		} else if ((param_name != nullptr) && (configGetDescr(param_name, &descr) >= 0)) {
+			float value = 0.0F;
+			if (decode_first_numeric_value(reader, value)) {
+				if (std::strcmp(name, RegisterNameNodeID) == 0) {
+					value = (value >= float(PortIDUnset)) ? 0.0F : value;
+				}
+				(void)configSet(param_name, value);  // Invalid values are ignored
+			}
+
+			value = configGet(param_name);
+
+			w.u8(3);                                // Persistent, mutable
+			if (standard) {
+				if ((std::strcmp(name, RegisterNameNodeID) == 0) && (value <= 0.0F)) {
+					value = float(PortIDUnset);
+				}
+				w.u8(std::uint8_t(ValueTag::Natural16));
+				w.u8(1);
+				w.u16(std::uint16_t(value));
+			} else if (descr.type == CONFIG_TYPE_BOOL) {
+				w.u8(std::uint8_t(ValueTag::Bit));
+				w.u16(1);
+				w.u8(value != 0.0F);
+			} else if (descr.type == CONFIG_TYPE_INT) {
+				w.u8(std::uint8_t(ValueTag::Integer32));
+				w.u8(1);
+				w.u32(std::uint32_t(std::int32_t(value)));
+			} else {
+				w.u8(std::uint8_t(ValueTag::Real32));
+				w.u8(1);
+				w.f32(value);
+			}
+		} else {
+			w.u8(0);
+			w.u8(std::uint8_t(ValueTag::Empty));    // No such register
+		}
+
+		respond(tr, w.size());
+	}
+
+	void handleRegisterList(const cyphal::Transfer& tr)
+	{
+		Reader reader(tr.payload, tr.payload_size);
+		unsigned index = reader.u16();
+
+		const char* name = nullptr;
+		if (index == 0) {
+			name = RegisterNameNodeID;
+		} else if (index <= NumPortRegisters * 2) {
+			index -= 1;
+			name = ((index % 2) == 0) ? port_registers[index / 2].id_name : port_registers[index / 2].type_name;
+		} else {
+			name = configNameByIndex(int(index - 1 - NumPortRegisters * 2));
+		}
+
+		Writer w(response_buffer_, sizeof(response_buffer_));
+		const unsigned len = (name != nullptr) ? std::strlen(name) : 0;
+		w.u8(std::uint8_t(len));                // Empty name terminates the list
+		w.bytes(name, len);
+
+		respond(tr, w.size());
+	}
+
+public:
+	Node(uavcan::ICanDriver& driver, uavcan::ISystemClock& clock)
+		: transport_(driver, clock, *this)
+	{ }
+
+	void init()
+	{
+		started_at_ = uavcan_stm32::clock::getMonotonic();
+
+		// 64-bit FNV-1a of the unique ID, truncated to 48 bits for the node ID allocation protocol
+		std::uint64_t hash = 0xCBF29CE484222325ULL;
+		for (auto x : board::read_unique_id()) {
+			hash = (hash ^ x) * 0x100000001B3ULL;
+		}
+		unique_id_hash_ = hash & ((1ULL << 48) - 1U);
+		random_state_ = std::uint32_t(hash ^ (hash >> 32));
+
+		subject_setpoint_ = get_subject_id(param_sub_setpoint_id);
+		subject_readiness_ = get_subject_id(param_sub_readiness_id);
+		subject_feedback_ = get_subject_id(param_pub_feedback_id);
+		subject_power_ = get_subject_id(param_pub_power_id);
+
+		self_index_ = param_esc_index.get();
+		command_ttl_ms_ = param_cmd_ttl_ms.get();
+
+		if ((param_node_id.get() > 0) || get_inherited_node_id().isUnicast()) {
+			transport_.setNodeID(std::uint8_t((param_node_id.get() > 0) ?
+			                                  param_node_id.get() : get_inherited_node_id().get()));
+			os::lowsyslog("Cyphal: Using static node ID %u\n", unsigned(transport_.getNodeID()));
+		} else {
+			os::lowsyslog("Cyphal: Waiting for dynamic node ID allocation...\n");
+		}
+	}
+
+	/**
+	 * Returns the time when the next request should be sent.
+	 */
+	uavcan::MonotonicTime pollNodeIDAllocation(uavcan::MonotonicTime ts)
+	{
+		publishNodeIDAllocationRequest();
+		return ts + uavcan::MonotonicDuration::fromMSec(getRandom() % 1000);
+	}
+
+	bool hasNodeID() const { return transport_.getNodeID() <= cyphal::NodeIDMax; }
+	std::uint8_t getNodeID() const { return transport_.getNodeID(); }
+
+	void pollReadinessTimeout(uavcan::MonotonicTime ts)
+	{
+		if (motor_commanded_ && !isEngaged(ts)) {
+			os::lowsyslog("Cyphal: Readiness timeout\n");
+			motor_commanded_ = false;
+			motor_stop();
+		}
+	}
+
+	void spin(uavcan::MonotonicTime deadline) { transport_.spin(deadline); }
+
+	const cyphal::PerfCounters& getPerfCounters() const { return transport_.getPerfCounters(); }
+
+	std::uint16_t getSetpointSubjectID() const { return subject_setpoint_; }
+	Readiness getReadiness() const { return readiness_; }
+
+	void publishPeriodic(uavcan::MonotonicTime ts, uavcan::MonotonicTime& next_heartbeat_at,
+	                     uavcan::MonotonicTime& next_power_at)
+	{
+		if (ts >= next_heartbeat_at) {
+			next_heartbeat_at += uavcan::MonotonicDuration::fromMSec(1000);
+			publishHeartbeat();
+		}
+		if (ts >= next_power_at) {
+			// Lower the publish rate to 1Hz if the motor is not running
+			next_power_at = ts + uavcan::MonotonicDuration::fromMSec(motor_is_idle() ?
+			                                                         1000 : PowerPublicationPeriodMSec);
+			publishPower();
+		}
+	}
+
+	unsigned getExtent(cyphal::TransferKind kind, std::uint16_t port_id) const override
+	{
+		if (!hasNodeID()) {
+			return ((kind == cyphal::TransferKind::Message) && (port_id == SubjectNodeIDAllocation)) ? 9 : 0;
+		}
+
+		if (kind == cyphal::TransferKind::Message) {
+			if (port_id == subject_setpoint_) {
+				return 62;
+			}
+			if (port_id == subject_readiness_) {
+				return 1;
+			}
+		} else if (kind == cyphal::TransferKind::Request) {
+			switch (port_id) {
+			case ServiceRegisterAccess: return 515;
+			case ServiceRegisterList:   return 2;
+			case ServiceGetInfo:        return 1;
+			case ServiceExecuteCommand: return 300;
+			default:                    break;
+			}
+		}
+		return 0;
+	}
+
+	unsigned getTransferIDTimeoutMSec(cyphal::TransferKind kind, std::uint16_t port_id) const override
+	{
+		if ((kind == cyphal::TransferKind::Message) &&
+		    ((port_id == subject_setpoint_) || (port_id == subject_readiness_))) {
+			return CommandTransferIDTimeoutMSec;
+		}
+		return cyphal::ITransferHandler::getTransferIDTimeoutMSec(kind, port_id);
+	}
+
+	void handleTransfer(const cyphal::Transfer& tr) override
+	{
+		if (tr.kind == cyphal::TransferKind::Message) {
+			if (!hasNodeID()) {
+				handleNodeIDAllocationResponse(tr);
+			} else if (tr.port_id == subject_setpoint_) {
+				handleSetpoint(tr);
+			} else if (tr.port_id == subject_readiness_) {
+				handleReadiness(tr);
+			}
+		} else if (tr.kind == cyphal::TransferKind::Request) {
+			switch (tr.port_id) {
+			case ServiceRegisterAccess: handleRegisterAccess(tr); break;
+			case ServiceRegisterList:   handleRegisterList(tr);   break;
+			case ServiceGetInfo:        handleGetInfo(tr);        break;
+			case ServiceExecuteCommand: handleExecuteCommand(tr); break;
+			default:                    break;
+			}
+		}
+	}
+};
+
+Node& get_node()
+{
+	static Node node(can.driver, uavcan_stm32::SystemClock::instance());
+	return node;
+}
+
+/*
+ * Cyphal spin loop
+ */
+class : public chibios_rt::BaseStaticThread<3000>
+{
+	os::watchdog::Timer wdt_;
+	volatile bool need_to_print_status_ = false;
+
+	void handle_background_tasks()
+	{
+		if (need_to_print_status_) {
+			need_to_print_status_ = false;
+
+			const auto& perf = get_node().getPerfCounters();
+
+			std::printf("Protocol:    Cyphal/CAN\n");
+			std::printf("CAN bitrate: %u\n", unsigned(active_can_bus_bit_rate));
+			std::printf("Node ID:     %u\n", unsigned(get_node().getNodeID()));
+			std::printf("Node health: %u\n", unsigned(node_status_health));
+			std::printf("Setpoint:    %u\n", unsigned(get_node().getSetpointSubjectID()));
+			std::printf("Readiness:   %u\n", unsigned(get_node().getReadiness()));
+
+			std::printf("Transfers RX/TX: %u / %u\n", unsigned(perf.transfers_rx), unsigned(perf.transfers_tx));
+			std::printf("Transfer errors: %u\n", unsigned(perf.errors));
+			std::printf("TX overflows:    %u\n", unsigned(perf.tx_queue_overflows));
+
+			for (unsigned i = 0; i < can.driver.getNumIfaces(); i++) {
+				std::printf("CAN iface %u:\n", i);
+				std::printf("    Frames RX/TX: %u / %u\n",
+					    unsigned(perf.frames_rx[i]), unsigned(perf.frames_tx[i]));
+				std::printf("    RX overflows: %u\n",
+					    unsigned(can.driver.getIface(i)->getRxQueueOverflowCount()));
+				std::printf("    Errors:       %u\n", unsigned(can.driver.getIface(i)->getErrorCount()));
+			}
+		}
+	}
+
+	void init_can()
+	{
+		int res = 0;
+		do {
+			wdt_.reset();
+			::sleep(1);
+
+			handle_background_tasks();
+
+			std::uint32_t bitrate = get_inherited_can_bus_bit_rate();
+			const bool autodetect = bitrate == 0;
+
+			res = can.init([]() {::usleep(can.getRecommendedListeningDelay().toUSec());}, bitrate);
+
+			if (res >= 0) {
+				::os::lowsyslog("CAN inited at %u bps\n", unsigned(bitrate));
+				active_can_bus_bit_rate = bitrate;
+			} else if (autodetect && (res == -uavcan_stm32::ErrBitRateNotDetected)) {
+				; // Nothing to do
+			} else {
+				::os::lowsyslog("Could not init CAN; status: %d, autodetect: %d, bitrate: %u\n",
+				        res, int(autodetect), unsigned(bitrate));
+			}
+		} while (res < 0);
+
+		assert(active_can_bus_bit_rate > 0);
+	}
+
+public:
+	void main() override
+	{
+		wdt_.startMSec(10000);
+		setName("cyphal");
+
+		init_can();
+
+		wdt_.reset();
+
+		get_node().init();
+
+		auto next_allocation_request_at = uavcan_stm32::clock::getMonotonic();
+		while (!get_node().hasNodeID() && !os::isRebootRequested()) {
+			wdt_.reset();
+			handle_background_tasks();
+			get_node().spin(uavcan_stm32::clock::getMonotonic() + uavcan::MonotonicDuration::fromMSec(10));
+
+			const auto ts = uavcan_stm32::clock::getMonotonic();
+			if (ts >= next_allocation_request_at) {
+				next_allocation_request_at = get_node().pollNodeIDAllocation(ts);
+			}
+		}
+
+		os::lowsyslog("Cyphal: Node started, ID %u\n", unsigned(get_node().getNodeID()));
+
+		auto next_heartbeat_at = uavcan_stm32::clock::getMonotonic();
+		auto next_power_at = next_heartbeat_at;
+
+		while (!os::isRebootRequested()) {
+			// The loop runs back to back, each iteration is due as soon as the previous one ends
+			thread_stats_begin(THREAD_STATS_NODE, thread_stats_now());
+			wdt_.reset();
+
+			handle_background_tasks();
+
+			const auto ts = uavcan_stm32::clock::getMonotonic();
+			get_node().publishPeriodic(ts, next_heartbeat_at, next_power_at);
+			get_node().pollReadinessTimeout(ts);
+
+			get_node().spin(ts + uavcan::MonotonicDuration::fromMSec(SpinDurationMSec));
+			thread_stats_end(THREAD_STATS_NODE, SpinDeadlineUSec);
+		}
+
+		os::lowsyslog("Cyphal: Going down\n");
+		get_node().spin(uavcan_stm32::clock::getMonotonic() + uavcan::MonotonicDuration::fromMSec(10));
+	}
+
+	void print_status()
+	{
+		need_to_print_status_ = true;
+		while (need_to_print_status_) {
+			::usleep(10000);
+		}
+	}
+} node_thread;
+
+}
+
+void set_node_status_ok()
+{
+	node_status_health = Health::Nominal;
+}
+
+void set_node_status_warning()
+{
+	node_status_health = Health::Caution;
+}
+
+void set_node_status_critical()
+{
+	node_status_health = Health::Warning;
+}
+
+unsigned get_esc_index()
+{
+	return param_esc_index.get();
+}
+
+extern void init_bootloader_interface();
+
+void print_status()
+{
+	node_thread.print_status();
+}
+
+int init()
+{
+	init_bootloader_interface();
+
+	(void)node_thread.start(HIGHPRIO - 2);
+
+	return 0;
+}
+
+}
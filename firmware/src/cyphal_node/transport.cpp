@@ -0,0 +1,412 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "transport.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace cyphal
+{
+namespace
+{
+
+constexpr std::uint8_t TailStartOfTransfer = 0x80;
+constexpr std::uint8_t TailEndOfTransfer   = 0x40;
+constexpr std::uint8_t TailToggle          = 0x20;
+
+constexpr std::uint32_t IDServiceNotMessage = 1U << 25;
+constexpr std::uint32_t IDAnonymous         = 1U << 24;     ///< Same bit is the request flag for services
+constexpr std::uint32_t IDRequestNotResponse = 1U << 24;
+constexpr std::uint32_t IDReserved23        = 1U << 23;
+constexpr std::uint32_t IDMessageReserved   = (1U << 22) | (1U << 21);
+constexpr std::uint32_t IDReserved7         = 1U << 7;
+
+constexpr std::uint16_t SubjectIDMask = 0x1FFF;
+constexpr std::uint16_t ServiceIDMask = 0x1FF;
+
+std::uint32_t make_session_key(TransferKind kind, std::uint16_t port_id, std::uint8_t source_node_id)
+{
+	return (std::uint32_t(kind) << 24) | (std::uint32_t(port_id) << 8) | source_node_id;
+}
+
+}
+
+constexpr unsigned Transport::MaxPayloadSize;
+constexpr unsigned Transport::FramePayloadSize;
+
+std::uint16_t crc16(std::uint16_t crc, const std::uint8_t* data, unsigned size)
+{
+	// CRC-16/CCITT-FALSE
+	while (size --> 0) {
+		crc ^= std::uint16_t(*data++) << 8;
+		for (int i = 0; i < 8; i++) {
+			crc = (crc & 0x8000U) ? std::uint16_t((crc << 1) ^ 0x1021U) : std::uint16_t(crc << 1);
+		}
+	}
+	return crc;
+}
+
+void Transport::TxQueue::push(const TxItem& item)
+{
+	items[(head + size) % TxQueueCapacity] = item;
+	size++;
+}
+
+void Transport::TxQueue::pop()
+{
+	head = (head + 1) % TxQueueCapacity;
+	size--;
+}
+
+Transport::RxSession* Transport::findOrCreateSession(std::uint32_t key)
+{
+	RxSession* oldest = nullptr;
+
+	for (auto& s : rx_sessions_) {
+		if (s.used && (s.key == key)) {
+			return &s;
+		}
+		if ((oldest == nullptr) || !s.used ||
+		    (oldest->used && (s.last_transfer_ts < oldest->last_transfer_ts))) {
+			oldest = &s;
+		}
+	}
+
+	oldest->key = key;
+	oldest->used = true;
+	oldest->in_progress = false;
+	oldest->last_transfer_ts = uavcan::MonotonicTime();
+	oldest->interval_usec = 0;
+	return oldest;
+}
+
+bool Transport::isNewTransfer(const RxSession& session, std::uint8_t transfer_id, std::uint8_t iface_index,
+                              uavcan::MonotonicTime ts, unsigned transfer_id_timeout_ms)
+{
+	if (session.last_transfer_ts.isZero() ||
+	    ((ts - session.last_transfer_ts).toMSec() > transfer_id_timeout_ms)) {
+		return true;
+	}
+	if (iface_index == session.iface_index) {
+		return transfer_id != session.transfer_id;
+	}
+	/*
+	 * Another interface is accepted if the current one has missed a transfer. Copies of the same transfer arrive
+	 * within the skew between the interfaces, so a transfer that arrives later than half of the interval after
+	 * the last one is the next transfer; it also has to be newer than the last one, so that a late copy of a past
+	 * transfer is never accepted again.
+	 */
+	const std::uint8_t forward_distance = (transfer_id - session.transfer_id) & TransferIDMask;
+	return (session.interval_usec > 0) &&
+	       ((ts - session.last_transfer_ts).toUSec() > std::int64_t(session.interval_usec / 2)) &&
+	       (forward_distance > 0) && (forward_distance <= (TransferIDMask / 2));
+}
+
+void Transport::beginTransfer(RxSession& session, std::uint8_t transfer_id, std::uint8_t iface_index,
+                              uavcan::MonotonicTime ts, unsigned transfer_id_timeout_ms)
+{
+	if (!session.last_transfer_ts.isZero() &&
+	    ((ts - session.last_transfer_ts).toMSec() <= transfer_id_timeout_ms)) {
+		const auto interval_usec = std::uint32_t((ts - session.last_transfer_ts).toUSec());
+		session.interval_usec = (session.interval_usec == 0) ? interval_usec :
+		                        ((session.interval_usec * 7U + interval_usec) / 8U);
+	}
+	session.transfer_id = transfer_id;
+	session.iface_index = iface_index;
+	session.last_transfer_ts = ts;
+}
+
+void Transport::acceptFrame(std::uint8_t iface_index, const uavcan::CanFrame& frame, uavcan::MonotonicTime ts)
+{
+	if (!frame.isExtended() || frame.isRemoteTransmissionRequest() || frame.isErrorFrame() || (frame.dlc < 1)) {
+		return;
+	}
+
+	const std::uint32_t id = frame.id & uavcan::CanFrame::MaskExtID;
+	const std::uint8_t tail = frame.data[frame.dlc - 1];
+	const std::uint8_t source = id & NodeIDMax;
+
+	Transfer transfer;
+	transfer.priority = Priority((id >> 26) & 7U);
+	transfer.transfer_id = tail & TransferIDMask;
+	transfer.timestamp = ts;
+
+	bool anonymous = false;
+
+	if (id & IDServiceNotMessage) {
+		const std::uint8_t destination = (id >> 7) & NodeIDMax;
+		if ((id & IDReserved23) || (destination != node_id_) || (source == node_id_)) {
+			return;
+		}
+		transfer.kind = (id & IDRequestNotResponse) ? TransferKind::Request : TransferKind::Response;
+		transfer.port_id = (id >> 14) & ServiceIDMask;
+		transfer.remote_node_id = source;
+	} else {
+		if ((id & IDReserved23) || (id & IDReserved7) || ((id & IDMessageReserved) != IDMessageReserved)) {
+			return;
+		}
+		anonymous = (id & IDAnonymous) != 0;
+		transfer.kind = TransferKind::Message;
+		transfer.port_id = (id >> 8) & SubjectIDMask;
+		transfer.remote_node_id = anonymous ? NodeIDUnset : source;
+	}
+
+	const unsigned extent = handler_.getExtent(transfer.kind, transfer.port_id);
+	if (extent == 0) {
+		return;
+	}
+
+	const unsigned transfer_id_timeout_ms = handler_.getTransferIDTimeoutMSec(transfer.kind, transfer.port_id);
+	const bool start = (tail & TailStartOfTransfer) != 0;
+	const bool end = (tail & TailEndOfTransfer) != 0;
+	const bool toggle = (tail & TailToggle) != 0;
+	const unsigned frame_payload_size = frame.dlc - 1U;
+
+	if (start && !toggle) {
+		return;                 // Not a Cyphal frame (the toggle bit of the first frame is inverted in UAVCAN v0)
+	}
+
+	if (start && end) {
+		if (!anonymous) {
+			RxSession* const session = findOrCreateSession(make_session_key(transfer.kind, transfer.port_id,
+			                                                                source));
+			if (!isNewTransfer(*session, transfer.transfer_id, iface_index, ts, transfer_id_timeout_ms)) {
+				return;
+			}
+			beginTransfer(*session, transfer.transfer_id, iface_index, ts, transfer_id_timeout_ms);
+			session->in_progress = false;
+		}
+		transfer.payload = frame.data;
+		transfer.payload_size = std::min(frame_payload_size, extent);
+		perf_.transfers_rx++;
+		handler_.handleTransfer(transfer);
+		return;
+	}
+
+	if (anonymous) {
+		return;                 // Anonymous transfers can't be multi-frame
+	}
+
+	RxSession* const session = findOrCreateSession(make_session_key(transfer.kind, transfer.port_id, source));
+
+	if (start) {
+		if (!isNewTransfer(*session, transfer.transfer_id, iface_index, ts, transfer_id_timeout_ms)) {
+			return;
+		}
+		beginTransfer(*session, transfer.transfer_id, iface_index, ts, transfer_id_timeout_ms);
+		session->current_transfer_ts = ts;
+		session->in_progress = true;
+		session->toggle = true;
+		session->size = 0;
+		session->crc = 0xFFFFU;
+	} else if (!session->in_progress || (session->iface_index != iface_index) ||
+	           (session->transfer_id != transfer.transfer_id) || (session->toggle != toggle)) {
+		return;
+	}
+
+	session->crc = crc16(session->crc, frame.data, frame_payload_size);
+	session->toggle = !toggle;
+
+	// The payload beyond the buffer is dropped, but it still has to be counted in order to locate the CRC
+	const unsigned room = (session->size < sizeof(session->buffer)) ? (sizeof(session->buffer) - session->size) : 0;
+	if (room > 0) {
+		std::memcpy(&session->buffer[session->size], frame.data, std::min(room, frame_payload_size));
+	}
+	session->size += frame_payload_size;
+
+	if (end) {
+		session->in_progress = false;
+		if ((session->crc != 0) || (session->size < 2)) {
+			perf_.errors++;
+			return;
+		}
+		transfer.timestamp = session->current_transfer_ts;
+		transfer.payload = session->buffer;
+		transfer.payload_size = std::min(std::min(session->size - 2U, MaxPayloadSize), extent);
+		perf_.transfers_rx++;
+		handler_.handleTransfer(transfer);
+	}
+}
+
+int Transport::send(const Transfer& transfer, uavcan::MonotonicTime tx_deadline)
+{
+	if ((transfer.payload_size > MaxPayloadSize) || ((transfer.payload == nullptr) && (transfer.payload_size > 0))) {
+		return -1;
+	}
+
+	const bool single_frame = transfer.payload_size <= FramePayloadSize;
+
+	std::uint32_t id = std::uint32_t(transfer.priority) << 26;
+
+	if (transfer.kind == TransferKind::Message) {
+		id |= IDMessageReserved | ((std::uint32_t(transfer.port_id) & SubjectIDMask) << 8);
+		if (node_id_ <= NodeIDMax) {
+			id |= node_id_;
+		} else if (single_frame) {
+			// Pseudo node ID of an anonymous transfer is derived from the payload to reduce collisions
+			id |= IDAnonymous | (crc16(0xFFFFU, transfer.payload, transfer.payload_size) & NodeIDMax);
+		} else {
+			return -1;
+		}
+	} else {
+		if ((node_id_ > NodeIDMax) || (transfer.remote_node_id > NodeIDMax)) {
+			return -1;
+		}
+		id |= IDServiceNotMessage | ((std::uint32_t(transfer.port_id) & ServiceIDMask) << 14) |
+		      (std::uint32_t(transfer.remote_node_id) << 7) | node_id_;
+		if (transfer.kind == TransferKind::Request) {
+			id |= IDRequestNotResponse;
+		}
+	}
+	id |= uavcan::CanFrame::FlagEFF;
+
+	const std::uint16_t crc = single_frame ? 0 : crc16(0xFFFFU, transfer.payload, transfer.payload_size);
+	const unsigned total_size = transfer.payload_size + (single_frame ? 0 : 2);
+	const unsigned num_frames = single_frame ? 1 : ((total_size + FramePayloadSize - 1) / FramePayloadSize);
+
+	const unsigned num_ifaces = driver_.getNumIfaces();
+	for (unsigned i = 0; i < num_ifaces; i++) {
+		if (tx_queues_[i].getFreeSpace() < num_frames) {
+			perf_.tx_queue_overflows++;
+			return -1;
+		}
+	}
+
+	TxItem item;
+	item.frame.id = id;
+	item.deadline = tx_deadline;
+
+	unsigned offset = 0;
+	bool toggle = true;
+	for (unsigned frame_index = 0; frame_index < num_frames; frame_index++) {
+		const unsigned size = std::min(total_size - offset, FramePayloadSize);
+		for (unsigned i = 0; i < size; i++, offset++) {
+			if (offset < transfer.payload_size) {
+				item.frame.data[i] = transfer.payload[offset];
+			} else {
+				// The CRC is transmitted in big endian
+				item.frame.data[i] = (offset == transfer.payload_size) ? std::uint8_t(crc >> 8) : std::uint8_t(crc);
+			}
+		}
+		item.frame.data[size] = std::uint8_t((transfer.transfer_id & TransferIDMask) |
+			((frame_index == 0) ? TailStartOfTransfer : 0) |
+			((frame_index == (num_frames - 1)) ? TailEndOfTransfer : 0) |
+			(toggle ? TailToggle : 0));
+		item.frame.dlc = std::uint8_t(size + 1);
+		toggle = !toggle;
+
+		for (unsigned i = 0; i < num_ifaces; i++) {
+			tx_queues_[i].push(item);
+		}
+	}
+
+	perf_.transfers_tx++;
+	return 0;
+}
+
+void Transport::flushTxQueue(std::uint8_t iface_index)
+{
+	auto& queue = tx_queues_[iface_index];
+	auto* const iface = driver_.getIface(iface_index);
+	const auto ts = clock_.getMonotonic();
+
+	while (!queue.isEmpty()) {
+		if (queue.front().deadline < ts) {
+			queue.pop();            // Expired
+			perf_.errors++;
+			continue;
+		}
+
+		const int res = iface->send(queue.front().frame, queue.front().deadline, 0);
+		if (res == 0) {
+			break;                  // No free mailbox
+		}
+		if (res > 0) {
+			perf_.frames_tx[iface_index]++;
+		} else {
+			perf_.errors++;
+		}
+		queue.pop();
+	}
+}
+
+void Transport::spin(uavcan::MonotonicTime deadline)
+{
+	const unsigned num_ifaces = driver_.getNumIfaces();
+
+	do {
+		uavcan::CanSelectMasks masks;
+		const uavcan::CanFrame* pending_tx[uavcan::MaxCanIfaces] = {};
+
+		for (unsigned i = 0; i < num_ifaces; i++) {
+			masks.read |= std::uint8_t(1U << i);
+			if (!tx_queues_[i].isEmpty()) {
+				masks.write |= std::uint8_t(1U << i);
+				pending_tx[i] = &tx_queues_[i].front().frame;
+			}
+		}
+
+		const int res = driver_.select(masks, pending_tx, deadline);
+		if (res < 0) {
+			perf_.errors++;
+			return;
+		}
+
+		for (unsigned i = 0; i < num_ifaces; i++) {
+			if (masks.write & (1U << i)) {
+				flushTxQueue(std::uint8_t(i));
+			}
+
+			if (masks.read & (1U << i)) {
+				auto* const iface = driver_.getIface(std::uint8_t(i));
+				while (true) {
+					uavcan::CanFrame frame;
+					uavcan::MonotonicTime ts_mono;
+					uavcan::UtcTime ts_utc;
+					uavcan::CanIOFlags flags = 0;
+					const int rx_res = iface->receive(frame, ts_mono, ts_utc, flags);
+					if (rx_res <= 0) {
+						if (rx_res < 0) {
+							perf_.errors++;
+						}
+						break;
+					}
+					perf_.frames_rx[i]++;
+					acceptFrame(std::uint8_t(i), frame, ts_mono);
+				}
+			}
+		}
+	} while (clock_.getMonotonic() < deadline);
+}
+
+}
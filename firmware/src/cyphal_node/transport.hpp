@@ -0,0 +1,219 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <uavcan/driver/can.hpp>
+#include <uavcan/driver/system_clock.hpp>
+
+/**
+ * Minimal Cyphal/CAN (Classic CAN) transport.
+ * All memory is allocated statically: the number of concurrent RX sessions, the maximum transfer payload size
+ * and the depth of the TX queues are fixed at compile time. The CAN driver is the same as used by libuavcan.
+ */
+namespace cyphal
+{
+
+constexpr std::uint8_t NodeIDMax = 127;
+constexpr std::uint8_t NodeIDUnset = 0xFF;
+
+constexpr std::uint8_t TransferIDMask = 31;
+
+enum class Priority : std::uint8_t
+{
+	Exceptional,
+	Immediate,
+	Fast,
+	High,
+	Nominal,
+	Low,
+	Slow,
+	Optional
+};
+
+enum class TransferKind : std::uint8_t
+{
+	Message,
+	Request,
+	Response
+};
+
+struct Transfer
+{
+	TransferKind kind = TransferKind::Message;
+	Priority priority = Priority::Nominal;
+	std::uint16_t port_id = 0;
+	/// Source node of a received transfer, destination node of an outgoing service transfer
+	std::uint8_t remote_node_id = NodeIDUnset;
+	std::uint8_t transfer_id = 0;
+	/// Reception timestamp of the first frame of the transfer
+	uavcan::MonotonicTime timestamp;
+	const std::uint8_t* payload = nullptr;
+	unsigned payload_size = 0;
+};
+
+class ITransferHandler
+{
+public:
+	virtual ~ITransferHandler() { }
+
+	/**
+	 * Returns the maximum payload size the application accepts on the port, or zero if the port is not used.
+	 * Longer payloads are truncated.
+	 */
+	virtual unsigned getExtent(TransferKind kind, std::uint16_t port_id) const = 0;
+
+	/**
+	 * Redundant interfaces are switched as soon as the current interface misses a transfer: a newer transfer
+	 * from another interface is accepted once half of the estimated transfer interval has elapsed since the last
+	 * one. Past the transfer ID timeout, any transfer is accepted from any interface, e.g. after the publisher
+	 * restarted; this is also the failover delay of the ports that are published irregularly.
+	 * The default is 2 seconds. It must exceed the maximum skew between the redundant interfaces.
+	 */
+	virtual unsigned getTransferIDTimeoutMSec(TransferKind kind, std::uint16_t port_id) const
+	{
+		(void)kind;
+		(void)port_id;
+		return 2000;
+	}
+
+	virtual void handleTransfer(const Transfer& transfer) = 0;
+};
+
+struct PerfCounters
+{
+	std::uint32_t transfers_rx = 0;
+	std::uint32_t transfers_tx = 0;
+	std::uint32_t errors = 0;
+	std::uint32_t tx_queue_overflows = 0;
+	std::uint32_t frames_rx[uavcan::MaxCanIfaces] = {};
+	std::uint32_t frames_tx[uavcan::MaxCanIfaces] = {};
+};
+
+std::uint16_t crc16(std::uint16_t crc, const std::uint8_t* data, unsigned size);
+
+class Transport
+{
+public:
+	static constexpr unsigned MaxPayloadSize = 300;
+	static constexpr unsigned NumRxSessions = 6;
+	static constexpr unsigned TxQueueCapacity = 48;         ///< Frames per interface
+
+private:
+	static constexpr unsigned FramePayloadSize = uavcan::CanFrame::MaxDataLen - 1;
+
+	struct TxItem
+	{
+		uavcan::CanFrame frame;
+		uavcan::MonotonicTime deadline;
+	};
+
+	struct TxQueue
+	{
+		TxItem items[TxQueueCapacity];
+		unsigned head = 0;
+		unsigned size = 0;
+
+		unsigned getFreeSpace() const { return TxQueueCapacity - size; }
+		bool isEmpty() const { return size == 0; }
+		TxItem& front() { return items[head]; }
+		void push(const TxItem& item);
+		void pop();
+	};
+
+	/**
+	 * Deduplicates transfers received via redundant interfaces and reassembles multi-frame transfers.
+	 * One session is kept per port and source node; the least recently used session is reused when
+	 * a transfer from a new source arrives.
+	 */
+	struct RxSession
+	{
+		std::uint32_t key = 0;
+		uavcan::MonotonicTime last_transfer_ts;
+		uavcan::MonotonicTime current_transfer_ts;
+		std::uint32_t interval_usec = 0;        ///< Moving average of the interval between the transfers
+		unsigned size = 0;
+		std::uint16_t crc = 0;
+		std::uint8_t transfer_id = 0;
+		std::uint8_t iface_index = 0;
+		bool used = false;
+		bool in_progress = false;
+		bool toggle = false;
+		std::uint8_t buffer[MaxPayloadSize + 2];
+	};
+
+	uavcan::ICanDriver& driver_;
+	uavcan::ISystemClock& clock_;
+	ITransferHandler& handler_;
+	std::uint8_t node_id_ = NodeIDUnset;
+	PerfCounters perf_;
+	TxQueue tx_queues_[uavcan::MaxCanIfaces];
+	RxSession rx_sessions_[NumRxSessions];
+
+	RxSession* findOrCreateSession(std::uint32_t key);
+	static bool isNewTransfer(const RxSession& session, std::uint8_t transfer_id, std::uint8_t iface_index,
+	                          uavcan::MonotonicTime ts, unsigned transfer_id_timeout_ms);
+	static void beginTransfer(RxSession& session, std::uint8_t transfer_id, std::uint8_t iface_index,
+	                          uavcan::MonotonicTime ts, unsigned transfer_id_timeout_ms);
+	void acceptFrame(std::uint8_t iface_index, const uavcan::CanFrame& frame, uavcan::MonotonicTime ts);
+	void flushTxQueue(std::uint8_t iface_index);
+
+public:
+	Transport(uavcan::ICanDriver& driver, uavcan::ISystemClock& clock, ITransferHandler& handler)
+		: driver_(driver)
+		, clock_(clock)
+		, handler_(handler)
+	{ }
+
+	void setNodeID(std::uint8_t node_id) { node_id_ = node_id; }
+	std::uint8_t getNodeID() const { return node_id_; }
+
+	/**
+	 * Enqueues the transfer for transmission via all interfaces; frames that could not be transmitted
+	 * before the deadline are discarded.
+	 * If the local node ID is not set, only single-frame anonymous message transfers can be sent.
+	 * Returns negative if the transfer could not be enqueued.
+	 */
+	int send(const Transfer& transfer, uavcan::MonotonicTime tx_deadline);
+
+	/**
+	 * Transmits the pending frames and processes the received ones until the deadline.
+	 * The handler is invoked from this function.
+	 */
+	void spin(uavcan::MonotonicTime deadline);
+
+	const PerfCounters& getPerfCounters() const { return perf_; }
+};
+
+}
@@ -43,6 +43,9 @@
 #include <board/led.hpp>
 #include <console.hpp>
 #include <pwm_input.hpp>
+#include <rtos_trace.h>
+#include <thread_stats.h>
+#include <serial_telemetry.hpp>
 #include <temperature_sensor.hpp>
 #include <motor/motor.h>
 #include <uavcan_node/uavcan_node.hpp>
@@ -59,6 +62,9 @@ os::watchdog::Timer init()
 {
 	auto wdt = board::init(WATCHDOG_TIMEOUT);
 
+	rtos_trace_init();
+	thread_stats_init();
+
 	led_ctl.set(board::LEDColor::PALE_WHITE);
 
 	// Temperature sensor
@@ -95,7 +101,14 @@ os::watchdog::Timer init()
 
 	// Initializing console after delay to ensure that CLI is flushed
 	usleep(300000);
-	console_init();
+	if (serial_telemetry::is_enabled()) {
+		res = serial_telemetry::init();
+		if (res < 0) {
+			board::die(res);
+		}
+	} else {
+		console_init();
+	}
 
 	return wdt;
 }
@@ -0,0 +1,98 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "accel_limiter.h"
+#include <assert.h>
+#include <stdbool.h>
+
+
+void accel_limiter_reset(struct accel_limiter* limiter, uint64_t zc_failures)
+{
+	assert(limiter);
+	limiter->scale = 1.0f;
+	limiter->zc_failures = zc_failures;
+}
+
+float accel_limiter_update(struct accel_limiter* limiter, const struct accel_limiter_params* params,
+                           const struct accel_limiter_input* input)
+{
+	assert(limiter && params && input);
+	assert(input->dt > 0.0f);
+
+	const float scale_min = params->scale_min;
+	float target = 1.0f;
+
+	/*
+	 * Current margin: the excess torque that accelerates the rotor is running out, and the current limiter
+	 * is about to cut the duty cycle.
+	 */
+	if ((input->current > params->current_knee) && (params->current_limit > params->current_knee)) {
+		const float excess = (input->current - params->current_knee) / (params->current_limit - params->current_knee);
+		target = 1.0f - (1.0f - scale_min) * excess;
+	}
+
+	/*
+	 * A ZC failure since the previous update means that the detector is at the edge of losing the rotor.
+	 */
+	if (input->zc_failures != limiter->zc_failures) {
+		target = scale_min;
+	}
+	limiter->zc_failures = input->zc_failures;
+
+	/*
+	 * The commutation can't lead any further if the advance is saturated, so the lag that builds up during
+	 * acceleration can't be compensated. This matters only if the rotor is loaded, otherwise it keeps up.
+	 */
+	const bool advance_saturated =
+		(input->comm_period > 0) && (input->comm_period <= params->comm_period_max_advance);
+	if (advance_saturated && (input->current > params->current_knee)) {
+		target = scale_min;
+	}
+
+	if (target < scale_min) {
+		target = scale_min;
+	}
+
+	/*
+	 * Immediate reduction, gradual recovery
+	 */
+	if (target < limiter->scale) {
+		limiter->scale = target;
+	} else {
+		limiter->scale += params->recovery_rate * input->dt;
+		if (limiter->scale > target) {
+			limiter->scale = target;
+		}
+	}
+	return limiter->scale;
+}
@@ -0,0 +1,82 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Adaptive acceleration limiter.
+ * Computes the scale of the duty cycle slew rate, which is reduced when the motor is close to losing
+ * synchronization during acceleration: when the input current approaches the limit, when the ZC detector
+ * reports failures, or when the timing advance is saturated under load. The scale drops immediately and
+ * recovers gradually when the margins are restored.
+ */
+struct accel_limiter
+{
+	float scale;                        ///< (0, 1]
+	uint64_t zc_failures;               ///< As of the previous update
+};
+
+struct accel_limiter_params
+{
+	float scale_min;                    ///< (0, 1]; 1 disables the limiter
+	float current_knee;                 ///< Amperes; the scale begins to reduce at this current
+	float current_limit;                ///< Amperes; the scale reaches the minimum at this current
+	float recovery_rate;                ///< Scale units per second
+	uint32_t comm_period_max_advance;   ///< The timing advance is at its maximum at or below this comm period
+};
+
+struct accel_limiter_input
+{
+	float dt;
+	float current;                      ///< Amperes, filtered
+	uint64_t zc_failures;               ///< Since the motor has started
+	uint32_t comm_period;
+};
+
+void accel_limiter_reset(struct accel_limiter* limiter, uint64_t zc_failures);
+
+/**
+ * @return the scale of the slew rate, (0, 1]
+ */
+float accel_limiter_update(struct accel_limiter* limiter, const struct accel_limiter_params* params,
+                           const struct accel_limiter_input* input);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,242 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "bench.h"
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+
+static const struct bench_step _scenario_dc[] =
+{
+	{ BENCH_SETPOINT_DC,  0.2f,   0,    2000 },         // Spin up
+	{ BENCH_SETPOINT_DC,  0.5f,   0,    1500 },
+	{ BENCH_SETPOINT_DC,  0.2f,   0,    1500 },
+	{ BENCH_SETPOINT_DC,  0.8f,   2000, 1500 },
+	{ BENCH_SETPOINT_DC,  0.3f,   0,    1500 }
+};
+
+static const struct bench_step _scenario_dc_small[] =
+{
+	{ BENCH_SETPOINT_DC,  0.3f,   0,    2000 },
+	{ BENCH_SETPOINT_DC,  0.35f,  0,    1000 },
+	{ BENCH_SETPOINT_DC,  0.3f,   0,    1000 },
+	{ BENCH_SETPOINT_DC,  0.6f,   0,    1000 },
+	{ BENCH_SETPOINT_DC,  0.65f,  0,    1000 },
+	{ BENCH_SETPOINT_DC,  0.6f,   0,    1000 }
+};
+
+static const struct bench_step _scenario_rpm[] =
+{
+	{ BENCH_SETPOINT_RPM, 1500.f, 0,    2000 },
+	{ BENCH_SETPOINT_RPM, 4000.f, 0,    1500 },
+	{ BENCH_SETPOINT_RPM, 2000.f, 0,    1500 },
+	{ BENCH_SETPOINT_RPM, 6000.f, 2000, 1500 },
+	{ BENCH_SETPOINT_RPM, 3000.f, 0,    1500 }
+};
+
+#define SCENARIO(name, description)  { #name, description, _scenario_##name, \
+                                       sizeof(_scenario_##name) / sizeof(_scenario_##name[0]) }
+
+const struct bench_scenario bench_scenarios[] =
+{
+	SCENARIO(dc,       "Large duty cycle steps and a ramp"),
+	SCENARIO(dc_small, "Small duty cycle steps at low and high speed"),
+	SCENARIO(rpm,      "RPM steps and a ramp")
+};
+
+const unsigned bench_num_scenarios = sizeof(bench_scenarios) / sizeof(bench_scenarios[0]);
+
+
+const struct bench_scenario* bench_find_scenario(const char* name)
+{
+	for (unsigned i = 0; i < bench_num_scenarios; i++) {
+		if (strcmp(bench_scenarios[i].name, name) == 0) {
+			return &bench_scenarios[i];
+		}
+	}
+	return NULL;
+}
+
+float bench_get_setpoint(const struct bench_scenario* scenario, unsigned step_index, unsigned elapsed_ms)
+{
+	assert(scenario && (step_index < scenario->num_steps));
+	const struct bench_step* const step = &scenario->steps[step_index];
+
+	if ((step_index == 0) || (elapsed_ms >= step->ramp_ms)) {
+		return step->setpoint;
+	}
+
+	const struct bench_step* const prev = &scenario->steps[step_index - 1];
+	if (prev->kind != step->kind) {
+		return step->setpoint;
+	}
+
+	return prev->setpoint + (step->setpoint - prev->setpoint) * (float)elapsed_ms / (float)step->ramp_ms;
+}
+
+void bench_recorder_reset(struct bench_recorder* rec)
+{
+	assert(rec);
+	rec->num_samples = 0;
+	rec->stride = 1;
+	rec->skip = 0;
+	rec->started = false;
+	rec->peak_current = 0.0f;
+	rec->num_desyncs = 0;
+	rec->num_zc_failures = 0;
+}
+
+void bench_recorder_push(struct bench_recorder* rec, uint64_t timestamp_hnsec, unsigned rpm, float current,
+                         bool running, uint64_t zc_failures)
+{
+	assert(rec);
+
+	if (!rec->started) {
+		rec->started = true;
+		rec->start_timestamp_hnsec = timestamp_hnsec;
+		rec->prev_running = running;
+		rec->prev_zc_failures = zc_failures;
+	}
+
+	/*
+	 * Full rate statistics
+	 */
+	if (current > rec->peak_current) {
+		rec->peak_current = current;
+	}
+	if (rec->prev_running && !running) {
+		rec->num_desyncs++;
+	}
+	rec->prev_running = running;
+
+	// The counter restarts from zero when the motor restarts after a desync
+	rec->num_zc_failures += (zc_failures >= rec->prev_zc_failures) ?
+		(uint32_t)(zc_failures - rec->prev_zc_failures) : (uint32_t)zc_failures;
+	rec->prev_zc_failures = zc_failures;
+
+	/*
+	 * Decimated samples
+	 */
+	if (rec->skip > 0) {
+		rec->skip--;
+		return;
+	}
+
+	if (rec->num_samples >= BENCH_MAX_SAMPLES) {
+		// The next sample falls on an even position, so the interval stays uniform
+		for (unsigned i = 0; i < BENCH_MAX_SAMPLES / 2; i++) {
+			rec->samples[i] = rec->samples[i * 2];
+		}
+		rec->num_samples = BENCH_MAX_SAMPLES / 2;
+		rec->stride *= 2;
+	}
+
+	const float current_10ma = current * 100.0f;
+	struct bench_sample* const s = &rec->samples[rec->num_samples++];
+	s->time_usec = (uint32_t)((timestamp_hnsec - rec->start_timestamp_hnsec) / 10U);
+	s->rpm = (rpm > UINT16_MAX) ? UINT16_MAX : (uint16_t)rpm;
+	s->current_10ma = (current_10ma > INT16_MAX) ? INT16_MAX :
+	                  ((current_10ma < INT16_MIN) ? INT16_MIN : (int16_t)current_10ma);
+
+	rec->skip = rec->stride - 1;
+}
+
+void bench_compute_metrics(const struct bench_recorder* rec, float settle_band, struct bench_metrics* out)
+{
+	assert(rec && out);
+
+	memset(out, 0, sizeof(*out));
+	out->rise_time = NAN;
+	out->overshoot_pct = NAN;
+	out->settling_time = NAN;
+	out->peak_current = rec->peak_current;
+	out->num_desyncs = rec->num_desyncs;
+	out->num_zc_failures = rec->num_zc_failures;
+
+	const struct bench_sample* const s = rec->samples;
+	const unsigned n = rec->num_samples;
+	if (n == 0) {
+		return;
+	}
+
+	out->rpm_initial = s[0].rpm;
+
+	const uint32_t tail_start = s[n - 1].time_usec - s[n - 1].time_usec / 5;
+	float sum = 0.0f;
+	unsigned count = 0;
+	for (unsigned i = 0; i < n; i++) {
+		if (s[i].time_usec >= tail_start) {
+			sum += s[i].rpm;
+			count++;
+		}
+	}
+	out->rpm_final = sum / (float)count;        // At least the last sample is counted
+
+	const float delta = out->rpm_final - out->rpm_initial;
+	if (fabsf(delta) < BENCH_MIN_TRANSITION_RPM) {
+		return;
+	}
+
+	/*
+	 * Progress of the transition is zero at the initial value and one at the final value,
+	 * regardless of the direction of the step
+	 */
+	int index_10 = -1;
+	int index_90 = -1;
+	int last_outside_band = -1;
+	float peak_progress = 0.0f;
+	for (unsigned i = 0; i < n; i++) {
+		const float progress = ((float)s[i].rpm - out->rpm_initial) / delta;
+		if ((index_10 < 0) && (progress >= 0.1f)) {
+			index_10 = (int)i;
+		}
+		if ((index_90 < 0) && (progress >= 0.9f)) {
+			index_90 = (int)i;
+		}
+		if (progress > peak_progress) {
+			peak_progress = progress;
+		}
+		if (fabsf(progress - 1.0f) > settle_band) {
+			last_outside_band = (int)i;
+		}
+	}
+
+	if ((index_10 >= 0) && (index_90 >= 0)) {
+		out->rise_time = (float)(s[index_90].time_usec - s[index_10].time_usec) * 1e-6f;
+	}
+	out->overshoot_pct = (peak_progress > 1.0f) ? ((peak_progress - 1.0f) * 100.0f) : 0.0f;
+	if (last_outside_band < (int)n - 1) {
+		out->settling_time = (last_outside_band < 0) ? 0.0f : ((float)s[last_outside_band + 1].time_usec * 1e-6f);
+	}
+}
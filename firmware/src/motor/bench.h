@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Scripted step response benchmark.
+ * This module has no platform dependencies, so that the same scenarios and metrics can be used with a host
+ * simulation of the motor controller; the numbers are comparable with those obtained on the bench.
+ */
+
+enum bench_setpoint_kind
+{
+	BENCH_SETPOINT_DC,
+	BENCH_SETPOINT_RPM
+};
+
+/**
+ * The setpoint is ramped linearly from the previous one over ramp_ms (zero means step change),
+ * then held for hold_ms. The response is recorded from the beginning of the ramp until the end of the hold.
+ */
+struct bench_step
+{
+	enum bench_setpoint_kind kind;
+	float setpoint;                 ///< Duty cycle [0, 1] or RPM
+	uint16_t ramp_ms;
+	uint16_t hold_ms;
+};
+
+struct bench_scenario
+{
+	const char* name;
+	const char* description;
+	const struct bench_step* steps;
+	unsigned num_steps;
+};
+
+extern const struct bench_scenario bench_scenarios[];
+extern const unsigned bench_num_scenarios;
+
+/**
+ * @return NULL if there is no such scenario
+ */
+const struct bench_scenario* bench_find_scenario(const char* name);
+
+/**
+ * Returns the setpoint of the step at the specified time since the beginning of the step.
+ * A ramp starts from the setpoint of the previous step if it is of the same kind; otherwise it is a step change.
+ */
+float bench_get_setpoint(const struct bench_scenario* scenario, unsigned step_index, unsigned elapsed_ms);
+
+/**
+ * Records the motor state at the control loop rate.
+ * When the buffer is full, every other sample is discarded and the recording interval is doubled,
+ * so that a step of any length fits; the peak current, desyncs, and ZC failures are accounted at the full rate.
+ */
+#define BENCH_MAX_SAMPLES   1024
+
+struct bench_sample
+{
+	uint32_t time_usec;             ///< Since the beginning of the step
+	uint16_t rpm;
+	int16_t current_10ma;
+};
+
+struct bench_recorder
+{
+	struct bench_sample samples[BENCH_MAX_SAMPLES];
+	unsigned num_samples;
+	unsigned stride;
+	unsigned skip;
+
+	bool started;
+	uint64_t start_timestamp_hnsec;
+	bool prev_running;
+	uint64_t prev_zc_failures;
+
+	float peak_current;
+	unsigned num_desyncs;
+	uint32_t num_zc_failures;
+};
+
+void bench_recorder_reset(struct bench_recorder* rec);
+
+/**
+ * @param running       False if the motor is not running; a transition from running to not running is a desync,
+ *                      because the benchmark never stops the motor while a step is being recorded
+ * @param zc_failures   The ZC failure counter of the motor controller, which is reset when the motor starts
+ */
+void bench_recorder_push(struct bench_recorder* rec, uint64_t timestamp_hnsec, unsigned rpm, float current,
+                         bool running, uint64_t zc_failures);
+
+struct bench_metrics
+{
+	float rpm_initial;
+	float rpm_final;                ///< Average over the last fifth of the step
+	float rise_time;                ///< Seconds from 10% to 90% of the transition; NAN if not applicable
+	float overshoot_pct;            ///< Percent of the transition; NAN if not applicable
+	float settling_time;            ///< Seconds since the beginning of the step; NAN if not applicable
+	float peak_current;
+	unsigned num_desyncs;
+	uint32_t num_zc_failures;
+};
+
+/**
+ * The transition metrics are not applicable if the RPM changes by less than BENCH_MIN_TRANSITION_RPM.
+ * @param settle_band   Fraction of the transition, e.g. 0.05
+ */
+#define BENCH_MIN_TRANSITION_RPM    100
+
+void bench_compute_metrics(const struct bench_recorder* rec, float settle_band, struct bench_metrics* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,150 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "dc_limiter.h"
+#include "motor.h"
+#include "realtime/timer.h"
+#include <zubax_chibios/config/config.h>
+#include <math.h>
+#include <assert.h>
+#include <stdbool.h>
+
+
+CONFIG_PARAM_FLOAT("mot_dc_accel",     0.09,   0.001,   0.5)
+CONFIG_PARAM_FLOAT("mot_dc_slope",     5.0,    0.1,     20.0)
+
+CONFIG_PARAM_FLOAT("mot_i_max",    20.0,   1.0,     60.0)
+CONFIG_PARAM_FLOAT("mot_i_max_p",  0.2,    0.01,    2.0)
+
+/*
+ * The adaptive acceleration limiter (accel_limiter.h) is disabled by default. It is enabled by setting
+ * mot_acc_scl_min below 1, e.g. 0.1, which is the lowest scale of mot_dc_accel when the motor is close to
+ * losing sync; it should be tuned with tools/rtctl_sweep for the motor first.
+ */
+CONFIG_PARAM_FLOAT("mot_acc_scl_min", 1.0,  0.01,    1.0)       // Slew rate scale, 1 disables adaptive limiting
+CONFIG_PARAM_FLOAT("mot_acc_i_knee",  0.6,  0.1,     1.0)       // Fraction of mot_i_max
+CONFIG_PARAM_FLOAT("mot_acc_recov",   2.0,  0.1,     100.0)     // Slew rate scale per second
+
+
+void dc_limiter_configure(struct dc_limiter_params* params)
+{
+	assert(params);
+	params->min_voltage     = configGet("mot_v_min");
+	params->current_limit   = configGet("mot_i_max");
+	params->current_limit_p = configGet("mot_i_max_p");
+	params->dc_step_max     = configGet("mot_dc_accel");
+	params->dc_slope        = configGet("mot_dc_slope");
+
+	params->accel_limiter_params.scale_min     = configGet("mot_acc_scl_min");
+	params->accel_limiter_params.current_knee  = configGet("mot_acc_i_knee") * params->current_limit;
+	params->accel_limiter_params.current_limit = params->current_limit;
+	params->accel_limiter_params.recovery_rate = configGet("mot_acc_recov");
+	// Same as in motor_rtctl.c: the advance is at its maximum below mot_tim_cp_max, unless it exceeds mot_tim_cp_min
+	params->accel_limiter_params.comm_period_max_advance =
+		fminf(configGet("mot_tim_cp_max"), configGet("mot_tim_cp_min")) * HNSEC_PER_USEC;
+}
+
+void dc_limiter_reset(struct dc_limiter* limiter, uint64_t zc_failures)
+{
+	assert(limiter);
+	accel_limiter_reset(&limiter->accel_limiter, zc_failures);
+}
+
+static float limit_current(const struct dc_limiter_params* params, const struct dc_limiter_input* input,
+                           float new_duty_cycle, int* limit_mask)
+{
+	const bool overcurrent = input->current_for_limiter > params->current_limit;
+	const bool braking = input->dc_actual <= 0.0f || new_duty_cycle <= 0.0f;
+
+	if (overcurrent && !braking) {
+		const float error = input->current_for_limiter - params->current_limit;
+
+		const float comp = error * params->current_limit_p;
+		assert(comp >= 0.0f);
+
+		const float min_dc = params->min_voltage / input->voltage;
+
+		new_duty_cycle -= comp * input->dc_actual;
+		if (new_duty_cycle < min_dc) {
+			new_duty_cycle = min_dc;
+		}
+
+		*limit_mask |= MOTOR_LIMIT_CURRENT;
+	} else {
+		*limit_mask &= ~MOTOR_LIMIT_CURRENT;
+	}
+	return new_duty_cycle;
+}
+
+static float limit_slope(const struct dc_limiter_params* params, const struct dc_limiter_input* input,
+                         float new_duty_cycle, float accel_scale, int* limit_mask)
+{
+	// The adaptive limiter restricts only the acceleration, the deceleration is never slowed down
+	const float scale = (fabsf(new_duty_cycle) > fabsf(input->dc_actual)) ? accel_scale : 1.0f;
+
+	const float dc_step_max =
+		(fabsf(new_duty_cycle) + fabsf(input->dc_actual)) * 0.5f * params->dc_step_max * scale;
+	if (fabsf(new_duty_cycle - input->dc_actual) > dc_step_max) {
+		float step = params->dc_slope * scale * input->dt;
+
+		if (step > dc_step_max) {
+			step = dc_step_max;
+		}
+		if (new_duty_cycle < input->dc_actual) {
+			step = -step;
+		}
+		new_duty_cycle = input->dc_actual + step;
+		*limit_mask |= MOTOR_LIMIT_ACCEL;
+	} else {
+		*limit_mask &= ~MOTOR_LIMIT_ACCEL;
+	}
+	return new_duty_cycle;
+}
+
+float dc_limiter_update(struct dc_limiter* limiter, const struct dc_limiter_params* params,
+                        const struct dc_limiter_input* input, float new_duty_cycle, int* limit_mask)
+{
+	assert(limiter && params && input && limit_mask);
+
+	const struct accel_limiter_input accel_limiter_input = {
+		input->dt,
+		input->current,
+		input->zc_failures,
+		input->comm_period
+	};
+	const float accel_scale =
+		accel_limiter_update(&limiter->accel_limiter, &params->accel_limiter_params, &accel_limiter_input);
+
+	new_duty_cycle = limit_current(params, input, new_duty_cycle, limit_mask);
+	return limit_slope(params, input, new_duty_cycle, accel_scale, limit_mask);
+}
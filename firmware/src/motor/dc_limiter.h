@@ -0,0 +1,90 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include "accel_limiter.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Limiters of the duty cycle, applied after the primary control logic: the input current limit, then the limit
+ * of the slew rate, which is scaled by the adaptive acceleration limiter (see accel_limiter.h).
+ * The logic doesn't depend on the platform, so that the same code runs in the host simulator.
+ */
+struct dc_limiter
+{
+	struct accel_limiter accel_limiter;
+};
+
+struct dc_limiter_params
+{
+	float min_voltage;                  ///< Volts; the current limiter doesn't reduce the voltage below this
+	float current_limit;                ///< Amperes
+	float current_limit_p;              ///< Relative reduction of the duty cycle per ampere above the limit
+	float dc_step_max;                  ///< Relative to the duty cycle; larger changes are slewed
+	float dc_slope;                     ///< Duty cycle units per second
+	struct accel_limiter_params accel_limiter_params;
+};
+
+struct dc_limiter_input
+{
+	float dt;
+	float dc_actual;                    ///< Applied at the previous update
+	float voltage;                      ///< Volts
+	float current;                      ///< Amperes, filtered; for the acceleration limiter
+	float current_for_limiter;          ///< Amperes, filtered with a longer time constant; for the current limit
+	uint64_t zc_failures;               ///< Since the motor has started
+	uint32_t comm_period;
+};
+
+/**
+ * Reads the parameters from the configuration.
+ */
+void dc_limiter_configure(struct dc_limiter_params* params);
+
+void dc_limiter_reset(struct dc_limiter* limiter, uint64_t zc_failures);
+
+/**
+ * Updates MOTOR_LIMIT_CURRENT and MOTOR_LIMIT_ACCEL in the limit mask, see motor.h.
+ * @return the limited duty cycle
+ */
+float dc_limiter_update(struct dc_limiter* limiter, const struct dc_limiter_params* params,
+                        const struct dc_limiter_input* input, float new_duty_cycle, int* limit_mask);
+
+#ifdef __cplusplus
+}
+#endif
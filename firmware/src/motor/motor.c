@@ -34,9 +34,13 @@
 
 #include "motor.h"
 #include "rpmctl.h"
+#include "setpoint_shaper.h"
+#include "dc_limiter.h"
+#include "bench.h"
 #include "realtime/api.h"
 #include <math.h>
 #include <ch.h>
+#include <thread_stats.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -59,7 +63,9 @@ static unsigned comm_period_to_rpm(uint32_t comm_period);
 static int _watchdog_id;
 static MUTEX_DECL(_mutex);
 static EVENTSOURCE_DECL(_setpoint_update_event);
+static volatile uint32_t _setpoint_updated_at;           ///< See thread_stats_now()
 static THD_WORKING_AREA(_wa_control_thread, 1024);
+static struct bench_recorder* _bench_recorder;          ///< Protected by the mutex
 
 /*
  * TODO: Current implementation is a mess.
@@ -75,7 +81,16 @@ static struct state
 
 	unsigned rpm_setpoint;
 
+	struct setpoint_shaper voltage_shaper;          ///< Open loop setpoint in volts
+	struct setpoint_shaper rpm_shaper;
+	bool shapers_initialized;
+
+	struct dc_limiter dc_limiter;
+
+	bool start_locked_out;              ///< The motor must not start, see motor_lock_out_start()
+
 	int setpoint_ttl_ms;
+	uint64_t setpoint_apply_at;         ///< Resulting duty cycle is applied at this time, see motor_set_duty_cycle_at()
 	int num_unexpected_stops;
 
 	float input_voltage;
@@ -95,8 +110,9 @@ static struct params
 	float dc_min_voltage;
 	float dc_spinup_voltage;
 	float spinup_voltage_ramp_duration;
-	float dc_step_max;
-	float dc_slope;
+
+	struct setpoint_shaper_limits voltage_shaper_limits;
+	struct setpoint_shaper_limits rpm_shaper_limits;
 
 	int poles;
 	bool reverse;
@@ -105,8 +121,7 @@ static struct params
 	unsigned rpm_max;
 	unsigned rpm_min;
 
-	float current_limit;
-	float current_limit_p;
+	struct dc_limiter_params dc_limiter_params;
 
 	float voltage_current_lowpass_tau;
 	int num_unexpected_stops_to_latch;
@@ -116,17 +131,17 @@ static struct params
 CONFIG_PARAM_FLOAT("mot_v_min",        2.5,    0.5,     10.0)
 CONFIG_PARAM_FLOAT("mot_v_spinup",     0.5,    0.01,    10.0)
 CONFIG_PARAM_FLOAT("mot_spup_vramp_t", 3.0,    0.0,     10.0)
-CONFIG_PARAM_FLOAT("mot_dc_accel",     0.09,   0.001,   0.5)
-CONFIG_PARAM_FLOAT("mot_dc_slope",     5.0,    0.1,     20.0)
+
+CONFIG_PARAM_FLOAT("mot_sp_v_rate",    0.0,    0.0,     1000.0)         // V/s, zero disables shaping
+CONFIG_PARAM_FLOAT("mot_sp_v_accel",   0.0,    0.0,     100000.0)       // V/s^2, zero disables the accel limit
+CONFIG_PARAM_FLOAT("mot_sp_rpm_rate",  0.0,    0.0,     1000000.0)      // RPM/s, zero disables shaping
+CONFIG_PARAM_FLOAT("mot_sp_rpm_accel", 0.0,    0.0,     10000000.0)     // RPM/s^2, zero disables the accel limit
 
 CONFIG_PARAM_INT("mot_num_poles",  14,     2,       100)
 CONFIG_PARAM_INT("ctl_dir",        0,      0,       1)
 
 CONFIG_PARAM_INT("mot_rpm_min",    1000,   50,      5000)
 
-CONFIG_PARAM_FLOAT("mot_i_max",    20.0,   1.0,     60.0)
-CONFIG_PARAM_FLOAT("mot_i_max_p",  0.2,    0.01,    2.0)
-
 CONFIG_PARAM_FLOAT("mot_lpf_freq", 20.0,   1.0,     200.0)
 CONFIG_PARAM_INT("mot_stop_thres", 7,      1,       100)
 
@@ -136,8 +151,11 @@ static void configure(void)
 	_params.dc_min_voltage    = configGet("mot_v_min");
 	_params.dc_spinup_voltage = configGet("mot_v_spinup");
 	_params.spinup_voltage_ramp_duration = configGet("mot_spup_vramp_t");
-	_params.dc_step_max    = configGet("mot_dc_accel");
-	_params.dc_slope       = configGet("mot_dc_slope");
+
+	_params.voltage_shaper_limits.rate_max  = configGet("mot_sp_v_rate");
+	_params.voltage_shaper_limits.accel_max = configGet("mot_sp_v_accel");
+	_params.rpm_shaper_limits.rate_max      = configGet("mot_sp_rpm_rate");
+	_params.rpm_shaper_limits.accel_max     = configGet("mot_sp_rpm_accel");
 
 	_params.poles = configGet("mot_num_poles");
 	_params.reverse = configGet("ctl_dir");
@@ -146,8 +164,7 @@ static void configure(void)
 	_params.rpm_max = comm_period_to_rpm(_params.comm_period_limit);
 	_params.rpm_min = configGet("mot_rpm_min");
 
-	_params.current_limit = configGet("mot_i_max");
-	_params.current_limit_p = configGet("mot_i_max_p");
+	dc_limiter_configure(&_params.dc_limiter_params);
 
 	_params.voltage_current_lowpass_tau = 1.0f / configGet("mot_lpf_freq");
 	_params.num_unexpected_stops_to_latch = configGet("mot_stop_thres");
@@ -160,6 +177,7 @@ static void poll_beep(void)
 	const bool do_beep =
 		(_state.beep_frequency > 0) &&
 		(_state.beep_duration_msec > 0) &&
+		!_state.start_locked_out &&
 		(motor_rtctl_get_state() == MOTOR_RTCTL_STATE_IDLE);
 
 	if (do_beep) {
@@ -214,7 +232,9 @@ static void stop(bool expected)
 	_state.dc_actual = 0.0;
 	_state.dc_openloop_setpoint = 0.0;
 	_state.rpm_setpoint = 0;
+	_state.shapers_initialized = false;
 	_state.setpoint_ttl_ms = 0;
+	_state.setpoint_apply_at = 0;
 	_state.filtered_input_current_for_limiter = 0.0;
 	_state.rtctl_state = motor_rtctl_get_state();
 	if (expected) {
@@ -252,7 +272,8 @@ static void update_control_non_running(void)
 		(_state.mode == MOTOR_CONTROL_MODE_OPENLOOP && (_state.dc_openloop_setpoint > 0)) ||
 		(_state.mode == MOTOR_CONTROL_MODE_RPM && (_state.rpm_setpoint > 0));
 
-	if (need_start && (_state.num_unexpected_stops < _params.num_unexpected_stops_to_latch)) {
+	if (need_start && !_state.start_locked_out &&
+	    (_state.num_unexpected_stops < _params.num_unexpected_stops_to_latch)) {
 		const uint64_t timestamp = motor_rtctl_timestamp_hnsec();
 
 		_state.dc_actual = _params.dc_min_voltage / _state.input_voltage;
@@ -273,7 +294,7 @@ static void update_control_non_running(void)
 	}
 }
 
-static float update_control_open_loop(uint32_t comm_period)
+static float update_control_open_loop(uint32_t comm_period, float dt)
 {
 	const float min_dc = _params.dc_min_voltage / _state.input_voltage;
 
@@ -284,6 +305,17 @@ static float update_control_open_loop(uint32_t comm_period)
 		_state.dc_openloop_setpoint = min_dc;
 	}
 
+	/*
+	 * The setpoint is shaped in volts rather than in duty cycle, so that the limits are independent of the
+	 * bus voltage. Conversion back to duty cycle uses the present bus voltage.
+	 */
+	setpoint_shaper_update(&_state.voltage_shaper, &_params.voltage_shaper_limits,
+	                       _state.dc_openloop_setpoint * _state.input_voltage, dt);
+	float dc_setpoint = _state.voltage_shaper.value / _state.input_voltage;
+	if (dc_setpoint < min_dc) {
+		dc_setpoint = min_dc;
+	}
+
 	const uint32_t cp_limit = _params.comm_period_limit * 5 / 4;
 
 	if (comm_period < cp_limit) {
@@ -292,13 +324,13 @@ static float update_control_open_loop(uint32_t comm_period)
 		const float c0 = _params.comm_period_limit / 4;         // Reach zero dcyc at this comm period
 		const float dc = (comm_period - c0) / (c1 - c0);
 
-		if (dc < _state.dc_openloop_setpoint) {
+		if (dc < dc_setpoint) {
 			_state.limit_mask |= MOTOR_LIMIT_RPM;
 			return dc;
 		}
 	}
 	_state.limit_mask &= ~MOTOR_LIMIT_RPM;
-	return _state.dc_openloop_setpoint;
+	return dc_setpoint;
 }
 
 static float update_control_rpm(uint32_t comm_period, float dt)
@@ -310,60 +342,17 @@ static float update_control_rpm(uint32_t comm_period, float dt)
 		_state.rpm_setpoint = _params.rpm_min;
 	}
 
+	setpoint_shaper_update(&_state.rpm_shaper, &_params.rpm_shaper_limits, _state.rpm_setpoint, dt);
+
 	const struct rpmctl_input input = {
 		_state.limit_mask,
 		dt,
 		(float)comm_period_to_rpm(comm_period),
-		_state.rpm_setpoint
+		_state.rpm_shaper.value
 	};
 	return rpmctl_update(&input);
 }
 
-static float update_control_current_limit(float new_duty_cycle)
-{
-	const bool overcurrent = _state.filtered_input_current_for_limiter > _params.current_limit;
-	const bool braking = _state.dc_actual <= 0.0f || new_duty_cycle <= 0.0f;
-
-	if (overcurrent && !braking) {
-		const float error = _state.filtered_input_current_for_limiter - _params.current_limit;
-
-		const float comp = error * _params.current_limit_p;
-		assert(comp >= 0.0f);
-
-		const float min_dc = _params.dc_min_voltage / _state.input_voltage;
-
-		new_duty_cycle -= comp * _state.dc_actual;
-		if (new_duty_cycle < min_dc) {
-			new_duty_cycle = min_dc;
-		}
-
-		_state.limit_mask |= MOTOR_LIMIT_CURRENT;
-	} else {
-		_state.limit_mask &= ~MOTOR_LIMIT_CURRENT;
-	}
-	return new_duty_cycle;
-}
-
-static float update_control_dc_slope(float new_duty_cycle, float dt)
-{
-	const float dc_step_max = (fabsf(new_duty_cycle) + fabsf(_state.dc_actual)) * 0.5f * _params.dc_step_max;
-	if (fabsf(new_duty_cycle - _state.dc_actual) > dc_step_max) {
-		float step = _params.dc_slope * dt;
-
-		if (step > dc_step_max) {
-			step = dc_step_max;
-		}
-		if (new_duty_cycle < _state.dc_actual) {
-			step = -step;
-		}
-		new_duty_cycle = _state.dc_actual + step;
-		_state.limit_mask |= MOTOR_LIMIT_ACCEL;
-	} else {
-		_state.limit_mask &= ~MOTOR_LIMIT_ACCEL;
-	}
-	return new_duty_cycle;
-}
-
 static void update_control(uint32_t comm_period, float dt)
 {
 	/*
@@ -384,12 +373,22 @@ static void update_control(uint32_t comm_period, float dt)
 		return;
 	}
 
+	/*
+	 * Setpoint shapers start from the actual state of the motor
+	 */
+	if (!_state.shapers_initialized) {
+		setpoint_shaper_reset(&_state.voltage_shaper, _state.dc_actual * _state.input_voltage);
+		setpoint_shaper_reset(&_state.rpm_shaper, (float)comm_period_to_rpm(comm_period));
+		dc_limiter_reset(&_state.dc_limiter, motor_rtctl_get_zc_failures_since_start());
+		_state.shapers_initialized = true;
+	}
+
 	/*
 	 * Primary control logic; can return NAN to stop the motor
 	 */
 	float new_duty_cycle = nan("");
 	if (_state.mode == MOTOR_CONTROL_MODE_OPENLOOP) {
-		new_duty_cycle = update_control_open_loop(comm_period);
+		new_duty_cycle = update_control_open_loop(comm_period, dt);
 	}
 	else if (_state.mode == MOTOR_CONTROL_MODE_RPM) {
 		new_duty_cycle = update_control_rpm(comm_period, dt);
@@ -404,14 +403,28 @@ static void update_control(uint32_t comm_period, float dt)
 	/*
 	 * Limiters
 	 */
-	new_duty_cycle = update_control_current_limit(new_duty_cycle);
-	new_duty_cycle = update_control_dc_slope(new_duty_cycle, dt);
+	const struct dc_limiter_input dc_limiter_input = {
+		dt,
+		_state.dc_actual,
+		_state.input_voltage,
+		_state.input_current,
+		_state.filtered_input_current_for_limiter,
+		motor_rtctl_get_zc_failures_since_start(),
+		comm_period
+	};
+	new_duty_cycle = dc_limiter_update(&_state.dc_limiter, &_params.dc_limiter_params, &dc_limiter_input,
+	                                   new_duty_cycle, &_state.limit_mask);
 
 	/*
 	 * Update
 	 */
 	_state.dc_actual = new_duty_cycle;
-	motor_rtctl_set_duty_cycle(_state.dc_actual);
+	if (_state.setpoint_apply_at > motor_rtctl_timestamp_hnsec()) {
+		motor_rtctl_set_duty_cycle_at(_state.dc_actual, _state.setpoint_apply_at);
+	} else {
+		_state.setpoint_apply_at = 0;       // Applied; the following updates of the same setpoint are immediate
+		motor_rtctl_set_duty_cycle(_state.dc_actual);
+	}
 }
 
 static void update_setpoint_ttl(int dt_ms)
@@ -428,6 +441,15 @@ static void update_setpoint_ttl(int dt_ms)
 	}
 }
 
+/**
+ * Wakes the control thread to process the new setpoint immediately; the iteration is due now, see thread_stats.h.
+ */
+static void wake_control_thread(void)
+{
+	_setpoint_updated_at = thread_stats_now();
+	chEvtBroadcastFlags(&_setpoint_update_event, ALL_EVENTS);
+}
+
 static void control_thread(void* arg)
 {
 	(void)arg;
@@ -437,6 +459,7 @@ static void control_thread(void* arg)
 	chEvtRegisterMask(&_setpoint_update_event, &listener, ALL_EVENTS);
 
 	uint64_t timestamp_hnsec = motor_rtctl_timestamp_hnsec();
+	systime_t release = chVTGetSystemTime();
 
 	while (1) {
 		/*
@@ -466,11 +489,36 @@ static void control_thread(void* arg)
 		}
 
 		/*
+		 * The iterations are released every control period, counted from the previous release rather than from
+		 * the end of the previous iteration, so that the time spent in the iteration doesn't shift the schedule.
+		 * A setpoint update releases the iteration earlier, and the schedule continues from it.
+		 * An iteration that is late by more than a period, e.g. because of a start, restarts the schedule.
+		 *
 		 * The event must be set only when the mutex is unlocked.
 		 * Otherwise this thread will take control, stumble upon the locked mutex, return the control
 		 * to the thread that holds the mutex, unlock the mutex, then proceed.
 		 */
-		chEvtWaitAnyTimeout(ALL_EVENTS, MS2ST(control_period_ms));
+		const systime_t period = MS2ST(control_period_ms);
+		release += period;
+		const systime_t now = chVTGetSystemTime();
+		uint32_t released_at = 0;
+		if (chVTIsTimeWithinX(now, release - period, release)) {
+			if (chEvtWaitAnyTimeout(ALL_EVENTS, release - now) != 0) {
+				released_at = _setpoint_updated_at;
+				release = chVTGetSystemTime();
+			} else {
+				released_at = thread_stats_get_tick_time(release);
+			}
+		} else {
+			(void)chEvtWaitAnyTimeout(ALL_EVENTS, TIME_IMMEDIATE);
+			released_at = thread_stats_get_tick_time(release);
+			if (!chVTIsTimeWithinX(now, release, release + period)) {
+				release = now;
+			}
+		}
+
+		// The iteration must complete before the next one is due, otherwise the control rate can't be sustained
+		thread_stats_begin(THREAD_STATS_MOTOR, released_at);
 
 		chMtxLock(&_mutex);
 
@@ -485,10 +533,19 @@ static void control_thread(void* arg)
 		update_setpoint_ttl(dt_hnsec / HNSEC_PER_MSEC);
 		update_control(comm_period, dt);
 
+		if (_bench_recorder != NULL) {
+			bench_recorder_push(_bench_recorder, new_timestamp_hnsec,
+			                    comm_period_to_rpm(motor_rtctl_get_comm_period_hnsec()), _state.input_current,
+			                    motor_rtctl_get_state() == MOTOR_RTCTL_STATE_RUNNING,
+			                    motor_rtctl_get_zc_failures_since_start());
+		}
+
 		poll_beep();
 
 		chMtxUnlock(&_mutex);
 
+		thread_stats_end(THREAD_STATS_MOTOR, control_period_ms * 1000);
+
 		watchdogReset(_watchdog_id);
 	}
 
@@ -531,6 +588,20 @@ int motor_init(float current_shunt_resistance)
 	return 0;
 }
 
+/**
+ * The deadline of a setpoint that was not applied by update_control() yet is kept unless the new one is earlier.
+ * Otherwise a stream of setpoints that arrive faster than the deadline offset would keep moving it forward and
+ * never get applied; likewise, a setpoint that arrives right past the deadline, before the next commutation,
+ * would replace the due value in the real time code with one scheduled later. The value of the latest setpoint
+ * is used either way. Must be called with the mutex locked.
+ */
+static void schedule_setpoint(uint64_t apply_at_hnsec)
+{
+	if ((_state.setpoint_apply_at == 0) || (apply_at_hnsec < _state.setpoint_apply_at)) {
+		_state.setpoint_apply_at = apply_at_hnsec;
+	}
+}
+
 void motor_stop(void)
 {
 	chMtxLock(&_mutex);
@@ -539,18 +610,25 @@ void motor_stop(void)
 }
 
 void motor_set_duty_cycle(float dc, int ttl_ms)
+{
+	motor_set_duty_cycle_at(dc, ttl_ms, 0);
+}
+
+void motor_set_duty_cycle_at(float dc, int ttl_ms, uint64_t apply_at_hnsec)
 {
 	chMtxLock(&_mutex);
 
 	if (_state.mode != MOTOR_CONTROL_MODE_OPENLOOP) {
 		_state.mode = MOTOR_CONTROL_MODE_OPENLOOP;
 		_state.limit_mask = 0;
+		_state.shapers_initialized = false;
 	}
 
 	if (dc < 0.0) { dc = 0.0; }
 	if (dc > 1.0) { dc = 1.0; }
 	_state.dc_openloop_setpoint = dc;
 	_state.setpoint_ttl_ms = ttl_ms;
+	schedule_setpoint(apply_at_hnsec);
 
 	if (dc == 0.0) {
 		_state.num_unexpected_stops = 0;
@@ -558,17 +636,22 @@ void motor_set_duty_cycle(float dc, int ttl_ms)
 
 	chMtxUnlock(&_mutex);
 
-	// Wake the control thread to process the new setpoint immediately
-	chEvtBroadcastFlags(&_setpoint_update_event, ALL_EVENTS);
+	wake_control_thread();
 }
 
 void motor_set_rpm(unsigned rpm, int ttl_ms)
+{
+	motor_set_rpm_at(rpm, ttl_ms, 0);
+}
+
+void motor_set_rpm_at(unsigned rpm, int ttl_ms, uint64_t apply_at_hnsec)
 {
 	chMtxLock(&_mutex);
 
 	if (_state.mode != MOTOR_CONTROL_MODE_RPM) {
 		_state.mode = MOTOR_CONTROL_MODE_RPM;
 		_state.limit_mask = 0;
+		_state.shapers_initialized = false;
 	}
 
 	if (rpm > _params.rpm_max) {
@@ -576,6 +659,7 @@ void motor_set_rpm(unsigned rpm, int ttl_ms)
 	}
 	_state.rpm_setpoint = rpm;
 	_state.setpoint_ttl_ms = ttl_ms;
+	schedule_setpoint(apply_at_hnsec);
 
 	if (rpm == 0) {
 		_state.num_unexpected_stops = 0;
@@ -583,8 +667,12 @@ void motor_set_rpm(unsigned rpm, int ttl_ms)
 
 	chMtxUnlock(&_mutex);
 
-	// Wake the control thread to process the new setpoint immediately
-	chEvtBroadcastFlags(&_setpoint_update_event, ALL_EVENTS);
+	wake_control_thread();
+}
+
+uint64_t motor_get_timestamp_hnsec(void)
+{
+	return motor_rtctl_timestamp_hnsec();
 }
 
 float motor_get_duty_cycle(void)
@@ -604,6 +692,11 @@ unsigned motor_get_rpm(void)
 	return rpm;
 }
 
+unsigned motor_get_num_poles(void)
+{
+	return (unsigned)_params.poles;
+}
+
 enum motor_control_mode motor_get_control_mode(void)
 {
 	chMtxLock(&_mutex);
@@ -628,6 +721,24 @@ bool motor_is_idle(void)
 	return ret;
 }
 
+bool motor_lock_out_start(void)
+{
+	chMtxLock(&_mutex);
+	const bool idle = motor_rtctl_get_state() == MOTOR_RTCTL_STATE_IDLE;
+	if (idle) {
+		_state.start_locked_out = true;
+	}
+	chMtxUnlock(&_mutex);
+	return idle;
+}
+
+void motor_release_start_lockout(void)
+{
+	chMtxLock(&_mutex);
+	_state.start_locked_out = false;
+	chMtxUnlock(&_mutex);
+}
+
 bool motor_is_blocked(void)
 {
 	chMtxLock(&_mutex);
@@ -664,6 +775,12 @@ void motor_confirm_initialization(void)
 	chMtxUnlock(&_mutex);
 }
 
+bool motor_get_phase_currents(float out_currents[3])
+{
+	// No lock needed
+	return motor_rtctl_get_phase_currents(out_currents);
+}
+
 uint64_t motor_get_zc_failures_since_start(void)
 {
 	// No lock needed
@@ -724,7 +841,7 @@ void motor_beep(int frequency, int duration_msec)
 		_state.beep_frequency = frequency;
 		_state.beep_duration_msec = duration_msec;
 		chMtxUnlock(&_mutex);
-		chEvtBroadcastFlags(&_setpoint_update_event, ALL_EVENTS); // Wake the control thread
+		wake_control_thread();
 	} else {
 		chMtxUnlock(&_mutex);
 	}
@@ -737,6 +854,13 @@ void motor_print_debug_info(void)
 	chMtxUnlock(&_mutex);
 }
 
+void motor_set_bench_recorder(struct bench_recorder* recorder)
+{
+	chMtxLock(&_mutex);
+	_bench_recorder = recorder;
+	chMtxUnlock(&_mutex);
+}
+
 void motor_emergency(void)
 {
 	motor_rtctl_emergency();
@@ -84,6 +84,24 @@ void motor_set_duty_cycle(float dc, int ttl_ms);
  */
 void motor_set_rpm(unsigned rpm, int ttl_ms);
 
+/**
+ * Same as above, but the resulting duty cycle is applied at the specified time rather than immediately.
+ * This allows several motor controllers to react to a common command at the same instant.
+ * If the time is in the past, the setpoint is applied immediately.
+ * A setpoint that arrives before the previous one was applied replaces its value, but is applied at the time
+ * of the previous one, so that a fast stream of setpoints cannot postpone the application indefinitely.
+ * In the six-step mode the new duty cycle takes effect within one ADC sampling period past the specified time,
+ * unless the motor is spinning up or recovering the sync, where it waits for the next commutation.
+ * @param [in] apply_at_hnsec   See motor_get_timestamp_hnsec()
+ */
+void motor_set_duty_cycle_at(float dc, int ttl_ms, uint64_t apply_at_hnsec);
+void motor_set_rpm_at(unsigned rpm, int ttl_ms, uint64_t apply_at_hnsec);
+
+/**
+ * Monotonic time of the motor controller in hectonanoseconds.
+ */
+uint64_t motor_get_timestamp_hnsec(void);
+
 /**
  * Returns current duty cycle.
  */
@@ -94,6 +112,11 @@ float motor_get_duty_cycle(void);
  */
 unsigned motor_get_rpm(void);
 
+/**
+ * Number of magnetic poles of the motor, as configured; electrical RPM = RPM * poles / 2.
+ */
+unsigned motor_get_num_poles(void);
+
 void motor_stop(void);
 
 enum motor_control_mode motor_get_control_mode(void);
@@ -110,6 +133,15 @@ bool motor_is_running(void);
  */
 bool motor_is_idle(void);
 
+/**
+ * Prevents the motor from starting (and beeping) until motor_release_start_lockout() is called.
+ * This is needed for flash IO, which stalls the CPU.
+ * @return True if the lockout is engaged; false if the motor is not idle, in which case nothing is changed.
+ */
+bool motor_lock_out_start(void);
+
+void motor_release_start_lockout(void);
+
 /**
  * Returns true if the motor controller has given up trying to start.
  * @return True if the motor controller is locked.
@@ -128,6 +160,13 @@ int motor_get_limit_mask(void);
  */
 void motor_get_input_voltage_current(float* out_voltage, float* out_current);
 
+/**
+ * Returns RMS phase currents in amperes, if available in the current commutation mode.
+ * @param [out] out_currents Amperes, phases A, B, C
+ * @return true if the values are available
+ */
+bool motor_get_phase_currents(float out_currents[3]);
+
 /**
  * Simple wrappers; refer to RTCTL API docs to learn more
  * @{
@@ -145,6 +184,13 @@ void motor_execute_cli_command(int argc, const char* argv[]);
  * @}
  */
 
+/**
+ * The recorder is updated from the control loop at its rate until detached; pass NULL to detach.
+ * It must not be accessed by the caller while attached. See bench.h.
+ */
+struct bench_recorder;
+void motor_set_bench_recorder(struct bench_recorder* recorder);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,8 @@ extern "C" {
 extern const int MOTOR_ADC_SYNC_ADVANCE_NANOSEC;
 extern const int MOTOR_ADC_SAMPLE_WINDOW_NANOSEC;
 extern const int MOTOR_ADC_MIN_BLANKING_TIME_NANOSEC;
+extern const int MOTOR_ADC_CURRENT_SETTLING_NANOSEC;
+extern const int MOTOR_ADC_CURRENT_SAMPLE_NANOSEC;
 
 
 struct motor_adc_sample
@@ -53,6 +56,7 @@ struct motor_adc_sample
     int phase_values[3];
     int input_voltage;
     int input_current;
+    int input_current_aux;      ///< Only in the current sampling mode, see motor_pwm_set_duties_from_isr()
 };
 
 
@@ -61,6 +65,13 @@ int motor_adc_init(float current_shunt_resistance);
 void motor_adc_enable_from_isr(void);
 void motor_adc_disable_from_isr(void);
 
+/**
+ * In the current sampling mode the phase voltages are not sampled; instead, the input current is sampled twice
+ * per PWM period - once with the input voltage at the main trigger, and once more at the auxiliary trigger.
+ * The change takes effect from the next PWM period. Can be called from any context.
+ */
+void motor_adc_set_current_sampling_mode(bool enabled);
+
 struct motor_adc_sample motor_adc_get_last_sample(void);
 
 float motor_adc_convert_input_voltage(int raw);
@@ -120,6 +120,19 @@ void motor_rtctl_stop(void);
  */
 void motor_rtctl_set_duty_cycle(float duty_cycle);
 
+/**
+ * Same as motor_rtctl_set_duty_cycle(), but the new duty cycle is applied by the real time code once the
+ * specified timestamp is reached. In the six-step mode the PWM value of the current step is updated by the first
+ * ADC callback past the timestamp, i.e. late by up to one ADC sampling period plus the IRQ latency; in the spinup
+ * and in the sync recovery it takes effect at the first commutation past the timestamp instead. With sinusoidal
+ * commutation, it takes effect at the first PWM period past the timestamp.
+ * A subsequent call of either function overrides the scheduled value; if the value is still pending, the new one
+ * is applied the same way.
+ * @param [in] duty_cycle       Same as motor_rtctl_set_duty_cycle()
+ * @param [in] timestamp_hnsec  See motor_rtctl_timestamp_hnsec()
+ */
+void motor_rtctl_set_duty_cycle_at(float duty_cycle, uint64_t timestamp_hnsec);
+
 /**
  * Returns motor state.
  */
@@ -157,6 +170,12 @@ void motor_rtctl_emergency(void);
  */
 void motor_rtctl_get_input_voltage_current(float* out_voltage, float* out_current);
 
+/**
+ * Returns RMS phase currents reconstructed from the DC link current, in amperes.
+ * This is only available while the sinusoidal commutation is active; otherwise returns false.
+ */
+bool motor_rtctl_get_phase_currents(float out_currents[3]);
+
 /**
  * Minimum safe comm period. Depends on PWM frequency.
  */
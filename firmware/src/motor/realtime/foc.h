@@ -0,0 +1,113 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "adc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sensorless field oriented control with sinusoidal commutation.
+ * The motor is started and brought up to speed by the six-step commutation logic, which then hands over to
+ * this module once the speed is high enough for the flux observer to track the rotor angle reliably.
+ * The voltage vector is kept in quadrature with the rotor flux; its amplitude is defined by the duty cycle,
+ * so that the higher level control logic is the same for both commutation modes.
+ *
+ * Electrical angles are represented as uint16, where 65536 corresponds to the full electrical revolution.
+ * Phase A is aligned with the alpha axis.
+ */
+enum motor_foc_result
+{
+	MOTOR_FOC_RESULT_OK,
+	MOTOR_FOC_RESULT_EXIT,       ///< Speed is too low or braking is requested, must return to six-step commutation
+	MOTOR_FOC_RESULT_FAILED      ///< The observer has lost the rotor
+};
+
+void motor_foc_init(void);
+
+/**
+ * Whether the sinusoidal commutation is enabled via configuration.
+ */
+bool motor_foc_is_enabled(void);
+
+/**
+ * Six-step commutation hands over to FOC once the comm period is below this value.
+ */
+uint32_t motor_foc_get_handover_comm_period_hnsec(void);
+
+/**
+ * Duty cycle in [-1; 1]; the amplitude of the voltage vector is proportional to it.
+ * Can be called from any context.
+ */
+void motor_foc_set_duty_cycle(float duty_cycle);
+
+/**
+ * Takes control over the PWM.
+ * @param [in] angle            Current electrical angle of the rotor flux
+ * @param [in] comm_period      Current commutation period (1/6 of the electrical period), hnsec
+ * @param [in] direction        Positive if the electrical angle increases, negative otherwise
+ */
+void motor_foc_start_from_isr(uint16_t angle, uint32_t comm_period, int direction);
+
+/**
+ * Shall be called from the ADC callback while FOC is active.
+ */
+enum motor_foc_result motor_foc_update_from_isr(const struct motor_adc_sample* sample);
+
+uint16_t motor_foc_get_angle(void);
+
+/**
+ * Commutation period equivalent to the current electrical speed, for compatibility with the six-step logic.
+ */
+uint32_t motor_foc_get_comm_period_hnsec(void);
+
+/**
+ * Input current estimated from the phase currents and voltages, in raw ADC units.
+ */
+int motor_foc_get_input_current_raw(void);
+
+/**
+ * RMS phase currents reconstructed from the DC link current, in amperes.
+ */
+void motor_foc_get_phase_currents(float out_currents[3]);
+
+void motor_foc_print_debug_info(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -39,6 +39,7 @@
 #include "irq.h"
 #include <ch.h>
 #include <hal.h>
+#include <rtos_trace.h>
 #include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -69,18 +70,68 @@ const int MOTOR_ADC_SAMPLE_WINDOW_NANOSEC = SAMPLE_DURATION_NANOSEC * NUM_SAMPLE
  */
 const int MOTOR_ADC_MIN_BLANKING_TIME_NANOSEC = 9000;
 
+/**
+ * The input current is converted first in the sequence, so it only takes one sample duration.
+ * The settling time is dictated by the response time of the current sense amplifier.
+ */
+const int MOTOR_ADC_CURRENT_SETTLING_NANOSEC = 1500;
+const int MOTOR_ADC_CURRENT_SAMPLE_NANOSEC = SAMPLE_DURATION_NANOSEC;
+
 
 static float _shunt_resistance = 0;
 
 static uint32_t _adc1_2_dma_buffer[NUM_SAMPLES_PER_ADC];
 static struct motor_adc_sample _sample;
 
+static bool _current_sampling_mode;
+static volatile bool _current_sampling_mode_requested;
+
+
+/**
+ * Must be invoked when the ADC is idle, i.e. from the ADC IRQ.
+ */
+static void configure_sequence(bool current_sampling_mode)
+{
+	_current_sampling_mode = current_sampling_mode;
+
+	// The DMA counter has just been reloaded, so it's safe to change the transfer length
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel1->CNDTR = current_sampling_mode ? 1 : NUM_SAMPLES_PER_ADC;
+	DMA1_Channel1->CCR |= DMA_CCR_EN;
+
+	// Only the first conversion (VOLT, CURR) is kept in the current sampling mode
+	const uint32_t sqr1 = current_sampling_mode ? 0 : (ADC_SQR1_L_0 | ADC_SQR1_L_1);
+	ADC1->SQR1 = sqr1;
+	ADC2->SQR1 = sqr1;
+
+	// Changing the other bits together with ADON does not start a conversion
+	if (current_sampling_mode) {
+		ADC1->CR2 |= ADC_CR2_JEXTTRIG;
+	} else {
+		ADC1->CR2 &= ~ADC_CR2_JEXTTRIG;
+	}
+}
+
 
 __attribute__((optimize(3)))
 CH_FAST_IRQ_HANDLER(Vector88)	// ADC1 + ADC2 handler
 {
+	rtos_trace_irq_enter();
+
+	/*
+	 * If the mode was changed while the IRQ was disabled, this sample was acquired with the old sequence
+	 * and has to be dropped.
+	 */
+	if (_current_sampling_mode != _current_sampling_mode_requested) {
+		configure_sequence(_current_sampling_mode_requested);
+		ADC1->SR = 0;
+		rtos_trace_irq_exit();
+		return;
+	}
+
+	const int num_samples = _current_sampling_mode ? 1 : NUM_SAMPLES_PER_ADC;
 	_sample.timestamp = motor_timer_hnsec() -
-		((SAMPLE_DURATION_NANOSEC * NUM_SAMPLES_PER_ADC) / 2) / NSEC_PER_HNSEC;
+		((SAMPLE_DURATION_NANOSEC * num_samples) / 2) / NSEC_PER_HNSEC;
 
 #define SMPLADC1(num)     (_adc1_2_dma_buffer[num] & 0xFFFFU)
 #define SMPLADC2(num)     (_adc1_2_dma_buffer[num] >> 16)
@@ -88,10 +139,15 @@ CH_FAST_IRQ_HANDLER(Vector88)	// ADC1 + ADC2 handler
 	 * ADC channel sampling:
 	 *   VOLT A A C
 	 *   CURR C B B
+	 * In the current sampling mode only the first column is sampled, plus the injected CURR on ADC1.
 	 */
-	_sample.phase_values[0] = (SMPLADC1(1) + SMPLADC1(2)) / 2;
-	_sample.phase_values[1] = (SMPLADC2(2) + SMPLADC2(3)) / 2;
-	_sample.phase_values[2] = (SMPLADC2(1) + SMPLADC1(3)) / 2;
+	if (_current_sampling_mode) {
+		_sample.input_current_aux = ADC1->JDR1;
+	} else {
+		_sample.phase_values[0] = (SMPLADC1(1) + SMPLADC1(2)) / 2;
+		_sample.phase_values[1] = (SMPLADC2(2) + SMPLADC2(3)) / 2;
+		_sample.phase_values[2] = (SMPLADC2(1) + SMPLADC1(3)) / 2;
+	}
 
 	_sample.input_voltage = SMPLADC1(0);
 	_sample.input_current = SMPLADC2(0);
@@ -101,7 +157,14 @@ CH_FAST_IRQ_HANDLER(Vector88)	// ADC1 + ADC2 handler
 
 	motor_adc_sample_callback(&_sample);
 
+	// The callback may have changed the mode; applying it right away so that the next sample is not lost
+	if (_current_sampling_mode != _current_sampling_mode_requested) {
+		configure_sequence(_current_sampling_mode_requested);
+	}
+
 	ADC1->SR = 0;         // Reset the IRQ flags
+
+	rtos_trace_irq_exit();
 }
 
 static void adc_calibrate(ADC_TypeDef* const adc)
@@ -159,6 +222,7 @@ static void enable(void)
 	 * the overall sampling time.
 	 */
 	ADC1->SQR1 = ADC_SQR1_L_0 | ADC_SQR1_L_1;
+	ADC1->JSQR = ADC_JSQR_JSQ4_2 | ADC_JSQR_JSQ4_0;      // CURR, injected, see configure_sequence()
 	ADC1->SQR3 =
 		ADC_SQR3_SQ1_2 |
 		ADC_SQR3_SQ2_0 |
@@ -176,7 +240,7 @@ static void enable(void)
 
 	// ADC initialization
 	ADC1->CR1 = ADC_CR1_DUALMOD_1 | ADC_CR1_DUALMOD_2 | ADC_CR1_SCAN | ADC_CR1_EOCIE;
-	ADC1->CR2 = ADC_CR2_ADON | ADC_CR2_EXTTRIG | MOTOR_ADC1_2_TRIGGER | ADC_CR2_DMA;
+	ADC1->CR2 = ADC_CR2_ADON | ADC_CR2_EXTTRIG | MOTOR_ADC1_2_TRIGGER | ADC_CR2_DMA | MOTOR_ADC1_INJECTED_TRIGGER;
 
 	ADC2->CR1 = ADC_CR1_DUALMOD_1 | ADC_CR1_DUALMOD_2 | ADC_CR1_SCAN;
 	ADC2->CR2 = ADC_CR2_ADON | ADC_CR2_EXTTRIG | ADC_CR2_EXTSEL_0 | ADC_CR2_EXTSEL_1 | ADC_CR2_EXTSEL_2;
@@ -227,6 +291,11 @@ void motor_adc_disable_from_isr(void)
 	ADC1->CR1 &= ~ADC_CR1_EOCIE;
 }
 
+void motor_adc_set_current_sampling_mode(bool enabled)
+{
+	_current_sampling_mode_requested = enabled;
+}
+
 struct motor_adc_sample motor_adc_get_last_sample(void)
 {
 	struct motor_adc_sample ret;
@@ -36,6 +36,8 @@
 #include "adc.h"
 #include "pwm.h"
 #include "irq.h"
+#include "timer.h"
+#include "trace.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -60,6 +62,21 @@ void motor_rtctl_execute_cli_command(int argc, const char* argv[])
 		return;
 	}
 
+	if ((argc > 0) && !strcmp("trace", argv[0])) {  // trace [arm [delay_ms]]
+		if ((argc > 1) && !strcmp("arm", argv[1])) {
+			const int delay_ms = (argc > 2) ? atoi(argv[2]) : 0;
+			if ((delay_ms < 0) || (delay_ms > 60000)) {
+				puts("ERROR: Invalid delay");
+				return;
+			}
+			motor_trace_arm(delay_ms * HNSEC_PER_MSEC);
+			printf("Trace armed, will be triggered %d ms after the next start\n", delay_ms);
+		} else {
+			motor_trace_print();
+		}
+		return;
+	}
+
 	const struct motor_adc_sample adc_sample = motor_adc_get_last_sample();
 
 	printf("ADC raw phases:  %i  %i  %i\n",
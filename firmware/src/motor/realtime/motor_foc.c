@@ -0,0 +1,645 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "foc.h"
+#include "internal.h"
+#include "pwm.h"
+#include "timer.h"
+#include "irq.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include <zubax_chibios/config/config.h>
+
+/**
+ * One commutation step, i.e. 60 electrical degrees
+ */
+#define ANGLE_60_DEG               10923
+#define ANGLE_90_DEG               16384
+
+#define Q15_ONE_OVER_SQRT3         18919
+#define Q15_SQRT3_OVER_2           28378
+
+/**
+ * Speed is represented as the angle increment per PWM period with this many fractional bits
+ */
+#define OMEGA_FRAC_BITS            8
+
+/**
+ * The observer is considered to have lost the rotor if the flux magnitude error stays large for about this
+ * number of PWM periods
+ */
+#define OBSERVER_FAILURE_PERIODS   1000
+
+/**
+ * Phase current readings older than this number of PWM periods are not used for reconstruction
+ */
+#define CURRENT_MAX_AGE_PERIODS    4
+
+/**
+ * Time constant of the phase current RMS filters, in PWM periods, log2
+ */
+#define CURRENT_RMS_TAU_SHIFT      10
+
+#undef MIN
+#undef MAX
+#define MIN(a, b)                  (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)                  (((a) > (b)) ? (a) : (b))
+
+/**
+ * One full period of sine in Q15
+ */
+static const int16_t SINE_TABLE[256] = {
+	     0,    804,   1608,   2410,   3212,   4011,   4808,   5602,   6393,   7179,   7962,   8739,
+	  9512,  10278,  11039,  11793,  12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+	 18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,  23170,  23731,  24279,  24811,
+	 25329,  25832,  26319,  26790,  27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+	 30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,  32137,  32285,  32412,  32521,
+	 32609,  32678,  32728,  32757,  32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+	 32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,  30273,  29956,  29621,  29268,
+	 28898,  28510,  28105,  27683,  27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+	 23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,  18204,  17530,  16846,  16151,
+	 15446,  14732,  14010,  13279,  12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+	  6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,      0,   -804,  -1608,  -2410,
+	 -3212,  -4011,  -4808,  -5602,  -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+	-12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159,
+	-20787, -21403, -22005, -22594, -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+	-27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+	-31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+	-32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580,
+	-31356, -31113, -30852, -30571, -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+	-27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403,
+	-20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+	-12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,  -6393,  -5602,  -4808,  -4011,
+	 -3212,  -2410,  -1608,   -804
+};
+
+/*
+ * Units used in the real time code:
+ *   current  - mA
+ *   voltage  - mV
+ *   flux     - 1e-4 uWb, i.e. mV * hnsec
+ *   time     - hnsec
+ */
+static struct state
+{
+	int direction;
+	uint16_t angle;
+	int32_t omega;
+
+	int32_t flux_integral[2];
+	int32_t flux_error;
+	unsigned observer_failures;
+
+	int32_t phase_currents[MOTOR_NUM_PHASES];
+	uint32_t phase_currents_updated_at[MOTOR_NUM_PHASES];
+	uint64_t phase_currents_mean_sq[MOTOR_NUM_PHASES];      ///< mA^2, Q(CURRENT_RMS_TAU_SHIFT)
+	int sampled_phase_low;                  ///< Sampled at the auxiliary trigger, negative if none
+	int sampled_phase_high;                 ///< Sampled at the main trigger, negative if none
+	int pwm_carry[MOTOR_NUM_PHASES];        ///< Shift of the PWM edges to be compensated in the next period
+
+	int32_t i_alpha;
+	int32_t i_beta;
+	int32_t i_d;
+	int32_t i_q;
+	int32_t v_alpha;                        ///< Applied during the current PWM period
+	int32_t v_beta;
+	int32_t v_d;
+	int32_t v_q;
+	int32_t input_current;
+
+	uint32_t period_counter;
+	uint32_t current_samples_skipped;
+} _state;
+
+static struct precomputed_params
+{
+	bool enabled;
+
+	int32_t resistance;                     ///< mOhm
+	int32_t inductance;                     ///< Flux units per mA
+	int32_t flux;
+	int64_t flux_sq;
+	int flux_sq_shift;                      ///< Brings flux_sq into the range [2^15, 2^16)
+	int observer_gain_shift;
+
+	uint32_t handover_comm_period;
+	int32_t omega_min;
+	int32_t sampling_period;
+	uint32_t comm_period_mult;              ///< Divided by omega yields the comm period
+	int32_t decoupling_mult;
+
+	int32_t input_voltage_mult;             ///< mV per LSB, Q16
+	int32_t input_current_mult;             ///< mA per LSB, Q16
+
+	int pwm_top;
+	int pwm_margin;
+	int current_settling;
+	int current_window;
+} _params;
+
+static volatile int32_t _duty_cycle_q16;
+
+
+CONFIG_PARAM_BOOL("mot_foc_enable",     false)
+CONFIG_PARAM_INT("mot_foc_r_mohm",      100,   1,     1000)     // milliohm
+CONFIG_PARAM_INT("mot_foc_l_uh",        20,    1,     2000)     // microhenry
+CONFIG_PARAM_INT("mot_foc_flux_uwb",    500,   10,    50000)    // microweber
+CONFIG_PARAM_INT("mot_foc_cp_max",      500,   100,   10000)    // microsecond
+CONFIG_PARAM_INT("mot_foc_obs_sh",      6,     0,     16)       // dimensionless
+
+void motor_foc_init(void)
+{
+	_params.enabled = configGet("mot_foc_enable");
+
+	/*
+	 * Motor parameters are per phase. The flux linkage can be derived from the velocity constant Kv [RPM/V]
+	 * and the number of pole pairs as 60 / (sqrt(3) * 2 * pi * Kv * pole_pairs).
+	 */
+	_params.resistance = configGet("mot_foc_r_mohm");
+	_params.inductance = configGet("mot_foc_l_uh") * 10;
+	_params.flux       = configGet("mot_foc_flux_uwb") * 10000;
+	_params.flux_sq    = (int64_t)_params.flux * (int64_t)_params.flux;
+
+	_params.flux_sq_shift = 0;
+	while ((_params.flux_sq >> _params.flux_sq_shift) >= (1 << 16)) {
+		_params.flux_sq_shift++;
+	}
+	_params.observer_gain_shift = configGet("mot_foc_obs_sh");
+
+	_params.sampling_period = motor_adc_sampling_period_hnsec();
+	_params.handover_comm_period = configGet("mot_foc_cp_max") * HNSEC_PER_USEC;
+	_params.comm_period_mult = ((uint32_t)ANGLE_60_DEG << OMEGA_FRAC_BITS) * (uint32_t)_params.sampling_period;
+
+	// Hysteresis - the FOC mode is left when the speed drops 1.5 times below the handover speed
+	_params.omega_min = _params.comm_period_mult / (_params.handover_comm_period * 3 / 2);
+
+	// Electrical speed in rad/s multiplied by flux yields voltage; see update_voltage()
+	_params.decoupling_mult = (int32_t)((2.0F * 3.14159265F * 65536.0F) / _params.sampling_period + 0.5F);
+
+	_params.input_voltage_mult = (int32_t)(motor_adc_convert_input_voltage(1 << 16) * 1000.0F);
+	_params.input_current_mult = (int32_t)(motor_adc_convert_input_current(1 << 16) * 1000.0F);
+
+	_params.pwm_top = motor_pwm_get_top();
+	_params.pwm_margin = _params.pwm_top / 32;   // Keeps the high side gate drivers pumped
+	_params.current_settling = motor_pwm_get_current_settling_ticks();
+	_params.current_window = motor_pwm_get_current_window_ticks();
+
+	printf("Motor: FOC %s, handover comm period %u usec\n",
+	       _params.enabled ? "enabled" : "disabled",
+	       (unsigned)(_params.handover_comm_period / HNSEC_PER_USEC));
+}
+
+bool motor_foc_is_enabled(void)
+{
+	return _params.enabled;
+}
+
+uint32_t motor_foc_get_handover_comm_period_hnsec(void)
+{
+	return _params.handover_comm_period;
+}
+
+void motor_foc_set_duty_cycle(float duty_cycle)
+{
+	duty_cycle = (duty_cycle < -1.0F) ? -1.0F : duty_cycle;
+	duty_cycle = (duty_cycle > 1.0F) ? 1.0F : duty_cycle;
+	_duty_cycle_q16 = (int32_t)(duty_cycle * 65536.0F);
+}
+
+// --- Hard real time code below ---
+#pragma GCC optimize 3
+
+static int32_t sine(uint16_t angle)
+{
+	const unsigned index = angle >> 8;
+	const int32_t fraction = angle & 0xFF;
+	const int32_t a = SINE_TABLE[index];
+	const int32_t b = SINE_TABLE[(index + 1) & 0xFF];
+	return a + (((b - a) * fraction) >> 8);
+}
+
+static int32_t cosine(uint16_t angle)
+{
+	return sine((uint16_t)(angle + ANGLE_90_DEG));
+}
+
+/**
+ * atan(z) ~ z * (pi/4 + 0.273 * (1 - z)) for z in [0, 1], the maximum error is about 0.3 degree.
+ */
+static uint16_t arctangent(int32_t y, int32_t x)
+{
+	uint32_t ax = abs(x);
+	uint32_t ay = abs(y);
+	if ((ax == 0) && (ay == 0)) {
+		return 0;
+	}
+
+	// Scaling down to 16 bits so that the division below does not overflow
+	const uint32_t larger = MAX(ax, ay);
+	const int bits = 32 - __builtin_clz(larger);
+	if (bits > 16) {
+		ax >>= bits - 16;
+		ay >>= bits - 16;
+	}
+
+	const bool swap = ay > ax;
+	const int32_t z = swap ? ((ax << 15) / MAX(ay, 1U)) : ((ay << 15) / MAX(ax, 1U));   // Q15
+	int32_t angle = (z * (8192 + ((2847 * (32768 - z)) >> 15))) >> 15;
+
+	if (swap) {
+		angle = ANGLE_90_DEG - angle;
+	}
+	if (x < 0) {
+		angle = 2 * ANGLE_90_DEG - angle;
+	}
+	if (y < 0) {
+		angle = -angle;
+	}
+	return (uint16_t)angle;
+}
+
+/**
+ * There is only one current sensor in the DC link. While an active vector is applied, the DC link current
+ * equals to the current of one of the phases, so the DC link current is sampled within both active vectors
+ * of the PWM period, and the remaining phase current is recovered using Kirchhoff's current law.
+ * Note that the current sense amplifier is unidirectional, so regenerative currents read as zero.
+ */
+static void update_phase_currents(const struct motor_adc_sample* sample)
+{
+	if (_state.sampled_phase_low >= 0) {
+		const int32_t current = (sample->input_current_aux * _params.input_current_mult) >> 16;
+		_state.phase_currents[_state.sampled_phase_low] = -current;
+		_state.phase_currents_updated_at[_state.sampled_phase_low] = _state.period_counter;
+	}
+	if (_state.sampled_phase_high >= 0) {
+		const int32_t current = (sample->input_current * _params.input_current_mult) >> 16;
+		_state.phase_currents[_state.sampled_phase_high] = current;
+		_state.phase_currents_updated_at[_state.sampled_phase_high] = _state.period_counter;
+	}
+
+	int oldest = 0;
+	for (int i = 1; i < MOTOR_NUM_PHASES; i++) {
+		if (_state.phase_currents_updated_at[i] < _state.phase_currents_updated_at[oldest]) {
+			oldest = i;
+		}
+	}
+
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		if ((i != oldest) &&
+		    ((_state.period_counter - _state.phase_currents_updated_at[i]) > CURRENT_MAX_AGE_PERIODS)) {
+			return;             // Not enough fresh data, keeping the old values
+		}
+	}
+
+	int32_t* const currents = _state.phase_currents;
+	currents[oldest] = 0;
+	currents[oldest] = -(currents[0] + currents[1] + currents[2]);
+
+	// Clarke transform
+	_state.i_alpha = currents[0];
+	_state.i_beta = (int32_t)(((int64_t)(currents[0] + 2 * currents[1]) * Q15_ONE_OVER_SQRT3) >> 15);
+
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		const uint64_t sq = (uint64_t)((int64_t)currents[i] * currents[i]);
+		_state.phase_currents_mean_sq[i] += sq - (_state.phase_currents_mean_sq[i] >> CURRENT_RMS_TAU_SHIFT);
+	}
+}
+
+/**
+ * Nonlinear flux observer: the stator flux is obtained by integrating the EMF; the rotor flux is the stator flux
+ * minus the inductive component. The integrator is corrected so that the magnitude of the rotor flux converges to
+ * the known flux linkage of the motor, which eliminates the drift.
+ * Ref. "Sensorless Control of Surface-Mount Permanent-Magnet Synchronous Motors Based on a Nonlinear Observer",
+ * Lee, Hong, Nam, Ortega, Praly, Astolfi.
+ */
+static void update_observer(void)
+{
+	const int32_t voltages[2] = { _state.v_alpha, _state.v_beta };
+	const int32_t currents[2] = { _state.i_alpha, _state.i_beta };
+
+	int32_t flux[2];
+	int64_t flux_sq = 0;
+
+	for (int i = 0; i < 2; i++) {
+		const int32_t emf = voltages[i] - (_params.resistance * currents[i]) / 1000;
+		_state.flux_integral[i] += emf * _params.sampling_period;
+
+		flux[i] = _state.flux_integral[i] - (int32_t)((int64_t)_params.inductance * currents[i]);
+		flux_sq += (int64_t)flux[i] * (int64_t)flux[i];
+	}
+
+	int64_t error = (_params.flux_sq - flux_sq) >> _params.flux_sq_shift;
+	error = MAX(error, -(1 << 17));
+	error = MIN(error, (1 << 17));
+	_state.flux_error = error;
+
+	const int32_t integral_limit = _params.flux * 4;
+	for (int i = 0; i < 2; i++) {
+		_state.flux_integral[i] += (int32_t)(((int64_t)flux[i] * error) >> (16 + _params.observer_gain_shift));
+		_state.flux_integral[i] = MAX(_state.flux_integral[i], -integral_limit);
+		_state.flux_integral[i] = MIN(_state.flux_integral[i], integral_limit);
+	}
+
+	// Error of 1<<15 means that the squared flux magnitude is off by about 25..50%
+	if (abs(_state.flux_error) > (1 << 15)) {
+		_state.observer_failures += 2;
+	} else if (_state.observer_failures > 0) {
+		_state.observer_failures--;
+	}
+
+	const uint16_t new_angle = arctangent(flux[1], flux[0]);
+	const int32_t delta = (int16_t)(new_angle - _state.angle);
+	_state.omega += ((delta << OMEGA_FRAC_BITS) - _state.omega) / 16;
+	_state.angle = new_angle;
+}
+
+static void update_rotor_frame_currents(void)
+{
+	const int64_t sin_a = sine(_state.angle);
+	const int64_t cos_a = cosine(_state.angle);
+
+	// Park transform; the q axis leads the d axis in the direction of rotation
+	_state.i_d = (int32_t)((_state.i_alpha * cos_a + _state.i_beta * sin_a) >> 15);
+	_state.i_q = (int32_t)(((_state.i_beta * cos_a - _state.i_alpha * sin_a) >> 15) * _state.direction);
+}
+
+static void update_input_current(int32_t input_voltage)
+{
+	// P = 3/2 * (v_alpha * i_alpha + v_beta * i_beta), and the input current is P / Vin
+	const int32_t power = (int32_t)(((int64_t)_state.v_alpha * _state.i_alpha +
+	                                 (int64_t)_state.v_beta * _state.i_beta) >> 8);
+	const int32_t current = (power * 3 / 2) / MAX(input_voltage >> 8, 1);
+	_state.input_current += (current - _state.input_current) / 64;
+}
+
+/**
+ * The PWM counter counts up, so the phases are switched from the positive rail to the negative rail
+ * in the order of increasing PWM values. The first active vector connects only the lowest phase to the
+ * negative rail; the second one connects only the highest phase to the positive rail. Both are sampled
+ * in every PWM period.
+ *
+ * If an active vector is too short for the current sense amplifier to settle, the PWM edges are pushed apart
+ * to make it long enough, and the introduced error is subtracted from the PWM values in the next period,
+ * so that the average voltage is not affected.
+ *
+ * The PWM values are modified in place. Returns the main ADC trigger point; the auxiliary one is returned
+ * via the pointer. The triggers are kept in place even if the windows are unusable, because the main trigger
+ * also samples the input voltage.
+ */
+static int shape_current_sampling_windows(int pwm_vals[MOTOR_NUM_PHASES], int* out_adc_trigger_aux)
+{
+	const int window = _params.current_window;
+	const int pwm_min = _params.pwm_margin;
+	const int pwm_max = _params.pwm_top - _params.pwm_margin;
+
+	int requested[MOTOR_NUM_PHASES];
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		requested[i] = pwm_vals[i] + _state.pwm_carry[i];
+		pwm_vals[i] = MIN(MAX(requested[i], pwm_min), pwm_max);
+	}
+
+	int lowest = 0;
+	int highest = 0;
+	for (int i = 1; i < MOTOR_NUM_PHASES; i++) {
+		if (pwm_vals[i] < pwm_vals[lowest]) {
+			lowest = i;
+		}
+		if (pwm_vals[i] >= pwm_vals[highest]) {
+			highest = i;
+		}
+	}
+	const int middle = MOTOR_NUM_PHASES - lowest - highest;
+	assert((middle != lowest) && (middle != highest));
+
+	// First active vector - moving the lowest edge down, or the middle edge up if there's no room
+	if ((pwm_vals[middle] - pwm_vals[lowest]) < window) {
+		pwm_vals[lowest] = MAX(pwm_vals[middle] - window, pwm_min);
+		pwm_vals[middle] = MAX(pwm_vals[middle], pwm_vals[lowest] + window);
+	}
+
+	// Second active vector - moving the highest edge up, or the middle edge down together with the lowest one
+	if ((pwm_vals[highest] - pwm_vals[middle]) < window) {
+		pwm_vals[highest] = MIN(pwm_vals[middle] + window, pwm_max);
+		if ((pwm_vals[highest] - pwm_vals[middle]) < window) {
+			pwm_vals[middle] = pwm_vals[highest] - window;
+			pwm_vals[lowest] = MAX(MIN(pwm_vals[lowest], pwm_vals[middle] - window), pwm_min);
+		}
+	}
+
+	const bool low_window_ok  = (pwm_vals[middle] - pwm_vals[lowest])  >= window;
+	const bool high_window_ok = (pwm_vals[highest] - pwm_vals[middle]) >= window;
+
+	_state.sampled_phase_low  = low_window_ok  ? lowest  : -1;
+	_state.sampled_phase_high = high_window_ok ? highest : -1;
+	if (!low_window_ok || !high_window_ok) {
+		_state.current_samples_skipped++;
+	}
+
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		int carry = requested[i] - pwm_vals[i];
+		carry = MAX(carry, -window);
+		carry = MIN(carry, window);
+		_state.pwm_carry[i] = carry;
+	}
+
+	*out_adc_trigger_aux = pwm_vals[lowest] + _params.current_settling;
+	return pwm_vals[middle] + _params.current_settling;
+}
+
+static void update_voltage(int32_t input_voltage)
+{
+	// Maximum amplitude of the phase voltage achievable with SVPWM
+	const int32_t v_max = (input_voltage * Q15_ONE_OVER_SQRT3) >> 15;
+
+	const int32_t duty_cycle_q15 = MIN(MAX(_duty_cycle_q16, 0), 65536) / 2;
+	_state.v_q = (v_max * duty_cycle_q15) >> 15;
+
+	/*
+	 * Decoupling of the cross term -(w * L * Iq), which otherwise makes the current lag behind the voltage
+	 * at high speed. Voltage [mV] = flux [1e-4 uWb] * omega * 2pi / (2^(16 + OMEGA_FRAC_BITS) * Ts [hnsec]).
+	 */
+	const int64_t inductive_flux = (int64_t)_params.inductance * _state.i_q;
+	const int64_t speed_voltage = ((inductive_flux * (_state.omega * _state.direction)) >> 16) *
+	                              _params.decoupling_mult;
+	_state.v_d = -(int32_t)(speed_voltage >> (OMEGA_FRAC_BITS + 16));
+	_state.v_d = MAX(_state.v_d, -v_max / 4);
+	_state.v_d = MIN(_state.v_d, v_max / 4);
+
+	// The voltage will be applied in the next PWM period, so the rotation during the delay is compensated
+	const uint16_t angle = _state.angle + ((_state.omega * 3 / 2) >> OMEGA_FRAC_BITS);
+	const int32_t sin_a = sine(angle);
+	const int32_t cos_a = cosine(angle);
+
+	// Inverse Park transform
+	const int32_t v_q = _state.v_q * _state.direction;
+	_state.v_alpha = (_state.v_d * cos_a - v_q * sin_a) >> 15;
+	_state.v_beta  = (_state.v_d * sin_a + v_q * cos_a) >> 15;
+
+	// Inverse Clarke transform
+	const int32_t beta_term = (_state.v_beta * Q15_SQRT3_OVER_2) >> 15;
+	const int32_t phase_voltages[MOTOR_NUM_PHASES] = {
+		_state.v_alpha,
+		-_state.v_alpha / 2 + beta_term,
+		-_state.v_alpha / 2 - beta_term
+	};
+
+	// SVPWM via min-max zero sequence injection
+	const int32_t v_min = MIN(MIN(phase_voltages[0], phase_voltages[1]), phase_voltages[2]);
+	const int32_t v_max_phase = MAX(MAX(phase_voltages[0], phase_voltages[1]), phase_voltages[2]);
+	const int32_t offset = (v_min + v_max_phase) / 2;
+
+	int pwm_vals[MOTOR_NUM_PHASES];
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		int pwm = _params.pwm_top / 2 + ((phase_voltages[i] - offset) * _params.pwm_top) / input_voltage;
+		pwm = MAX(pwm, _params.pwm_margin);
+		pwm = MIN(pwm, _params.pwm_top - _params.pwm_margin);
+		pwm_vals[i] = pwm;
+	}
+
+	int adc_trigger_aux = 0;
+	const int adc_trigger = shape_current_sampling_windows(pwm_vals, &adc_trigger_aux);
+	motor_pwm_set_duties_from_isr(pwm_vals, adc_trigger_aux, adc_trigger);
+}
+
+void motor_foc_start_from_isr(uint16_t angle, uint32_t comm_period, int direction)
+{
+	memset(&_state, 0, sizeof(_state));
+
+	_state.direction = (direction >= 0) ? 1 : -1;
+	_state.angle = angle;
+	_state.omega = _state.direction * (int32_t)(_params.comm_period_mult / MAX(comm_period, 1U));
+
+	_state.flux_integral[0] = (int32_t)(((int64_t)_params.flux * cosine(angle)) >> 15);
+	_state.flux_integral[1] = (int32_t)(((int64_t)_params.flux * sine(angle)) >> 15);
+
+	_state.sampled_phase_low = -1;
+	_state.sampled_phase_high = -1;
+	_state.period_counter = CURRENT_MAX_AGE_PERIODS + 1;    // All phase currents are stale
+}
+
+enum motor_foc_result motor_foc_update_from_isr(const struct motor_adc_sample* sample)
+{
+	_state.period_counter++;
+
+	const int32_t input_voltage = (sample->input_voltage * _params.input_voltage_mult) >> 16;
+	if (input_voltage <= 0) {
+		return MOTOR_FOC_RESULT_FAILED;
+	}
+
+	update_phase_currents(sample);
+	update_observer();
+	update_rotor_frame_currents();
+	update_input_current(input_voltage);
+
+	if (_state.observer_failures >= (OBSERVER_FAILURE_PERIODS * 2)) {
+		return MOTOR_FOC_RESULT_FAILED;
+	}
+
+	if ((_duty_cycle_q16 <= 0) || ((_state.omega * _state.direction) < _params.omega_min)) {
+		return MOTOR_FOC_RESULT_EXIT;
+	}
+
+	update_voltage(input_voltage);
+	return MOTOR_FOC_RESULT_OK;
+}
+
+uint16_t motor_foc_get_angle(void)
+{
+	return _state.angle;
+}
+
+// --- End of hard real time code ---
+#pragma GCC reset_options
+
+uint32_t motor_foc_get_comm_period_hnsec(void)
+{
+	const int32_t omega = abs(_state.omega);
+	return _params.comm_period_mult / MAX(omega, 1);
+}
+
+int motor_foc_get_input_current_raw(void)
+{
+	const int32_t current = MAX(_state.input_current, 0);
+	return (int)(((int64_t)current << 16) / MAX(_params.input_current_mult, 1));
+}
+
+void motor_foc_get_phase_currents(float out_currents[MOTOR_NUM_PHASES])
+{
+	uint64_t mean_sq[MOTOR_NUM_PHASES];
+
+	irq_primask_disable();
+	memcpy(mean_sq, _state.phase_currents_mean_sq, sizeof(mean_sq));
+	irq_primask_enable();
+
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		out_currents[i] = sqrtf((float)(mean_sq[i] >> CURRENT_RMS_TAU_SHIFT)) / 1000.0F;
+	}
+}
+
+void motor_foc_print_debug_info(void)
+{
+	static const int ALIGNMENT = 25;
+
+#define PRINT_INT(name, value) printf("  %-*s %li\n", ALIGNMENT, (name), (long)(value))
+
+	irq_primask_disable();
+	const struct state state_copy = _state;
+	irq_primask_enable();
+
+	printf("Motor FOC state\n");
+	PRINT_INT("angle",             state_copy.angle);
+	PRINT_INT("omega",             state_copy.omega);
+	PRINT_INT("flux error",        state_copy.flux_error);
+	PRINT_INT("observer failures", state_copy.observer_failures);
+	PRINT_INT("id mA",             state_copy.i_d);
+	PRINT_INT("iq mA",             state_copy.i_q);
+	PRINT_INT("vd mV",             state_copy.v_d);
+	PRINT_INT("vq mV",             state_copy.v_q);
+	PRINT_INT("input current mA",  state_copy.input_current);
+	PRINT_INT("current skipped",   state_copy.current_samples_skipped);
+
+	static const char* const PHASE_CURRENT_NAMES[MOTOR_NUM_PHASES] = {
+		"phase A rms mA",
+		"phase B rms mA",
+		"phase C rms mA"
+	};
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		PRINT_INT(PHASE_CURRENT_NAMES[i],
+		          sqrtf((float)(state_copy.phase_currents_mean_sq[i] >> CURRENT_RMS_TAU_SHIFT)));
+	}
+
+#undef PRINT_INT
+}
@@ -63,6 +63,8 @@ static uint16_t _pwm_min;
 static uint16_t _adc_advance_ticks;
 static uint16_t _adc_blanking_ticks;
 static uint16_t _adc_sample_duration_ticks;
+static uint16_t _current_settling_ticks;
+static uint16_t _current_window_ticks;
 
 
 static int init_constants(unsigned frequency, const float pwm_dead_time_ns)
@@ -143,6 +145,15 @@ static int init_constants(unsigned frequency, const float pwm_dead_time_ns)
 			(unsigned)_adc_blanking_ticks);
 	}
 
+	/*
+	 * Input current sampling within the active vectors, used with sinusoidal commutation
+	 */
+	const float current_settling = (MOTOR_ADC_CURRENT_SETTLING_NANOSEC + pwm_dead_time_ns) / 1e9f;
+	_current_settling_ticks = (uint16_t)(current_settling / pwm_clock_period);
+
+	const float current_sample_duration = MOTOR_ADC_CURRENT_SAMPLE_NANOSEC / 1e9f;
+	_current_window_ticks = _current_settling_ticks + (uint16_t)(current_sample_duration / pwm_clock_period);
+
 	printf("Motor: PWM range [%u; %u], ADC: advance %u ticks, blanking %u ticks, sample %u ticks\n",
 		(unsigned)_pwm_min,
 		(unsigned)_pwm_top,
@@ -182,7 +193,7 @@ static void init_timers(const float pwm_dead_time)
 	/*
 	 * OC channels
 	 * TIM1 CC1, CC2, CC3 are used to control the FETs; TIM1 CC4 is not used.
-	 * TIM2 CC2 is used to trigger the ADC conversion.
+	 * TIM2 CC2 is used to trigger the ADC conversion; TIM2 CC1 triggers the auxiliary current sample.
 	 */
 	// Phase A, phase B
 	TIM1->CCMR1 =
@@ -195,11 +206,12 @@ static void init_timers(const float pwm_dead_time)
 
 	// ADC sync
 	TIM2->CCMR1 =
+		TIM_CCMR1_OC1PE | TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1M_0 |
 		TIM_CCMR1_OC2PE | TIM_CCMR1_OC2M_2 | TIM_CCMR1_OC2M_1 | TIM_CCMR1_OC2M_0;
 
 	// OC polarity (no inversion, all disabled except ADC sync)
 	TIM1->CCER = 0;
-	TIM2->CCER = TIM_CCER_CC2E;
+	TIM2->CCER = TIM_CCER_CC1E | TIM_CCER_CC2E;
 
 	/*
 	 * Dead time generator setup.
@@ -225,6 +237,7 @@ static void init_timers(const float pwm_dead_time)
 	 * Default ADC sync config, will be adjusted dynamically
 	 */
 	TIM2->CCR2 = _adc_blanking_ticks;
+	TIM2->CCR1 = _adc_blanking_ticks;
 
 	// Timers are configured now but not started yet. Starting is tricky because of synchronization, see below.
 	TIM1->EGR = TIM_EGR_UG | TIM_EGR_COMG;
@@ -469,6 +482,52 @@ void motor_pwm_set_step_from_isr(const struct motor_pwm_commutation_step* step,
 	adjust_adc_sync(pwm_val);
 }
 
+__attribute__((optimize(3)))
+void motor_pwm_set_duties_from_isr(const int pwm_vals[MOTOR_NUM_PHASES], int adc_trigger_aux, int adc_trigger)
+{
+	static const uint32_t CCER_ALL_PHASES =
+		TIM_CCER_CC1E | TIM_CCER_CC1NE | TIM_CCER_CC2E | TIM_CCER_CC2NE | TIM_CCER_CC3E | TIM_CCER_CC3NE;
+
+	if ((TIM1->CCER & CCER_ALL_PHASES) != CCER_ALL_PHASES) {
+		// Switching from the six-step mode or from freewheeling - the channels need to be configured first
+		phase_reset_all_i();
+		for (int phase = 0; phase < MOTOR_NUM_PHASES; phase++) {
+			phase_set_i(phase, pwm_vals[phase], false);
+		}
+	} else {
+		TIM1->CCR1 = pwm_vals[0];
+		TIM1->CCR2 = pwm_vals[1];
+		TIM1->CCR3 = pwm_vals[2];
+	}
+
+	if (adc_trigger_aux < 1) {
+		adc_trigger_aux = 1;
+	}
+	if (adc_trigger > _pwm_top) {
+		adc_trigger = _pwm_top;
+	}
+	if (adc_trigger < adc_trigger_aux) {
+		adc_trigger = adc_trigger_aux;
+	}
+	TIM2->CCR1 = adc_trigger_aux;
+	TIM2->CCR2 = adc_trigger;
+}
+
+int motor_pwm_get_top(void)
+{
+	return _pwm_top;
+}
+
+int motor_pwm_get_current_settling_ticks(void)
+{
+	return _current_settling_ticks;
+}
+
+int motor_pwm_get_current_window_ticks(void)
+{
+	return _current_window_ticks;
+}
+
 void motor_pwm_beep(int frequency, int duration_msec)
 {
 	static const float DUTY_CYCLE = 0.01;
@@ -39,6 +39,8 @@
 #include "timer.h"
 #include "irq.h"
 #include "forced_rotation_detection.h"
+#include "foc.h"
+#include "trace.h"
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -117,11 +119,28 @@ static const struct motor_pwm_commutation_step COMMUTATION_TABLE_REVERSE[MOTOR_N
 	{1, 0, 2}       // BEMF +
 };
 
+/**
+ * Electrical angle of the rotor flux at the zero cross of each commutation step, used for handover to FOC.
+ * The rotor flux is aligned with the axis of the floating phase at the zero cross; the step sequence
+ * rotates the stator current vector clockwise in the forward table and counterclockwise in the reverse one.
+ * Phase A is aligned with the zero angle; 65536 is the full electrical revolution.
+ */
+static const uint16_t COMMUTATION_TABLE_FORWARD_ZC_ANGLES[MOTOR_NUM_COMMUTATION_STEPS] = {
+	43691, 32768, 21845, 10923, 0, 54613
+};
+static const uint16_t COMMUTATION_TABLE_REVERSE_ZC_ANGLES[MOTOR_NUM_COMMUTATION_STEPS] = {
+	21845, 32768, 43691, 54613, 0, 10923
+};
+
+#define COMMUTATION_STEP_ANGLE     10923
+
 enum flags
 {
 	FLAG_ACTIVE        = 1,
 	FLAG_SPINUP        = 2,
-	FLAG_SYNC_RECOVERY = 4
+	FLAG_SYNC_RECOVERY = 4,
+	FLAG_FOC           = 8,
+	FLAG_LOW_SPEED     = 16
 };
 
 enum zc_detection_result
@@ -144,6 +163,10 @@ static struct diag_info                /// This data is never used by the contro
 	uint32_t bemf_wrong_slope;
 	uint32_t desaturations;
 	uint32_t late_commutations;
+	uint32_t foc_handovers;
+	uint32_t foc_failures;
+	uint32_t low_speed_entries;
+	uint32_t low_speed_exits;
 
 	/// Last ZC solution
 	int64_t zc_solution_slope;
@@ -171,8 +194,15 @@ static struct control_state            /// Control state
 	int64_t spinup_bemf_integral_negative;
 	bool spinup_prev_zc_timestamp_set;
 
+	int64_t lowspeed_flux_threshold;   ///< BEMF integral from ZC to commutation, counts * hnsec; zero if unknown
+	int64_t lowspeed_flux;
+	uint64_t lowspeed_zc_timestamp;    ///< Zero if the ZC has not been detected on this step yet
+	uint64_t lowspeed_prev_timestamp;
+	int lowspeed_prev_bemf;
+
 	int current_comm_step;
 	const struct motor_pwm_commutation_step* comm_table;
+	const uint16_t* comm_table_zc_angles;
 
 	unsigned immediate_zc_failures;
 	unsigned immediate_zc_detects;
@@ -188,6 +218,11 @@ static struct control_state            /// Control state
 
 	int neutral_voltage;
 
+	/// Neutral voltage correction per comm step: offset + gain * input_current / 256, both in ADC counts * 256
+	int32_t neutral_offset_q8[MOTOR_NUM_COMMUTATION_STEPS];
+	int32_t neutral_current_gain_q8[MOTOR_NUM_COMMUTATION_STEPS];
+	int32_t zc_error_mean;
+
 	int input_voltage;
 	int input_current;
 
@@ -198,6 +233,13 @@ static struct control_state            /// Control state
 	uint64_t spinup_ramp_duration_hnsec;
 } _state;
 
+static struct scheduled_duty_cycle     /// Written by the thread with IRQ disabled, consumed by the ISR
+{
+	uint64_t deadline;                 ///< Zero if nothing is scheduled
+	int pwm_val;
+	float duty_cycle;
+} _scheduled_duty_cycle;
+
 static struct precomputed_params       /// Parameters are read only
 {
 	int timing_advance_min_deg64;
@@ -209,7 +251,9 @@ static struct precomputed_params       /// Parameters are read only
 	int bemf_valid_range_pct128;
 	unsigned zc_failures_max;
 	uint32_t comm_period_max;
+	uint32_t lowspeed_comm_period_max;
 	int comm_blank_hnsec;
+	bool neutral_compensation;
 
 	uint32_t spinup_start_comm_period;
 	uint32_t spinup_timeout;
@@ -220,6 +264,34 @@ static struct precomputed_params       /// Parameters are read only
 
 static bool _initialization_confirmed = false;
 
+/**
+ * Variables that define the decisions of the six-step logic, saved into the trace snapshot.
+ * The comm tables are not listed, they are defined by the direction of rotation, which is saved first.
+ * The order must be preserved when the list is extended, otherwise old traces can't be replayed.
+ */
+#define TRACE_SNAPSHOT_SCALARS(X) \
+	X(_state.flags) X(_state.zc_detection_result) \
+	X(_state.blank_time_deadline) X(_state.prev_zc_timestamp) X(_state.prev_comm_timestamp) \
+	X(_state.comm_period) X(_state.averaged_comm_period) \
+	X(_state.spinup_bemf_integral_positive) X(_state.spinup_bemf_integral_negative) \
+	X(_state.spinup_prev_zc_timestamp_set) \
+	X(_state.lowspeed_flux_threshold) X(_state.lowspeed_flux) X(_state.lowspeed_zc_timestamp) \
+	X(_state.lowspeed_prev_timestamp) X(_state.lowspeed_prev_bemf) \
+	X(_state.current_comm_step) \
+	X(_state.immediate_zc_failures) X(_state.immediate_zc_detects) X(_state.immediate_desaturations) \
+	X(_state.zc_bemf_samples_optimal) X(_state.zc_bemf_samples_optimal_past_zc) \
+	X(_state.zc_bemf_samples_acquired) X(_state.zc_bemf_samples_acquired_past_zc) \
+	X(_state.zc_bemf_seen_before_zc) X(_state.neutral_voltage) X(_state.zc_error_mean) \
+	X(_state.input_voltage) X(_state.input_current) \
+	X(_state.pwm_val) X(_state.pwm_val_before_spinup) X(_state.pwm_val_after_spinup) \
+	X(_state.spinup_ramp_duration_hnsec) \
+	X(_scheduled_duty_cycle.deadline) X(_scheduled_duty_cycle.pwm_val) \
+	X(_diag.started_at)
+
+#define TRACE_SNAPSHOT_ARRAYS(X) \
+	X(_state.zc_bemf_samples) X(_state.zc_bemf_timestamps) \
+	X(_state.neutral_offset_q8) X(_state.neutral_current_gain_q8)
+
 // Timing advance settings
 CONFIG_PARAM_INT("mot_tim_adv_min",     5,     0,     20)       // electrical degree
 CONFIG_PARAM_INT("mot_tim_adv_max",     15,    0,     29)       // electrical degree
@@ -231,6 +303,8 @@ CONFIG_PARAM_INT("mot_bemf_win_den",    4,     3,     8)        // dimensionless
 CONFIG_PARAM_INT("mot_bemf_range",      90,    10,    100)      // percent
 CONFIG_PARAM_INT("mot_zc_fails_max",    100,   6,     300)      // dimensionless
 CONFIG_PARAM_INT("mot_comm_per_max",    4000,  1000,  10000)    // microsecond
+CONFIG_PARAM_INT("mot_ls_cp_max",       0,     0,     100000)   // microsecond, zero disables the low speed mode
+CONFIG_PARAM_BOOL("mot_neutral_comp",   false)
 // Spinup settings
 CONFIG_PARAM_INT("mot_spup_st_cp",      100000,10000, 300000)   // microsecond
 CONFIG_PARAM_INT("mot_spup_to_ms",      5000,  100,   9000)     // millisecond (sic!)
@@ -247,7 +321,9 @@ static void configure(void)
 	_params.bemf_valid_range_pct128     = configGet("mot_bemf_range") * 128 / 100;
 	_params.zc_failures_max  = configGet("mot_zc_fails_max");
 	_params.comm_period_max  = configGet("mot_comm_per_max") * HNSEC_PER_USEC;
+	_params.lowspeed_comm_period_max = configGet("mot_ls_cp_max") * HNSEC_PER_USEC;
 	_params.comm_blank_hnsec = configGet("mot_blank_usec") * HNSEC_PER_USEC;
+	_params.neutral_compensation = configGet("mot_neutral_comp");
 
 	_params.spinup_start_comm_period = configGet("mot_spup_st_cp") * HNSEC_PER_USEC;
 	_params.spinup_timeout           = configGet("mot_spup_to_ms") * HNSEC_PER_MSEC;
@@ -270,21 +346,112 @@ static void configure(void)
 		_params.spinup_start_comm_period = _params.comm_period_max;
 	}
 
+	if (_params.lowspeed_comm_period_max <= _params.comm_period_max) {
+		_params.lowspeed_comm_period_max = 0;  // The low speed mode must extend the range, otherwise it's useless
+	}
+
 	_params.adc_sampling_period = motor_adc_sampling_period_hnsec();
 
-	printf("Motor: RTCTL config: Max comm period: %u usec, BEMF window denom: %i\n",
+	printf("Motor: RTCTL config: Max comm period: %u usec, low speed: %u usec, BEMF window denom: %i\n",
 		(unsigned)(_params.comm_period_max / HNSEC_PER_USEC),
+		(unsigned)(_params.lowspeed_comm_period_max / HNSEC_PER_USEC),
 		_params.motor_bemf_window_len_denom);
 }
 
 // --- Hard real time code below ---
 #pragma GCC optimize 3
 
-static void stop_from_isr(void)
+static void trace_check_trigger(uint64_t timestamp)
+{
+	if (!motor_trace_begin_from_isr(timestamp)) {
+		return;
+	}
+
+	motor_trace_add_snapshot_value_from_isr(_state.comm_table == COMMUTATION_TABLE_REVERSE);
+#define X(var)      motor_trace_add_snapshot_value_from_isr((int64_t)(var));
+	TRACE_SNAPSHOT_SCALARS(X)
+#undef X
+#define X(arr)      for (unsigned i = 0; i < sizeof(arr) / sizeof(arr[0]); i++) { \
+	                    motor_trace_add_snapshot_value_from_isr((int64_t)(arr)[i]); }
+	TRACE_SNAPSHOT_ARRAYS(X)
+#undef X
+}
+
+static void trace_adc_sample(const struct motor_adc_sample* sample)
 {
+	trace_check_trigger(sample->timestamp);
+
+	struct motor_trace_record* const rec =
+		motor_trace_add_from_isr(MOTOR_TRACE_ADC_SAMPLE, sample->timestamp, _state.flags);
+	if (rec != NULL) {
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			rec->values[i] = sample->phase_values[i];
+		}
+		rec->values[3] = sample->input_voltage;
+		rec->values[4] = sample->input_current;
+	}
+}
+
+static void trace_zc(uint64_t zc_timestamp, uint64_t comm_deadline)
+{
+	struct motor_trace_record* const rec = motor_trace_add_from_isr(MOTOR_TRACE_ZC, zc_timestamp, _state.flags);
+	if (rec != NULL) {
+		const uint32_t deadline = (uint32_t)(comm_deadline - zc_timestamp);
+		rec->values[0] = _state.comm_period & 0xFFFF;
+		rec->values[1] = _state.comm_period >> 16;
+		rec->values[2] = deadline & 0xFFFF;
+		rec->values[3] = deadline >> 16;
+	}
+}
+
+static void trace_step(uint64_t timestamp, enum zc_detection_result result, bool stop)
+{
+	struct motor_trace_record* const rec = motor_trace_add_from_isr(MOTOR_TRACE_STEP, timestamp, _state.flags);
+	if (rec != NULL) {
+		rec->values[0] = _state.current_comm_step;
+		rec->values[1] = _state.pwm_val;
+		rec->values[2] = result;
+		rec->values[3] = stop;
+	}
+}
+
+static void trace_duty_cycle(uint64_t timestamp, int pwm_val, uint64_t deadline)
+{
+	trace_check_trigger(timestamp);
+
+	struct motor_trace_record* const rec =
+		motor_trace_add_from_isr(MOTOR_TRACE_DUTY_CYCLE, timestamp, _state.flags);
+	if (rec != NULL) {
+		rec->values[0] = pwm_val;
+		for (int i = 0; i < 4; i++) {
+			rec->values[1 + i] = (deadline >> (16 * i)) & 0xFFFF;
+		}
+	}
+}
+
+static void stop_from_isr(uint64_t timestamp)
+{
+	motor_trace_end_from_isr(timestamp, MOTOR_TRACE_END_STOP_FROM_ISR, _state.flags);
 	_state.flags = 0;
 	motor_timer_cancel();
 	motor_pwm_set_freewheeling();
+	motor_adc_set_current_sampling_mode(false);
+}
+
+/**
+ * Invoked from the commutation timer callback and from every ADC callback; see
+ * apply_scheduled_duty_cycle_within_step() for the six-step mode. In the FOC mode the ADC callback runs every
+ * PWM period. Returns true if the scheduled duty cycle has been applied.
+ */
+static bool apply_scheduled_duty_cycle(uint64_t timestamp)
+{
+	if ((_scheduled_duty_cycle.deadline > 0) && (timestamp >= _scheduled_duty_cycle.deadline)) {
+		_scheduled_duty_cycle.deadline = 0;
+		_state.pwm_val = _scheduled_duty_cycle.pwm_val;
+		motor_foc_set_duty_cycle(_scheduled_duty_cycle.duty_cycle);
+		return true;
+	}
+	return false;
 }
 
 static void engage_current_comm_step(void)
@@ -293,6 +460,43 @@ static void engage_current_comm_step(void)
 	motor_pwm_set_step_from_isr(_state.comm_table + _state.current_comm_step, _state.pwm_val);
 }
 
+/**
+ * The PWM value of the current step is updated in the middle of the step, so that a scheduled duty cycle is
+ * applied within one ADC sampling period past its deadline rather than at the next commutation, which is up to
+ * one commutation period later; this keeps the skew between the controllers independent of their speeds.
+ * The ADC stays enabled past the ZC while a duty cycle is scheduled, see disable_adc_past_zc().
+ * The spinup ramps the PWM value, and the steps in sync recovery or desaturation may be unpowered; these are
+ * left to the next commutation.
+ */
+static void apply_scheduled_duty_cycle_within_step(const struct motor_adc_sample* sample)
+{
+	const bool powered =
+		((_state.flags & (FLAG_SPINUP | FLAG_SYNC_RECOVERY)) == 0) &&
+		(_state.zc_detection_result != ZC_DESATURATION);
+
+	if (powered && apply_scheduled_duty_cycle(sample->timestamp)) {
+		engage_current_comm_step();
+		// The replay must see the sample even if it is not used by the ZC detector
+		if ((_state.zc_detection_result != ZC_NOT_DETECTED) || (sample->timestamp < _state.blank_time_deadline)) {
+			trace_adc_sample(sample);
+		}
+	}
+
+	if ((_state.zc_detection_result != ZC_NOT_DETECTED) && (_scheduled_duty_cycle.deadline == 0)) {
+		motor_adc_disable_from_isr();
+	}
+}
+
+/**
+ * The ADC is not needed past the ZC until the next commutation, unless a duty cycle is scheduled.
+ */
+static void disable_adc_past_zc(void)
+{
+	if (_scheduled_duty_cycle.deadline == 0) {
+		motor_adc_disable_from_isr();
+	}
+}
+
 static void register_good_step(void)
 {
 	if (_state.immediate_zc_failures > 0) {
@@ -361,6 +565,9 @@ static void prepare_zc_detector_for_next_step(void)
 	_state.zc_bemf_samples_acquired_past_zc = 0;
 	_state.zc_bemf_seen_before_zc = false;
 
+	_state.lowspeed_flux = 0;
+	_state.lowspeed_zc_timestamp = 0;
+
 	const int advance = get_effective_timing_advance_deg64();
 
 	/*
@@ -386,6 +593,11 @@ void motor_timer_callback(uint64_t timestamp_hnsec)
 		return;
 	}
 
+	trace_check_trigger(timestamp_hnsec);
+	(void)motor_trace_add_from_isr(MOTOR_TRACE_TIMER, timestamp_hnsec, _state.flags);
+
+	apply_scheduled_duty_cycle(timestamp_hnsec);
+
 	if ((_state.flags & FLAG_SPINUP) == 0) {
 		/*
 		 * Missing a step drops the advance angle back to negative 15 degrees temporarily,
@@ -463,8 +675,10 @@ void motor_timer_callback(uint64_t timestamp_hnsec)
 	}
 	}
 
+	trace_step(timestamp_hnsec, _state.zc_detection_result, stop_now);
+
 	if (stop_now) {
-		stop_from_isr(); // No bounce no play
+		stop_from_isr(timestamp_hnsec); // No bounce no play
 		return;
 	}
 
@@ -507,7 +721,7 @@ void motor_timer_callback(uint64_t timestamp_hnsec)
 
 		// Spinup timeout
 		if ((_diag.started_at + _params.spinup_timeout) <= timestamp_hnsec) {
-			stop_from_isr();
+			stop_from_isr(timestamp_hnsec);
 		}
 	}
 }
@@ -536,6 +750,19 @@ static void handle_detected_zc(uint64_t zc_timestamp)
 		_state.comm_period = zc_timestamp - _state.prev_zc_timestamp;
 	}
 
+	/*
+	 * Below the range of the ZC detector, the motor is switched to the low speed mode starting from the next step.
+	 * The handover happens only if the commutation threshold has been learned already.
+	 */
+	if ((_state.comm_period >= _params.comm_period_max) &&
+	    (_params.lowspeed_comm_period_max > 0) &&
+	    (_state.lowspeed_flux_threshold > 0) &&
+	    ((_state.flags & (FLAG_SPINUP | FLAG_SYNC_RECOVERY)) == 0))
+	{
+		_state.flags |= FLAG_LOW_SPEED;
+		_diag.low_speed_entries++;
+	}
+
 	_state.prev_zc_timestamp = zc_timestamp;
 	_state.comm_period = MIN(_state.comm_period, _params.comm_period_max);
 	_state.zc_detection_result = ZC_DETECTED;
@@ -545,13 +772,16 @@ static void handle_detected_zc(uint64_t zc_timestamp)
 	const uint32_t advance =
 		_state.comm_period / 2 - TIMING_ADVANCE64(_state.comm_period, get_effective_timing_advance_deg64());
 
-	const int64_t delta = motor_timer_set_absolute(zc_timestamp + advance - STEP_SWITCHING_DELAY_HNSEC);
+	const uint64_t comm_deadline = zc_timestamp + advance - STEP_SWITCHING_DELAY_HNSEC;
+	const int64_t delta = motor_timer_set_absolute(comm_deadline);
 	if (delta <= 0) {
 		// The commutation event is already in the past; record an error.
 		_diag.late_commutations++;
 	}
 
-	motor_adc_disable_from_isr();
+	trace_zc(zc_timestamp, comm_deadline);
+
+	disable_adc_past_zc();
 }
 
 static void update_input_voltage_current(const struct motor_adc_sample* sample)
@@ -597,6 +827,13 @@ static void update_neutral_voltage(const struct motor_adc_sample* sample)
 	// high advance angles.
 	const struct motor_pwm_commutation_step* const step = _state.comm_table + _state.current_comm_step;
 	_state.neutral_voltage = (sample->phase_values[step->positive] + sample->phase_values[step->negative]) / 2;
+
+	if (_params.neutral_compensation) {
+		const int i = _state.current_comm_step;
+		const int32_t correction_q8 =
+			_state.neutral_offset_q8[i] + (_state.neutral_current_gain_q8[i] * _state.input_current) / 256;
+		_state.neutral_voltage += correction_q8 / 256;
+	}
 }
 
 // Returns TRUE if the BEMF has POSITIVE slope, otherwise returns FALSE.
@@ -640,7 +877,7 @@ static void solve_least_squares(const int n, const int x[], const int y[], int64
 	*out_yintercept = (LEAST_SQUARES_MULT * sum_y - slope * sum_x + n / 2) / n;
 }
 
-static uint64_t solve_zc_approximation(void)
+static uint64_t solve_zc_approximation(int64_t* out_slope)
 {
 	/*
 	 * Solution
@@ -654,6 +891,12 @@ static uint64_t solve_zc_approximation(void)
 	int64_t slope = 0, yintercept = 0;
 	solve_least_squares(_state.zc_bemf_samples_acquired, data_x, _state.zc_bemf_samples, &slope, &yintercept);
 
+	if (slope == 0) {
+		// Flat BEMF (e.g. stalled rotor) has no zero cross; the hardware division would silently yield zero
+		_diag.zc_solution_failures++;
+		return 0;
+	}
+
 	const int x = (-yintercept + slope / 2) / slope; // Linear equation solved for x
 
 	/*
@@ -668,6 +911,7 @@ static uint64_t solve_zc_approximation(void)
 #endif
 
 	const uint64_t zc_timestamp = _state.zc_bemf_timestamps[0] + x;
+	*out_slope = slope;
 
 	/*
 	 * Solution validation
@@ -703,8 +947,259 @@ static uint64_t solve_zc_approximation(void)
 	return zc_timestamp;
 }
 
+/**
+ * The average of the driven phases differs from the true neutral because of the winding and switch asymmetry,
+ * mismatch of the phase voltage dividers, and PWM ripple coupled into the floating phase. Each of these adds
+ * an offset to the BEMF readings, which is specific to the comm step and partly proportional to the current;
+ * the offset shifts the detected ZC by offset / slope. The shift shows up as a ZC timing error that repeats
+ * every electrical revolution, so the offset and the current gain are learned from it, one step at a time,
+ * with the normalized LMS algorithm.
+ * @param zc_error  Measured ZC timestamp minus the predicted one, hnsec
+ * @param zc_slope  BEMF slope from the ZC solution, ADC counts * LEAST_SQUARES_MULT per hnsec
+ */
+static void update_neutral_compensation(int64_t zc_error, int64_t zc_slope)
+{
+	static const int32_t MAX_OFFSET_Q8 = 64 * 256;
+	static const int32_t MAX_STEP_Q8 = 4 * 256;
+
+	// Common mode error is caused by acceleration; only the deviation from the mean is related to the offsets
+	_state.zc_error_mean = LOWPASS(_state.zc_error_mean, (int32_t)zc_error, 5);
+	const int64_t deviation = zc_error - _state.zc_error_mean;
+
+	// Offset that would produce this ZC timing error, ADC counts * 256
+	const int64_t raw_error_q8 = (-deviation * zc_slope * 256) / LEAST_SQUARES_MULT;
+	const int32_t error_q8 = MAX(MIN(raw_error_q8, MAX_STEP_Q8), -MAX_STEP_Q8);
+
+	const int i = _state.current_comm_step;
+	const int64_t current = _state.input_current;
+	const int64_t norm = 65536 + current * current;
+
+	int32_t offset_q8 = _state.neutral_offset_q8[i] + ((error_q8 * 65536LL) / norm) / 16;
+	int32_t gain_q8 = _state.neutral_current_gain_q8[i] + ((error_q8 * current * 256) / norm) / 16;
+
+	_state.neutral_offset_q8[i] = MAX(MIN(offset_q8, MAX_OFFSET_Q8), -MAX_OFFSET_Q8);
+	_state.neutral_current_gain_q8[i] = MAX(MIN(gain_q8, MAX_OFFSET_Q8), -MAX_OFFSET_Q8);
+
+	/*
+	 * Offsets that alternate with the BEMF slope delay all ZCs equally, which is not observable from the timing;
+	 * this component is removed, otherwise it would drift and shift the commutation angle.
+	 */
+	int32_t alternating_offset = 0;
+	int32_t alternating_gain = 0;
+	for (int k = 0; k < MOTOR_NUM_COMMUTATION_STEPS; k++) {
+		const int sign = (k & 1) ? 1 : -1;
+		alternating_offset += _state.neutral_offset_q8[k] * sign;
+		alternating_gain += _state.neutral_current_gain_q8[k] * sign;
+	}
+	alternating_offset /= MOTOR_NUM_COMMUTATION_STEPS;
+	alternating_gain /= MOTOR_NUM_COMMUTATION_STEPS;
+	for (int k = 0; k < MOTOR_NUM_COMMUTATION_STEPS; k++) {
+		const int sign = (k & 1) ? 1 : -1;
+		_state.neutral_offset_q8[k] -= alternating_offset * sign;
+		_state.neutral_current_gain_q8[k] -= alternating_gain * sign;
+	}
+}
+
+/**
+ * The threshold for the low speed mode is the BEMF integral from the zero cross to the commutation.
+ * The BEMF rises nearly linearly past the zero cross, so the integral is slope * t^2 / 2, where t is the
+ * delay from ZC to commutation; the slope is proportional to the squared angular speed, and the delay is
+ * inversely proportional to it, hence the integral corresponds to a constant electrical angle at any speed.
+ * It is learned at the low end of the ZC detector's range, where the advance angle is minimal.
+ */
+static void update_low_speed_flux_threshold(int64_t zc_slope)
+{
+	if ((_params.lowspeed_comm_period_max == 0) ||
+	    (_state.comm_period < _params.comm_period_max / 2) ||
+	    (_state.flags & (FLAG_SPINUP | FLAG_SYNC_RECOVERY)))
+	{
+		return;
+	}
+
+	const int64_t comm_delay =
+		_state.comm_period / 2 - TIMING_ADVANCE64(_state.comm_period, get_effective_timing_advance_deg64());
+	if ((comm_delay <= 0) || (zc_slope == 0)) {
+		return;
+	}
+
+	const int64_t flux = ((llabs(zc_slope) * comm_delay) * comm_delay) / (2 * LEAST_SQUARES_MULT);
+
+	if (_state.lowspeed_flux_threshold > 0) {
+		_state.lowspeed_flux_threshold = LOWPASS(_state.lowspeed_flux_threshold, flux, 15);
+	} else {
+		_state.lowspeed_flux_threshold = flux;
+	}
+}
+
+/**
+ * Low speed mode: the BEMF is integrated from the zero cross, and the commutation happens once the integral
+ * reaches the learned threshold. The BEMF is taken against the neutral voltage measured in the same sample,
+ * which makes the integral independent of the duty cycle and the supply voltage.
+ */
+static void update_low_speed_commutation(int bemf, uint64_t timestamp)
+{
+	// Oriented BEMF is positive past ZC regardless of the slope direction
+	const int oriented_bemf = is_bemf_slope_positive() ? bemf : -bemf;
+
+	if (oriented_bemf <= 0) {
+		// Before ZC, or the noise took it back - start over
+		_state.lowspeed_flux = 0;
+		_state.lowspeed_zc_timestamp = 0;
+	} else if (_state.lowspeed_zc_timestamp == 0) {
+		// First sample past ZC; the ZC timestamp is interpolated between this sample and the previous one
+		const int64_t dt = timestamp - _state.lowspeed_prev_timestamp;
+		const int prev = -_state.lowspeed_prev_bemf;
+		_state.lowspeed_zc_timestamp = _state.lowspeed_prev_timestamp + (dt * prev) / (prev + oriented_bemf);
+		_state.lowspeed_flux = ((int64_t)oriented_bemf * (int64_t)(timestamp - _state.lowspeed_zc_timestamp)) / 2;
+	} else {
+		const int64_t dt = timestamp - _state.lowspeed_prev_timestamp;
+		_state.lowspeed_flux += ((int64_t)(oriented_bemf + _state.lowspeed_prev_bemf) * dt) / 2;
+	}
+
+	_state.lowspeed_prev_bemf = oriented_bemf;
+	_state.lowspeed_prev_timestamp = timestamp;
+
+	if ((_state.lowspeed_zc_timestamp == 0) || (_state.lowspeed_flux < _state.lowspeed_flux_threshold)) {
+		return;
+	}
+
+	/*
+	 * Commutating right now; the ZC timestamp is only needed to keep track of the comm period
+	 */
+	uint64_t zc_timestamp = _state.lowspeed_zc_timestamp;
+	if (zc_timestamp <= _state.prev_zc_timestamp) {
+		zc_timestamp = _state.prev_zc_timestamp + 1;
+	}
+
+	if ((_state.flags & FLAG_SYNC_RECOVERY) == 0) {
+		const uint64_t predicted_zc_ts = _state.prev_zc_timestamp + _state.comm_period;
+		zc_timestamp = (predicted_zc_ts + zc_timestamp + 1ULL) / 2ULL;
+	}
+
+	_state.comm_period = MIN(zc_timestamp - _state.prev_zc_timestamp, _params.lowspeed_comm_period_max);
+	_state.prev_zc_timestamp = zc_timestamp;
+	_state.averaged_comm_period = (_state.comm_period + _state.averaged_comm_period * 3) / 4;
+	_state.zc_detection_result = ZC_DETECTED;
+
+	motor_timer_set_relative(0);
+	disable_adc_past_zc();
+
+	// Hysteresis prevents the mode from bouncing at the boundary
+	if (_state.averaged_comm_period < (_params.comm_period_max / 4) * 3) {
+		_state.flags &= ~FLAG_LOW_SPEED;
+		_diag.low_speed_exits++;
+	}
+}
+
+static bool is_foc_handover_possible(void)
+{
+	return motor_foc_is_enabled() &&
+	       ((_state.flags & (FLAG_SPINUP | FLAG_SYNC_RECOVERY)) == 0) &&
+	       (_state.comm_period <= motor_foc_get_handover_comm_period_hnsec()) &&
+	       (_state.averaged_comm_period <= motor_foc_get_handover_comm_period_hnsec()) &&
+	       (_state.pwm_val > (motor_pwm_get_top() / 2));     // Braking is not supported in the FOC mode
+}
+
+static int get_rotation_direction(void)
+{
+	return (_state.comm_table == COMMUTATION_TABLE_FORWARD) ? -1 : 1;
+}
+
+/**
+ * Must be invoked right after the zero cross has been detected.
+ */
+static void hand_over_to_foc(uint64_t timestamp)
+{
+	const int direction = get_rotation_direction();
+
+	// The angle progresses by one commutation step per comm period, starting from the zero cross
+	const int64_t since_zc = (int64_t)(timestamp - _state.prev_zc_timestamp);
+	const int32_t progress = (since_zc * COMMUTATION_STEP_ANGLE) / (int64_t)_state.comm_period;
+	const uint16_t angle = _state.comm_table_zc_angles[_state.current_comm_step] + progress * direction;
+
+	motor_trace_end_from_isr(timestamp, MOTOR_TRACE_END_FOC, _state.flags);
+
+	motor_timer_cancel();
+	motor_foc_start_from_isr(angle, _state.comm_period, direction);
+	motor_adc_set_current_sampling_mode(true);
+	motor_adc_enable_from_isr();
+
+	_state.flags |= FLAG_FOC;
+	_diag.foc_handovers++;
+}
+
+static void hand_over_to_six_step(uint64_t timestamp)
+{
+	const int direction = get_rotation_direction();
+	const uint16_t angle = motor_foc_get_angle();
+
+	// Finding the step whose zero cross is the most recent one
+	int step = 0;
+	int32_t progress = INT_MAX;
+	for (int i = 0; i < MOTOR_NUM_COMMUTATION_STEPS; i++) {
+		const int32_t p = (int16_t)(angle - _state.comm_table_zc_angles[i]) * direction;
+		if ((p >= 0) && (p < progress)) {
+			step = i;
+			progress = p;
+		}
+	}
+	assert(progress < COMMUTATION_STEP_ANGLE);
+
+	_state.flags &= ~FLAG_FOC;
+
+	_state.comm_period = MIN(motor_foc_get_comm_period_hnsec(), _params.comm_period_max);
+	_state.averaged_comm_period = _state.comm_period;
+	_state.current_comm_step = step;
+	_state.prev_zc_timestamp = timestamp - ((uint64_t)progress * _state.comm_period) / COMMUTATION_STEP_ANGLE;
+	_state.zc_detection_result = ZC_DETECTED;
+
+	motor_pwm_set_freewheeling();          // All phases must be reset before the six-step mode is engaged
+	engage_current_comm_step();
+
+	const uint32_t advance =
+		_state.comm_period / 2 - TIMING_ADVANCE64(_state.comm_period, get_effective_timing_advance_deg64());
+	motor_timer_set_absolute(_state.prev_zc_timestamp + advance - STEP_SWITCHING_DELAY_HNSEC);
+	motor_adc_set_current_sampling_mode(false);
+	motor_adc_disable_from_isr();
+}
+
+static void update_foc(const struct motor_adc_sample* sample)
+{
+	_state.input_voltage = LOWPASS(_state.input_voltage, sample->input_voltage, 7);
+
+	apply_scheduled_duty_cycle(sample->timestamp);
+
+	switch (motor_foc_update_from_isr(sample)) {
+	case MOTOR_FOC_RESULT_OK: {
+		_state.comm_period = motor_foc_get_comm_period_hnsec();
+		_state.averaged_comm_period = _state.comm_period;
+		break;
+	}
+	case MOTOR_FOC_RESULT_EXIT: {
+		hand_over_to_six_step(sample->timestamp);
+		break;
+	}
+	case MOTOR_FOC_RESULT_FAILED:
+	default: {
+		_diag.foc_failures++;
+		_diag.zc_failures_since_start++;
+		stop_from_isr(sample->timestamp);
+		break;
+	}
+	}
+}
+
 void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 {
+	if (_state.flags & FLAG_FOC) {
+		update_foc(sample);
+		return;
+	}
+
+	if ((_state.flags & FLAG_ACTIVE) != 0) {
+		apply_scheduled_duty_cycle_within_step(sample);
+	}
+
 	const bool proceed =
 		((_state.flags & FLAG_ACTIVE) != 0) &&
 		(_state.zc_detection_result == ZC_NOT_DETECTED) &&
@@ -718,6 +1213,8 @@ void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 	}
 	assert(_state.comm_table);
 
+	trace_adc_sample(sample);
+
 	/*
 	 * Normalization against the neutral voltage
 	 */
@@ -745,6 +1242,11 @@ void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 			_diag.bemf_samples_out_of_range++;
 			_state.zc_bemf_samples_acquired = 0;
 			_state.zc_bemf_samples_acquired_past_zc = 0;
+			// The low speed mode will take the ZC timestamp from this sample if the next one is past ZC
+			_state.lowspeed_prev_bemf = 0;
+			_state.lowspeed_prev_timestamp = sample->timestamp;
+			_state.lowspeed_zc_timestamp = 0;
+			_state.lowspeed_flux = 0;
 			return;
 		}
 
@@ -770,6 +1272,14 @@ void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 			return;
 		}
 
+		if (_state.flags & FLAG_LOW_SPEED) {
+			update_low_speed_commutation(bemf, sample->timestamp);
+			if (_state.zc_detection_result == ZC_NOT_DETECTED) {
+				update_input_voltage_current(sample);
+			}
+			return;
+		}
+
 		/*
 		 * Checking if BEMF goes in the right direction.
 		 * This check is only performed for the first sample.
@@ -819,7 +1329,8 @@ void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 		/*
 		 * Find the exact ZC timestamp using the collected samples
 		 */
-		const uint64_t zc_timestamp = solve_zc_approximation();
+		int64_t zc_slope = 0;
+		const uint64_t zc_timestamp = solve_zc_approximation(&zc_slope);
 
 		if (zc_timestamp == 0) {
 			// Abort only if there's no chance to get more data
@@ -842,9 +1353,22 @@ void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 			return;
 		}
 
+		const bool learn_neutral = _params.neutral_compensation && ((_state.flags & FLAG_SYNC_RECOVERY) == 0);
+		const int64_t zc_error = (int64_t)(zc_timestamp - (_state.prev_zc_timestamp + _state.comm_period));
+
 		TESTPAD_ZC_SET();
 		handle_detected_zc(zc_timestamp);
 		TESTPAD_ZC_CLEAR();
+
+		if (learn_neutral) {
+			update_neutral_compensation(zc_error, zc_slope);
+		}
+
+		update_low_speed_flux_threshold(zc_slope);
+
+		if (is_foc_handover_possible()) {
+			hand_over_to_foc(sample->timestamp);
+		}
 	} else {
 		if (past_zc) {
 			const int bemf_threshold = _state.neutral_voltage * 15 / 16;
@@ -908,6 +1432,7 @@ void motor_adc_sample_callback(const struct motor_adc_sample* sample)
 
 			motor_timer_set_relative(0);
 			motor_adc_disable_from_isr();
+			trace_zc(sample->timestamp, sample->timestamp);
 
 			if (_state.averaged_comm_period <= _params.comm_period_max) {
 				if (_state.pwm_val >= _state.pwm_val_after_spinup) {
@@ -941,6 +1466,7 @@ int motor_rtctl_init(const struct motor_rtctl_hardware_info* hw_info)
 	}
 
 	motor_forced_rotation_detector_init();
+	motor_foc_init();
 
 	configure();
 	motor_rtctl_stop();
@@ -1006,15 +1532,21 @@ void motor_rtctl_start(float initial_duty_cycle, float target_duty_cycle,
 	}
 
 	_state.pwm_val = _state.pwm_val_before_spinup;
+	motor_foc_set_duty_cycle(target_duty_cycle);
 
 	_state.comm_table = reverse ? COMMUTATION_TABLE_REVERSE : COMMUTATION_TABLE_FORWARD;
+	_state.comm_table_zc_angles = reverse ? COMMUTATION_TABLE_REVERSE_ZC_ANGLES : COMMUTATION_TABLE_FORWARD_ZC_ANGLES;
 	_state.comm_period = _params.spinup_start_comm_period;
 
-	_state.prev_zc_timestamp = motor_timer_hnsec() - _state.comm_period / 2;
+	const uint64_t timestamp = motor_timer_hnsec();
+	_state.prev_zc_timestamp = timestamp - _state.comm_period / 2;
 	_state.zc_detection_result = ZC_DETECTED;
 	_state.flags = FLAG_ACTIVE | FLAG_SPINUP;
 
-	_diag.started_at = motor_timer_hnsec();
+	_diag.started_at = timestamp;
+
+	motor_trace_start(timestamp);
+	trace_check_trigger(timestamp);
 
 	motor_timer_set_relative(_state.comm_period / 2);
 
@@ -1028,10 +1560,16 @@ void motor_rtctl_start(float initial_duty_cycle, float target_duty_cycle,
 
 void motor_rtctl_stop(void)
 {
+	irq_primask_disable();
+	motor_trace_end_from_isr(motor_timer_hnsec(), MOTOR_TRACE_END_STOP, _state.flags);
+	irq_primask_enable();
+
 	_state.flags = 0;
 	motor_timer_cancel();
 	_state.flags = 0;
 
+	motor_adc_set_current_sampling_mode(false);
+
 	irq_primask_disable();
 	motor_adc_enable_from_isr(); // ADC should be enabled by default
 	irq_primask_enable();
@@ -1041,8 +1579,41 @@ void motor_rtctl_stop(void)
 
 void motor_rtctl_set_duty_cycle(float duty_cycle)
 {
-	// We don't need a critical section to write an integer
-	_state.pwm_val = motor_pwm_compute_pwm_val(duty_cycle);
+	const int pwm_val = motor_pwm_compute_pwm_val(duty_cycle);
+
+	irq_primask_disable();
+	if (_scheduled_duty_cycle.deadline > 0) {
+		/*
+		 * The control thread passes the setpoint on once the scheduled time is reached, which may happen before
+		 * the ADC callback applies the scheduled duty cycle; the new one takes its place, so that it is applied
+		 * within the step as well rather than at the next commutation.
+		 */
+		_scheduled_duty_cycle.pwm_val = pwm_val;
+		_scheduled_duty_cycle.duty_cycle = duty_cycle;
+		_scheduled_duty_cycle.deadline = 1;
+	} else {
+		_state.pwm_val = pwm_val;
+	}
+	trace_duty_cycle(motor_timer_hnsec(), pwm_val, 0);
+	irq_primask_enable();
+
+	motor_foc_set_duty_cycle(duty_cycle);
+}
+
+void motor_rtctl_set_duty_cycle_at(float duty_cycle, uint64_t timestamp_hnsec)
+{
+	const int pwm_val = motor_pwm_compute_pwm_val(duty_cycle);
+
+	irq_primask_disable();
+	_scheduled_duty_cycle.pwm_val = pwm_val;
+	_scheduled_duty_cycle.duty_cycle = duty_cycle;
+	_scheduled_duty_cycle.deadline = (timestamp_hnsec > 0) ? timestamp_hnsec : 1;
+	trace_duty_cycle(motor_timer_hnsec(), pwm_val, _scheduled_duty_cycle.deadline);
+	if ((_state.flags & FLAG_ACTIVE) && ((_state.flags & FLAG_FOC) == 0) &&
+	    (_state.zc_detection_result != ZC_NOT_DETECTED)) {
+		motor_adc_enable_from_isr();    // Disabled past the ZC, see disable_adc_past_zc()
+	}
+	irq_primask_enable();
 }
 
 enum motor_rtctl_state motor_rtctl_get_state(void)
@@ -1102,8 +1673,10 @@ void motor_rtctl_emergency(void)
 	const irqstate_t irqstate = irq_primask_save();
 	{
 		motor_pwm_emergency();
+		motor_trace_end_from_isr(motor_timer_hnsec(), MOTOR_TRACE_END_STOP, _state.flags);
 		_state.flags = 0;
 		motor_timer_cancel();
+		motor_adc_set_current_sampling_mode(false);
 	}
 	irq_primask_restore(irqstate);
 }
@@ -1118,7 +1691,7 @@ void motor_rtctl_get_input_voltage_current(float* out_voltage, float* out_curren
 		curr = smpl.input_current;
 	} else {
 		volt = _state.input_voltage;
-		curr = _state.input_current;
+		curr = (_state.flags & FLAG_FOC) ? motor_foc_get_input_current_raw() : _state.input_current;
 	}
 
 	if (out_voltage) {
@@ -1129,6 +1702,15 @@ void motor_rtctl_get_input_voltage_current(float* out_voltage, float* out_curren
 	}
 }
 
+bool motor_rtctl_get_phase_currents(float out_currents[MOTOR_NUM_PHASES])
+{
+	if (!(_state.flags & FLAG_FOC)) {
+		return false;
+	}
+	motor_foc_get_phase_currents(out_currents);
+	return true;
+}
+
 uint32_t motor_rtctl_get_min_comm_period_hnsec(void)
 {
 	// Ensure some number of ADC samples per comm period
@@ -1174,6 +1756,15 @@ void motor_rtctl_print_debug_info(void)
 	PRINT_INT("bemf opt past zc",state_copy.zc_bemf_samples_optimal_past_zc);
 	PRINT_INT("timing adv deg",  timing_advance_deg);
 
+	if (_params.neutral_compensation) {
+		printf("  %-*s", ALIGNMENT, "neutral offset/gain");
+		for (int i = 0; i < MOTOR_NUM_COMMUTATION_STEPS; i++) {
+			printf(" %.1f/%.1f", state_copy.neutral_offset_q8[i] / 256.0F,
+			       state_copy.neutral_current_gain_q8[i] / 256.0F);
+		}
+		printf("\n");
+	}
+
 	/*
 	 * Diagnostics
 	 */
@@ -1185,6 +1776,10 @@ void motor_rtctl_print_debug_info(void)
 	PRINT_INT("zc failures",       diag_copy.zc_failures_since_start);
 	PRINT_INT("desaturations",     diag_copy.desaturations);
 	PRINT_INT("late commutations", diag_copy.late_commutations);
+	PRINT_INT("foc handovers",     diag_copy.foc_handovers);
+	PRINT_INT("foc failures",      diag_copy.foc_failures);
+	PRINT_INT("low speed entries", diag_copy.low_speed_entries);
+	PRINT_INT("low speed exits",   diag_copy.low_speed_exits);
 	PRINT_INT("bemf out of range", diag_copy.bemf_samples_out_of_range);
 	PRINT_INT("bemf premature zc", diag_copy.bemf_samples_premature_zc);
 	PRINT_INT("bemf extra past zc",diag_copy.extra_bemf_samples_past_zc);
@@ -1195,6 +1790,10 @@ void motor_rtctl_print_debug_info(void)
 	PRINT_FLT("zc sol slope",      diag_copy.zc_solution_slope / (float)LEAST_SQUARES_MULT);
 	PRINT_FLT("zc sol yintercept", diag_copy.zc_solution_yintercept / (float)LEAST_SQUARES_MULT);
 
+	if (state_copy.flags & FLAG_FOC) {
+		motor_foc_print_debug_info();
+	}
+
 	/*
 	 * ZC fitting
 	 */
@@ -39,6 +39,7 @@
 #include "irq.h"
 #include <ch.h>
 #include <hal.h>
+#include <rtos_trace.h>
 #include <assert.h>
 #include <stdio.h>
 
@@ -123,6 +124,8 @@ static volatile int64_t _remaining_ticks = 0;
 __attribute__((optimize(3)))
 CH_FAST_IRQ_HANDLER(TIMEVT_IRQHandler)
 {
+	rtos_trace_irq_enter();
+
 	if ((TIMEVT->SR & TIM_SR_CC1IF) && (TIMEVT->DIER & TIM_DIER_CC1IE)) {
 		TIMEVT->SR = ~TIM_SR_CC1IF;              // Acknowledge IRQ ASAP (before callback)
 
@@ -142,6 +145,8 @@ CH_FAST_IRQ_HANDLER(TIMEVT_IRQHandler)
 			}
 		}
 	}
+
+	rtos_trace_irq_exit();
 }
 
 /**
@@ -155,9 +160,13 @@ CH_FAST_IRQ_HANDLER(TIMEVT_IRQHandler)
 __attribute__((optimize(3)))
 CH_FAST_IRQ_HANDLER(TIMSTP_IRQHandler)
 {
+	rtos_trace_irq_enter();
+
 	assert(TIMSTP->SR & TIM_SR_UIF);
 	TIMSTP->SR = ~TIM_SR_UIF;
 	_raw_ticks += TICKS_PER_OVERFLOW;
+
+	rtos_trace_irq_exit();
 }
 
 /*
@@ -0,0 +1,189 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+#include "trace.h"
+#include "adc.h"
+#include "pwm.h"
+#include "irq.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <zubax_chibios/config/config.h>
+
+
+enum trace_state
+{
+	TRACE_IDLE,
+	TRACE_ARMED,
+	TRACE_WAITING,               ///< The motor is started, waiting for the trigger
+	TRACE_RECORDING,
+	TRACE_FINISHED
+};
+
+static struct trace
+{
+	enum trace_state state;
+	uint32_t delay;
+	uint64_t trigger_timestamp;
+
+	unsigned snapshot_len;
+	int64_t snapshot[MOTOR_TRACE_MAX_SNAPSHOT_LEN];
+
+	unsigned num_records;
+	struct motor_trace_record records[MOTOR_TRACE_MAX_RECORDS];
+} _trace;
+
+
+void motor_trace_arm(uint32_t delay_hnsec)
+{
+	irq_primask_disable();
+	_trace.state = TRACE_ARMED;
+	_trace.delay = delay_hnsec;
+	_trace.snapshot_len = 0;
+	_trace.num_records = 0;
+	irq_primask_enable();
+}
+
+void motor_trace_start(uint64_t timestamp)
+{
+	if (_trace.state == TRACE_ARMED) {
+		_trace.trigger_timestamp = timestamp + _trace.delay;
+		_trace.state = TRACE_WAITING;
+	}
+}
+
+// --- Hard real time code below ---
+#pragma GCC optimize 3
+
+bool motor_trace_begin_from_isr(uint64_t timestamp)
+{
+	if ((_trace.state != TRACE_WAITING) || (timestamp < _trace.trigger_timestamp)) {
+		return false;
+	}
+	_trace.trigger_timestamp = timestamp;
+	_trace.state = TRACE_RECORDING;
+	return true;
+}
+
+void motor_trace_add_snapshot_value_from_isr(int64_t value)
+{
+	assert(_trace.snapshot_len < MOTOR_TRACE_MAX_SNAPSHOT_LEN);
+	if (_trace.snapshot_len < MOTOR_TRACE_MAX_SNAPSHOT_LEN) {
+		_trace.snapshot[_trace.snapshot_len++] = value;
+	}
+}
+
+struct motor_trace_record* motor_trace_add_from_isr(enum motor_trace_record_type type, uint64_t timestamp,
+                                                    unsigned flags)
+{
+	if ((_trace.state != TRACE_RECORDING) || (_trace.num_records >= MOTOR_TRACE_MAX_RECORDS)) {
+		return NULL;
+	}
+
+	struct motor_trace_record* const rec = &_trace.records[_trace.num_records++];
+	rec->timestamp = (int32_t)(timestamp - _trace.trigger_timestamp);
+	rec->type = type;
+	rec->flags = flags;
+	memset(rec->values, 0, sizeof(rec->values));
+	return rec;
+}
+
+void motor_trace_end_from_isr(uint64_t timestamp, enum motor_trace_end_reason reason, unsigned flags)
+{
+	struct motor_trace_record* const rec = motor_trace_add_from_isr(MOTOR_TRACE_END, timestamp, flags);
+	if (rec != NULL) {
+		rec->values[0] = reason;
+	}
+	if ((_trace.state == TRACE_WAITING) || (_trace.state == TRACE_RECORDING)) {
+		_trace.state = TRACE_FINISHED;
+	}
+}
+
+// --- End of hard real time code ---
+#pragma GCC reset_options
+
+unsigned motor_trace_get_records(const struct motor_trace_record** out_records)
+{
+	if (out_records != NULL) {
+		*out_records = _trace.records;
+	}
+	return _trace.num_records;
+}
+
+void motor_trace_print(void)
+{
+	static const char* const STATE_NAMES[] = { "idle", "armed", "waiting", "recording", "finished" };
+
+	irq_primask_disable();
+	const enum trace_state state = _trace.state;
+	irq_primask_enable();
+
+	printf("Motor trace: %u/%u records, %s\n", _trace.num_records, (unsigned)MOTOR_TRACE_MAX_RECORDS,
+	       STATE_NAMES[state]);
+	if ((state != TRACE_FINISHED) || (_trace.num_records == 0)) {
+		return;
+	}
+
+	/*
+	 * Trigger timestamp in hex, hardware constants, and the snapshot of the control state
+	 */
+	printf("T %08lx%08lx %lu %i %u\n",
+	       (unsigned long)(_trace.trigger_timestamp >> 32), (unsigned long)(_trace.trigger_timestamp & 0xFFFFFFFFUL),
+	       (unsigned long)motor_adc_sampling_period_hnsec(), motor_pwm_get_top(), _trace.snapshot_len);
+
+	for (unsigned i = 0; i < _trace.snapshot_len; i++) {
+		const uint64_t x = (uint64_t)_trace.snapshot[i];
+		printf("S %08lx%08lx\n", (unsigned long)(x >> 32), (unsigned long)(x & 0xFFFFFFFFUL));
+	}
+
+	/*
+	 * Configuration of the motor control logic
+	 */
+	for (int i = 0; ; i++) {
+		const char* const name = configNameByIndex(i);
+		if (name == NULL) {
+			break;
+		}
+		if (strncmp(name, "mot_", 4) == 0) {
+			printf("P %s %f\n", name, configGet(name));
+		}
+	}
+
+	for (unsigned i = 0; i < _trace.num_records; i++) {
+		const struct motor_trace_record* const rec = &_trace.records[i];
+		printf("R %u %u %li %u %u %u %u %u\n", rec->type, rec->flags, (long)rec->timestamp,
+		       rec->values[0], rec->values[1], rec->values[2], rec->values[3], rec->values[4]);
+	}
+	printf("E\n");
+}
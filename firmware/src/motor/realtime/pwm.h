@@ -42,7 +42,8 @@
 extern "C" {
 #endif
 
-#define MOTOR_ADC1_2_TRIGGER    (ADC_CR2_EXTSEL_1 | ADC_CR2_EXTSEL_0)
+#define MOTOR_ADC1_2_TRIGGER            (ADC_CR2_EXTSEL_1 | ADC_CR2_EXTSEL_0)
+#define MOTOR_ADC1_INJECTED_TRIGGER     (ADC_CR2_JEXTSEL_1 | ADC_CR2_JEXTSEL_0)
 
 struct motor_pwm_commutation_step
 {
@@ -94,6 +95,25 @@ int motor_pwm_compute_pwm_val(float duty_cycle);
 
 void motor_pwm_set_step_from_isr(const struct motor_pwm_commutation_step* step, int pwm_val);
 
+/**
+ * Sinusoidal commutation - all three phases are switched with individual PWM values in [0; motor_pwm_get_top()].
+ * A phase is connected to the positive rail while the PWM counter is below its PWM value, and to the negative rail
+ * for the rest of the period.
+ * The main ADC sequence is triggered when the PWM counter reaches adc_trigger; the auxiliary input current sample
+ * is triggered at adc_trigger_aux, which must precede the main trigger by at least one ADC sample duration.
+ */
+void motor_pwm_set_duties_from_isr(const int pwm_vals[MOTOR_NUM_PHASES], int adc_trigger_aux, int adc_trigger);
+
+int motor_pwm_get_top(void);
+
+/**
+ * The input current can be sampled only while one of the active vectors is applied.
+ * Settling is the number of PWM ticks from the beginning of the active vector till the ADC trigger;
+ * window is the minimum duration of the active vector that allows to sample the current.
+ */
+int motor_pwm_get_current_settling_ticks(void);
+int motor_pwm_get_current_window_ticks(void);
+
 /**
  * Should be called from high priority threads
  */
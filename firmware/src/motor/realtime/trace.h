@@ -0,0 +1,127 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Trace of the inputs and the decisions of the six-step commutation logic, for offline replay.
+ * The trace is armed while the motor is idle; the recording is triggered after the configured delay since
+ * the next start of the motor, and ends when the motor is stopped, hands over to FOC, or the buffer is full.
+ * At the trigger, the control state is saved into the snapshot, so that the recorded inputs are sufficient
+ * to reproduce every decision bit-exactly. Only the ADC samples that reach the ZC detector are recorded;
+ * the other samples don't affect the control state. See tools/rtctl_replay.
+ */
+#ifndef MOTOR_TRACE_MAX_RECORDS
+#  define MOTOR_TRACE_MAX_RECORDS          512
+#endif
+
+#define MOTOR_TRACE_MAX_SNAPSHOT_LEN       96
+#define MOTOR_TRACE_NUM_VALUES             5
+
+enum motor_trace_record_type
+{
+	MOTOR_TRACE_ADC_SAMPLE,      ///< Input: phase voltages, input voltage, input current
+	MOTOR_TRACE_TIMER,           ///< Input: commutation timer callback
+	MOTOR_TRACE_DUTY_CYCLE,      ///< Input: PWM value, then the 64-bit deadline, zero if applied immediately
+	MOTOR_TRACE_ZC,              ///< Decision: 32-bit comm period, then the 32-bit relative commutation deadline
+	MOTOR_TRACE_STEP,            ///< Decision: comm step, PWM value, ZC detection result, stop flag
+	MOTOR_TRACE_END              ///< Decision or input, see enum motor_trace_end_reason
+};
+
+enum motor_trace_end_reason
+{
+	MOTOR_TRACE_END_STOP,        ///< Input: stopped by the thread
+	MOTOR_TRACE_END_STOP_FROM_ISR,
+	MOTOR_TRACE_END_FOC
+};
+
+struct motor_trace_record
+{
+	int32_t timestamp;           ///< Hectonanoseconds since the trigger
+	uint8_t type;
+	uint8_t flags;               ///< Control state flags
+	uint16_t values[MOTOR_TRACE_NUM_VALUES];
+};
+
+/**
+ * Discards the previous trace; the next start of the motor will be recorded after the specified delay.
+ * Shall be called when the motor is idle.
+ */
+void motor_trace_arm(uint32_t delay_hnsec);
+
+/**
+ * Shall be called when the motor is started, with IRQ disabled.
+ */
+void motor_trace_start(uint64_t timestamp);
+
+/**
+ * Returns true if the recording has been triggered by this call; the caller shall then save the snapshot.
+ */
+bool motor_trace_begin_from_isr(uint64_t timestamp);
+
+void motor_trace_add_snapshot_value_from_isr(int64_t value);
+
+/**
+ * Returns a record to fill, or NULL if the trace is not being recorded.
+ */
+struct motor_trace_record* motor_trace_add_from_isr(enum motor_trace_record_type type, uint64_t timestamp,
+                                                    unsigned flags);
+
+/**
+ * Ends the recording; does nothing if the trace is not being recorded.
+ */
+void motor_trace_end_from_isr(uint64_t timestamp, enum motor_trace_end_reason reason, unsigned flags);
+
+/**
+ * Returns the number of records and the pointer to the first one.
+ * Shall be called when the motor is idle.
+ */
+unsigned motor_trace_get_records(const struct motor_trace_record** out_records);
+
+/**
+ * Prints the trace in the format accepted by the replay harness.
+ * Shall be called when the motor is idle.
+ */
+void motor_trace_print(void);
+
+#ifdef __cplusplus
+}
+#endif
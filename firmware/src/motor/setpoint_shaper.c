@@ -0,0 +1,92 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+#include "setpoint_shaper.h"
+#include <math.h>
+#include <assert.h>
+
+
+void setpoint_shaper_reset(struct setpoint_shaper* shaper, float value)
+{
+	assert(shaper);
+	shaper->value = value;
+	shaper->rate = 0.0f;
+}
+
+bool setpoint_shaper_update(struct setpoint_shaper* shaper, const struct setpoint_shaper_limits* limits,
+                            float target, float dt)
+{
+	assert(shaper && limits);
+	assert(dt > 0.0f);
+
+	if (limits->rate_max <= 0.0f) {
+		setpoint_shaper_reset(shaper, target);
+		return false;
+	}
+
+	const float error = target - shaper->value;
+
+	/*
+	 * The rate that can still be brought down to zero at the target with the given acceleration:
+	 * v^2 = 2 * a * |e|
+	 */
+	float desired_rate = limits->rate_max;
+	if (limits->accel_max > 0.0f) {
+		const float braking_rate = sqrtf(2.0f * limits->accel_max * fabsf(error));
+		if (braking_rate < desired_rate) {
+			desired_rate = braking_rate;
+		}
+	}
+	desired_rate = copysignf(desired_rate, error);
+
+	if (limits->accel_max > 0.0f) {
+		const float rate_step_max = limits->accel_max * dt;
+		if (desired_rate > shaper->rate + rate_step_max) {
+			desired_rate = shaper->rate + rate_step_max;
+		} else if (desired_rate < shaper->rate - rate_step_max) {
+			desired_rate = shaper->rate - rate_step_max;
+		}
+	}
+	shaper->rate = desired_rate;
+
+	const float step = shaper->rate * dt;
+	if (fabsf(step) >= fabsf(error)) {
+		// Target reached or overshot - snapping to it
+		setpoint_shaper_reset(shaper, target);
+		return false;
+	}
+
+	shaper->value += step;
+	return true;
+}
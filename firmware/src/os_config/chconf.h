@@ -44,4 +44,26 @@
 #define PORT_IDLE_THREAD_STACK_SIZE     64
 #define PORT_INT_REQUIRED_STACK         512
 
+/*
+ * Thread execution time accounting, see thread_stats.h.
+ * Optional thread and interrupt tracer, see rtos_trace.h.
+ */
+#if !defined(_FROM_ASM_)
+# include <thread_stats.h>
+#endif
+
+#if RTOS_TRACE_ENABLED
+# if !defined(_FROM_ASM_)
+#  include <rtos_trace.h>
+# endif
+# define CH_CFG_CONTEXT_SWITCH_HOOK(ntp, otp)   {                                               \
+                                                    thread_stats_context_switch((ntp), (otp));  \
+                                                    rtos_trace_context_switch((ntp), (otp));    \
+                                                }
+# define CH_CFG_IRQ_PROLOGUE_HOOK()             rtos_trace_irq_enter()
+# define CH_CFG_IRQ_EPILOGUE_HOOK()             rtos_trace_irq_exit()
+#else
+# define CH_CFG_CONTEXT_SWITCH_HOOK(ntp, otp)   thread_stats_context_switch((ntp), (otp))
+#endif
+
 #include <zubax_chibios/sys/chconf_tail.h>
@@ -41,6 +41,7 @@
 #include <stdlib.h>
 #include <zubax_chibios/os.hpp>
 #include <motor/motor.h>
+#include <thread_stats.h>
 #include <assert.h>
 
 static const unsigned MIN_VALID_PULSE_WIDTH_USEC = 500;
@@ -52,10 +53,13 @@ static const float START_MAX_DUTY_CYCLE = 0.40;
 
 static const unsigned COMMAND_TTL_MS = 100;
 
+static const unsigned PULSE_DEADLINE_USEC = 2000;      ///< Since the pulse; the next one may arrive that soon, at 490 Hz
+
 
 chibios_rt::EvtSource _update_event;
 
 static volatile unsigned _last_pulse_width_usec;
+static volatile uint32_t _last_pulse_at;                ///< End of the pulse, see thread_stats_now()
 
 static os::Logger g_logger{"RCPWM"};
 
@@ -70,6 +74,7 @@ static void icu_pulse_width_callback(ICUDriver* icup)
 
 	if ((new_width >= MIN_VALID_PULSE_WIDTH_USEC) && (new_width <= MAX_VALID_PULSE_WIDTH_USEC)) {
 		_last_pulse_width_usec = new_width;
+		_last_pulse_at = thread_stats_now();
 
 		chSysLockFromISR();
 		chEvtBroadcastFlagsI(&_update_event.ev_source, ALL_EVENTS);      // TODO: use C++ API
@@ -107,6 +112,8 @@ static void thread(void*)
 			continue;
 		}
 
+		thread_stats_begin(THREAD_STATS_RCPWM, _last_pulse_at);
+
 		/*
 		 * Scale the input signal into [0, 1]
 		 */
@@ -141,6 +148,8 @@ static void thread(void*)
 		} else {
 			motor_stop();
 		}
+
+		thread_stats_end(THREAD_STATS_RCPWM, PULSE_DEADLINE_USEC);
 	}
 
 	g_logger.println("Going down");
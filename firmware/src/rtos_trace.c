@@ -0,0 +1,235 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "rtos_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ch.h>
+#include <hal.h>
+
+#if RTOS_TRACE_ENABLED
+
+#define NUM_EXCEPTIONS          (16 + 68)
+
+static struct trace
+{
+	bool frozen;
+	unsigned next;                                      ///< Index of the next record to write
+	uint32_t total;                                     ///< Number of records written since the last clear
+
+	uint32_t ignored_exceptions[(NUM_EXCEPTIONS + 31) / 32];
+
+	unsigned num_threads;
+	const void* threads[RTOS_TRACE_MAX_THREADS];
+
+	struct rtos_trace_record records[RTOS_TRACE_MAX_RECORDS];
+} _trace = {
+	.frozen = true                                      // Until the cycle counter is enabled
+};
+
+
+void rtos_trace_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	rtos_trace_clear();
+	rtos_trace_set_frozen(false);
+}
+
+void rtos_trace_context_switch(const void* new_thread, const void* old_thread)
+{
+	// Called from the kernel with the kernel locked, but the fast IRQs may still preempt
+	const uint32_t primask = __get_PRIMASK();
+	__set_PRIMASK(1);
+	rtos_trace_add(RTOS_TRACE_THREAD_SWITCH, rtos_trace_get_thread_id(new_thread),
+	               rtos_trace_get_thread_id(old_thread));
+	__set_PRIMASK(primask);
+}
+
+static bool is_exception_ignored(unsigned exception)
+{
+	return (exception < NUM_EXCEPTIONS) && (_trace.ignored_exceptions[exception / 32] & (1U << (exception % 32)));
+}
+
+void rtos_trace_irq_enter(void)
+{
+	const unsigned exception = __get_IPSR() & 0x1FF;
+	if (!is_exception_ignored(exception)) {
+		rtos_trace_add(RTOS_TRACE_IRQ_ENTER, exception, 0);
+	}
+}
+
+void rtos_trace_irq_exit(void)
+{
+	const unsigned exception = __get_IPSR() & 0x1FF;
+	if (!is_exception_ignored(exception)) {
+		rtos_trace_add(RTOS_TRACE_IRQ_EXIT, exception, 0);
+	}
+}
+
+void rtos_trace_add(enum rtos_trace_event event, unsigned id, unsigned arg)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__set_PRIMASK(1);
+
+	if (!_trace.frozen) {
+		struct rtos_trace_record* const rec = &_trace.records[_trace.next];
+		rec->cycles = DWT->CYCCNT;
+		rec->event = event;
+		rec->id = id;
+		rec->arg = arg;
+
+		_trace.next = (_trace.next + 1 < RTOS_TRACE_MAX_RECORDS) ? (_trace.next + 1) : 0;
+		_trace.total++;
+	}
+
+	__set_PRIMASK(primask);
+}
+
+unsigned rtos_trace_get_thread_id(const void* thread)
+{
+	for (unsigned i = 0; i < _trace.num_threads; i++) {
+		if (_trace.threads[i] == thread) {
+			return i;
+		}
+	}
+	if (_trace.num_threads < RTOS_TRACE_MAX_THREADS) {
+		_trace.threads[_trace.num_threads] = thread;
+		return _trace.num_threads++;
+	}
+	return RTOS_TRACE_UNKNOWN_THREAD;
+}
+
+void rtos_trace_set_frozen(bool frozen)
+{
+	_trace.frozen = frozen;
+}
+
+unsigned rtos_trace_get_num_records(uint32_t* out_num_lost)
+{
+	const unsigned num_records = (_trace.total < RTOS_TRACE_MAX_RECORDS) ? _trace.total : RTOS_TRACE_MAX_RECORDS;
+	if (out_num_lost != NULL) {
+		*out_num_lost = _trace.total - num_records;
+	}
+	return num_records;
+}
+
+const struct rtos_trace_record* rtos_trace_get_record(unsigned index)
+{
+	const unsigned oldest = (_trace.total < RTOS_TRACE_MAX_RECORDS) ? 0 : _trace.next;
+	return &_trace.records[(oldest + index) % RTOS_TRACE_MAX_RECORDS];
+}
+
+const void* rtos_trace_get_thread(unsigned id)
+{
+	return (id < _trace.num_threads) ? _trace.threads[id] : NULL;
+}
+
+void rtos_trace_clear(void)
+{
+	const uint32_t primask = __get_PRIMASK();
+	__set_PRIMASK(1);
+	_trace.next = 0;
+	_trace.total = 0;
+	__set_PRIMASK(primask);
+}
+
+static void print_trace(void)
+{
+	static const char EVENT_CODES[] = {
+		[RTOS_TRACE_THREAD_SWITCH] = 'S',
+		[RTOS_TRACE_IRQ_ENTER] = 'I',
+		[RTOS_TRACE_IRQ_EXIT] = 'i'
+	};
+
+	rtos_trace_set_frozen(true);
+
+	uint32_t num_lost = 0;
+	const unsigned num_records = rtos_trace_get_num_records(&num_lost);
+
+	printf("rtos_trace clock=%lu records=%u lost=%lu\n", (unsigned long)STM32_SYSCLK, num_records,
+	       (unsigned long)num_lost);
+
+	for (unsigned i = 0; i < RTOS_TRACE_MAX_THREADS; i++) {
+		const thread_t* const tp = rtos_trace_get_thread(i);
+		if (tp != NULL) {
+			const char* const name = chRegGetThreadNameX(tp);
+			printf("thread %u %p %s\n", i, (const void*)tp, (name != NULL) ? name : "?");
+		}
+	}
+
+	for (unsigned i = 0; i < num_records; i++) {
+		const struct rtos_trace_record* const rec = rtos_trace_get_record(i);
+		printf("%08lx %c %u %u\n", (unsigned long)rec->cycles, EVENT_CODES[rec->event], rec->id, rec->arg);
+	}
+	puts("end");
+
+	rtos_trace_clear();
+	rtos_trace_set_frozen(false);
+}
+
+void rtos_trace_execute_cli_command(int argc, const char* argv[])
+{
+	if ((argc == 0) || !strcmp("dump", argv[0])) {
+		print_trace();
+	} else if (!strcmp("clear", argv[0])) {
+		rtos_trace_clear();
+	} else if ((argc == 2) && (!strcmp("ignore", argv[0]) || !strcmp("unignore", argv[0]))) {
+		const int exception = atoi(argv[1]);
+		if ((exception <= 0) || (exception >= NUM_EXCEPTIONS)) {
+			puts("ERROR: Invalid exception number");
+			return;
+		}
+		const uint32_t mask = 1U << (exception % 32);
+		if (argv[0][0] == 'i') {
+			_trace.ignored_exceptions[exception / 32] |= mask;
+		} else {
+			_trace.ignored_exceptions[exception / 32] &= ~mask;
+		}
+	} else {
+		puts("Usage: trace [dump|clear|ignore <exception number>|unignore <exception number>]");
+	}
+}
+
+#else
+
+void rtos_trace_execute_cli_command(int argc, const char* argv[])
+{
+	(void)argc;
+	(void)argv;
+	puts("RTOS trace is disabled; rebuild with RTOS_TRACE=1");
+}
+
+#endif
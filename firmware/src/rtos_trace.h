@@ -0,0 +1,150 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Trace of the thread switches and the interrupts, timestamped with the CPU cycle counter.
+ * The records are written into a RAM ring buffer, which keeps the most recent history; the buffer is dumped
+ * over the CLI and converted on the host, see tools/rtos_trace.
+ *
+ * The tracer is enabled at compile time with RTOS_TRACE=1 (see the Makefile); otherwise all functions below,
+ * except the CLI command, compile to nothing. The interrupts are traced via the ChibiOS hooks (see chconf.h),
+ * except the fast interrupts of the motor driver, which call the functions below directly.
+ *
+ * The recording part doesn't depend on ChibiOS, only on the CMSIS PRIMASK and DWT accessors, so that it can be
+ * built on the host with stubbed CMSIS.
+ */
+#ifndef RTOS_TRACE_ENABLED
+#  define RTOS_TRACE_ENABLED               0
+#endif
+
+#ifndef RTOS_TRACE_MAX_RECORDS
+#  define RTOS_TRACE_MAX_RECORDS           1024
+#endif
+
+#define RTOS_TRACE_MAX_THREADS             16
+#define RTOS_TRACE_UNKNOWN_THREAD          0xFF
+
+enum rtos_trace_event
+{
+	RTOS_TRACE_THREAD_SWITCH,    ///< ID of the new thread, argument is the ID of the previous thread
+	RTOS_TRACE_IRQ_ENTER,        ///< Exception number, i.e. IRQ number + 16
+	RTOS_TRACE_IRQ_EXIT
+};
+
+struct rtos_trace_record
+{
+	uint32_t cycles;             ///< CPU cycle counter, wraps around
+	uint8_t event;
+	uint8_t id;
+	uint16_t arg;
+};
+
+#if RTOS_TRACE_ENABLED
+
+/**
+ * Enables the cycle counter and starts the recording.
+ */
+void rtos_trace_init(void);
+
+void rtos_trace_context_switch(const void* new_thread, const void* old_thread);
+
+void rtos_trace_irq_enter(void);
+
+void rtos_trace_irq_exit(void);
+
+/**
+ * Adds a record timestamped with the current value of the cycle counter. Can be called from any context.
+ */
+void rtos_trace_add(enum rtos_trace_event event, unsigned id, unsigned arg);
+
+/**
+ * Returns the ID of the thread, registering it on the first call; RTOS_TRACE_UNKNOWN_THREAD if the table is full.
+ * Shall be called with IRQ disabled.
+ */
+unsigned rtos_trace_get_thread_id(const void* thread);
+
+/**
+ * Stops or resumes the recording. The records are not modified while the recording is stopped.
+ */
+void rtos_trace_set_frozen(bool frozen);
+
+/**
+ * Returns the number of records in the buffer and the total number of records lost due to wrap-around.
+ * The records are accessed via rtos_trace_get_record(), from the oldest to the newest.
+ * Shall be called when the recording is stopped.
+ */
+unsigned rtos_trace_get_num_records(uint32_t* out_num_lost);
+
+const struct rtos_trace_record* rtos_trace_get_record(unsigned index);
+
+/**
+ * Returns the thread registered under the ID, or NULL.
+ */
+const void* rtos_trace_get_thread(unsigned id);
+
+/**
+ * Discards all records; threads stay registered.
+ */
+void rtos_trace_clear(void);
+
+#else
+
+static inline void rtos_trace_init(void) { }
+static inline void rtos_trace_context_switch(const void* new_thread, const void* old_thread)
+{
+	(void)new_thread;
+	(void)old_thread;
+}
+static inline void rtos_trace_irq_enter(void) { }
+static inline void rtos_trace_irq_exit(void) { }
+
+#endif
+
+/**
+ * Console command: trace [dump|clear|ignore <exception number>|unignore <exception number>]
+ * Dumping stops the recording for the duration of the dump; the dump is then cleared.
+ */
+void rtos_trace_execute_cli_command(int argc, const char* argv[]);
+
+#ifdef __cplusplus
+}
+#endif
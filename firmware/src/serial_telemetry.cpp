@@ -0,0 +1,233 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "serial_telemetry.hpp"
+#include <ch.hpp>
+#include <hal.h>
+#include <algorithm>
+#include <unistd.h>
+#include <zubax_chibios/os.hpp>
+#include <motor/motor.h>
+#include <temperature_sensor.hpp>
+#include <uavcan_node/uavcan_node.hpp>
+
+namespace serial_telemetry
+{
+namespace
+{
+
+enum class Mode
+{
+	Disabled,
+	OnRequest,
+	Periodic
+};
+
+os::config::Param<unsigned> param_mode("tlm_mode",          0,      0,      2);
+os::config::Param<unsigned> param_rate_hz("tlm_rate_hz",   10,      1,    100);
+
+constexpr unsigned PollIntervalMSec = 10;
+constexpr unsigned TxPinIndex = 6;                      // PB6, USART1 remapped
+
+/**
+ * USART1 TX is handed over from the serial driver to DMA1 channel 4. The serial driver keeps receiving,
+ * but its output is discarded, so that log messages don't get mixed into the frames.
+ *
+ * The output is discarded by replacing the notification callback of the output queue, which is the only place
+ * where the serial driver enables the TXE interrupt, i.e. where it starts writing to the data register. This is
+ * safe because:
+ *  - The callback is invoked by the writers of the queue with the kernel locked, and oqGetI() is an I-class
+ *    function, so discarding also wakes up the writers waiting for space in the queue, as transmission would.
+ *  - Once the queue is empty, the interrupt handler of the serial driver disables TXE and TC interrupts by itself,
+ *    and nothing enables them again, so from that moment the data register belongs to DMA only.
+ *  - The serial driver is started once at boot (see board.cpp) and never restarted, so the callback stays in place.
+ *  - The receiving side of the driver does not use the output queue.
+ * Everything that bypasses the output queue (such as a panic message) may still end up on the line.
+ */
+class Transmitter
+{
+	Frame buffer_;
+
+	static void discard_output(io_queue_t* qp)
+	{
+		while (oqGetI(qp) >= Q_OK) {
+		}
+	}
+
+public:
+	void init(bool open_drain)
+	{
+		chSysLock();
+		STDOUT_SD.oqueue.q_notify = &Transmitter::discard_output;
+		discard_output(&STDOUT_SD.oqueue);
+		chSysUnlock();
+
+		// Letting the serial driver finish the byte it was transmitting; the interrupts are disabled by the handler
+		// after the transmission is complete. The TC flag alone is not enough since the handler clears it.
+		while ((USART1->CR1 & (USART_CR1_TXEIE | USART_CR1_TCIE)) != 0) {
+			::usleep(1000);
+		}
+
+		if (open_drain) {
+			palSetPadMode(GPIOB, TxPinIndex, PAL_MODE_STM32_ALTERNATE_OPENDRAIN);
+		}
+
+		RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+		DMA1_Channel4->CCR = 0;
+		DMA1_Channel4->CPAR = reinterpret_cast<std::uint32_t>(&USART1->DR);
+		USART1->CR3 |= USART_CR3_DMAT;
+	}
+
+	bool isBusy() const
+	{
+		return (DMA1_Channel4->CCR & DMA_CCR_EN) && (DMA1_Channel4->CNDTR > 0);
+	}
+
+	/**
+	 * Returns false if the previous frame is still being transmitted.
+	 */
+	bool send(const Frame& frame)
+	{
+		if (isBusy()) {
+			return false;
+		}
+		buffer_ = frame;
+
+		DMA1_Channel4->CCR = 0;
+		DMA1->IFCR = DMA_IFCR_CGIF4;
+		DMA1_Channel4->CMAR = reinterpret_cast<std::uint32_t>(buffer_.data());
+		DMA1_Channel4->CNDTR = buffer_.size();
+		DMA1_Channel4->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_EN;
+		return true;
+	}
+};
+
+class : public chibios_rt::BaseStaticThread<512>
+{
+	Transmitter transmitter_;
+	Mode mode_ = Mode::Disabled;
+	unsigned self_index_ = 0;
+	unsigned num_poles_ = 0;
+	float consumption_mAh_ = 0.0F;
+	systime_t prev_integration_ts_ = 0;
+
+	void integrate_consumption()
+	{
+		const systime_t ts = chVTGetSystemTimeX();
+		const float dt = float(ST2MS(systime_t(ts - prev_integration_ts_))) / 1e3F;
+		prev_integration_ts_ = ts;
+
+		float voltage = 0.0F;
+		float current = 0.0F;
+		motor_get_input_voltage_current(&voltage, &current);
+		consumption_mAh_ += std::max(current, 0.0F) * dt * (1000.0F / 3600.0F);
+	}
+
+	Frame make_frame() const
+	{
+		Snapshot snap;
+
+		const auto temperature_K = temperature_sensor::get_temperature_K();
+		snap.temperature_degC = (temperature_K >= 0) ? float(temperature_K - 273) : 0.0F;
+
+		motor_get_input_voltage_current(&snap.voltage, &snap.current);
+		snap.consumption_mAh = consumption_mAh_;
+		snap.electrical_rpm = motor_get_rpm() * (num_poles_ / 2U);
+
+		return encode_frame(snap);
+	}
+
+	void main() override
+	{
+		os::watchdog::Timer wdt;
+		wdt.startMSec(1000);
+		setName("serial_tlm");
+
+		transmitter_.init(mode_ == Mode::OnRequest);
+		prev_integration_ts_ = chVTGetSystemTimeX();
+
+		const systime_t period = MS2ST(1000U / param_rate_hz.get());
+		systime_t prev_frame_ts = chVTGetSystemTimeX();
+
+		while (!os::isRebootRequested()) {
+			wdt.reset();
+
+			if (mode_ == Mode::OnRequest) {
+				const msg_t req = sdGetTimeout(&STDOUT_SD, MS2ST(PollIntervalMSec));
+				integrate_consumption();
+				if ((req >= 0) && (unsigned(req) == self_index_)) {
+					(void)transmitter_.send(make_frame());
+				}
+			} else {
+				::usleep(PollIntervalMSec * 1000);
+				integrate_consumption();
+				if (chVTTimeElapsedSinceX(prev_frame_ts) >= period) {
+					prev_frame_ts += period;
+					(void)transmitter_.send(make_frame());
+				}
+			}
+		}
+	}
+
+public:
+	void init(Mode mode)
+	{
+		mode_ = mode;
+		self_index_ = uavcan_node::get_esc_index();
+		num_poles_ = motor_get_num_poles();
+
+		(void)start(NORMALPRIO);
+	}
+} thread_;
+
+}
+
+bool is_enabled()
+{
+	return Mode(param_mode.get()) != Mode::Disabled;
+}
+
+int init()
+{
+	if (!is_enabled()) {
+		return 0;
+	}
+
+	const auto mode = Mode(param_mode.get());
+	os::lowsyslog("Serial telemetry: %s, CLI is disabled\n", (mode == Mode::OnRequest) ? "on request" : "periodic");
+
+	thread_.init(mode);
+	return 0;
+}
+
+}
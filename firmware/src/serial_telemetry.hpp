@@ -0,0 +1,86 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/**
+ * Binary ESC telemetry on the serial port, an alternative to the CLI.
+ * The frame format is the de-facto standard 10-byte ESC telemetry frame (known as KISS/BLHeli32 telemetry),
+ * all multi-byte fields are big endian:
+ *      temperature, degC               uint8
+ *      voltage, 0.01 V                 uint16
+ *      current, 0.01 A                 uint16
+ *      consumption, mAh                uint16
+ *      electrical RPM / 100            uint16
+ *      CRC-8 of the above (poly 0x07)  uint8
+ * The frames are transmitted by DMA, either periodically or once per request. A request is a byte equal to
+ * the ESC index received on the serial port; in this mode the TX pin is open drain, so that several ESCs
+ * can share one line.
+ */
+namespace serial_telemetry
+{
+
+constexpr unsigned FrameSize = 10;
+
+typedef std::array<std::uint8_t, FrameSize> Frame;
+
+struct Snapshot
+{
+	float temperature_degC = 0.0F;
+	float voltage = 0.0F;
+	float current = 0.0F;
+	float consumption_mAh = 0.0F;
+	std::uint32_t electrical_rpm = 0;
+};
+
+/**
+ * The frame encoding is platform-independent (see serial_telemetry_frame.cpp), so that it can be tested on the host.
+ */
+std::uint8_t crc8(const std::uint8_t* data, unsigned size);
+
+/**
+ * Values are rounded and saturated to the range of the fields.
+ */
+Frame encode_frame(const Snapshot& snapshot);
+
+/**
+ * True if the serial port is configured for telemetry rather than CLI; this setting is applied at startup.
+ */
+bool is_enabled();
+
+int init();
+
+}
@@ -0,0 +1,84 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "serial_telemetry.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace serial_telemetry
+{
+namespace
+{
+
+std::uint16_t saturate_u16(float x)
+{
+	return std::uint16_t(std::min(std::max(std::lround(x), 0L), 65535L));
+}
+
+}
+
+std::uint8_t crc8(const std::uint8_t* data, unsigned size)
+{
+	std::uint8_t crc = 0;
+	while (size --> 0) {
+		crc ^= *data++;
+		for (int i = 0; i < 8; i++) {
+			crc = (crc & 0x80U) ? std::uint8_t((crc << 1) ^ 0x07U) : std::uint8_t(crc << 1);
+		}
+	}
+	return crc;
+}
+
+Frame encode_frame(const Snapshot& snapshot)
+{
+	const std::uint16_t fields[] = {
+		saturate_u16(snapshot.voltage * 100.0F),
+		saturate_u16(snapshot.current * 100.0F),
+		saturate_u16(snapshot.consumption_mAh),
+		std::uint16_t(std::min<std::uint64_t>((std::uint64_t(snapshot.electrical_rpm) + 50U) / 100U, 65535U))
+	};
+
+	Frame frame;
+	frame[0] = std::uint8_t(std::min(saturate_u16(snapshot.temperature_degC), std::uint16_t(255)));
+
+	unsigned offset = 1;
+	for (auto x : fields) {
+		frame[offset++] = std::uint8_t(x >> 8);
+		frame[offset++] = std::uint8_t(x);
+	}
+
+	frame[FrameSize - 1] = crc8(frame.data(), FrameSize - 1);
+	return frame;
+}
+
+}
@@ -0,0 +1,214 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "thread_stats.h"
+#include <assert.h>
+#include <string.h>
+#include <ch.h>
+#include <hal.h>
+
+#define CYCLES_PER_USEC             (STM32_SYSCLK / 1000000)
+#define CYCLES_PER_TICK             (STM32_SYSCLK / CH_CFG_ST_FREQUENCY)
+#define FIRST_BUCKET_LIMIT_USEC     16
+
+static const char* const NAMES[THREAD_STATS_NUM_IDS] = {
+	[THREAD_STATS_MOTOR] = "motor",
+	[THREAD_STATS_NODE]  = "node",
+	[THREAD_STATS_RCPWM] = "rcpwm"
+};
+
+static struct entry
+{
+	const void* thread;                         ///< Registered by the first thread_stats_begin()
+	uint64_t cpu_cycles;                        ///< Total, except the current time slice; see get_cpu_cycles()
+	uint32_t switched_in_at;
+
+	uint64_t cpu_cycles_at_reset;
+	uint64_t cpu_cycles_at_begin;
+	uint32_t released_at;
+
+	struct thread_stats stats;                  ///< The load is computed on request
+} _entries[THREAD_STATS_NUM_IDS];
+
+static systime_t _reset_at;
+
+
+/**
+ * Shall be called with the kernel locked.
+ */
+static uint64_t get_cpu_cycles(const struct entry* e, uint32_t now)
+{
+	if (e->thread == chThdGetSelfX()) {
+		return e->cpu_cycles + (uint32_t)(now - e->switched_in_at);
+	}
+	return e->cpu_cycles;
+}
+
+static unsigned get_bucket(uint32_t usec)
+{
+	unsigned bucket = 0;
+	uint32_t limit = FIRST_BUCKET_LIMIT_USEC;
+	while ((bucket < (THREAD_STATS_NUM_BUCKETS - 1)) && (usec >= limit)) {
+		bucket++;
+		limit *= 2;
+	}
+	return bucket;
+}
+
+void thread_stats_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	thread_stats_reset();
+}
+
+void thread_stats_context_switch(const void* new_thread, const void* old_thread)
+{
+	// Called from the kernel with the kernel locked, so it must be fast
+	const uint32_t now = DWT->CYCCNT;
+	for (unsigned i = 0; i < THREAD_STATS_NUM_IDS; i++) {
+		struct entry* const e = &_entries[i];
+		if (e->thread == old_thread) {
+			e->cpu_cycles += (uint32_t)(now - e->switched_in_at);
+		} else if (e->thread == new_thread) {
+			e->switched_in_at = now;
+		}
+	}
+}
+
+uint32_t thread_stats_now(void)
+{
+	return DWT->CYCCNT;
+}
+
+uint32_t thread_stats_get_tick_time(uint32_t system_time)
+{
+	chSysLock();
+	uint32_t ticks = chVTGetSystemTimeX();
+	uint32_t since_tick = SysTick->LOAD - SysTick->VAL;
+	uint32_t now = DWT->CYCCNT;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {
+		// The counter has wrapped, but the tick interrupt is held off by the lock; it may have wrapped after the read
+		ticks++;
+		since_tick = SysTick->LOAD - SysTick->VAL;
+		now = DWT->CYCCNT;
+	}
+	chSysUnlock();
+
+	return now - since_tick - (ticks - system_time) * CYCLES_PER_TICK;
+}
+
+void thread_stats_begin(enum thread_stats_id id, uint32_t released_at)
+{
+	assert(id < THREAD_STATS_NUM_IDS);
+	struct entry* const e = &_entries[id];
+
+	chSysLock();
+	const uint32_t now = DWT->CYCCNT;
+	if (e->thread == NULL) {
+		e->thread = chThdGetSelfX();
+		e->switched_in_at = now;
+		e->cpu_cycles_at_reset = e->cpu_cycles;
+	}
+	assert(e->thread == chThdGetSelfX());
+	e->cpu_cycles_at_begin = get_cpu_cycles(e, now);
+	e->released_at = released_at;
+	chSysUnlock();
+}
+
+void thread_stats_end(enum thread_stats_id id, uint32_t deadline_usec)
+{
+	assert(id < THREAD_STATS_NUM_IDS);
+	struct entry* const e = &_entries[id];
+
+	chSysLock();
+	const uint32_t now = DWT->CYCCNT;
+	const uint32_t cpu_usec = (uint32_t)(get_cpu_cycles(e, now) - e->cpu_cycles_at_begin) / CYCLES_PER_USEC;
+	const uint32_t response_usec = (now - e->released_at) / CYCLES_PER_USEC;
+
+	struct thread_stats* const s = &e->stats;
+	s->num_iterations++;
+	s->histogram[get_bucket(cpu_usec)]++;
+	if (cpu_usec > s->max_cpu_usec) {
+		s->max_cpu_usec = cpu_usec;
+	}
+	if (response_usec > s->max_response_usec) {
+		s->max_response_usec = response_usec;
+	}
+	if ((deadline_usec > 0) && (response_usec > deadline_usec)) {
+		s->num_deadline_misses++;
+	}
+	chSysUnlock();
+}
+
+bool thread_stats_get(enum thread_stats_id id, struct thread_stats* out_stats)
+{
+	assert(id < THREAD_STATS_NUM_IDS);
+	assert(out_stats);
+	const struct entry* const e = &_entries[id];
+
+	chSysLock();
+	const bool registered = e->thread != NULL;
+	*out_stats = e->stats;
+	const uint64_t cpu_cycles = get_cpu_cycles(e, DWT->CYCCNT) - e->cpu_cycles_at_reset;
+	const systime_t elapsed_ticks = chVTGetSystemTimeX() - _reset_at;
+	chSysUnlock();
+
+	out_stats->load = (elapsed_ticks > 0) ? (cpu_cycles / ((float)elapsed_ticks * CYCLES_PER_TICK)) : 0.0f;
+	return registered;
+}
+
+const char* thread_stats_get_name(enum thread_stats_id id)
+{
+	assert(id < THREAD_STATS_NUM_IDS);
+	return NAMES[id];
+}
+
+uint32_t thread_stats_get_bucket_limit_usec(unsigned bucket)
+{
+	return (bucket < (THREAD_STATS_NUM_BUCKETS - 1)) ? (FIRST_BUCKET_LIMIT_USEC << bucket) : 0;
+}
+
+void thread_stats_reset(void)
+{
+	chSysLock();
+	const uint32_t now = DWT->CYCCNT;
+	for (unsigned i = 0; i < THREAD_STATS_NUM_IDS; i++) {
+		struct entry* const e = &_entries[i];
+		memset(&e->stats, 0, sizeof(e->stats));
+		e->cpu_cycles_at_reset = get_cpu_cycles(e, now);
+	}
+	_reset_at = chVTGetSystemTimeX();
+	chSysUnlock();
+}
@@ -0,0 +1,128 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Execution time and deadline miss accounting of the periodic loops.
+ * Each loop marks its iterations with thread_stats_begin() and thread_stats_end(). The CPU time of the thread
+ * is accumulated on every context switch (see chconf.h), so that the CPU time of an iteration doesn't include
+ * the time when the thread was blocked or preempted by other threads. The interrupts are not excluded: their time
+ * is charged to the thread they preempted.
+ *
+ * An iteration misses its deadline if it ends later than the deadline after its release, i.e. the time when it
+ * was due: the scheduled wake-up of a periodic loop, or the event it handles. The response time thus includes
+ * the latency of the wake-up, which is where a starved thread loses most of its time.
+ * The time is measured with the CPU cycle counter.
+ */
+enum thread_stats_id
+{
+	THREAD_STATS_MOTOR,                         ///< Motor control loop
+	THREAD_STATS_NODE,                          ///< UAVCAN or Cyphal spin loop
+	THREAD_STATS_RCPWM,                         ///< RC PWM input
+	THREAD_STATS_NUM_IDS
+};
+
+/**
+ * The histogram of the CPU time per iteration has logarithmic buckets: the first one is below 16 us,
+ * each next one is twice as wide, the last one has no upper limit.
+ */
+#define THREAD_STATS_NUM_BUCKETS            10
+
+struct thread_stats
+{
+	float load;                                 ///< Fraction of the time since the reset when the thread was running
+	uint32_t num_iterations;
+	uint32_t num_deadline_misses;
+	uint32_t max_cpu_usec;                      ///< Max CPU time of an iteration
+	uint32_t max_response_usec;                 ///< Max time from the release to the end of an iteration
+	uint32_t histogram[THREAD_STATS_NUM_BUCKETS];
+};
+
+/**
+ * Enables the cycle counter and resets the statistics.
+ */
+void thread_stats_init(void);
+
+/**
+ * Called from the kernel on every context switch.
+ */
+void thread_stats_context_switch(const void* new_thread, const void* old_thread);
+
+/**
+ * Current time for thread_stats_begin(), CPU cycles; wraps around. Can be called from any context.
+ */
+uint32_t thread_stats_now(void);
+
+/**
+ * Converts the system time (see chVTGetSystemTimeX()) in the past or the present to the time of
+ * thread_stats_now(), with the precision of the cycle counter rather than of the system tick.
+ * Requires the periodic tick mode, where the system time is advanced by the SysTick interrupt.
+ */
+uint32_t thread_stats_get_tick_time(uint32_t system_time);
+
+/**
+ * The first call registers the calling thread under the ID.
+ * @param released_at       When the iteration was due, see thread_stats_now()
+ */
+void thread_stats_begin(enum thread_stats_id id, uint32_t released_at);
+
+/**
+ * @param deadline_usec     Max time since the release; zero if the iteration has no deadline
+ */
+void thread_stats_end(enum thread_stats_id id, uint32_t deadline_usec);
+
+/**
+ * @return false if there is no thread registered under the ID, e.g. the RC PWM input is disabled
+ */
+bool thread_stats_get(enum thread_stats_id id, struct thread_stats* out_stats);
+
+const char* thread_stats_get_name(enum thread_stats_id id);
+
+/**
+ * @return upper limit of the histogram bucket, microseconds; zero for the last bucket
+ */
+uint32_t thread_stats_get_bucket_limit_usec(unsigned bucket);
+
+void thread_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
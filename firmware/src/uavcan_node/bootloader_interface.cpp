@@ -33,8 +33,15 @@
  ****************************************************************************/
 
 #include <uavcan_stm32/bxcan.hpp>
+#include <cstring>
 #include "bootloader_interface.hpp"
 
+/// Provided by linker
+const extern std::uint8_t BootloaderImage[];
+const extern std::uint8_t DeviceSignatureStorage[];
+const extern std::uint8_t FirmwareImage[];
+const extern std::uint8_t FirmwareImageEnd[];
+
 namespace uavcan_node
 {
 /**
@@ -53,6 +60,23 @@ static const volatile struct __attribute__((packed))
 } _app_descriptor __attribute__((section(".app_descriptor")));
 
 
+/**
+ * Layout of the bootloader descriptor, see bootloader/bootloader/include/shared.h.
+ * Bootloaders that predate the descriptor don't have it.
+ */
+struct __attribute__((packed)) BootloaderDescriptor
+{
+    std::uint8_t signature[8];
+    std::uint32_t capabilities;
+    std::uint32_t application_address;
+    std::uint32_t application_size;
+    std::uint8_t reserved[4];
+};
+
+static constexpr std::uint8_t BootloaderDescriptorSignature[8] = {'B','L','D','e','s','c','0','0'};
+static constexpr std::uint32_t BootloaderCapabilityStaging = 1U << 0;
+
+
 static constexpr auto BootloaderSignature = 0xB0A0424CU;
 static constexpr auto AppSignature        = 0xB0A04150U;
 
@@ -121,6 +145,49 @@ uavcan::protocol::SoftwareVersion get_uavcan_software_version()
     return x;
 }
 
+StagingArea get_staging_area()
+{
+    static constexpr std::uint32_t FlashPageSize = 2048;
+
+    const BootloaderDescriptor* descriptor = nullptr;
+
+    // The descriptor is aligned on an 8-byte boundary somewhere after the vector table of the bootloader
+    for (const std::uint8_t* p = BootloaderImage;
+         (p + sizeof(BootloaderDescriptor)) <= DeviceSignatureStorage;
+         p += 8)
+    {
+        if (std::memcmp(p, BootloaderDescriptorSignature, sizeof(BootloaderDescriptorSignature)) == 0)
+        {
+            descriptor = reinterpret_cast<const BootloaderDescriptor*>(p);
+            break;
+        }
+    }
+
+    if ((descriptor == nullptr) || ((descriptor->capabilities & BootloaderCapabilityStaging) == 0))
+    {
+        return StagingArea();
+    }
+
+    // The bootloader looks for the staged image past the image size from our descriptor, which must be correct
+    const std::uint32_t image_size = _app_descriptor.image_size;
+    if ((descriptor->application_address != reinterpret_cast<std::uint32_t>(&FirmwareImage[0])) ||
+        (image_size < std::uint32_t(FirmwareImageEnd - FirmwareImage)))
+    {
+        return StagingArea();
+    }
+
+    const std::uint32_t offset = (image_size + FlashPageSize - 1U) & ~(FlashPageSize - 1U);
+    if (offset >= descriptor->application_size)
+    {
+        return StagingArea();
+    }
+
+    StagingArea area;
+    area.address = &FirmwareImage[offset];
+    area.size = descriptor->application_size - offset;
+    return area;
+}
+
 std::uint32_t get_inherited_can_bus_bit_rate()
 {
     return shared_data.can_bus_bit_rate_bps;
@@ -57,6 +57,22 @@ std::uint32_t get_inherited_can_bus_bit_rate();
  */
 uavcan::NodeID get_inherited_node_id();
 
+/**
+ * The free flash following the running image, where a new image can be downloaded to by the application.
+ * The bootloader installs it from there on the next boot.
+ */
+struct StagingArea
+{
+    const std::uint8_t* address = nullptr;
+    std::uint32_t size = 0;
+};
+
+/**
+ * Returns an empty area if the installed bootloader can't install a staged image, e.g. because it predates
+ * this feature, or if there is no free flash left. The image must be downloaded by the bootloader itself then.
+ */
+StagingArea get_staging_area();
+
 /**
  * Initializes the shared data structure with given values.
  */
@@ -33,12 +33,15 @@
  ****************************************************************************/
 
 #include "esc_controller.hpp"
+#include "uavcan_node.hpp"
 #include <uavcan/equipment/esc/RawCommand.hpp>
 #include <uavcan/equipment/esc/RPMCommand.hpp>
 #include <uavcan/equipment/esc/Status.hpp>
 #include <zubax_chibios/os.hpp>
 #include <motor/motor.h>
 #include <temperature_sensor.hpp>
+#include <algorithm>
+#include <cstdint>
 
 namespace uavcan_node
 {
@@ -54,6 +57,127 @@ float max_dc_to_start;
 os::config::Param<unsigned> param_esc_index("esc_index",           0,      0,    15);
 os::config::Param<unsigned> param_cmd_ttl_ms("cmd_ttl_ms",       200,    100,  5000);
 os::config::Param<float> param_cmd_start_dc("cmd_start_dc",      1.0,   0.01,   1.0);
+os::config::Param<unsigned> param_cmd_sync_us("cmd_sync_us",        0,      0,    5000);
+
+/*
+ * Thrust linearization table.
+ * Maps normalized thrust command to normalized output, which is duty cycle for raw commands, or a fraction of
+ * thr_rpm_max for RPM commands. Breakpoints are evenly spaced in thrust; values are in units of 1/10000.
+ * The default table is the identity mapping. Use tools/thrust_calibration to compute it from bench data.
+ */
+os::config::Param<unsigned> param_thr_lin_en("thr_lin_en",        0,      0,    1);
+os::config::Param<unsigned> param_thr_rpm_max("thr_rpm_max",  10000,    100,  100000);
+
+os::config::Param<unsigned> param_thr_lut_0("thr_lut_0",          0,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_1("thr_lut_1",       1250,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_2("thr_lut_2",       2500,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_3("thr_lut_3",       3750,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_4("thr_lut_4",       5000,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_5("thr_lut_5",       6250,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_6("thr_lut_6",       7500,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_7("thr_lut_7",       8750,      0,    10000);
+os::config::Param<unsigned> param_thr_lut_8("thr_lut_8",      10000,      0,    10000);
+
+constexpr unsigned ThrustTableSize = 9;
+
+const os::config::Param<unsigned>* const param_thr_lut[ThrustTableSize] = {
+	&param_thr_lut_0,
+	&param_thr_lut_1,
+	&param_thr_lut_2,
+	&param_thr_lut_3,
+	&param_thr_lut_4,
+	&param_thr_lut_5,
+	&param_thr_lut_6,
+	&param_thr_lut_7,
+	&param_thr_lut_8
+};
+
+/**
+ * Fixed point piecewise linear interpolation over evenly spaced breakpoints, so the segment is found
+ * by a shift rather than by search.
+ */
+class ThrustLinearizer
+{
+	static constexpr unsigned InputFracBits = 16;
+	static constexpr unsigned SegmentFracBits = 13;     // 2^16 / (ThrustTableSize - 1)
+	static_assert((1U << (InputFracBits - SegmentFracBits)) == (ThrustTableSize - 1), "Table size");
+
+	static constexpr int OutputScale = 10000;
+
+	std::uint16_t table_[ThrustTableSize] = {};
+	bool enabled_ = false;
+
+public:
+	void init()
+	{
+		enabled_ = param_thr_lin_en.get() != 0;
+		if (!enabled_) {
+			return;
+		}
+
+		for (unsigned i = 0; i < ThrustTableSize; i++) {
+			table_[i] = std::uint16_t(param_thr_lut[i]->get());
+			if ((i > 0) && (table_[i] < table_[i - 1])) {
+				os::lowsyslog("ESC: Thrust table is not monotonic at %u, linearization disabled\n", i);
+				enabled_ = false;
+				return;
+			}
+		}
+		os::lowsyslog("ESC: Thrust linearization enabled\n");
+	}
+
+	bool isEnabled() const { return enabled_; }
+
+	/**
+	 * @param thrust    Normalized thrust command, Q16, [0, 65536]
+	 * @return          Normalized output, Q16, [0, 65536]
+	 */
+	std::uint32_t map(std::uint32_t thrust) const
+	{
+		if (thrust >= (1U << InputFracBits)) {
+			return (std::uint32_t(table_[ThrustTableSize - 1]) << InputFracBits) / OutputScale;
+		}
+
+		const unsigned index = thrust >> SegmentFracBits;
+		const int frac = int(thrust & ((1U << SegmentFracBits) - 1U));
+
+		const int a = table_[index];
+		const int b = table_[index + 1];
+		const int y = a + (((b - a) * frac) >> SegmentFracBits);
+
+		return (std::uint32_t(y) << InputFracBits) / OutputScale;
+	}
+};
+
+ThrustLinearizer thrust_linearizer;
+
+uavcan::INode* node_ptr;
+std::uint64_t command_sync_delay_usec;
+
+/**
+ * The frames of a broadcast command are received by all nodes on the bus at the same time, but the delay
+ * between the reception and the callback invocation varies from node to node. In order to apply the setpoint
+ * at the same instant on every node, the application time is derived from the reception timestamp, which is
+ * captured in the CAN RX interrupt; since the reception is the common event, the clocks of the nodes need not
+ * be synchronized. The commands carry no transmission timestamp.
+ * Returns zero if the setpoint should be applied immediately.
+ */
+template <typename Message>
+std::uint64_t compute_setpoint_application_time(const uavcan::ReceivedDataStructure<Message>& msg)
+{
+	if (command_sync_delay_usec == 0) {
+		return 0;
+	}
+
+	const std::uint64_t motor_now = motor_get_timestamp_hnsec();
+	const std::int64_t age_usec = (node_ptr->getMonotonicTime() - msg.getMonotonicTimestamp()).toUSec();
+
+	const std::int64_t delay_usec = std::int64_t(command_sync_delay_usec) - age_usec;
+	if (delay_usec <= 0) {
+		return 0;           // Too late
+	}
+	return motor_now + std::uint64_t(delay_usec) * 10U;
+}
 
 
 void cb_raw_command(const uavcan::ReceivedDataStructure<uavcan::equipment::esc::RawCommand>& msg)
@@ -63,14 +187,20 @@ void cb_raw_command(const uavcan::ReceivedDataStructure<uavcan::equipment::esc::
 		return;
 	}
 
-	const float scaled_dc =
-		msg.cmd[self_index] / float(uavcan::equipment::esc::RawCommand::FieldTypes::cmd::RawValueType::max());
+	constexpr int RawCommandMax = uavcan::equipment::esc::RawCommand::FieldTypes::cmd::RawValueType::max();
+
+	float scaled_dc = msg.cmd[self_index] / float(RawCommandMax);
+
+	if (thrust_linearizer.isEnabled() && (msg.cmd[self_index] > 0)) {
+		const auto thrust = (std::uint32_t(msg.cmd[self_index]) << 16) / RawCommandMax;
+		scaled_dc = thrust_linearizer.map(thrust) / 65536.0F;
+	}
 
 	const bool idle = motor_is_idle();
 	const bool accept = (!idle) || (idle && (scaled_dc <= max_dc_to_start));
 
 	if (accept && (scaled_dc > 0)) {
-		motor_set_duty_cycle(scaled_dc, command_ttl_ms);
+		motor_set_duty_cycle_at(scaled_dc, command_ttl_ms, compute_setpoint_application_time(msg));
 	} else {
 		motor_stop();
 	}
@@ -83,10 +213,17 @@ void cb_rpm_command(const uavcan::ReceivedDataStructure<uavcan::equipment::esc::
 		return;
 	}
 
-	const int rpm = msg.rpm[self_index];
+	int rpm = msg.rpm[self_index];
+
+	if (thrust_linearizer.isEnabled() && (rpm > 0)) {
+		// The command is interpreted as thrust, where thr_rpm_max corresponds to the full thrust
+		const std::uint64_t rpm_max = param_thr_rpm_max.get();
+		const auto thrust = std::min<std::uint64_t>((std::uint64_t(rpm) << 16) / rpm_max, 1U << 16);
+		rpm = int((thrust_linearizer.map(std::uint32_t(thrust)) * rpm_max) >> 16);
+	}
 
 	if (rpm > 0) {
-		motor_set_rpm(rpm, command_ttl_ms);
+		motor_set_rpm_at(rpm, command_ttl_ms, compute_setpoint_application_time(msg));
 	} else {
 		motor_stop();
 	}
@@ -121,6 +258,11 @@ void cb_10Hz(const uavcan::TimerEvent& event)
 
 }
 
+unsigned get_esc_index()
+{
+	return param_esc_index.get();
+}
+
 int init_esc_controller(uavcan::INode& node)
 {
 	static uavcan::Subscriber<uavcan::equipment::esc::RawCommand> sub_raw_command(node);
@@ -130,6 +272,9 @@ int init_esc_controller(uavcan::INode& node)
 	self_index = param_esc_index.get();
 	command_ttl_ms = param_cmd_ttl_ms.get();
 	max_dc_to_start = param_cmd_start_dc.get();
+	command_sync_delay_usec = param_cmd_sync_us.get();
+	node_ptr = &node;
+	thrust_linearizer.init();
 
 	int res = 0;
 
@@ -0,0 +1,633 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "firmware_update.hpp"
+#include "bootloader_interface.hpp"
+#include <algorithm>
+#include <cstring>
+#include <uavcan/protocol/file/Read.hpp>
+#include <zubax_chibios/os.hpp>
+#include <zubax_chibios/platform/stm32/flash_writer.hpp>
+#include <motor/motor.h>
+
+/// Provided by linker
+const extern std::uint8_t FirmwareImage[];
+
+namespace uavcan_node
+{
+namespace
+{
+/**
+ * Writes the new image into the staging area sequentially, erasing the pages on the go.
+ * Flash is programmed in half words, so the data is accumulated in a buffer which is written once full.
+ * The staging area is the free flash past the running image, so a large image may not fit; that is reported
+ * separately from the flash failures, since the bootloader can still download such an image by itself.
+ */
+class StagingWriter
+{
+	static constexpr unsigned FlashPageSize = 2048;
+	static constexpr unsigned BufferSize = 256;
+
+	alignas(4) std::uint8_t buffer_[BufferSize];
+	unsigned buffered_size_ = 0;
+	std::uint32_t written_size_ = 0;
+	std::uint32_t erased_size_ = 0;
+	StagingArea area_;
+	bool overflow_ = false;
+
+public:
+	void reset(const StagingArea& area)
+	{
+		buffered_size_ = 0;
+		written_size_ = 0;
+		erased_size_ = 0;
+		area_ = area;
+		overflow_ = false;
+	}
+
+	const std::uint8_t* get_address() const { return area_.address; }
+
+	std::uint32_t get_size() const { return written_size_ + buffered_size_; }
+
+	bool is_overflown() const { return overflow_; }
+
+	/**
+	 * Fails early if the image of the specified size would not fit.
+	 */
+	bool reserve(std::uint32_t size)
+	{
+		overflow_ = overflow_ || (size > area_.size);
+		return !overflow_;
+	}
+
+	bool flush()
+	{
+		if (buffered_size_ == 0) {
+			return true;
+		}
+
+		// The erased state of the padding byte is retained
+		const unsigned padded_size = (buffered_size_ + 1U) & ~1U;
+		if (padded_size > buffered_size_) {
+			buffer_[buffered_size_] = 0xFF;
+		}
+
+		if (!reserve(written_size_ + padded_size)) {
+			return false;
+		}
+
+		os::stm32::FlashWriter writer;
+
+		while (erased_size_ < (written_size_ + padded_size)) {
+			if (!writer.erase(&area_.address[erased_size_], FlashPageSize)) {
+				return false;
+			}
+			erased_size_ += FlashPageSize;
+		}
+
+		if (!writer.write(&area_.address[written_size_], &buffer_[0], padded_size)) {
+			return false;
+		}
+
+		written_size_ += buffered_size_;
+		buffered_size_ = 0;
+		return true;
+	}
+
+	bool write(const std::uint8_t* data, std::uint32_t size)
+	{
+		while (size > 0) {
+			const unsigned n = std::min<std::uint32_t>(size, BufferSize - buffered_size_);
+			std::memcpy(&buffer_[buffered_size_], data, n);
+			buffered_size_ += n;
+			data += n;
+			size -= n;
+
+			if ((buffered_size_ == BufferSize) && !flush()) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * Reconstructs the new image from a binary patch against the running image.
+ * The patch is produced by tools/firmware_delta/make_delta.py. All fields are little endian:
+ *   Header:  signature "SPDelta0", uint64 image CRC of the base image, uint32 size of the new image
+ *   COPY:    uint8 1, uint32 offset, uint32 length  - copy a block from the base image
+ *   INSERT:  uint8 2, uint32 length, data[length]    - literal data
+ *   END:     uint8 0
+ * The patch is decoded as it arrives, so it can be fed in chunks of any size.
+ */
+class DeltaDecoder
+{
+	static constexpr unsigned SignatureSize = 8;
+	static constexpr unsigned HeaderSize = SignatureSize + 8 + 4;
+
+	enum class State { Header, Opcode, Arguments, Literal, Done };
+
+	enum Opcode : std::uint8_t
+	{
+		OpcodeEnd = 0,
+		OpcodeCopy = 1,
+		OpcodeInsert = 2
+	};
+
+	StagingWriter& writer_;
+
+	std::uint8_t field_[HeaderSize];
+	unsigned field_size_ = 0;
+	unsigned expected_field_size_ = 0;
+
+	State state_ = State::Header;
+	std::uint8_t opcode_ = OpcodeEnd;
+	std::uint32_t literal_remaining_ = 0;
+	std::uint32_t target_size_ = 0;
+
+	static const char* get_signature() { return "SPDelta0"; }
+
+	static std::uint32_t read_u32(const std::uint8_t* p)
+	{
+		std::uint32_t x = 0;
+		std::memcpy(&x, p, sizeof(x));
+		return x;
+	}
+
+	/// The running image along with its padding up to the staging area, which is never written to
+	std::uint32_t get_base_size() const
+	{
+		return writer_.get_address() - FirmwareImage;
+	}
+
+	void expect_field(State state, unsigned size)
+	{
+		state_ = state;
+		field_size_ = 0;
+		expected_field_size_ = size;
+	}
+
+	bool write(const std::uint8_t* data, std::uint32_t size)
+	{
+		return ((writer_.get_size() + size) <= target_size_) && writer_.write(data, size);
+	}
+
+	bool handle_header()
+	{
+		std::uint64_t base_crc = 0;
+		std::memcpy(&base_crc, &field_[SignatureSize], sizeof(base_crc));
+		target_size_ = read_u32(&field_[SignatureSize + 8]);
+
+		if (base_crc != get_uavcan_software_version().image_crc) {
+			os::lowsyslog("FW update: The patch is not applicable to the running image\n");
+			return false;
+		}
+		if (!writer_.reserve(target_size_)) {
+			return false;
+		}
+
+		state_ = State::Opcode;
+		return true;
+	}
+
+	bool handle_arguments()
+	{
+		if (opcode_ == OpcodeCopy) {
+			const std::uint32_t offset = read_u32(&field_[0]);
+			const std::uint32_t length = read_u32(&field_[4]);
+			if ((offset > get_base_size()) || (length > (get_base_size() - offset))) {
+				return false;
+			}
+			state_ = State::Opcode;
+			return write(&FirmwareImage[offset], length);
+		}
+
+		literal_remaining_ = read_u32(&field_[0]);
+		state_ = (literal_remaining_ > 0) ? State::Literal : State::Opcode;
+		return true;
+	}
+
+	bool handle_opcode(std::uint8_t opcode)
+	{
+		opcode_ = opcode;
+		switch (opcode_) {
+		case OpcodeEnd: {
+			state_ = State::Done;
+			return true;
+		}
+		case OpcodeCopy: {
+			expect_field(State::Arguments, 8);
+			return true;
+		}
+		case OpcodeInsert: {
+			expect_field(State::Arguments, 4);
+			return true;
+		}
+		default: {
+			return false;
+		}
+		}
+	}
+
+public:
+	DeltaDecoder(StagingWriter& writer) :
+		writer_(writer)
+	{ }
+
+	static bool is_delta(const std::uint8_t* data, unsigned size)
+	{
+		return (size >= SignatureSize) && (std::memcmp(data, get_signature(), SignatureSize) == 0);
+	}
+
+	void reset()
+	{
+		expect_field(State::Header, HeaderSize);
+		literal_remaining_ = 0;
+		target_size_ = 0;
+	}
+
+	/**
+	 * Returns false if the patch is malformed or not applicable to the running image.
+	 */
+	bool feed(const std::uint8_t* data, unsigned size)
+	{
+		while ((size > 0) && (state_ != State::Done)) {
+			if ((state_ == State::Header) || (state_ == State::Arguments)) {
+				const unsigned n = std::min(size, expected_field_size_ - field_size_);
+				std::memcpy(&field_[field_size_], data, n);
+				field_size_ += n;
+				data += n;
+				size -= n;
+
+				if (field_size_ == expected_field_size_) {
+					const bool ok = (state_ == State::Header) ? handle_header() : handle_arguments();
+					if (!ok) {
+						return false;
+					}
+				}
+			} else if (state_ == State::Opcode) {
+				if (!handle_opcode(*data)) {
+					return false;
+				}
+				data++;
+				size--;
+			} else {
+				const unsigned n = std::min<std::uint32_t>(size, literal_remaining_);
+				if (!write(data, n)) {
+					return false;
+				}
+				literal_remaining_ -= n;
+				data += n;
+				size -= n;
+
+				if (literal_remaining_ == 0) {
+					state_ = State::Opcode;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool is_complete() const
+	{
+		return (state_ == State::Done) && (writer_.get_size() == target_size_);
+	}
+};
+
+/**
+ * Downloads the new firmware image into the staging area using the running node.
+ * Several file read requests are kept in flight at once; the responses may arrive in any order,
+ * so they are buffered per request and committed to flash strictly in the order of increasing offset.
+ * The file can be either a full image or a patch against the running image, see DeltaDecoder.
+ * The image is not validated here - the bootloader verifies its CRC before installing it.
+ * If the image turns out to be too large for the free flash, the node restarts into the bootloader,
+ * which downloads the image by itself once the file server repeats the request.
+ * The motor is locked out of starting for the whole download, since flash IO stalls the CPU.
+ */
+class FirmwareDownloader
+{
+	typedef uavcan::protocol::file::Read Read;
+
+	typedef uavcan::MethodBinder<FirmwareDownloader*,
+			void (FirmwareDownloader::*)(const uavcan::ServiceCallResult<Read>&)>
+			ReadCallbackBinder;
+
+	static constexpr unsigned MaxPendingReads = 4;
+	static constexpr unsigned MaxRetries = 3;
+	static constexpr unsigned RequestTimeoutMSec = 1000;
+	static constexpr unsigned ReadChunkSize = Read::Response::FieldTypes::data::MaxSize;
+
+	struct Slot
+	{
+		uavcan::ServiceCallID call_id;
+		std::uint32_t offset = 0;
+		std::uint16_t size = 0;
+		std::uint8_t retries = 0;
+		bool pending = false;   ///< Request is in flight
+		bool ready = false;     ///< Response is received but not yet written
+		alignas(4) std::uint8_t data[ReadChunkSize];
+	};
+
+	uavcan::ServiceClient<Read, ReadCallbackBinder, MaxPendingReads> client_;
+	Slot slots_[MaxPendingReads];
+	uavcan::protocol::file::Path::FieldTypes::path path_;
+	uavcan::NodeID server_node_id_;
+
+	StagingWriter writer_;
+	DeltaDecoder decoder_;
+	uavcan::INode& node_;
+	const std::uint32_t can_bus_bit_rate_;
+
+	std::uint32_t next_request_offset_ = 0;
+	std::uint32_t next_write_offset_ = 0;
+	std::uint32_t file_size_ = 0xFFFFFFFFU;            ///< Unknown until a short read is received
+	bool in_progress_ = false;
+	bool is_delta_ = false;
+
+	void abort(const char* reason)
+	{
+		os::lowsyslog("FW update: Aborted: %s\n", reason);
+		client_.cancelAllCalls();
+		for (auto& s : slots_) {
+			s.pending = false;
+			s.ready = false;
+		}
+		in_progress_ = false;
+
+		if (writer_.is_overflown()) {
+			// The motor stays locked out until the reboot
+			os::lowsyslog("FW update: The image does not fit into the free flash, restarting into the bootloader\n");
+			pass_parameters_to_bootloader(can_bus_bit_rate_, node_.getNodeID());
+			os::requestReboot();
+		} else {
+			motor_release_start_lockout();
+		}
+	}
+
+	bool request(Slot& slot)
+	{
+		Read::Request req;
+		req.offset = slot.offset;
+		req.path.path = path_;
+
+		const int res = client_.call(server_node_id_, req, slot.call_id);
+		if (res < 0) {
+			os::lowsyslog("FW update: Read request failed: %d\n", res);
+			return false;
+		}
+		slot.pending = true;
+		slot.ready = false;
+		return true;
+	}
+
+	bool request_next_chunk(Slot& slot)
+	{
+		if (next_request_offset_ >= file_size_) {
+			return true;                        // Nothing left to request, the slot stays idle
+		}
+		slot.offset = next_request_offset_;
+		slot.retries = 0;
+		next_request_offset_ += ReadChunkSize;
+		return request(slot);
+	}
+
+	bool write(const Slot& slot)
+	{
+		if (slot.offset == 0) {
+			is_delta_ = DeltaDecoder::is_delta(&slot.data[0], slot.size);
+			if (is_delta_) {
+				os::lowsyslog("FW update: The file is a patch against the running image\n");
+				decoder_.reset();
+			}
+		}
+
+		return is_delta_ ? decoder_.feed(&slot.data[0], slot.size) : writer_.write(&slot.data[0], slot.size);
+	}
+
+	void finish()
+	{
+		if (!writer_.flush()) {
+			abort(writer_.is_overflown() ? "Image too large" : "Flash write failure");
+			return;
+		}
+		if (is_delta_ && !decoder_.is_complete()) {
+			abort("Incomplete patch");
+			return;
+		}
+
+		in_progress_ = false;
+
+		if (writer_.get_size() == 0) {
+			os::lowsyslog("FW update: Empty image\n");
+			motor_release_start_lockout();
+			return;
+		}
+
+		// The motor stays locked out until the reboot
+
+		os::lowsyslog("FW update: %u bytes downloaded, %u bytes staged, rebooting into the bootloader\n",
+			unsigned(file_size_), unsigned(writer_.get_size()));
+		os::requestReboot();
+	}
+
+	void handle_read_response(const uavcan::ServiceCallResult<Read>& result)
+	{
+		if (!in_progress_) {
+			return;
+		}
+
+		auto slot = std::find_if(std::begin(slots_), std::end(slots_), [&](const Slot& s) {
+			return s.pending && (s.call_id == result.getCallID());
+		});
+		if (slot == std::end(slots_)) {
+			return;
+		}
+		slot->pending = false;
+
+		if (!result.isSuccessful()) {
+			if (++slot->retries > MaxRetries) {
+				abort("Too many retries");
+			} else if (!request(*slot)) {
+				abort("Request failure");
+			}
+			return;
+		}
+
+		const auto& resp = result.getResponse();
+		if (resp.error.value != uavcan::protocol::file::Error::OK) {
+			os::lowsyslog("FW update: File server error %d at offset %u\n",
+				int(resp.error.value), unsigned(slot->offset));
+			abort("File server error");
+			return;
+		}
+
+		slot->size = resp.data.size();
+		std::fill(std::begin(slot->data), std::end(slot->data), 0xFF);
+		for (unsigned i = 0; i < resp.data.size(); i++) {
+			slot->data[i] = resp.data[i];
+		}
+		slot->ready = true;
+
+		if (slot->size < ReadChunkSize) {
+			file_size_ = std::min<std::uint32_t>(file_size_, slot->offset + slot->size);
+		}
+
+		commit_ready_chunks();
+	}
+
+	void commit_ready_chunks()
+	{
+		while (in_progress_) {
+			auto slot = std::find_if(std::begin(slots_), std::end(slots_), [&](const Slot& s) {
+				return s.ready && (s.offset == next_write_offset_);
+			});
+
+			if (next_write_offset_ >= file_size_) {
+				// Discarding the responses past the end of file, if any
+				if (std::none_of(std::begin(slots_), std::end(slots_), [](const Slot& s) { return s.pending; })) {
+					client_.cancelAllCalls();
+					finish();
+				}
+				return;
+			}
+
+			if (slot == std::end(slots_)) {
+				return;                                 // Waiting for the next chunk in order
+			}
+
+			slot->ready = false;
+			if (!write(*slot)) {
+				abort(writer_.is_overflown() ? "Image too large" :
+				      (is_delta_ ? "Invalid patch" : "Flash write failure"));
+				return;
+			}
+			next_write_offset_ += slot->size;
+
+			if (!request_next_chunk(*slot)) {
+				abort("Request failure");
+				return;
+			}
+		}
+	}
+
+public:
+	FirmwareDownloader(uavcan::INode& node, std::uint32_t can_bus_bit_rate) :
+		client_(node),
+		decoder_(writer_),
+		node_(node),
+		can_bus_bit_rate_(can_bus_bit_rate)
+	{ }
+
+	int init()
+	{
+		const int res = client_.init();
+		if (res < 0) {
+			return res;
+		}
+		client_.setCallback(ReadCallbackBinder(this, &FirmwareDownloader::handle_read_response));
+		client_.setRequestTimeout(uavcan::MonotonicDuration::fromMSec(RequestTimeoutMSec));
+		return 0;
+	}
+
+	/**
+	 * The caller must engage the motor start lockout beforehand; it is released once the download is aborted.
+	 */
+	bool start(uavcan::NodeID server_node_id, const uavcan::protocol::file::Path::FieldTypes::path& path,
+	           const StagingArea& area)
+	{
+		server_node_id_ = server_node_id;
+		path_ = path;
+
+		writer_.reset(area);
+		next_request_offset_ = 0;
+		next_write_offset_ = 0;
+		file_size_ = 0xFFFFFFFFU;
+		in_progress_ = true;
+		is_delta_ = false;
+
+		os::lowsyslog("FW update: Downloading [%s] from %d into the staging area of %u bytes\n",
+			path_.c_str(), int(server_node_id_.get()), unsigned(area.size));
+
+		for (auto& s : slots_) {
+			if (!request_next_chunk(s)) {
+				abort("Request failure");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool is_in_progress() const { return in_progress_; }
+};
+
+uavcan::LazyConstructor<FirmwareDownloader> downloader;
+
+}
+
+int init_firmware_update(uavcan::INode& node, std::uint32_t can_bus_bit_rate)
+{
+	downloader.construct<uavcan::INode&, std::uint32_t>(node, can_bus_bit_rate);
+	return downloader->init();
+}
+
+std::uint8_t begin_firmware_update(uavcan::NodeID server_node_id,
+                                   const uavcan::protocol::file::Path::FieldTypes::path& path)
+{
+	typedef uavcan::protocol::file::BeginFirmwareUpdate::Response Response;
+
+	if (!downloader.isConstructed()) {
+		return Response::ERROR_UNKNOWN;
+	}
+	if (downloader->is_in_progress()) {
+		return Response::ERROR_IN_PROGRESS;
+	}
+	// An older bootloader would not install the staged image, the update would silently do nothing
+	const StagingArea area = get_staging_area();
+	if (area.size == 0) {
+		os::lowsyslog("FW update: The bootloader does not support staging, or there is no free flash\n");
+		return Response::ERROR_INVALID_MODE;
+	}
+	// Flash IO stalls the CPU, which is not acceptable while the motor is running
+	if (!motor_lock_out_start()) {
+		return Response::ERROR_INVALID_MODE;
+	}
+
+	return downloader->start(server_node_id, path, area) ? Response::ERROR_OK : Response::ERROR_UNKNOWN;
+}
+
+bool is_firmware_update_in_progress()
+{
+	return downloader.isConstructed() && downloader->is_in_progress();
+}
+
+}
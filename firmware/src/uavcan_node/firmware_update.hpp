@@ -0,0 +1,59 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <uavcan_stm32/uavcan_stm32.hpp>
+#include <uavcan/protocol/file/BeginFirmwareUpdate.hpp>
+
+namespace uavcan_node
+{
+
+/**
+ * The bit rate is passed to the bootloader if the image has to be downloaded by the bootloader after all.
+ */
+int init_firmware_update(uavcan::INode& node, std::uint32_t can_bus_bit_rate);
+
+/**
+ * Starts downloading the new firmware image from the specified file server into the staging area,
+ * which is the free flash past the running image.
+ * Once the image is downloaded, the node reboots and the bootloader copies the image into the application area.
+ * Returns one of the BeginFirmwareUpdate response error codes; ERROR_INVALID_MODE means that the download
+ * can't be done by the application, because the motor is not idle or the bootloader does not support staging.
+ */
+std::uint8_t begin_firmware_update(uavcan::NodeID server_node_id,
+                                   const uavcan::protocol::file::Path::FieldTypes::path& path);
+
+bool is_firmware_update_in_progress();
+
+}
@@ -0,0 +1,117 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace uavcan_node
+{
+/**
+ * Redundant interface monitor.
+ * libuavcan transmits every frame via all available interfaces and deduplicates received transfers, switching
+ * to another interface if the current one stops delivering; so the node keeps working if one of the buses fails.
+ * This class only detects such failures in order to report them: an interface is considered faulted if
+ * it doesn't receive anything during a check interval while the other ones do. A fault is therefore detected
+ * within one to two check intervals, as is the recovery.
+ *
+ * This class doesn't depend on libuavcan, so that it can be tested on the host; see tools/can_redundancy.
+ */
+class RedundancyMonitor
+{
+public:
+	static constexpr unsigned MaxIfaces = 3;
+	static constexpr std::uint64_t CheckIntervalUSec = 1000000;
+
+private:
+	std::uint64_t prev_frames_rx_[MaxIfaces] = {};
+	bool faulted_[MaxIfaces] = {};
+	std::uint64_t next_check_at_usec_ = 0;
+
+public:
+	/**
+	 * Should be invoked periodically, much more often than the check interval.
+	 * @param [in] ts_usec      Monotonic time
+	 * @param [in] num_ifaces   Number of interfaces, at most MaxIfaces
+	 * @param [in] frames_rx    Total number of frames received by each interface so far
+	 * @return                  Bit mask of the interfaces whose state has changed
+	 */
+	unsigned update(std::uint64_t ts_usec, unsigned num_ifaces, const std::uint64_t frames_rx[])
+	{
+		if (ts_usec < next_check_at_usec_) {
+			return 0;
+		}
+		next_check_at_usec_ = ts_usec + CheckIntervalUSec;
+
+		num_ifaces = std::min(num_ifaces, MaxIfaces);
+		if (num_ifaces < 2) {
+			return 0;
+		}
+
+		std::uint64_t frames_rx_deltas[MaxIfaces] = {};
+		bool any_iface_alive = false;
+		for (unsigned i = 0; i < num_ifaces; i++) {
+			frames_rx_deltas[i] = frames_rx[i] - prev_frames_rx_[i];
+			prev_frames_rx_[i] = frames_rx[i];
+			any_iface_alive = any_iface_alive || (frames_rx_deltas[i] > 0);
+		}
+
+		if (!any_iface_alive) {
+			return 0;           // The bus is just silent, no conclusions can be made
+		}
+
+		unsigned changed_mask = 0;
+		for (unsigned i = 0; i < num_ifaces; i++) {
+			const bool faulted = frames_rx_deltas[i] == 0;
+			if (faulted != faulted_[i]) {
+				faulted_[i] = faulted;
+				changed_mask |= 1U << i;
+			}
+		}
+		return changed_mask;
+	}
+
+	bool isIfaceFaulted(unsigned index) const
+	{
+		return (index < MaxIfaces) && faulted_[index];
+	}
+
+	bool isAnyIfaceFaulted() const
+	{
+		return std::any_of(std::begin(faulted_), std::end(faulted_), [](bool x) { return x; });
+	}
+};
+
+}
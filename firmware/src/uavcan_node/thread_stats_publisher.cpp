@@ -0,0 +1,97 @@
+/****************************************************************************
+ *
+ *   Copyright (C) 2026 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+#include "thread_stats_publisher.hpp"
+#include <uavcan/protocol/debug/KeyValue.hpp>
+#include <zubax_chibios/os.hpp>
+#include <thread_stats.h>
+#include <cstdio>
+
+namespace uavcan_node
+{
+namespace
+{
+
+os::config::Param<unsigned> param_stat_pub_ms("stat_pub_ms",       0,      0,    60000);
+
+uavcan::Publisher<uavcan::protocol::debug::KeyValue>* pub_key_value;
+
+
+void publish(const char* thread_name, const char* metric, float value)
+{
+	char key[uavcan::protocol::debug::KeyValue::FieldTypes::key::MaxSize + 1];
+	std::snprintf(key, sizeof(key), "%s.%s", thread_name, metric);
+
+	uavcan::protocol::debug::KeyValue msg;
+	msg.key = key;
+	msg.value = value;
+	(void)pub_key_value->broadcast(msg);
+}
+
+void cb_timer(const uavcan::TimerEvent&)
+{
+	for (unsigned i = 0; i < THREAD_STATS_NUM_IDS; i++) {
+		const auto id = static_cast<thread_stats_id>(i);
+		thread_stats st;
+		if (thread_stats_get(id, &st)) {
+			publish(thread_stats_get_name(id), "load", st.load * 100.0F);
+			publish(thread_stats_get_name(id), "miss", float(st.num_deadline_misses));
+			publish(thread_stats_get_name(id), "max_us", float(st.max_cpu_usec));
+		}
+	}
+}
+
+}
+
+int init_thread_stats_publisher(uavcan::INode& node)
+{
+	static uavcan::Timer timer(node);
+
+	const unsigned period_ms = param_stat_pub_ms.get();
+	if (period_ms == 0) {
+		return 0;
+	}
+
+	pub_key_value = new uavcan::Publisher<uavcan::protocol::debug::KeyValue>(node);
+	int res = pub_key_value->init(uavcan::TransferPriority::Lowest);
+	if (res != 0) {
+		return res;
+	}
+
+	timer.setCallback(&cb_timer);
+	timer.startPeriodic(uavcan::MonotonicDuration::fromMSec(period_ms));
+
+	return 0;
+}
+
+}
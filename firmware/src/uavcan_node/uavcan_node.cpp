@@ -36,6 +36,9 @@
 #include "esc_controller.hpp"
 #include "indication_controller.hpp"
 #include "bootloader_interface.hpp"
+#include "firmware_update.hpp"
+#include "thread_stats_publisher.hpp"
+#include "redundancy_monitor.hpp"
 #include <algorithm>
 #include <ch.hpp>
 #include <board/board.hpp>
@@ -49,6 +52,7 @@
 #include <uavcan_stm32/bxcan.hpp>
 #include <unistd.h>
 #include <motor/motor.h>
+#include <thread_stats.h>
 
 namespace uavcan_node
 {
@@ -57,7 +61,22 @@ namespace
 
 typedef uavcan::Node<uavcan::MemPoolBlockSize * 128> Node;
 
-uavcan_stm32::CanInitHelper<254> can;
+/*
+ * The RX queue holds the frames that arrive while the node thread isn't spinning. At the full load of the bus
+ * at 1 Mbit/s, which is the worst case, a frame arrives every 67 us: the shortest frame with an extended ID and
+ * a single data byte (the tail byte) takes 67 bit times, or more with bit stuffing.
+ */
+constexpr unsigned RxQueueCapacity = 254;
+constexpr unsigned MinFrameIntervalUSec = 67;
+
+constexpr unsigned SpinDurationMSec = 100;
+/*
+ * A longer iteration of the spin loop may overflow the RX queue at the full bus load, because the frames are
+ * processed only while spinning; it means that the thread was starved, or that a background task stalled it.
+ */
+constexpr unsigned SpinDeadlineUSec = SpinDurationMSec * 1000 + RxQueueCapacity * MinFrameIntervalUSec;
+
+uavcan_stm32::CanInitHelper<RxQueueCapacity> can;
 
 os::config::Param<unsigned> param_node_id("uavcan_node_id",   0,      0,       125);
 
@@ -210,8 +229,22 @@ void handle_begin_firmware_update_request(
 
 	if (in_progress) {
 		response.error = response.ERROR_IN_PROGRESS;
-	} else {
+		return;
+	}
+
+	/*
+	 * The image is downloaded by the application itself if possible, which is much faster than letting
+	 * the bootloader do that, since the node is already configured and concurrent transfers are supported.
+	 * The bootloader is only used as a fallback, e.g. if flash IO is not possible at the moment.
+	 */
+	const auto server_node_id = (request.source_node_id > 0) ?
+		uavcan::NodeID(request.source_node_id) : request.getSrcNodeID();
+
+	response.error = begin_firmware_update(server_node_id, request.image_file_remote_path.path);
+
+	if ((response.error != response.ERROR_OK) && (response.error != response.ERROR_IN_PROGRESS)) {
 		in_progress = true;
+		response.error = response.ERROR_OK;
 		pass_parameters_to_bootloader(active_can_bus_bit_rate, get_node().getNodeID());
 		os::requestReboot();
 	}
@@ -324,6 +357,32 @@ public:
 	}
 };
 
+/*
+ * Redundant interface monitor, fed with the RX counters of libuavcan
+ */
+RedundancyMonitor redundancy_monitor;
+
+static_assert(uavcan::MaxCanIfaces <= RedundancyMonitor::MaxIfaces, "RedundancyMonitor::MaxIfaces");
+
+void poll_redundancy_monitor(uavcan::INode& node)
+{
+	const auto& io_manager = node.getDispatcher().getCanIOManager();
+	const unsigned num_ifaces = io_manager.getNumIfaces();
+
+	std::uint64_t frames_rx[uavcan::MaxCanIfaces] = {};
+	for (unsigned i = 0; i < num_ifaces; i++) {
+		frames_rx[i] = io_manager.getIfacePerfCounters(i).frames_rx;
+	}
+
+	const unsigned changed_mask = redundancy_monitor.update(node.getMonotonicTime().toUSec(), num_ifaces, frames_rx);
+	for (unsigned i = 0; i < num_ifaces; i++) {
+		if (changed_mask & (1U << i)) {
+			os::lowsyslog("UAVCAN: CAN iface %u %s\n", i,
+			              redundancy_monitor.isIfaceFaulted(i) ? "FAULTED" : "recovered");
+		}
+	}
+}
+
 /*
  * UAVCAN spin loop
  */
@@ -374,6 +433,7 @@ class : public chibios_rt::BaseStaticThread<4000>
 				std::printf("    RX overflows: %u\n",
 					    unsigned(can.driver.getIface(i)->getRxQueueOverflowCount()));
 				std::printf("    Errors:       %u\n", unsigned(iface_perf[i].errors));
+				std::printf("    Faulted:      %u\n", unsigned(redundancy_monitor.isIfaceFaulted(i)));
 			}
 		}
 	}
@@ -510,6 +570,16 @@ class : public chibios_rt::BaseStaticThread<4000>
 			board::die(res);
 		}
 
+		res = init_firmware_update(get_node(), active_can_bus_bit_rate);
+		if (res < 0) {
+			board::die(res);
+		}
+
+		res = init_thread_stats_publisher(get_node());
+		if (res < 0) {
+			board::die(res);
+		}
+
 	        res = get_begin_firmware_update_server().start(&handle_begin_firmware_update_request);
 	        if (res < 0)
 	        {
@@ -538,17 +608,29 @@ public:
 		init_node();
 
 		while (!os::isRebootRequested()) {
+			// The loop runs back to back, each iteration is due as soon as the previous one ends
+			thread_stats_begin(THREAD_STATS_NODE, thread_stats_now());
 			wdt_.reset();
 
 			handle_background_tasks();
 
-			get_node().getNodeStatusProvider().setHealth(node_status_health);
-			get_node().getNodeStatusProvider().setMode(node_status_mode);
+			poll_redundancy_monitor(get_node());
+
+			// Loss of a redundant bus is reported as a warning unless there's something worse going on
+			auto health = node_status_health;
+			if (redundancy_monitor.isAnyIfaceFaulted() &&
+			    (health < uavcan::protocol::NodeStatus::HEALTH_WARNING)) {
+				health = uavcan::protocol::NodeStatus::HEALTH_WARNING;
+			}
+			get_node().getNodeStatusProvider().setHealth(health);
+			get_node().getNodeStatusProvider().setMode(is_firmware_update_in_progress() ?
+				uavcan::protocol::NodeStatus::MODE_SOFTWARE_UPDATE : node_status_mode);
 
-			const int spin_res = get_node().spin(uavcan::MonotonicDuration::fromMSec(100));
+			const int spin_res = get_node().spin(uavcan::MonotonicDuration::fromMSec(SpinDurationMSec));
 			if (spin_res < 0) {
 				os::lowsyslog("UAVCAN: Spin failure: %d\n", spin_res);
 			}
+			thread_stats_end(THREAD_STATS_NODE, SpinDeadlineUSec);
 		}
 
 		os::lowsyslog("UAVCAN: Going down\n");
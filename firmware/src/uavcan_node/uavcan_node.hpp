@@ -45,6 +45,11 @@ void set_node_status_critical();
 
 bool is_passive_mode();
 
+/**
+ * Index of this ESC in the setpoint vector; other interfaces that address the ESCs by index use it too.
+ */
+unsigned get_esc_index();
+
 void print_status();
 
 int init();
@@ -0,0 +1,549 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Decodes and analyzes the data stream of the ardubenchmark thrust stand firmware.
+
+Commands:
+  capture   Records the raw serial stream into a file (requires pyserial).
+  analyze   Decodes a recorded stream, validates the checksums, and reports the efficiency curve
+            and the step response metrics; the summary can be saved as JSON.
+  diff      Compares two JSON summaries, e.g. of the same bench procedure run with two firmware versions,
+            and reports the changes; the exit code is non-zero if a regression was found.
+
+Two stream formats are supported; see the firmware sources for details.
+
+The legacy format (default) is emitted by ardubenchmark.c at 115200 baud: header 0xFA [1], checksum [1], tach [2],
+voltage [2], current [2]. The checksum is the 8-bit sum of the bytes after it. Tach is the interval between two
+subsequent blade detections in 250 kHz ticks, or zero if no blade was detected within 0.2 seconds.
+The frames carry no timestamps, so the time is reconstructed from the tach intervals.
+
+The batched format is emitted by the input capture firmware (ardubenchmark_icp.c) at 1 Mbaud: header 0xFB [1],
+sequence [1], number of edges N [1], dropped edges [1], timestamp [4], voltage [2], current [2],
+edge timestamps [4 * N], CRC-16-CCITT [2].
+The timestamps are in 2 MHz ticks. The intervals across lost frames or dropped edges are discarded.
+
+In both formats, voltage and current are raw 10-bit ADC readings; their scale depends on the transducers and
+must be specified on the command line.
+
+Example:
+  ./analyze.py capture /dev/ttyUSB0 v2.3.bin --duration 60
+  ./analyze.py analyze v2.3.bin --blades 2 --volt-lsb 0.0293 --amp-lsb 0.0732 --json v2.3.json
+  ./analyze.py diff v2.3.json v2.4.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+import time
+
+FRAME_HEADER = 0xFA
+FRAME_SIZE = 8
+BAUDRATE = 115200
+
+TACH_FREQUENCY = 250000
+TACH_TIMEOUT = 0.2          # Seconds; the firmware reports zero tach after 50000 ticks without a blade
+
+BATCH_FRAME_HEADER = 0xFB
+BATCH_FRAME_PREFIX = struct.Struct('<BBBBIHH')
+BATCH_MAX_EDGES = 8
+BATCH_BAUDRATE = 1000000
+BATCH_TIMER_FREQUENCY = 2000000
+
+
+class Frame:
+    def __init__(self, tach, voltage, current):
+        self.tach = tach
+        self.voltage = voltage
+        self.current = current
+
+
+class DecoderStats:
+    def __init__(self):
+        self.frames = 0
+        self.checksum_errors = 0
+        self.bytes_skipped = 0
+        self.frames_lost = 0        # Batched format only
+        self.edges_dropped = 0
+
+
+def compute_checksum(payload):
+    return sum(payload) & 0xFF
+
+
+def encode_frame(tach, voltage, current):
+    payload = struct.pack('<HHH', tach, voltage, current)
+    return bytes([FRAME_HEADER, compute_checksum(payload)]) + payload
+
+
+def decode_stream(data, stats=None):
+    """
+    Extracts valid frames from the byte stream; the decoder resynchronizes on the header after errors.
+    Returns the frames, the stats, and the number of bytes consumed; the rest is an incomplete frame.
+    """
+    stats = stats if stats is not None else DecoderStats()
+    frames = []
+    pos = 0
+    while pos + FRAME_SIZE <= len(data):
+        if data[pos] != FRAME_HEADER:
+            pos += 1
+            stats.bytes_skipped += 1
+            continue
+        payload = data[pos + 2:pos + FRAME_SIZE]
+        if compute_checksum(payload) != data[pos + 1]:
+            stats.checksum_errors += 1
+            stats.bytes_skipped += 1
+            pos += 1
+            continue
+        frames.append(Frame(*struct.unpack('<HHH', payload)))
+        stats.frames += 1
+        pos += FRAME_SIZE
+    return frames, stats, pos
+
+
+class BatchFrame:
+    def __init__(self, sequence, dropped, timestamp, voltage, current, edges):
+        self.sequence = sequence
+        self.dropped = dropped
+        self.timestamp = timestamp
+        self.voltage = voltage
+        self.current = current
+        self.edges = edges
+
+
+def compute_crc(data):
+    """CRC-16-CCITT, reflected, as computed by _crc_ccitt_update() from avr-libc."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc
+
+
+def encode_batch_frame(sequence, dropped, timestamp, voltage, current, edges):
+    body = BATCH_FRAME_PREFIX.pack(BATCH_FRAME_HEADER, sequence & 0xFF, len(edges), dropped,
+                                   timestamp & 0xFFFFFFFF, voltage, current)
+    body += b''.join(struct.pack('<I', e & 0xFFFFFFFF) for e in edges)
+    return body + struct.pack('<H', compute_crc(body[1:]))
+
+
+def decode_batch_stream(data, stats=None):
+    """Same as decode_stream(), for the batched format. Lost frames are detected by the sequence number."""
+    stats = stats if stats is not None else DecoderStats()
+    frames = []
+    pos = 0
+    prev_sequence = None
+    while pos + BATCH_FRAME_PREFIX.size + 2 <= len(data):
+        if data[pos] != BATCH_FRAME_HEADER or data[pos + 2] > BATCH_MAX_EDGES:
+            pos += 1
+            stats.bytes_skipped += 1
+            continue
+        size = BATCH_FRAME_PREFIX.size + 4 * data[pos + 2] + 2
+        if pos + size > len(data):
+            break
+        if compute_crc(data[pos + 1:pos + size]) != 0:      # The CRC of a message with its CRC appended is zero
+            stats.checksum_errors += 1
+            stats.bytes_skipped += 1
+            pos += 1
+            continue
+        _, sequence, num_edges, dropped, timestamp, voltage, current = BATCH_FRAME_PREFIX.unpack_from(data, pos)
+        edges = list(struct.unpack_from('<%dI' % num_edges, data, pos + BATCH_FRAME_PREFIX.size))
+        frames.append(BatchFrame(sequence, dropped, timestamp, voltage, current, edges))
+        if prev_sequence is not None:
+            stats.frames_lost += (sequence - prev_sequence - 1) & 0xFF
+        prev_sequence = sequence
+        stats.frames += 1
+        stats.edges_dropped += dropped
+        pos += size
+    return frames, stats, pos
+
+
+class Sample:
+    def __init__(self, time, rpm, voltage, current):
+        self.time = time
+        self.rpm = rpm
+        self.voltage = voltage
+        self.current = current
+
+    @property
+    def power(self):
+        return self.voltage * self.current
+
+
+def convert_frames(frames, blades, volt_lsb, amp_lsb, amp_zero):
+    samples = []
+    t = 0.0
+    for f in frames:
+        if f.tach > 0:
+            t += f.tach / TACH_FREQUENCY
+            rpm = 60.0 * TACH_FREQUENCY / (f.tach * blades)
+        else:
+            t += TACH_TIMEOUT
+            rpm = 0.0
+        samples.append(Sample(t, rpm, f.voltage * volt_lsb, (f.current - amp_zero) * amp_lsb))
+    return samples
+
+
+def convert_batch_frames(frames, blades, volt_lsb, amp_lsb, amp_zero):
+    """
+    Emits one sample per blade edge, and a zero RPM sample per frame if there were no edges for TACH_TIMEOUT.
+    The 32-bit timestamps are unwrapped relative to the previous one, so that the overflow is handled.
+    """
+    samples = []
+    origin = None
+    ref_raw, ref_time = 0, 0.0
+
+    def to_seconds(raw):
+        nonlocal ref_raw, ref_time
+        delta = (raw - ref_raw) & 0xFFFFFFFF
+        if delta >= 0x80000000:
+            delta -= 0x100000000
+        ref_raw, ref_time = raw, ref_time + delta / BATCH_TIMER_FREQUENCY
+        return ref_time
+
+    last_edge = None
+    prev_sequence = None
+    for f in frames:
+        if origin is None:
+            ref_raw = f.timestamp
+            origin = f.timestamp
+        # The interval between the edges around a gap is unknown; the last edge time is still valid for the timeout
+        interval_valid = f.dropped == 0 and (prev_sequence is None or f.sequence == (prev_sequence + 1) & 0xFF)
+        prev_sequence = f.sequence
+        voltage, current = f.voltage * volt_lsb, (f.current - amp_zero) * amp_lsb
+        for e in f.edges:
+            t = to_seconds(e)
+            if last_edge is not None and interval_valid and 0 < t - last_edge < TACH_TIMEOUT:
+                samples.append(Sample(t, 60.0 / ((t - last_edge) * blades), voltage, current))
+            last_edge = t
+            interval_valid = True
+        t = to_seconds(f.timestamp)
+        if last_edge is None or t - last_edge >= TACH_TIMEOUT:
+            samples.append(Sample(t, 0.0, voltage, current))
+    return samples
+
+
+FORMATS = {
+    'batch': (decode_batch_stream, convert_batch_frames, BATCH_BAUDRATE),
+    'legacy': (decode_stream, convert_frames, BAUDRATE),
+}
+
+
+def resample(samples, period):
+    """Zero order hold onto a uniform time grid, because the frames are emitted per blade."""
+    result = []
+    if not samples:
+        return result
+    t = samples[0].time
+    index = 0
+    while t <= samples[-1].time:
+        while index + 1 < len(samples) and samples[index + 1].time <= t:
+            index += 1
+        s = samples[index]
+        result.append(Sample(t, s.rpm, s.voltage, s.current))
+        t += period
+    return result
+
+
+def median(values):
+    values = sorted(values)
+    n = len(values)
+    return values[n // 2] if n % 2 else (values[n // 2 - 1] + values[n // 2]) / 2
+
+
+def find_plateaus(grid, period, window, tolerance_pct, min_tolerance_rpm, min_duration):
+    """Returns (first index, last index, level) of the intervals where the RPM stays within the tolerance."""
+    def get_tolerance(level):
+        return max(level * tolerance_pct / 100.0, min_tolerance_rpm)
+
+    width = max(int(window / period), 1)
+    steady = [False] * len(grid)
+    for i in range(len(grid) - width + 1):
+        chunk = [s.rpm for s in grid[i:i + width]]
+        if max(chunk) - min(chunk) <= get_tolerance(median(chunk)):
+            for k in range(i, i + width):
+                steady[k] = True
+
+    plateaus = []
+    i = 0
+    while i < len(grid):
+        if not steady[i]:
+            i += 1
+            continue
+        # Steady intervals at different levels are adjacent if the transition is shorter than the period
+        k = i
+        while k + 1 < len(grid) and steady[k + 1] and \
+                abs(grid[k + 1].rpm - grid[k].rpm) <= get_tolerance(grid[k].rpm):
+            k += 1
+        if (k - i + 1) * period >= min_duration:
+            plateaus.append((i, k, median([s.rpm for s in grid[i:k + 1]])))
+        i = k + 1
+    return plateaus
+
+
+def compute_step_metrics(grid, plateaus, min_step, settle_band):
+    """
+    Rise time is measured from 10% to 90% of the step. Settling time is measured from the 10% crossing
+    to the last excursion outside of the settling band. Overshoot is relative to the step size.
+    """
+    steps = []
+    for (_, end0, level0), (_, end1, level1) in zip(plateaus, plateaus[1:]):
+        size = level1 - level0
+        if abs(size) < min_step:
+            continue
+        segment = grid[end0:end1 + 1]
+        normalized = [(s.time, (s.rpm - level0) / size) for s in segment]
+
+        def first_crossing(threshold):
+            return next((t for t, y in normalized if y >= threshold), None)
+
+        t10 = first_crossing(0.1)
+        t90 = first_crossing(0.9)
+        if t10 is None or t90 is None:
+            continue
+        peak = max(y for _, y in normalized)
+        last_outside = max((t for t, y in normalized if t >= t10 and abs(y - 1.0) > settle_band), default=t10)
+        steps.append({
+            'time': round(segment[0].time, 3),
+            'from_rpm': round(level0),
+            'to_rpm': round(level1),
+            'rise_time': round(t90 - t10, 4),
+            'overshoot_pct': round(max(peak - 1.0, 0.0) * 100.0, 2),
+            'settling_time': round(last_outside - t10, 4),
+        })
+    return steps
+
+
+def compute_efficiency(grid, plateaus, bin_width, thrust_coef):
+    """Averages the steady state samples in RPM bins. Thrust is estimated as thrust_coef * (RPM / 1000)^2.
+    Each plateau goes into the bin nearest to its level as a whole, so that one operating point is never split."""
+    bins = {}
+    for first, last, level in plateaus:
+        if level > 0:
+            bins.setdefault(int(round(level / bin_width)), []).extend(grid[first:last + 1])
+
+    curve = []
+    for key in sorted(bins):
+        members = bins[key]
+        rpm = sum(s.rpm for s in members) / len(members)
+        voltage = sum(s.voltage for s in members) / len(members)
+        current = sum(s.current for s in members) / len(members)
+        power = sum(s.power for s in members) / len(members)
+        point = {
+            'rpm_bin': key * bin_width,
+            'rpm': round(rpm, 1),
+            'voltage': round(voltage, 3),
+            'current': round(current, 3),
+            'power': round(power, 3),
+            'rpm_per_watt': round(rpm / power, 3) if power > 0 else None,
+        }
+        if thrust_coef:
+            thrust = thrust_coef * (rpm / 1000.0) ** 2
+            point['thrust'] = round(thrust, 2)
+            point['grams_per_watt'] = round(thrust / power, 4) if power > 0 else None
+        curve.append(point)
+    return curve
+
+
+def analyze(data, args):
+    decode, convert, _ = FORMATS[args.format]
+    frames, stats, _ = decode(data)
+    samples = convert(frames, args.blades, args.volt_lsb, args.amp_lsb, args.amp_zero)
+    grid = resample(samples, args.period)
+    plateaus = find_plateaus(grid, args.period, args.window, args.tolerance, args.min_tolerance, args.min_plateau)
+    return {
+        'frames': stats.frames,
+        'checksum_errors': stats.checksum_errors,
+        'bytes_skipped': stats.bytes_skipped,
+        'frames_lost': stats.frames_lost,
+        'edges_dropped': stats.edges_dropped,
+        'duration': round(samples[-1].time - samples[0].time, 3) if samples else 0.0,
+        'efficiency': compute_efficiency(grid, plateaus, args.bin_width, args.thrust_coef),
+        'steps': compute_step_metrics(grid, plateaus, args.min_step, args.settle_band / 100.0),
+    }
+
+
+def print_summary(summary):
+    print('Frames: %d, checksum errors: %d, bytes skipped: %d, duration: %.1f s' %
+          (summary['frames'], summary['checksum_errors'], summary['bytes_skipped'], summary['duration']))
+    if summary.get('frames_lost') or summary.get('edges_dropped'):
+        print('Frames lost: %d, edges dropped by the firmware: %d' % (summary['frames_lost'], summary['edges_dropped']))
+
+    print('\nEfficiency (steady state)')
+    has_thrust = any('grams_per_watt' in p for p in summary['efficiency'])
+    print('%8s %8s %8s %8s %8s%s' % ('RPM', 'V', 'A', 'W', 'RPM/W', '     g/W' if has_thrust else ''))
+    for p in summary['efficiency']:
+        line = '%8.0f %8.2f %8.2f %8.1f %8.1f' % (p['rpm'], p['voltage'], p['current'], p['power'],
+                                                  p['rpm_per_watt'] or 0)
+        if has_thrust:
+            line += ' %8.3f' % (p['grams_per_watt'] or 0)
+        print(line)
+
+    print('\nStep response')
+    print('%8s %8s %8s %10s %10s %10s' % ('Time', 'From', 'To', 'Rise, s', 'Overshoot', 'Settling'))
+    for s in summary['steps']:
+        print('%8.2f %8d %8d %10.3f %9.1f%% %10.3f' % (s['time'], s['from_rpm'], s['to_rpm'], s['rise_time'],
+                                                      s['overshoot_pct'], s['settling_time']))
+
+
+def relative_change(old, new):
+    if old is None or new is None or old == 0:
+        return None
+    return (new - old) / abs(old) * 100.0
+
+
+def diff_summaries(base, new, threshold_pct, rpm_tolerance):
+    """Returns the report lines and the number of regressions exceeding the threshold."""
+    lines = []
+    regressions = 0
+
+    def compare(label, old, new_value, lower_is_better):
+        nonlocal regressions
+        change = relative_change(old, new_value)
+        if change is None:
+            return
+        worse = change > threshold_pct if lower_is_better else change < -threshold_pct
+        regressions += worse
+        lines.append('  %-28s %10.3f -> %10.3f  %+7.1f%%%s' % (label, old, new_value, change,
+                                                            '  REGRESSION' if worse else ''))
+
+    lines.append('Efficiency')
+    new_bins = {p['rpm_bin']: p for p in new['efficiency']}
+    for p in base['efficiency']:
+        q = new_bins.get(p['rpm_bin'])
+        if q is None:
+            continue
+        compare('%d RPM power, W' % p['rpm_bin'], p['power'], q['power'], True)
+        if 'grams_per_watt' in p and 'grams_per_watt' in q:
+            compare('%d RPM efficiency, g/W' % p['rpm_bin'], p['grams_per_watt'], q['grams_per_watt'], False)
+
+    lines.append('Step response')
+    remaining = list(new['steps'])
+    for s in base['steps']:
+        match = next((q for q in remaining
+                      if abs(q['from_rpm'] - s['from_rpm']) <= rpm_tolerance and
+                      abs(q['to_rpm'] - s['to_rpm']) <= rpm_tolerance), None)
+        if match is None:
+            lines.append('  %d -> %d RPM: no matching step' % (s['from_rpm'], s['to_rpm']))
+            continue
+        remaining.remove(match)
+        prefix = '%d->%d' % (s['from_rpm'], s['to_rpm'])
+        compare(prefix + ' rise, s', s['rise_time'], match['rise_time'], True)
+        compare(prefix + ' settling, s', s['settling_time'], match['settling_time'], True)
+        # Overshoot is compared in absolute percentage points, because it is often zero
+        delta = match['overshoot_pct'] - s['overshoot_pct']
+        worse = delta > threshold_pct
+        regressions += worse
+        lines.append('  %-28s %10.1f -> %10.1f  %+7.1f pp%s' % (prefix + ' overshoot, %', s['overshoot_pct'],
+                                                              match['overshoot_pct'], delta,
+                                                              '  REGRESSION' if worse else ''))
+    return lines, regressions
+
+
+def capture(args):
+    import serial
+    decode, _, baudrate = FORMATS[args.format]
+    with serial.Serial(args.port, args.baudrate or baudrate, timeout=0.5) as port, open(args.output, 'wb') as out:
+        stats = DecoderStats()
+        pending = b''
+        started_at = time.monotonic()
+        try:
+            while args.duration is None or time.monotonic() - started_at < args.duration:
+                chunk = port.read(1024)
+                out.write(chunk)
+                # Live decoding only reports the progress; the raw stream is saved as is
+                pending += chunk
+                _, _, consumed = decode(pending, stats)
+                pending = pending[consumed:]
+                print('\rFrames: %d, checksum errors: %d' % (stats.frames, stats.checksum_errors), end='',
+                      file=sys.stderr)
+        except KeyboardInterrupt:
+            pass
+        print(file=sys.stderr)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest='command')
+
+    p = commands.add_parser('capture', help='record the raw serial stream')
+    p.add_argument('port', help='serial port, e.g. /dev/ttyUSB0')
+    p.add_argument('output', help='output file')
+    p.add_argument('--duration', type=float, help='seconds; until Ctrl+C if not specified')
+    p.add_argument('--format', choices=sorted(FORMATS), default='legacy', help='stream format (default legacy)')
+    p.add_argument('--baudrate', type=int, help='override the default baud rate of the format')
+
+    p = commands.add_parser('analyze', help='decode and analyze a recorded stream')
+    p.add_argument('input', help='recorded stream')
+    p.add_argument('--json', help='save the summary into this file')
+    p.add_argument('--format', choices=sorted(FORMATS), default='legacy', help='stream format (default legacy)')
+    p.add_argument('--blades', type=int, default=2, help='number of propeller blades (default 2)')
+    p.add_argument('--volt-lsb', type=float, default=5.0 / 1024, help='volts per voltage ADC count')
+    p.add_argument('--amp-lsb', type=float, default=5.0 / 1024, help='amperes per current ADC count')
+    p.add_argument('--amp-zero', type=float, default=0, help='current ADC reading at zero current')
+    p.add_argument('--thrust-coef', type=float,
+                   help='grams of thrust at 1000 RPM; enables the g/W estimate, assuming thrust ~ RPM^2')
+    p.add_argument('--bin-width', type=float, default=500, help='RPM bin width of the efficiency curve')
+    p.add_argument('--period', type=float, default=0.01, help='resampling period, seconds')
+    p.add_argument('--window', type=float, default=0.3, help='steady state detection window, seconds')
+    p.add_argument('--tolerance', type=float, default=2.0, help='steady state RPM tolerance, percent')
+    p.add_argument('--min-tolerance', type=float, default=50, help='lower limit of the steady state tolerance, RPM')
+    p.add_argument('--min-plateau', type=float, default=0.5, help='minimum steady state duration, seconds')
+    p.add_argument('--min-step', type=float, default=300, help='minimum step size, RPM')
+    p.add_argument('--settle-band', type=float, default=5.0, help='settling band, percent of the step')
+
+    p = commands.add_parser('diff', help='compare two JSON summaries')
+    p.add_argument('base', help='reference summary')
+    p.add_argument('new', help='summary to compare against the reference')
+    p.add_argument('--threshold', type=float, default=5.0, help='regression threshold, percent')
+    p.add_argument('--rpm-tolerance', type=float, default=200, help='step level matching tolerance, RPM')
+
+    args = parser.parse_args()
+
+    if args.command == 'capture':
+        return capture(args)
+
+    if args.command == 'analyze':
+        with open(args.input, 'rb') as f:
+            summary = analyze(f.read(), args)
+        if summary['frames'] == 0:
+            print('No valid frames found', file=sys.stderr)
+            return 1
+        print_summary(summary)
+        if args.json:
+            with open(args.json, 'w') as f:
+                json.dump(summary, f, indent=2)
+        return 0
+
+    if args.command == 'diff':
+        with open(args.base) as f:
+            base = json.load(f)
+        with open(args.new) as f:
+            new = json.load(f)
+        lines, regressions = diff_summaries(base, new, args.threshold, args.rpm_tolerance)
+        print('\n'.join(lines))
+        print('Regressions: %d' % regressions)
+        return 1 if regressions else 0
+
+    parser.print_help()
+    return 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,393 @@
+/*
+ * Pavel Kirienko <pavel.kirienko@gmail.com>
+ *
+ * This is an optical tachometer firmware for Arduino Nano v3.
+ * It detects the propeller blades by observing the voltage variations on a photodiode when a source of light
+ * is obscured by the blade. The edges are timestamped in hardware by the input capture unit of Timer 1,
+ * so the measurement doesn't depend on the main loop timing.
+ * The firmware also samples two extra ADC inputs for DC voltage and current measurement.
+ * The data is reported via the serial port at 1 Mbaud in batched frames, see below.
+ *
+ * This is an alternative to the polling firmware in ardubenchmark.c, built with "make ICP=1". It is validated
+ * under simavr with an external sensor on ICP1 ("make simtest"); the analog comparator path is not simulated.
+ *
+ * The input capture is driven either by the analog comparator (default) or by an external digital sensor
+ * connected to ICP1 (build with -DTACH_SOURCE_COMPARATOR=0). In the former case, the photodiode signal is
+ * compared against its own average, which is obtained with an RC filter, so no threshold calibration is needed.
+ *
+ * Arduino Nano v3 connections:
+ *   A7 - Voltage transducer input
+ *   A6 - Current transducer input
+ *   D7 - Vishay BPW24R (cathode) (anode to GND); pulled up internally
+ *   D6 - Comparator reference: connected to D7 via 100K, and to GND via 1uF
+ *   D8 - External digital sensor, active low (only if the comparator is not used)
+ *   D2 - RPM signal output
+ *
+ * Frame layout (little endian):
+ *   Header 0xFB [1], Sequence [1], Number of edges N [1], Dropped edges [1], Timestamp [4],
+ *   Voltage [2], Current [2], Edge timestamps [4 * N], CRC [2]
+ * The timestamps are in 2 MHz ticks; they overflow every 35 minutes. The frame timestamp is never older than
+ * the edge timestamps in the same frame. Voltage and current are averaged 10-bit ADC readings.
+ * The number of dropped edges is non-zero if the edge buffer overflowed because the link was too slow;
+ * the LED is turned on permanently in this case.
+ * The CRC is CRC-16-CCITT (reflected, polynomial 0x8408, initial value 0xFFFF) of all bytes after the header.
+ * A frame is emitted when TACH_MAX_EDGES_PER_FRAME edges are collected, or every SERIAL_FRAME_PERIOD_USEC.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#ifndef TACH_SOURCE_COMPARATOR
+#   define TACH_SOURCE_COMPARATOR   1
+#endif
+
+// --------------------------
+
+#if F_CPU != 16000000
+#   error "Expected core clock - 16MHz"
+#endif
+
+#define TIMER_TICKS_PER_USEC    2
+
+static volatile uint16_t timer_overflows;
+
+void timer_init(void)
+{
+    TCCR1A = 0;
+    TCCR1B = (1 << ICNC1) | (1 << CS11);        // 2 MHz clock, capture on the falling edge with noise canceler
+    TIFR1 = 0xFF;
+    TIMSK1 = (1 << ICIE1) | (1 << TOIE1);
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    timer_overflows++;
+}
+
+/**
+ * Extends a 16-bit timer reading to 32 bits. Must be called with interrupts disabled.
+ * If an overflow is pending, a small reading belongs to the new period.
+ */
+static inline uint32_t timer_extend(uint16_t low)
+{
+    uint16_t high = timer_overflows;
+    if ((TIFR1 & (1 << TOV1)) && (low < 0x8000))
+        high++;
+    return ((uint32_t)high << 16) | low;
+}
+
+uint32_t timer_stamp(void)
+{
+    uint32_t out = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        out = timer_extend(TCNT1);
+    }
+    return out;
+}
+
+// --------------------------
+
+void gpio_init(void)
+{
+    DDRB  = 1 << 5;  // LED on PB5, Sensor input on PB0
+    PORTB = 0xFF;    // All pull-ups, LED on
+
+    DDRC  = 0;
+    PORTC = 0;       // Analog inputs (digital buffers disabled by DIDR)
+
+    DDRD  = 1 << 2;  // RPM output on PD2
+    PORTD = 0xBF;    // Photodiode cathode pulled up on PD7, comparator reference on PD6 must float
+}
+
+#define rpm_out_set() PORTD |= (1 << 2)
+#define rpm_out_clr() PORTD &= ~(1 << 2)
+
+void led_set(bool on)
+{
+    if (on) PORTB |= 1 << 5;
+    else    PORTB &= ~(1 << 5);
+}
+
+// --------------------------
+
+/*
+ * The capture interrupt is disabled for TACH_HOLDOFF_USEC after every detected edge, so that the noise around
+ * the threshold crossing doesn't produce extra edges. This limits the maximum rate to 5000 blades per second.
+ * The ring buffer size must be a power of two.
+ */
+#define TACH_HOLDOFF_USEC           200
+#define TACH_RING_SIZE              32
+#define TACH_MAX_EDGES_PER_FRAME    8
+
+static volatile uint32_t tach_ring[TACH_RING_SIZE];
+static volatile uint8_t tach_ring_head;              // Written by the ISR only
+static volatile uint8_t tach_ring_tail;              // Written by the main loop only
+static volatile uint8_t tach_dropped;
+
+void tach_init(void)
+{
+#if TACH_SOURCE_COMPARATOR
+    DIDR1 = (1 << AIN1D) | (1 << AIN0D);
+    ADCSRB &= ~(1 << ACME);                             // Negative input is AIN1
+    ACSR = (1 << ACIC);                                 // Positive input is AIN0; output goes to the input capture
+#else
+    ACSR = (1 << ACD);
+#endif
+}
+
+ISR(TIMER1_CAPT_vect)
+{
+    const uint16_t low = ICR1;
+    const uint32_t stamp = timer_extend(low);
+
+    const uint8_t head = tach_ring_head;
+    if ((uint8_t)(head - tach_ring_tail) < TACH_RING_SIZE) {
+        tach_ring[head & (TACH_RING_SIZE - 1)] = stamp;
+        tach_ring_head = head + 1;
+    } else if (tach_dropped < 0xFF) {
+        tach_dropped++;
+    }
+
+    rpm_out_set();
+
+    OCR1A = low + TACH_HOLDOFF_USEC * TIMER_TICKS_PER_USEC;
+    TIFR1 = 1 << OCF1A;
+    TIMSK1 = (TIMSK1 & ~(1 << ICIE1)) | (1 << OCIE1A);
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+    rpm_out_clr();
+
+    TIFR1 = 1 << ICF1;                                  // Discard the edges captured during the holdoff
+    TIMSK1 = (TIMSK1 & ~(1 << OCIE1A)) | (1 << ICIE1);
+}
+
+uint8_t tach_num_pending(void)
+{
+    return tach_ring_head - tach_ring_tail;             // Single byte read is atomic
+}
+
+uint32_t tach_pop(void)
+{
+    const uint8_t tail = tach_ring_tail;
+    uint32_t out = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        out = tach_ring[tail & (TACH_RING_SIZE - 1)];
+    }
+    tach_ring_tail = tail + 1;
+    return out;
+}
+
+uint8_t tach_take_dropped(void)
+{
+    uint8_t out = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        out = tach_dropped;
+        tach_dropped = 0;
+    }
+    return out;
+}
+
+// --------------------------
+
+enum adc_channels
+{
+    ADC_CHAN_CURR = 6,
+    ADC_CHAN_VOLT = 7
+};
+
+#define adc_is_ready() (ADCSRA & (1 << 4))
+#define adc_read16()   (ADC >> 6)
+
+struct adc_accumulator
+{
+    uint32_t sum;
+    uint16_t count;
+    uint16_t last;
+};
+
+static struct adc_accumulator adc_voltage;
+static struct adc_accumulator adc_current;
+
+void adc_init(void)
+{
+    DIDR0 = 0x3F;
+    ADMUX = (1 << 6) | (1 << 5);
+    ADCSRA = (1 << 7) | (1 << 6) | (1 << 4) | (1 << 2) | (1 << 1);
+    while (!adc_is_ready()) {}
+}
+
+void adc_select_channel(uint8_t channel)
+{
+    ADMUX = (ADMUX & 0xF0) | channel;
+}
+
+void adc_start(void)
+{
+    ADCSRA |= (1 << 6) | (1 << 4);
+}
+
+/**
+ * Converts the voltage and current channels in turn without blocking.
+ */
+void adc_poll(void)
+{
+    if (!adc_is_ready())
+        return;
+
+    const bool is_voltage = (ADMUX & 0x0F) == ADC_CHAN_VOLT;
+    struct adc_accumulator* const acc = is_voltage ? &adc_voltage : &adc_current;
+    acc->sum += adc_read16();
+    acc->count++;
+
+    adc_select_channel(is_voltage ? ADC_CHAN_CURR : ADC_CHAN_VOLT);
+    adc_start();
+}
+
+uint16_t adc_take_average(struct adc_accumulator* acc)
+{
+    if (acc->count > 0) {
+        acc->last = acc->sum / acc->count;
+        acc->sum = 0;
+        acc->count = 0;
+    }
+    return acc->last;
+}
+
+// --------------------------
+
+#define SERIAL_FRAME_HEADER         0xFB
+#define SERIAL_FRAME_MAX_SIZE       (1 + 1 + 1 + 1 + 4 + 2 + 2 + 4 * TACH_MAX_EDGES_PER_FRAME + 2)
+#define SERIAL_FRAME_PERIOD_USEC    10000
+#define SERIAL_TX_BUFFER_SIZE       256     // Indexes wrap around naturally
+
+static volatile uint8_t serial_tx_buffer[SERIAL_TX_BUFFER_SIZE];
+static volatile uint8_t serial_tx_head;     // Written by the main loop only
+static volatile uint8_t serial_tx_tail;     // Written by the ISR only
+
+void serial_init(void)
+{
+    UCSR0A = 1 << U2X0;
+    UCSR0B = (1 << RXEN0) | (1 << TXEN0);
+    UCSR0C = (1 << 2) | (1 << 1);
+    UBRR0 = 1;      // 1 Mbaud 0%
+}
+
+ISR(USART_UDRE_vect)
+{
+    const uint8_t tail = serial_tx_tail;
+    if (tail == serial_tx_head) {
+        UCSR0B &= ~(1 << UDRIE0);
+        return;
+    }
+    UDR0 = serial_tx_buffer[tail];
+    serial_tx_tail = tail + 1;
+}
+
+uint16_t serial_tx_free_space(void)
+{
+    return SERIAL_TX_BUFFER_SIZE - 1 - (uint8_t)(serial_tx_head - serial_tx_tail);
+}
+
+void serial_write(const uint8_t* data, uint8_t size)
+{
+    uint8_t head = serial_tx_head;
+    while (size --> 0)
+        serial_tx_buffer[head++] = *data++;
+    serial_tx_head = head;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        UCSR0B |= 1 << UDRIE0;
+    }
+}
+
+/**
+ * Builds and sends a frame with up to TACH_MAX_EDGES_PER_FRAME pending edges.
+ * Returns false if the frame doesn't fit into the TX buffer; the edges are kept in the ring then.
+ */
+bool serial_send_frame(void)
+{
+    static uint8_t sequence;
+
+    if (serial_tx_free_space() < SERIAL_FRAME_MAX_SIZE)
+        return false;
+
+    uint8_t num_edges = tach_num_pending();
+    if (num_edges > TACH_MAX_EDGES_PER_FRAME)
+        num_edges = TACH_MAX_EDGES_PER_FRAME;
+
+    // Taken after the number of edges is known, so that it's not older than any of them
+    const uint32_t timestamp = timer_stamp();
+    const uint16_t voltage = adc_take_average(&adc_voltage);
+    const uint16_t current = adc_take_average(&adc_current);
+
+    uint8_t frame[SERIAL_FRAME_MAX_SIZE];
+    uint8_t size = 0;
+
+    frame[size++] = SERIAL_FRAME_HEADER;
+    frame[size++] = sequence++;
+    frame[size++] = num_edges;
+    const uint8_t dropped = tach_take_dropped();
+    frame[size++] = dropped;
+    memcpy(frame + size, &timestamp, 4);
+    size += 4;
+    memcpy(frame + size, &voltage, 2);
+    size += 2;
+    memcpy(frame + size, &current, 2);
+    size += 2;
+
+    for (uint8_t i = 0; i < num_edges; i++) {
+        const uint32_t edge = tach_pop();
+        memcpy(frame + size, &edge, 4);
+        size += 4;
+    }
+
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 1; i < size; i++)
+        crc = _crc_ccitt_update(crc, frame[i]);
+    memcpy(frame + size, &crc, 2);
+    size += 2;
+
+    serial_write(frame, size);
+
+    if (dropped > 0)
+        led_set(true);      // Latched, nothing turns it off
+    return true;
+}
+
+// --------------------------
+
+int main(void)
+{
+    gpio_init();
+    serial_init();
+    adc_init();
+    timer_init();
+    tach_init();
+
+    adc_select_channel(ADC_CHAN_VOLT);
+    adc_start();
+
+    led_set(false);
+    sei();
+
+    uint32_t prev_frame_timestamp = timer_stamp();
+
+    while (1) {
+        adc_poll();
+
+        const bool batch_full = tach_num_pending() >= TACH_MAX_EDGES_PER_FRAME;
+        const bool period_elapsed =
+            (timer_stamp() - prev_frame_timestamp) >= (SERIAL_FRAME_PERIOD_USEC * (uint32_t)TIMER_TICKS_PER_USEC);
+
+        if ((batch_full || period_elapsed) && serial_send_frame())
+            prev_frame_timestamp = timer_stamp();
+    }
+}
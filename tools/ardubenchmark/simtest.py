@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Runs the input capture firmware (ardubenchmark_icp.c) under simavr and checks the frames it emits.
+
+The firmware is built with TACH_SOURCE_COMPARATOR=0, and simtest_harness injects the edges of an external tach
+sensor into ICP1. The UART output is decoded by analyze.py. The test checks that the CRCs are valid, the sequence
+numbers are contiguous, every injected edge is reported exactly once with the timestamp of the injection, and the
+frames are emitted by the number of edges and by the period. The analog comparator path is not covered.
+
+The RPM profile holds each level for a fraction of a second: a slow one, where the frames are emitted by
+the period, and fast ones, where they are emitted every TACH_MAX_EDGES_PER_FRAME edges. The timer overflows
+many times over the profile. The exit code is non-zero if any check fails.
+
+Example:
+  make simtest
+"""
+
+import os
+import sys
+import subprocess
+import tempfile
+
+import analyze
+
+DIR = os.path.dirname(os.path.abspath(__file__))
+HARNESS = os.path.join(DIR, 'simtest_harness')
+FIRMWARE = os.path.join(DIR, 'simtest_icp.elf')
+
+F_CPU = 16000000
+CYCLES_PER_TICK = F_CPU // analyze.BATCH_TIMER_FREQUENCY
+FRAME_PERIOD = 0.01
+BLADES = 2
+
+START = 0.1                 # Seconds; the firmware initializes meanwhile
+LEVELS = [(600, 0.5), (6000, 0.5), (30000, 0.3), (3000, 0.5)]   # RPM, seconds
+
+MAX_CAPTURE_ERROR_TICKS = 2
+MAX_FRAME_INTERVAL_TICKS = int(FRAME_PERIOD * 1.1 * analyze.BATCH_TIMER_FREQUENCY)
+
+
+def make_edges():
+    """Returns the edge times in CPU cycles. The intervals are not multiples of the timer tick."""
+    edges = []
+    t = START
+    for rpm, duration in LEVELS:
+        interval = 60.0 / (rpm * BLADES)
+        end = t + duration
+        while t < end:
+            edges.append(int(t * F_CPU))
+            t += interval * (1 + 0.01 * ((len(edges) * 7) % 5 - 2))
+    return edges
+
+
+def check(failures, ok, what):
+    if not ok:
+        failures.append(what)
+        print('FAILED: %s' % what)
+
+
+def evaluate(edges, data):
+    """Returns the list of the failed checks."""
+    frames, stats, consumed = analyze.decode_batch_stream(data)
+    failures = []
+
+    check(failures, len(frames) > 0, 'frames decoded')
+    check(failures, stats.checksum_errors == 0, 'no CRC errors (%d)' % stats.checksum_errors)
+    check(failures, stats.bytes_skipped == 0, 'no bytes skipped (%d)' % stats.bytes_skipped)
+    check(failures, consumed == len(data), 'no incomplete frame at the end')
+    check(failures, stats.frames_lost == 0, 'no frames lost (%d)' % stats.frames_lost)
+    check(failures, stats.edges_dropped == 0, 'no edges dropped (%d)' % stats.edges_dropped)
+    check(failures, all(((b.sequence - a.sequence) & 0xFF) == 1 for a, b in zip(frames, frames[1:])),
+          'contiguous sequence numbers')
+
+    # The timestamps are far from the 32-bit overflow, so they are not unwrapped
+    reported = [e for fr in frames for e in fr.edges]
+    check(failures, len(reported) == len(edges), 'every edge reported once (%d of %d)' % (len(reported), len(edges)))
+    if reported and len(reported) == len(edges):
+        # The timer starts after the reset, so the offset is constant; it is taken from the first edge
+        offset = reported[0] - edges[0] // CYCLES_PER_TICK
+        errors = [abs(r - e // CYCLES_PER_TICK - offset) for r, e in zip(reported, edges)]
+        check(failures, max(errors) <= MAX_CAPTURE_ERROR_TICKS, 'edge timestamps (max error %d ticks)' % max(errors))
+        check(failures, abs(offset) < START * analyze.BATCH_TIMER_FREQUENCY, 'timer offset (%d ticks)' % offset)
+
+    check(failures, all(e <= fr.timestamp for fr in frames for e in fr.edges), 'frame timestamp not older than edges')
+    intervals = [b.timestamp - a.timestamp for a, b in zip(frames, frames[1:])]
+    check(failures, all(0 < x <= MAX_FRAME_INTERVAL_TICKS for x in intervals),
+          'frame intervals (max %d ticks)' % (max(intervals) if intervals else 0))
+    check(failures, any(len(fr.edges) == analyze.BATCH_MAX_EDGES for fr in frames), 'frames emitted by edge count')
+    check(failures, any(len(fr.edges) == 0 for fr in frames), 'frames emitted by period')
+
+    print('%d frames, %d edges injected, %d reported; %d checks failed' %
+          (len(frames), len(edges), len(reported), len(failures)))
+    return failures
+
+
+def main():
+    for path in (HARNESS, FIRMWARE):
+        if not os.path.isfile(path):
+            print('%s is not built, run make simtest' % os.path.basename(path), file=sys.stderr)
+            return 1
+
+    edges = make_edges()
+    with tempfile.TemporaryDirectory() as tmp:
+        edges_path = os.path.join(tmp, 'edges.txt')
+        stream_path = os.path.join(tmp, 'stream.bin')
+        with open(edges_path, 'w') as f:
+            f.write('\n'.join(str(x) for x in edges) + '\n')
+        proc = subprocess.run([HARNESS, FIRMWARE, edges_path, stream_path],
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+        if proc.returncode != 0:
+            print('Harness failed: %s' % proc.stderr.strip(), file=sys.stderr)
+            return 1
+        with open(stream_path, 'rb') as f:
+            data = f.read()
+
+    failures = evaluate(edges, data)
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
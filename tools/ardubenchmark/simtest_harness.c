@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * simavr harness of the input capture firmware (ardubenchmark_icp.c built with TACH_SOURCE_COMPARATOR=0),
+ * see simtest.py.
+ *
+ * The harness drives the output of an external digital tach sensor, which is connected to ICP1 (PB0): the output
+ * falls at the specified edge times and returns high PULSE_CYCLES later. The bytes sent by the UART are recorded.
+ * The simulation runs TAIL_CYCLES past the last edge, so that the firmware sends the last frame.
+ *
+ * Usage:
+ *   simtest_harness <firmware.elf> <edges.txt> <stream.bin>
+ * edges.txt holds the edge times in CPU cycles in ascending order, one per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sim_avr.h>
+#include <sim_elf.h>
+#include <sim_io.h>
+#include <sim_cycle_timers.h>
+#include <avr_ioport.h>
+#include <avr_uart.h>
+
+#define MCU             "atmega328p"
+#define F_CPU           16000000
+#define PULSE_CYCLES    (F_CPU / 10000)         // 100 us, shorter than the holdoff of the firmware
+#define TAIL_CYCLES     (F_CPU / 20)            // 50 ms, longer than the frame period
+
+static avr_cycle_count_t* edges;
+static size_t num_edges;
+static size_t next_edge;
+static bool pulse_active;
+static avr_irq_t* sensor_irq;
+static FILE* stream;
+
+static avr_cycle_count_t sensor_update(avr_t* avr, avr_cycle_count_t when, void* param)
+{
+    (void)avr;
+    (void)param;
+
+    if (!pulse_active) {
+        avr_raise_irq(sensor_irq, 0);
+        pulse_active = true;
+        return when + PULSE_CYCLES;
+    }
+
+    avr_raise_irq(sensor_irq, 1);
+    pulse_active = false;
+    next_edge++;
+    return (next_edge < num_edges) ? edges[next_edge] : 0;
+}
+
+static void uart_output(avr_irq_t* irq, uint32_t value, void* param)
+{
+    (void)irq;
+    (void)param;
+    fputc((int)(value & 0xFF), stream);
+}
+
+static int read_edges(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+
+    size_t capacity = 1024;
+    edges = malloc(capacity * sizeof(edges[0]));
+    unsigned long long x = 0;
+    while ((edges != NULL) && (fscanf(f, "%llu", &x) == 1)) {
+        if (num_edges == capacity) {
+            capacity *= 2;
+            edges = realloc(edges, capacity * sizeof(edges[0]));
+            if (edges == NULL)
+                break;
+        }
+        if ((num_edges > 0) && (x < edges[num_edges - 1] + 2 * PULSE_CYCLES)) {
+            fprintf(stderr, "Edges must be ascending and at least %d cycles apart\n", 2 * PULSE_CYCLES);
+            fclose(f);
+            return -1;
+        }
+        edges[num_edges++] = x;
+    }
+    fclose(f);
+    return ((edges != NULL) && (num_edges > 0)) ? 0 : -1;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <firmware.elf> <edges.txt> <stream.bin>\n", argv[0]);
+        return 1;
+    }
+
+    elf_firmware_t firmware;
+    memset(&firmware, 0, sizeof(firmware));
+    if (elf_read_firmware(argv[1], &firmware) != 0) {
+        fprintf(stderr, "Could not read %s\n", argv[1]);
+        return 1;
+    }
+    strcpy(firmware.mmcu, MCU);
+    firmware.frequency = F_CPU;
+
+    if (read_edges(argv[2]) != 0) {
+        fprintf(stderr, "Could not read the edges from %s\n", argv[2]);
+        return 1;
+    }
+
+    stream = fopen(argv[3], "wb");
+    if (stream == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[3]);
+        return 1;
+    }
+
+    avr_t* const avr = avr_make_mcu_by_name(MCU);
+    if (avr == NULL) {
+        fprintf(stderr, "simavr does not support %s\n", MCU);
+        return 1;
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &firmware);
+
+    // The bytes go into the file only, not to the console of simavr
+    uint32_t uart_flags = 0;
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &uart_flags);
+    uart_flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &uart_flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uart_output, NULL);
+
+    // The sensor output is idle high; the firmware captures the falling edges
+    sensor_irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 0);
+    avr_raise_irq(sensor_irq, 1);
+    avr_cycle_timer_register(avr, edges[0] - avr->cycle, sensor_update, NULL);
+
+    const avr_cycle_count_t end = edges[num_edges - 1] + TAIL_CYCLES;
+    int state = cpu_Running;
+    while ((avr->cycle < end) && (state != cpu_Done) && (state != cpu_Crashed))
+        state = avr_run(avr);
+
+    fclose(stream);
+
+    if (state == cpu_Crashed) {
+        fprintf(stderr, "The firmware crashed at cycle %llu\n", (unsigned long long)avr->cycle);
+        return 1;
+    }
+    return 0;
+}
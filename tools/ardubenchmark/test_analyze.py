@@ -0,0 +1,376 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Tests of analyze.py: the decoders of both stream formats and their resynchronization after errors,
+the conversion of the frames into samples, the step response metrics, the comparison of the summaries,
+and the command line on streams synthesized from a known RPM profile.
+
+Example:
+  make check
+  ./test_analyze.py -v
+"""
+
+import os
+import sys
+import json
+import math
+import tempfile
+import unittest
+import subprocess
+
+import analyze
+
+SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'analyze.py')
+
+BLADES = 2
+VOLT_LSB = 0.0293
+AMP_LSB = 0.0732
+
+
+def make_profile(levels, hold, tau):
+    """RPM steps between the levels, each held for the specified time, with a first order response"""
+    def rpm(t):
+        index = min(int(t / hold), len(levels) - 1)
+        if index == 0:
+            return levels[0]
+        since = t - index * hold
+        return levels[index] + (levels[index - 1] - levels[index]) * math.exp(-since / tau)
+    return rpm, hold * len(levels)
+
+
+def make_edges(rpm, duration, dt=20e-6):
+    """Blade detection times of the RPM profile"""
+    edges = []
+    position = 0.0
+    t = 0.0
+    while t < duration:
+        position += rpm(t) / 60.0 * BLADES * dt
+        t += dt
+        if position >= 1.0:
+            position -= 1.0
+            edges.append(t)
+    return edges
+
+
+def raw_current(rpm):
+    return int(rpm / 100)
+
+
+def make_batch_stream(rpm, edges, duration, frame_period=0.01, start_tick=0, lost=(), dropped=()):
+    """Frames by the frame period; the first edge of the frames listed in dropped is dropped by the firmware"""
+    stream = b''
+    index = 0
+    for n in range(int(round(duration / frame_period))):
+        t = (n + 1) * frame_period
+        batch = []
+        while index < len(edges) and edges[index] <= t:
+            batch.append(edges[index])
+            index += 1
+        num_dropped = 0
+        if n in dropped and batch:
+            batch = batch[1:]
+            num_dropped = 1
+        assert len(batch) <= analyze.BATCH_MAX_EDGES
+        ticks = [start_tick + int(e * analyze.BATCH_TIMER_FREQUENCY) for e in batch]
+        if n not in lost:
+            stream += analyze.encode_batch_frame(n, num_dropped, start_tick + int(t * analyze.BATCH_TIMER_FREQUENCY),
+                                                 512, raw_current(rpm(t)), ticks)
+    return stream
+
+
+def make_legacy_stream(rpm, edges):
+    stream = b''
+    for a, b in zip(edges, edges[1:]):
+        tach = int(round((b - a) * analyze.TACH_FREQUENCY))
+        stream += analyze.encode_frame(tach, 512, raw_current(rpm(b)))
+    return stream
+
+
+class TestLegacyDecoder(unittest.TestCase):
+    def test_round_trip(self):
+        data = analyze.encode_frame(1234, 500, 600) + analyze.encode_frame(0, 1023, 0)
+        frames, stats, consumed = analyze.decode_stream(data)
+        self.assertEqual(consumed, len(data))
+        self.assertEqual(stats.frames, 2)
+        self.assertEqual([(f.tach, f.voltage, f.current) for f in frames], [(1234, 500, 600), (0, 1023, 0)])
+
+    def test_resync(self):
+        good = analyze.encode_frame(1000, 1, 2)
+        corrupted = bytearray(analyze.encode_frame(2000, 3, 4))
+        corrupted[4] ^= 0x01
+        data = b'\x00\x55' + good + bytes(corrupted) + good + good[:5]
+        frames, stats, consumed = analyze.decode_stream(data)
+        self.assertEqual([f.tach for f in frames], [1000, 1000])
+        self.assertEqual(stats.checksum_errors, 1)
+        self.assertEqual(stats.bytes_skipped, 2 + len(corrupted))
+        self.assertEqual(consumed, len(data) - 5)       # The incomplete frame is left for the next chunk
+
+    def test_incremental(self):
+        data = b''.join(analyze.encode_frame(100 + i, i, i) for i in range(10))
+        stats = analyze.DecoderStats()
+        pending = b''
+        tachs = []
+        for i in range(0, len(data), 3):
+            pending += data[i:i + 3]
+            frames, _, consumed = analyze.decode_stream(pending, stats)
+            tachs += [f.tach for f in frames]
+            pending = pending[consumed:]
+        self.assertEqual(tachs, list(range(100, 110)))
+        self.assertEqual(stats.frames, 10)
+
+
+class TestBatchDecoder(unittest.TestCase):
+    def test_crc(self):
+        self.assertEqual(analyze.compute_crc(b'123456789'), 0x6F91)       # CRC-16/MCRF4XX check value
+
+    def test_round_trip(self):
+        data = analyze.encode_batch_frame(7, 1, 0xFFFFFFF0, 500, 600, [1, 2, 0xFFFFFFFF])
+        frames, stats, consumed = analyze.decode_batch_stream(data)
+        self.assertEqual(consumed, len(data))
+        self.assertEqual(stats.frames, 1)
+        self.assertEqual(stats.edges_dropped, 1)
+        f = frames[0]
+        self.assertEqual((f.sequence, f.dropped, f.timestamp, f.voltage, f.current, f.edges),
+                         (7, 1, 0xFFFFFFF0, 500, 600, [1, 2, 0xFFFFFFFF]))
+
+    def test_resync(self):
+        # The header byte inside of the payload of the valid frames must not confuse the decoder
+        payloads = [[analyze.BATCH_FRAME_HEADER], [], [analyze.BATCH_FRAME_HEADER] * 2, []]
+        frames = [analyze.encode_batch_frame(i, 0, i * 100, 0, 0, edges) for i, edges in enumerate(payloads)]
+        corrupted = bytearray(frames[1])
+        corrupted[-1] ^= 0x80
+        data = b'\xFB\x09' + frames[0] + bytes(corrupted) + frames[2] + frames[3][:-1]
+        decoded, stats, consumed = analyze.decode_batch_stream(data)
+        self.assertEqual([f.sequence for f in decoded], [0, 2])
+        self.assertEqual(stats.checksum_errors, 1)
+        self.assertEqual(stats.frames_lost, 1)
+        self.assertEqual(consumed, len(data) - len(frames[3]) + 1)
+
+    def test_sequence_wraparound(self):
+        data = b''.join(analyze.encode_batch_frame(s & 0xFF, 0, s, 0, 0, []) for s in range(250, 262))
+        data += analyze.encode_batch_frame(265 & 0xFF, 0, 265, 0, 0, [])
+        _, stats, _ = analyze.decode_batch_stream(data)
+        self.assertEqual(stats.frames, 13)
+        self.assertEqual(stats.frames_lost, 3)
+
+
+class TestBatchConversion(unittest.TestCase):
+    def convert(self, frames):
+        return analyze.convert_batch_frames(frames, BLADES, 1.0, 1.0, 0)
+
+    def test_timestamp_wraparound(self):
+        period = analyze.BATCH_TIMER_FREQUENCY // 100           # 100 Hz edges, i.e. 3000 RPM with 2 blades
+        start = 0x100000000 - 3 * period
+        edges = [(start + i * period) & 0xFFFFFFFF for i in range(8)]
+        frame = analyze.BatchFrame(0, 0, edges[-1], 1, 2, edges)
+        samples = [s for s in self.convert([frame]) if s.rpm > 0]
+        self.assertEqual(len(samples), 7)
+        for s in samples:
+            self.assertAlmostEqual(s.rpm, 3000.0, places=6)
+        self.assertAlmostEqual(samples[-1].time - samples[0].time, 0.06, places=9)
+
+    def test_interval_across_gap_discarded(self):
+        period = analyze.BATCH_TIMER_FREQUENCY // 100
+        frames = [analyze.BatchFrame(0, 0, 2 * period, 0, 0, [period, 2 * period]),
+                  analyze.BatchFrame(2, 0, 5 * period, 0, 0, [5 * period, 6 * period]),
+                  analyze.BatchFrame(3, 1, 8 * period, 0, 0, [8 * period, 9 * period])]
+        rpms = [round(s.rpm) for s in self.convert(frames)]
+        # The first edge after the lost frame and after the dropped edge starts a new interval
+        self.assertEqual(rpms, [3000, 3000, 3000])
+
+    def test_timeout(self):
+        period = analyze.BATCH_TIMER_FREQUENCY // 100
+        timeout = int(analyze.TACH_TIMEOUT * analyze.BATCH_TIMER_FREQUENCY)
+        frames = [analyze.BatchFrame(0, 0, period, 0, 0, [0, period]),
+                  analyze.BatchFrame(1, 0, period + timeout - 1, 0, 0, []),
+                  analyze.BatchFrame(2, 0, period + timeout + 1, 0, 0, [])]
+        self.assertEqual([round(s.rpm) for s in self.convert(frames)], [3000, 0])
+
+
+def make_grid(levels, hold, response, period=0.01):
+    """Resampled grid of a step sequence; response(since the step) is the normalized step response"""
+    grid = []
+    for i in range(int(hold * len(levels) / period)):
+        t = i * period
+        index = int(t / hold)
+        since = t - index * hold
+        level = levels[index] if index == 0 else \
+            levels[index - 1] + (levels[index] - levels[index - 1]) * response(since)
+        grid.append(analyze.Sample(t, level, 10.0, level / 1000.0))
+    return grid
+
+
+def compute_steps(grid, period=0.01):
+    plateaus = analyze.find_plateaus(grid, period, 0.3, 2.0, 50, 0.5)
+    return plateaus, analyze.compute_step_metrics(grid, plateaus, 300, 0.05)
+
+
+class TestStepMetrics(unittest.TestCase):
+    def test_first_order(self):
+        tau = 0.05
+        plateaus, steps = compute_steps(make_grid([2000, 5000, 3000], 2.0, lambda t: 1 - math.exp(-t / tau)))
+        self.assertEqual([round(p[2]) for p in plateaus], [2000, 5000, 3000])
+        self.assertEqual([(s['from_rpm'], s['to_rpm']) for s in steps], [(2000, 5000), (5000, 3000)])
+        for s in steps:
+            self.assertAlmostEqual(s['rise_time'], tau * math.log(9), delta=0.011)
+            self.assertEqual(s['overshoot_pct'], 0)
+            self.assertAlmostEqual(s['settling_time'], tau * (math.log(20) - math.log(1 / 0.9)), delta=0.02)
+
+    def test_overshoot(self):
+        # Underdamped second order response, zeta = 0.5, overshoot exp(-pi * zeta / sqrt(1 - zeta^2)) = 16.3%
+        zeta, wn = 0.5, 40.0
+        wd = wn * math.sqrt(1 - zeta ** 2)
+
+        def response(t):
+            return 1 - math.exp(-zeta * wn * t) * (math.cos(wd * t) + zeta / math.sqrt(1 - zeta ** 2) * math.sin(wd * t))
+
+        _, steps = compute_steps(make_grid([3000, 6000], 2.0, response, period=0.001), period=0.001)
+        self.assertEqual(len(steps), 1)
+        self.assertAlmostEqual(steps[0]['overshoot_pct'], 16.3, delta=0.3)
+        # The envelope exp(-zeta * wn * t) falls below the 5% band after ln(20 / sqrt(1 - zeta^2)) / (zeta * wn)
+        self.assertLess(steps[0]['settling_time'], math.log(20 / math.sqrt(1 - zeta ** 2)) / (zeta * wn))
+        self.assertGreater(steps[0]['settling_time'], 0.05)
+
+    def test_small_steps_ignored(self):
+        _, steps = compute_steps(make_grid([3000, 3200, 6000], 2.0, lambda t: 1 - math.exp(-t / 0.05)))
+        self.assertEqual([(s['from_rpm'], s['to_rpm']) for s in steps], [(3200, 6000)])
+
+
+def make_summary(power, rise, overshoot):
+    return {
+        'efficiency': [{'rpm_bin': 3000, 'power': power, 'grams_per_watt': 10.0 / power}],
+        'steps': [{'from_rpm': 3000, 'to_rpm': 6000, 'rise_time': rise, 'settling_time': 2 * rise,
+                   'overshoot_pct': overshoot}],
+    }
+
+
+class TestDiff(unittest.TestCase):
+    def test_no_change(self):
+        base = make_summary(100, 0.1, 5)
+        _, regressions = analyze.diff_summaries(base, base, 5.0, 200)
+        self.assertEqual(regressions, 0)
+
+    def test_improvement(self):
+        _, regressions = analyze.diff_summaries(make_summary(100, 0.1, 5), make_summary(90, 0.08, 0), 5.0, 200)
+        self.assertEqual(regressions, 0)
+
+    def test_regressions(self):
+        lines, regressions = analyze.diff_summaries(make_summary(100, 0.1, 5), make_summary(110, 0.2, 11), 5.0, 200)
+        # Power, g/W, rise, settling, overshoot
+        self.assertEqual(regressions, 5)
+        self.assertEqual(sum('REGRESSION' in x for x in lines), 5)
+
+    def test_step_matching(self):
+        new = make_summary(100, 0.1, 5)
+        new['steps'][0]['to_rpm'] = 6150
+        _, regressions = analyze.diff_summaries(make_summary(100, 0.1, 5), new, 5.0, 200)
+        self.assertEqual(regressions, 0)
+
+        new['steps'][0]['to_rpm'] = 6300
+        lines, regressions = analyze.diff_summaries(make_summary(100, 0.1, 5), new, 5.0, 200)
+        self.assertEqual(regressions, 0)
+        self.assertIn('  3000 -> 6000 RPM: no matching step', lines)
+
+
+class TestCommandLine(unittest.TestCase):
+    """Both formats of the same RPM profile must yield the same operating points and steps"""
+    LEVELS = [3000, 6000, 4000]
+    TAU = 0.05
+
+    @classmethod
+    def setUpClass(cls):
+        rpm, cls.duration = make_profile(cls.LEVELS, 2.0, cls.TAU)
+        cls.rpm = staticmethod(rpm)
+        cls.edges = make_edges(rpm, cls.duration)
+        cls.dir = tempfile.TemporaryDirectory()
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.dir.cleanup()
+
+    def path(self, name):
+        return os.path.join(self.dir.name, name)
+
+    def run_script(self, *args):
+        return subprocess.run([sys.executable, SCRIPT] + list(args), stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                              universal_newlines=True)
+
+    def run_analyze(self, name, data, *args):
+        with open(self.path(name + '.bin'), 'wb') as f:
+            f.write(data)
+        proc = self.run_script('analyze', self.path(name + '.bin'), '--blades', str(BLADES),
+                               '--volt-lsb', str(VOLT_LSB), '--amp-lsb', str(AMP_LSB),
+                               '--json', self.path(name + '.json'), *args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        with open(self.path(name + '.json')) as f:
+            return json.load(f)
+
+    def check_summary(self, summary):
+        self.assertEqual([round(p['rpm'], -2) for p in summary['efficiency']], sorted(self.LEVELS))
+        for p in summary['efficiency']:
+            self.assertAlmostEqual(p['voltage'], 512 * VOLT_LSB, places=3)
+            self.assertAlmostEqual(p['current'], raw_current(p['rpm']) * AMP_LSB, delta=AMP_LSB)
+        self.assertEqual([(round(s['from_rpm'], -2), round(s['to_rpm'], -2)) for s in summary['steps']],
+                         [(3000, 6000), (6000, 4000)])
+        for s in summary['steps']:
+            self.assertAlmostEqual(s['rise_time'], self.TAU * math.log(9), delta=0.02)
+
+    def test_batch(self):
+        # The timer overflows in the middle of the stream
+        start_tick = 0x100000000 - int(1.5 * analyze.BATCH_TIMER_FREQUENCY)
+        stream = make_batch_stream(self.rpm, self.edges, self.duration, start_tick=start_tick)
+        summary = self.run_analyze('batch', stream, '--format', 'batch')
+        self.assertEqual(summary['frames'], int(self.duration / 0.01))
+        self.assertEqual(summary['checksum_errors'], 0)
+        self.assertEqual(summary['frames_lost'], 0)
+        self.check_summary(summary)
+
+    def test_batch_with_losses(self):
+        stream = make_batch_stream(self.rpm, self.edges, self.duration, lost=(50, 150, 151, 400), dropped=(300,))
+        summary = self.run_analyze('batch_lossy', stream, '--format', 'batch')
+        self.assertEqual(summary['frames_lost'], 4)
+        self.assertEqual(summary['edges_dropped'], 1)
+        self.check_summary(summary)
+
+    def test_legacy(self):
+        summary = self.run_analyze('legacy', make_legacy_stream(self.rpm, self.edges))
+        self.assertEqual(summary['frames'], len(self.edges) - 1)
+        self.assertEqual(summary['frames_lost'], 0)
+        self.check_summary(summary)
+
+    def test_wrong_format(self):
+        with open(self.path('wrong.bin'), 'wb') as f:
+            f.write(make_legacy_stream(self.rpm, self.edges))
+        proc = self.run_script('analyze', self.path('wrong.bin'), '--format', 'batch')
+        self.assertEqual(proc.returncode, 1)
+        self.assertIn('No valid frames found', proc.stderr)
+
+    def test_diff(self):
+        self.run_analyze('base', make_batch_stream(self.rpm, self.edges, self.duration), '--format', 'batch')
+        proc = self.run_script('diff', self.path('base.json'), self.path('base.json'))
+        self.assertEqual(proc.returncode, 0, proc.stdout)
+        self.assertIn('Regressions: 0', proc.stdout)
+
+        rpm, duration = make_profile(self.LEVELS, 2.0, self.TAU * 2)
+        self.run_analyze('slow', make_batch_stream(rpm, make_edges(rpm, duration), duration), '--format', 'batch')
+        proc = self.run_script('diff', self.path('base.json'), self.path('slow.json'))
+        self.assertEqual(proc.returncode, 1, proc.stdout)
+        self.assertIn('REGRESSION', proc.stdout)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Verifies the data type signatures in bootloader/bootloader/include/uavcan_dsdl_defs.h.
+
+The bootloader does not carry the 64-bit UAVCAN v0 data type signatures; the signature column of the table holds
+the CRC-16-CCITT of the 64-bit signature in little endian byte order, which is the initial value of the transfer CRC.
+This script computes the 64-bit signatures from the normalized DSDL definitions the same way the DSDL compiler does,
+and compares their CRC-16 with the table. The exit code is non-zero on mismatch.
+"""
+
+import os
+import re
+import sys
+
+DEFS_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                         '..', '..', 'bootloader', 'bootloader', 'include', 'uavcan_dsdl_defs.h')
+
+
+def crc64we(data, crc=0xFFFFFFFFFFFFFFFF):
+    for b in data:
+        crc ^= b << 56
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x42F0E1EBA9EA3693) if crc & (1 << 63) else (crc << 1)
+            crc &= 0xFFFFFFFFFFFFFFFF
+    return crc
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def data_type_signature(normalized_definition, nested=()):
+    """
+    The signature of the normalized definition, extended with the signatures of the nested types in the order
+    of the fields, see the UAVCAN v0 specification.
+    """
+    crc = crc64we(normalized_definition.encode())
+    for nested_signature in nested:
+        value = crc ^ 0xFFFFFFFFFFFFFFFF
+        crc = crc64we(nested_signature.to_bytes(8, 'little'), crc)
+        crc = crc64we(value.to_bytes(8, 'little'), crc)
+    return crc ^ 0xFFFFFFFFFFFFFFFF
+
+
+def define(full_name, *fields, nested=()):
+    return data_type_signature('\n'.join((full_name,) + fields), nested)
+
+
+PATH = define('uavcan.protocol.file.Path', 'saturated uint8[<=200] path')
+ERROR = define('uavcan.protocol.file.Error', 'saturated int16 value')
+ENTRY_TYPE = define('uavcan.protocol.file.EntryType', 'saturated uint8 flags')
+LOG_LEVEL = define('uavcan.protocol.debug.LogLevel', 'saturated uint3 value')
+NODE_STATUS = define('uavcan.protocol.NodeStatus',
+                     'saturated uint32 uptime_sec',
+                     'saturated uint2 health',
+                     'saturated uint3 mode',
+                     'saturated uint3 sub_mode',
+                     'saturated uint16 vendor_specific_status_code')
+SOFTWARE_VERSION = define('uavcan.protocol.SoftwareVersion',
+                          'saturated uint8 major',
+                          'saturated uint8 minor',
+                          'saturated uint8 optional_field_flags',
+                          'saturated uint32 vcs_commit',
+                          'saturated uint64 image_crc')
+HARDWARE_VERSION = define('uavcan.protocol.HardwareVersion',
+                          'saturated uint8 major',
+                          'saturated uint8 minor',
+                          'saturated uint8[16] unique_id',
+                          'saturated uint8[<=255] certificate_of_authenticity')
+
+SIGNATURES = {
+    'Allocation': define('uavcan.protocol.dynamic_node_id.Allocation',
+                         'saturated uint7 node_id',
+                         'saturated bool first_part_of_unique_id',
+                         'saturated uint8[<=16] unique_id'),
+    'NodeStatus': NODE_STATUS,
+    'GetNodeInfo': define('uavcan.protocol.GetNodeInfo',
+                          '---',
+                          'uavcan.protocol.NodeStatus status',
+                          'uavcan.protocol.SoftwareVersion software_version',
+                          'uavcan.protocol.HardwareVersion hardware_version',
+                          'saturated uint8[<=80] name',
+                          nested=(NODE_STATUS, SOFTWARE_VERSION, HARDWARE_VERSION)),
+    'BeginFirmwareUpdate': define('uavcan.protocol.file.BeginFirmwareUpdate',
+                                  'saturated uint8 source_node_id',
+                                  'uavcan.protocol.file.Path image_file_remote_path',
+                                  '---',
+                                  'saturated uint8 error',
+                                  'saturated uint8[<=127] optional_error_message',
+                                  nested=(PATH,)),
+    'GetInfo': define('uavcan.protocol.file.GetInfo',
+                      'uavcan.protocol.file.Path path',
+                      '---',
+                      'saturated uint40 size',
+                      'uavcan.protocol.file.Error error',
+                      'uavcan.protocol.file.EntryType entry_type',
+                      nested=(PATH, ERROR, ENTRY_TYPE)),
+    'Read': define('uavcan.protocol.file.Read',
+                   'saturated uint40 offset',
+                   'uavcan.protocol.file.Path path',
+                   '---',
+                   'uavcan.protocol.file.Error error',
+                   'saturated uint8[<=256] data',
+                   nested=(PATH, ERROR)),
+    'LogMessage': define('uavcan.protocol.debug.LogMessage',
+                         'uavcan.protocol.debug.LogLevel level',
+                         'saturated uint8[<=31] source',
+                         'saturated uint8[<=90] text',
+                         nested=(LOG_LEVEL,)),
+    'KeyValue': define('uavcan.protocol.debug.KeyValue',
+                       'saturated float32 value',
+                       'saturated uint8[<=58] key'),
+}
+
+
+def main():
+    with open(DEFS_PATH) as f:
+        table = re.findall(r'^\s*UAVCAN_DSDL_(?:MESG|SREQ|SRSP)_DEF\((\w+),\s*\d+,\s*(0x[0-9a-fA-F]+)', f.read(), re.M)
+
+    ok = bool(table)
+    for name, value in table:
+        signature = SIGNATURES[name]
+        expected = crc16_ccitt(signature.to_bytes(8, 'little'))
+        match = int(value, 16) == expected
+        ok = ok and match
+        print('%-20s 0x%016x  0x%04x  %s' % (name, signature, expected, 'ok' if match else 'MISMATCH, table has ' + value))
+
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Measures the firmware download throughput of the bootloader against a simulated file server.
+ *
+ * The file read loop of the bootloader (file_read_and_program() with its adaptive request rate) is built from
+ * the unmodified bootloader sources; the sources are included into this file in order to reach the static
+ * functions. The CAN transport, the timers and the flash are replaced with a model that runs in virtual time:
+ * every file read request gets a response after the server latency, or times out if it is lost.
+ *
+ * Usage:
+ *   ./sim [key=value ...]
+ *
+ * Server model, all times are in milliseconds:
+ *   size=<bytes>       Image size, default 65536
+ *   latency=<ms>       Minimum response latency, default 5
+ *   jitter=<ms>        Mean of the exponentially distributed extra latency, default 2
+ *   loss=<p>           Probability that a request or its response is lost, default 0
+ *   error=<p>          Probability that the server responds with an error, default 0
+ *   busy_period=<ms>   The server is periodically busy serving other nodes, zero disables, default 0
+ *   busy_ms=<ms>       Duration of the busy phase within every busy_period, default 0
+ *   busy_latency=<ms>  Latency during the busy phase, default 400
+ *   bus_speed=<1..4>   CAN bit rate code, determines the initial request interval, default 4 (1 Mbit/s)
+ *   seed=<n>           Random seed, default 1
+ *
+ * The downloaded image is compared with the served file; the exit code is non-zero if they differ.
+ */
+
+// The entry point of the bootloader is not used; it is made static so that it is discarded with its dependencies
+#define main static __attribute__((unused)) bootloader_main
+#include "main.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#define MAX_TIMERS  8
+
+/*
+ * Virtual time and timers
+ */
+static time_ms_t _now;
+
+static struct
+{
+	bool allocated;
+	time_ms_t deadline;
+} _timers[MAX_TIMERS];
+
+const bl_timer_cb_t null_cb = { 0, 0 };
+
+bl_timer_id timer_allocate(bl_timer_modes_t mode, time_ms_t msfromnow, bl_timer_cb_t *fc)
+{
+	(void)mode;
+	(void)fc;
+	for (bl_timer_id i = 0; i < MAX_TIMERS; i++) {
+		if (!_timers[i].allocated) {
+			_timers[i].allocated = true;
+			_timers[i].deadline = _now + msfromnow;
+			return i;
+		}
+	}
+	abort();
+}
+
+void timer_free(bl_timer_id id) { _timers[id].allocated = false; }
+
+void timer_restart(bl_timer_id id, time_ms_t ms) { _timers[id].deadline = _now + ms; }
+
+int timer_expired(bl_timer_id id) { return _now >= _timers[id].deadline; }
+
+time_ms_t timer_tic(void) { return _now; }
+
+/// The bootloader sleeps until the next tick
+void timer_idle(void) { _now++; }
+
+/*
+ * File server
+ */
+static struct
+{
+	uint32_t size;
+	double latency;
+	double jitter;
+	double loss;
+	double error;
+	uint32_t busy_period;
+	uint32_t busy_ms;
+	double busy_latency;
+	unsigned bus_speed;
+	unsigned seed;
+} _cfg = { 65536, 5, 2, 0, 0, 0, 0, 400, 4, 1 };
+
+static uint8_t* _file;
+static uint32_t _requested_offset;
+static bool _request_pending;
+
+static struct
+{
+	unsigned requests;
+	unsigned lost;
+	unsigned errors;
+	time_ms_t first_request_at;
+	time_ms_t last_request_at;
+} _stats;
+
+static double uniform(void)
+{
+	return (rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static double server_latency_ms(void)
+{
+	const bool busy = (_cfg.busy_period > 0) && ((_now % _cfg.busy_period) < _cfg.busy_ms);
+	const double base = busy ? _cfg.busy_latency : _cfg.latency;
+	return base + ((_cfg.jitter > 0) ? -_cfg.jitter * log(uniform()) : 0.0);
+}
+
+uavcan_error_t uavcan_tx_dsdl(uavcan_dsdl_t dsdl, uavcan_protocol_t *protocol, const uint8_t *transfer, size_t length)
+{
+	(void)protocol;
+	(void)length;
+	if (dsdl == DSDLReqRead) {
+		const uavcan_Read_request_t* req = (const uavcan_Read_request_t*)transfer;
+		_requested_offset = req->offset;
+		_request_pending = true;
+		if (_stats.requests == 0) {
+			_stats.first_request_at = _now;
+		}
+		_stats.last_request_at = _now;
+		_stats.requests++;
+	}
+	return UavcanOk;
+}
+
+uavcan_error_t uavcan_rx_dsdl(uavcan_dsdl_t dsdl, uavcan_protocol_t *protocol, uint8_t *transfer,
+			      size_t *length, uint32_t timeout_ms)
+{
+	(void)protocol;
+	if ((dsdl != DSDLRspRead) || !_request_pending) {
+		_now += timeout_ms;
+		return UavcanBootTimeout;
+	}
+	_request_pending = false;
+
+	const double latency = server_latency_ms();
+	if ((uniform() < _cfg.loss) || (latency >= timeout_ms)) {
+		_stats.lost++;
+		_now += timeout_ms;
+		return UavcanBootTimeout;
+	}
+	_now += (time_ms_t)ceil(latency);
+
+	uavcan_Read_response_t* rsp = (uavcan_Read_response_t*)transfer;
+	memset(rsp, 0, sizeof(*rsp));
+
+	if (uniform() < _cfg.error) {
+		_stats.errors++;
+		rsp->error.value = FILE_ERROR_IO_ERROR;
+		*length = sizeof(rsp->error);
+		return UavcanOk;
+	}
+
+	const uint32_t n = (_requested_offset < _cfg.size) ?
+		((_cfg.size - _requested_offset < sizeof(rsp->data)) ? _cfg.size - _requested_offset : sizeof(rsp->data)) : 0;
+	memcpy(rsp->data, &_file[_requested_offset], n);
+	*length = sizeof(rsp->error) + n;
+	return UavcanOk;
+}
+
+/*
+ * Flash and the rest of the platform
+ */
+flash_error_t bl_flash_write(uint32_t flash_address, uint8_t *data, ssize_t count)
+{
+	memcpy((void*)(uintptr_t)flash_address, data, count);
+	return FLASH_OK;
+}
+
+void stm32_gpiowrite(uint32_t pinset, bool value) { (void)pinset; (void)value; }
+
+void uavcan_tx_log_message(uavcan_LogMessageConsts_t level, uint8_t stage, uint8_t status)
+{
+	(void)level;
+	(void)stage;
+	(void)status;
+}
+
+void uavcan_tx_key_value(const char *key, uint32_t value)
+{
+	(void)key;
+	(void)value;
+}
+
+uint8_t g_server_node_id = 1;
+
+static bool parse_arg(const char* arg)
+{
+	char key[32];
+	double value = 0;
+	if (sscanf(arg, "%31[^=]=%lf", key, &value) != 2) {
+		return false;
+	}
+	if      (strcmp(key, "size") == 0)         { _cfg.size = value; }
+	else if (strcmp(key, "latency") == 0)      { _cfg.latency = value; }
+	else if (strcmp(key, "jitter") == 0)       { _cfg.jitter = value; }
+	else if (strcmp(key, "loss") == 0)         { _cfg.loss = value; }
+	else if (strcmp(key, "error") == 0)        { _cfg.error = value; }
+	else if (strcmp(key, "busy_period") == 0)  { _cfg.busy_period = value; }
+	else if (strcmp(key, "busy_ms") == 0)      { _cfg.busy_ms = value; }
+	else if (strcmp(key, "busy_latency") == 0) { _cfg.busy_latency = value; }
+	else if (strcmp(key, "bus_speed") == 0)    { _cfg.bus_speed = value; }
+	else if (strcmp(key, "seed") == 0)         { _cfg.seed = value; }
+	else { return false; }
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		if (!parse_arg(argv[i])) {
+			fprintf(stderr, "Invalid argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	srand(_cfg.seed);
+
+	_file = malloc(_cfg.size + 1);
+	for (uint32_t i = 0; i < _cfg.size; i++) {
+		_file[i] = rand();
+	}
+
+	// The bootloader keeps flash addresses in 32 bits, so the simulated flash is mapped where the real one is
+	uint8_t* flash = mmap((void*)APPLICATION_LOAD_ADDRESS, APPLICATION_SIZE + FLASH_PAGE_SIZE,
+			      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (flash != (uint8_t*)APPLICATION_LOAD_ADDRESS) {
+		perror("mmap");
+		return 1;
+	}
+	memset(flash, 0xFF, APPLICATION_SIZE);
+
+	bootloader.fw_image = (volatile uint32_t*)flash;
+	bootloader.bus_speed = _cfg.bus_speed;
+
+	uavcan_Path_t path;
+	memset(&path, 0, sizeof(path));
+	memcpy(path.u8, "fw.bin", 6);
+
+	fw_update_stats.started_at = _now;
+	const flash_error_t status = file_read_and_program(&path, 6, _cfg.size);
+
+	// The first word is programmed last by the bootloader after the image is validated
+	memcpy(flash, (const void*)&bootloader.fw_word0.l, sizeof(uint32_t));
+	const bool match = (status == FLASH_OK) && (memcmp(flash, _file, _cfg.size) == 0);
+
+	const double seconds = _now / 1000.0;
+	printf("result=%s bytes=%u time_s=%.3f throughput_Bps=%.0f requests=%u lost=%u errors=%u retries=%u "
+	       "mean_interval_ms=%.1f wait_ms=%u limit_ms=%u\n",
+	       match ? "ok" : "FAIL", (unsigned)fw_update_stats.bytes_written, seconds,
+	       (seconds > 0) ? fw_update_stats.bytes_written / seconds : 0.0,
+	       _stats.requests, _stats.lost, _stats.errors, (unsigned)fw_update_stats.retries,
+	       (_stats.requests > 1) ?
+	       (double)(_stats.last_request_at - _stats.first_request_at) / (_stats.requests - 1) : 0.0,
+	       (unsigned)fw_update_stats.wait_ms, (unsigned)fw_update_stats.limit_ms);
+
+	return match ? 0 : 1;
+}
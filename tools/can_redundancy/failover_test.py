@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Failover test of the redundant CAN interfaces of the UAVCAN node, on the virtual CAN buses of python-can.
+
+A simulated flight controller broadcasts uavcan.equipment.esc.RawCommand via two virtual buses, like a redundant
+CAN setup does; one of the buses is cut for a while during the test. The node side receives from both buses:
+  - The transfers are deduplicated by a model of the TransferReceiver of libuavcan, which accepts a transfer from
+    another interface only if nothing was accepted from the current one for one transfer interval (libuavcan is
+    not a part of this repository, so its interface switching rule is reproduced here for single frame transfers).
+  - The RX frame counters of both interfaces are fed to RedundancyMonitor of the firmware, built by the Makefile
+    into libmonitor.so.
+
+For every scenario, the following is measured:
+  - Setpoints lost, i.e. transfers that were delivered via a working bus but not accepted, and setpoints that
+    were accepted twice.
+  - The longest interval between the accepted setpoints, which must stay well below cmd_ttl_ms.
+  - The setpoint latency, i.e. the time from transmission to acceptance; on the host it only reflects the
+    scheduling of this script, but it shows that the setpoints are not delayed by the failover.
+  - The time the monitor needs to report the fault and the recovery.
+The exit code is non-zero if any scenario fails.
+
+Examples:
+  make check
+  ./failover_test.py --rate 100
+"""
+
+import os
+import sys
+import time
+import ctypes
+import random
+import struct
+import argparse
+
+import can
+
+NUM_IFACES = 2
+RAW_COMMAND_DTID = 1030
+SOURCE_NODE_ID = 10
+CMD_TTL_MS = 200                    # Default of cmd_ttl_ms, see esc_controller.cpp
+MONITOR_CHECK_INTERVAL = 1.0        # RedundancyMonitor::CheckIntervalUSec
+MAX_LOSS_PER_FAILOVER = 1
+
+# Name, phases: (duration in seconds, connected buses, traffic)
+SCENARIOS = [
+    ('bus0_fault', [(1.0, (True, True), True), (2.5, (False, True), True), (2.5, (True, True), True)]),
+    ('bus1_fault', [(1.0, (True, True), True), (2.5, (True, False), True), (2.5, (True, True), True)]),
+    ('silence', [(1.0, (True, True), True), (2.5, (True, True), False), (1.0, (True, True), True)]),
+]
+
+TRANSFER_ID_MODULO = 32
+
+
+class TransferReceiver:
+    """
+    Single frame transfers only. A frame restarts the reception if the receiver is not initialized, if the transfer
+    ID timed out, if it is a new transfer via the current interface, or if the interface switch delay (one transfer
+    interval) has expired and the transfer ID is not older than expected; otherwise the frame is accepted only if
+    it comes via the current interface with the expected transfer ID. Duplicates via the other interface carry the
+    transfer ID that was already accepted and get rejected.
+    """
+    DEFAULT_INTERVAL = 1.0
+    MIN_INTERVAL = 1e-3
+    MAX_INTERVAL = 10.0
+
+    def __init__(self):
+        self.iface = None
+        self.tid = None                 # Expected transfer ID
+        self.this_transfer_ts = None
+        self.prev_transfer_ts = None
+        self.interval = self.DEFAULT_INTERVAL
+
+    def add_frame(self, ts, iface, tid):
+        since_last = (ts - self.this_transfer_ts) if self.this_transfer_ts is not None else 0
+        not_initialized = self.tid is None
+        tid_timed_out = not not_initialized and since_last > self.interval * 2
+        same_iface = iface == self.iface
+        non_wrapped_tid = not not_initialized and (tid - self.tid) % TRANSFER_ID_MODULO < TRANSFER_ID_MODULO // 2
+        not_previous_tid = not not_initialized and (self.tid - tid) % TRANSFER_ID_MODULO > 1
+        iface_switch_allowed = since_last > self.interval
+
+        if not_initialized or tid_timed_out or (same_iface and not_previous_tid) or \
+                (iface_switch_allowed and non_wrapped_tid):
+            self.iface = iface
+            self.tid = tid
+
+        if iface != self.iface or tid != self.tid:
+            return False
+
+        self.prev_transfer_ts, self.this_transfer_ts = self.this_transfer_ts, ts
+        if self.prev_transfer_ts is not None:
+            interval = min(max(ts - self.prev_transfer_ts, self.MIN_INTERVAL), self.MAX_INTERVAL)
+            self.interval = (self.interval * 7 + interval) / 8
+        self.tid = (tid + 1) % TRANSFER_ID_MODULO
+        return True
+
+
+class Monitor:
+    def __init__(self, path):
+        self.lib = ctypes.CDLL(path)
+        self.lib.monitor_update.argtypes = [ctypes.c_uint64, ctypes.c_uint, ctypes.POINTER(ctypes.c_uint64)]
+        self.lib.monitor_update.restype = ctypes.c_uint
+        self.lib.monitor_is_iface_faulted.argtypes = [ctypes.c_uint]
+
+    def reset(self):
+        self.lib.monitor_reset()
+
+    def update(self, ts, frames_rx):
+        counters = (ctypes.c_uint64 * len(frames_rx))(*frames_rx)
+        return self.lib.monitor_update(int(ts * 1e6), len(frames_rx), counters)
+
+    def is_iface_faulted(self, index):
+        return bool(self.lib.monitor_is_iface_faulted(index))
+
+
+def make_raw_command_frame(seq, transfer_id):
+    # The sequence number takes the place of the command values, which are irrelevant here
+    can_id = (RAW_COMMAND_DTID << 8) | SOURCE_NODE_ID
+    tail = 0x80 | 0x40 | (transfer_id % TRANSFER_ID_MODULO)        # Start and end of transfer, no toggle
+    return can.Message(arbitration_id=can_id, is_extended_id=True, data=struct.pack('<I3xB', seq, tail))
+
+
+def parse_raw_command_frame(msg):
+    if msg.arbitration_id != (RAW_COMMAND_DTID << 8) | SOURCE_NODE_ID:
+        return None
+    seq, tail = struct.unpack('<I3xB', bytes(msg.data))
+    return seq, tail & 0x1F
+
+
+def run_scenario(monitor, phases, rate):
+    tx = [can.Bus(interface='virtual', channel='can%d' % i) for i in range(NUM_IFACES)]
+    rx = [can.Bus(interface='virtual', channel='can%d' % i) for i in range(NUM_IFACES)]
+    receiver = TransferReceiver()
+    monitor.reset()
+
+    frames_rx = [0] * NUM_IFACES
+    delivered = set()           # Sequence numbers delivered via at least one bus
+    accepted = set()
+    num_duplicates = 0          # Transfers accepted more than once
+    latencies = []
+    max_gap = 0
+    events = []                 # (time since the start of the phase, phase index, iface, faulted)
+
+    seq = 0
+    try:
+        for phase_index, (duration, connected, traffic) in enumerate(phases):
+            phase_started = time.monotonic()
+            last_accepted_at = None
+            next_tx = phase_started
+            while time.monotonic() < phase_started + duration:
+                if traffic and time.monotonic() >= next_tx:
+                    frame = make_raw_command_frame(seq, seq)
+                    for i in random.sample(range(NUM_IFACES), NUM_IFACES):
+                        if connected[i]:
+                            tx[i].send(frame)
+                    seq += 1
+                    next_tx += 1.0 / rate
+
+                received = []
+                for i, bus in enumerate(rx):
+                    msg = bus.recv(timeout=0)
+                    while msg is not None:
+                        frames_rx[i] += 1
+                        received.append((msg.timestamp, i, msg))
+                        msg = bus.recv(timeout=0)
+
+                for ts, iface, msg in sorted(received, key=lambda x: (x[0], x[1])):
+                    frame_seq, tid = parse_raw_command_frame(msg)
+                    delivered.add(frame_seq)
+                    if receiver.add_frame(ts, iface, tid):
+                        num_duplicates += 1 if frame_seq in accepted else 0
+                        accepted.add(frame_seq)
+                        now = time.time()
+                        latencies.append(now - ts)
+                        if last_accepted_at is not None:
+                            max_gap = max(max_gap, now - last_accepted_at)
+                        last_accepted_at = now
+
+                changed_mask = monitor.update(time.monotonic(), frames_rx)
+                for i in range(NUM_IFACES):
+                    if changed_mask & (1 << i):
+                        events.append((time.monotonic() - phase_started, phase_index, i,
+                                       monitor.is_iface_faulted(i)))
+
+                time.sleep(max(0, min(next_tx - time.monotonic(), 1e-3)))
+    finally:
+        for bus in tx + rx:
+            bus.shutdown()
+
+    return {
+        'sent': seq,
+        'lost': len(delivered - accepted),
+        'duplicates': num_duplicates,
+        'max_gap': max_gap,
+        'latency_mean': sum(latencies) / len(latencies),
+        'latency_max': max(latencies),
+        'events': events,
+    }
+
+
+def check_scenario(phases, result):
+    errors = []
+    num_failovers = sum(1 for _, connected, _ in phases if not all(connected))
+    if result['lost'] > MAX_LOSS_PER_FAILOVER * num_failovers:
+        errors.append('%d setpoints lost' % result['lost'])
+    if result['duplicates'] > 0:
+        errors.append('%d setpoints accepted twice' % result['duplicates'])
+    if result['max_gap'] * 1e3 >= CMD_TTL_MS / 2:
+        errors.append('setpoint interval %.1f ms is too close to cmd_ttl_ms' % (result['max_gap'] * 1e3))
+
+    # Every bus that is cut for longer than two check intervals must be reported, then reported as recovered
+    # within two check intervals after it is connected back; nothing else may be reported
+    expected = []
+    for phase_index, (duration, connected, _) in enumerate(phases):
+        for i in range(NUM_IFACES):
+            was_connected = phases[phase_index - 1][1][i] if phase_index > 0 else True
+            if was_connected != connected[i]:
+                expected.append((phase_index, i, not connected[i]))
+    reported = [(phase_index, iface, faulted) for _, phase_index, iface, faulted in result['events']]
+    if reported != expected:
+        errors.append('monitor reported %s, expected %s' % (reported, expected))
+    late = [e for e in result['events'] if e[0] > MONITOR_CHECK_INTERVAL * 2.1]
+    if late:
+        errors.append('monitor reported too late: %s' % late)
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('prefix', nargs='?', default='', help='run only the scenarios whose names start with this')
+    parser.add_argument('--rate', type=float, default=400, help='setpoint rate, Hz')
+    parser.add_argument('--seed', type=int, default=1, help='random seed of the transmission order')
+    args = parser.parse_args()
+
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'libmonitor.so')
+    if not os.path.isfile(path):
+        print('The monitor is not built, run make first', file=sys.stderr)
+        return 1
+    monitor = Monitor(path)
+    random.seed(args.seed)
+
+    scenarios = [s for s in SCENARIOS if s[0].startswith(args.prefix)]
+    num_failed = 0
+    for name, phases in scenarios:
+        result = run_scenario(monitor, phases, args.rate)
+        errors = check_scenario(phases, result)
+        num_failed += 1 if errors else 0
+        print('%-12s %-4s sent=%d lost=%d dup=%d max_interval=%.1fms latency_mean=%.2fms latency_max=%.2fms' %
+              (name, 'FAIL' if errors else 'OK', result['sent'], result['lost'], result['duplicates'], result['max_gap'] * 1e3,
+               result['latency_mean'] * 1e3, result['latency_max'] * 1e3))
+        for t, phase_index, iface, faulted in result['events']:
+            print('    phase %d: iface %d %s after %.2f s' % (phase_index, iface, 'FAULTED' if faulted else 'recovered',
+                                                            t))
+        for e in errors:
+            print('    ' + e)
+
+    print('%d of %d scenarios failed' % (num_failed, len(scenarios)))
+    return 1 if num_failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * C interface of the redundant interface monitor of the UAVCAN node, for failover_test.py.
+ */
+
+#include <redundancy_monitor.hpp>
+
+static uavcan_node::RedundancyMonitor _monitor;
+
+extern "C"
+{
+
+void monitor_reset(void)
+{
+	_monitor = uavcan_node::RedundancyMonitor();
+}
+
+unsigned monitor_update(std::uint64_t ts_usec, unsigned num_ifaces, const std::uint64_t* frames_rx)
+{
+	return _monitor.update(ts_usec, num_ifaces, frames_rx);
+}
+
+int monitor_is_iface_faulted(unsigned index)
+{
+	return _monitor.isIfaceFaulted(index);
+}
+
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Board interface of the firmware (src/board/board.hpp), for the host build.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace board
+{
+
+typedef std::array<std::uint8_t, 12> UniqueID;
+
+inline UniqueID read_unique_id()
+{
+	UniqueID uid;
+	for (unsigned i = 0; i < uid.size(); i++) {
+		uid[i] = std::uint8_t(i + 1);
+	}
+	return uid;
+}
+
+struct HardwareVersion
+{
+	std::uint8_t major;
+	std::uint8_t minor;
+};
+
+inline HardwareVersion detect_hardware_version() { return HardwareVersion{1, 0}; }
+
+typedef std::array<std::uint8_t, 128> DeviceSignature;
+
+inline bool try_read_device_signature(DeviceSignature& out_sign)
+{
+	(void)out_sign;
+	return false;
+}
+
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Subset of the C++ wrapper of ChibiOS that is used by the node, for the host build. Threads are never started.
+ */
+
+#pragma once
+
+#include <cassert>
+
+#define HIGHPRIO        255
+
+namespace chibios_rt
+{
+
+class BaseThread
+{
+public:
+	virtual ~BaseThread() { }
+	virtual void main() = 0;
+
+	void* start(int priority)
+	{
+		(void)priority;
+		return nullptr;
+	}
+
+	static void setName(const char* name) { (void)name; }
+};
+
+template <unsigned WorkingAreaSize>
+class BaseStaticThread : public BaseThread
+{
+};
+
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Subset of the driver interface of libuavcan that is used by the Cyphal transport, for the host build.
+ * The declarations follow libuavcan; the time types are reduced to what the transport needs.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace uavcan
+{
+
+enum { MaxCanIfaces = 3 };
+
+class MonotonicDuration
+{
+	std::int64_t usec_ = 0;
+
+public:
+	static MonotonicDuration fromUSec(std::int64_t usec) { MonotonicDuration d; d.usec_ = usec; return d; }
+	static MonotonicDuration fromMSec(std::int64_t msec) { return fromUSec(msec * 1000); }
+	std::int64_t toUSec() const { return usec_; }
+	std::int64_t toMSec() const { return usec_ / 1000; }
+};
+
+class MonotonicTime
+{
+	std::uint64_t usec_ = 0;
+
+public:
+	static MonotonicTime fromUSec(std::uint64_t usec) { MonotonicTime t; t.usec_ = usec; return t; }
+	static MonotonicTime fromMSec(std::uint64_t msec) { return fromUSec(msec * 1000); }
+	std::uint64_t toUSec() const { return usec_; }
+	std::uint64_t toMSec() const { return usec_ / 1000; }
+	bool isZero() const { return usec_ == 0; }
+
+	MonotonicDuration operator-(const MonotonicTime& r) const
+	{
+		return MonotonicDuration::fromUSec(std::int64_t(usec_ - r.usec_));
+	}
+	MonotonicTime operator+(const MonotonicDuration& r) const { return fromUSec(usec_ + r.toUSec()); }
+	MonotonicTime& operator+=(const MonotonicDuration& r) { usec_ += r.toUSec(); return *this; }
+
+	bool operator<(const MonotonicTime& r) const { return usec_ < r.usec_; }
+	bool operator>(const MonotonicTime& r) const { return usec_ > r.usec_; }
+	bool operator<=(const MonotonicTime& r) const { return usec_ <= r.usec_; }
+	bool operator>=(const MonotonicTime& r) const { return usec_ >= r.usec_; }
+	bool operator==(const MonotonicTime& r) const { return usec_ == r.usec_; }
+};
+
+class UtcTime
+{
+	std::uint64_t usec_ = 0;
+
+public:
+	static UtcTime fromUSec(std::uint64_t usec) { UtcTime t; t.usec_ = usec; return t; }
+	std::uint64_t toUSec() const { return usec_; }
+};
+
+struct CanFrame
+{
+	static const std::uint32_t MaskStdID = 0x000007FFU;
+	static const std::uint32_t MaskExtID = 0x1FFFFFFFU;
+	static const std::uint32_t FlagEFF = 1U << 31;
+	static const std::uint32_t FlagRTR = 1U << 30;
+	static const std::uint32_t FlagERR = 1U << 29;
+
+	static const std::uint8_t MaxDataLen = 8;
+
+	std::uint32_t id = 0;
+	std::uint8_t data[MaxDataLen] = {};
+	std::uint8_t dlc = 0;
+
+	bool isExtended() const { return (id & FlagEFF) != 0; }
+	bool isRemoteTransmissionRequest() const { return (id & FlagRTR) != 0; }
+	bool isErrorFrame() const { return (id & FlagERR) != 0; }
+};
+
+typedef std::uint16_t CanIOFlags;
+
+struct CanSelectMasks
+{
+	std::uint8_t read = 0;
+	std::uint8_t write = 0;
+};
+
+class ICanIface
+{
+public:
+	virtual ~ICanIface() { }
+	virtual std::int16_t send(const CanFrame& frame, MonotonicTime tx_deadline, CanIOFlags flags) = 0;
+	virtual std::int16_t receive(CanFrame& out_frame, MonotonicTime& out_ts_monotonic, UtcTime& out_ts_utc,
+	                             CanIOFlags& out_flags) = 0;
+	virtual std::uint64_t getErrorCount() const = 0;
+};
+
+class ICanDriver
+{
+public:
+	virtual ~ICanDriver() { }
+	virtual ICanIface* getIface(std::uint8_t iface_index) = 0;
+	virtual std::uint8_t getNumIfaces() const = 0;
+	virtual std::int16_t select(CanSelectMasks& inout_masks, const CanFrame* (& pending_tx)[MaxCanIfaces],
+	                            MonotonicTime blocking_deadline) = 0;
+};
+
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Subset of the clock interface of libuavcan that is used by the Cyphal transport, for the host build.
+ */
+
+#pragma once
+
+#include <uavcan/driver/can.hpp>
+
+namespace uavcan
+{
+
+class ISystemClock
+{
+public:
+	virtual ~ISystemClock() { }
+	virtual MonotonicTime getMonotonic() const = 0;
+	virtual UtcTime getUtc() const = 0;
+};
+
+}
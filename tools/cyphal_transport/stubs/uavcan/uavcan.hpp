@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Subset of libuavcan that is used by the interfaces of the bootloader and the node, for the host build.
+ */
+
+#pragma once
+
+#include <uavcan/driver/system_clock.hpp>
+
+namespace uavcan
+{
+
+class NodeID
+{
+	std::uint8_t value_ = 0;
+
+public:
+	NodeID() { }
+	NodeID(std::uint8_t value) : value_(value) { }
+
+	std::uint8_t get() const { return value_; }
+	bool isUnicast() const { return (value_ > 0) && (value_ <= 127); }
+};
+
+namespace protocol
+{
+
+struct SoftwareVersion
+{
+	std::uint8_t major = 0;
+	std::uint8_t minor = 0;
+	std::uint8_t optional_field_flags = 0;
+	std::uint32_t vcs_commit = 0;
+	std::uint64_t image_crc = 0;
+};
+
+}
+
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * CAN driver of the STM32 platform, for the host build. It has no interfaces; the tests connect the node to
+ * the virtual bus instead.
+ */
+
+#pragma once
+
+#include <uavcan_stm32/uavcan_stm32.hpp>
+
+namespace uavcan_stm32
+{
+
+static const std::int16_t ErrBitRateNotDetected = 1005;
+
+class CanIface : public uavcan::ICanIface
+{
+public:
+	std::uint32_t getRxQueueOverflowCount() const { return 0; }
+};
+
+class CanDriver : public uavcan::ICanDriver
+{
+public:
+	CanIface* getIface(std::uint8_t iface_index) override
+	{
+		(void)iface_index;
+		return nullptr;
+	}
+
+	std::uint8_t getNumIfaces() const override { return 0; }
+
+	std::int16_t select(uavcan::CanSelectMasks& inout_masks,
+	                    const uavcan::CanFrame* (& pending_tx)[uavcan::MaxCanIfaces],
+	                    uavcan::MonotonicTime blocking_deadline) override
+	{
+		(void)pending_tx;
+		(void)blocking_deadline;
+		inout_masks = uavcan::CanSelectMasks();
+		return 0;
+	}
+};
+
+template <unsigned RxQueueCapacity>
+class CanInitHelper
+{
+public:
+	CanDriver driver;
+
+	template <typename DelayCallable>
+	int init(DelayCallable delay_callable, std::uint32_t& inout_bitrate)
+	{
+		(void)delay_callable;
+		(void)inout_bitrate;
+		return -1;
+	}
+
+	static uavcan::MonotonicDuration getRecommendedListeningDelay() { return uavcan::MonotonicDuration::fromMSec(1); }
+};
+
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Subset of the STM32 platform driver of libuavcan that is used by the node, for the host build.
+ * The clock is defined by the test.
+ */
+
+#pragma once
+
+#include <uavcan/uavcan.hpp>
+
+namespace uavcan_stm32
+{
+namespace clock
+{
+
+uavcan::MonotonicTime getMonotonic();
+
+}
+
+class SystemClock
+{
+public:
+	static uavcan::ISystemClock& instance();
+};
+
+}
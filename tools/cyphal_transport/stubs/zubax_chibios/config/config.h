@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Configuration parameters of zubax_chibios, for the host build. The parameters are kept in RAM;
+ * saving and erasing always succeed.
+ */
+
+#pragma once
+
+#include <cstring>
+
+typedef enum
+{
+	CONFIG_TYPE_FLOAT,
+	CONFIG_TYPE_INT,
+	CONFIG_TYPE_BOOL
+} ConfigDataType;
+
+typedef struct
+{
+	const char* name;
+	ConfigDataType type;
+	float default_;
+	float min;
+	float max;
+} ConfigParam;
+
+namespace config_stub
+{
+
+static const int MaxParams = 64;
+
+struct Table
+{
+	ConfigParam descr[MaxParams];
+	float value[MaxParams];
+	int size;
+};
+
+inline Table& table()
+{
+	static Table t;
+	return t;
+}
+
+inline int find(const char* name)
+{
+	for (int i = 0; i < table().size; i++) {
+		if (std::strcmp(table().descr[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+inline void add(const char* name, ConfigDataType type, float default_, float min, float max)
+{
+	if (table().size < MaxParams) {
+		const ConfigParam descr = { name, type, default_, min, max };
+		table().descr[table().size] = descr;
+		table().value[table().size] = default_;
+		table().size++;
+	}
+}
+
+}
+
+inline int configSet(const char* name, float value)
+{
+	const int index = config_stub::find(name);
+	if (index < 0) {
+		return -1;
+	}
+	const ConfigParam& descr = config_stub::table().descr[index];
+	if ((value < descr.min) || (value > descr.max)) {
+		return -1;
+	}
+	config_stub::table().value[index] = value;
+	return 0;
+}
+
+inline float configGet(const char* name)
+{
+	const int index = config_stub::find(name);
+	return (index < 0) ? 0.0F : config_stub::table().value[index];
+}
+
+inline int configGetDescr(const char* name, ConfigParam* out)
+{
+	const int index = config_stub::find(name);
+	if (index < 0) {
+		return -1;
+	}
+	*out = config_stub::table().descr[index];
+	return 0;
+}
+
+inline const char* configNameByIndex(int index)
+{
+	return ((index >= 0) && (index < config_stub::table().size)) ? config_stub::table().descr[index].name : nullptr;
+}
+
+inline int configSave() { return 0; }
+inline int configErase() { return 0; }
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Subset of zubax_chibios that is used by the node, for the host build.
+ * The log goes to stdout; a reboot request is only recorded.
+ */
+
+#pragma once
+
+#include <zubax_chibios/config/config.h>
+#include <cstdarg>
+#include <cstdio>
+
+namespace os
+{
+
+inline bool& reboot_requested()
+{
+	static bool x = false;
+	return x;
+}
+
+inline void requestReboot() { reboot_requested() = true; }
+inline bool isRebootRequested() { return reboot_requested(); }
+
+inline void lowsyslog(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	std::vfprintf(stdout, format, args);
+	va_end(args);
+}
+
+namespace watchdog
+{
+
+class Timer
+{
+public:
+	void startMSec(unsigned timeout_ms) { (void)timeout_ms; }
+	void reset() { }
+};
+
+}
+
+namespace config
+{
+
+template <typename T>
+class Param
+{
+	const char* const name_;
+
+public:
+	Param(const char* name, T default_, T min, T max)
+		: name_(name)
+	{
+		config_stub::add(name, CONFIG_TYPE_INT, float(default_), float(min), float(max));
+	}
+
+	T get() const { return T(configGet(name_)); }
+};
+
+}
+
+}
@@ -0,0 +1,429 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Tests of the Cyphal/CAN node of the firmware on a virtual redundant CAN bus.
+ *
+ * cyphal_node.cpp is built unmodified against the stubs of ChibiOS, zubax_chibios, the board and the CAN driver
+ * in stubs/. It is included into this file, so that the tests can instantiate its node class directly and connect
+ * it to the virtual bus of virtual_bus.hpp instead of the CAN driver. The motor interface (motor.h) is implemented
+ * here and records the commands of the node. The other endpoint of the bus plays the flight controller: it publishes
+ * the readiness and the setpoints and receives the feedback.
+ *
+ * The tests cover the setpoint and readiness handling, the ESC index, the feedback, the readiness timeout,
+ * the emergency stop command, and the failover of the setpoint stream to the other interface, which is checked
+ * at the motor interface at 400 Hz like in test_transport.cpp. Finally the static RAM footprint of the node and
+ * its host CPU time from the start of the spin to the call of motor_set_duty_cycle() are printed; the latter is
+ * the node's share of the RX-to-PWM latency, it is only indicative of the cost on the target.
+ *
+ * Usage:
+ *   ./test_node
+ * The exit code is non-zero if any check fails.
+ */
+
+#include "virtual_bus.hpp"
+#include <cyphal_node.cpp>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+
+constexpr std::uint8_t FlightControllerNodeID = 10;
+constexpr std::uint8_t ESCNodeID = 20;
+constexpr unsigned ESCIndex = 1;
+constexpr std::uint16_t ReadinessSubjectID = 101;
+constexpr std::uint16_t FeedbackSubjectID = 102;
+constexpr std::uint16_t ExecuteCommandServiceID = 435;
+
+/*
+ * Motor interface
+ */
+struct MotorStub
+{
+	float duty_cycle = 0.0F;
+	int ttl_ms = 0;
+	unsigned num_setpoints = 0;
+	unsigned num_stops = 0;
+	std::vector<std::uint64_t> setpoint_ts;         ///< Virtual time of every setpoint, microseconds
+	std::vector<float> setpoints;
+	std::chrono::steady_clock::time_point last_setpoint_host_ts;
+} _motor;
+
+}
+
+extern "C"
+{
+
+void motor_set_duty_cycle(float dc, int ttl_ms)
+{
+	_motor.last_setpoint_host_ts = std::chrono::steady_clock::now();
+	_motor.duty_cycle = dc;
+	_motor.ttl_ms = ttl_ms;
+	_motor.num_setpoints++;
+	_motor.setpoint_ts.push_back(_clock.getMonotonic().toUSec());
+	_motor.setpoints.push_back(dc);
+}
+
+void motor_stop(void)
+{
+	_motor.duty_cycle = 0.0F;
+	_motor.num_stops++;
+}
+
+float motor_get_duty_cycle(void)
+{
+	return _motor.duty_cycle;
+}
+
+bool motor_is_idle(void)
+{
+	return _motor.duty_cycle <= 0.0F;
+}
+
+void motor_get_input_voltage_current(float* out_voltage, float* out_current)
+{
+	*out_voltage = 16.0F;
+	*out_current = _motor.duty_cycle * 10.0F;
+}
+
+std::uint32_t thread_stats_now(void)
+{
+	return std::uint32_t(_clock.getMonotonic().toUSec());
+}
+
+void thread_stats_begin(enum thread_stats_id id, std::uint32_t released_at)
+{
+	(void)id;
+	(void)released_at;
+}
+
+void thread_stats_end(enum thread_stats_id id, std::uint32_t deadline_usec)
+{
+	(void)id;
+	(void)deadline_usec;
+}
+
+}
+
+/*
+ * Platform interfaces of the node
+ */
+namespace uavcan_stm32
+{
+
+uavcan::MonotonicTime clock::getMonotonic()
+{
+	return _clock.getMonotonic();
+}
+
+uavcan::ISystemClock& SystemClock::instance()
+{
+	return _clock;
+}
+
+}
+
+namespace uavcan_node
+{
+
+uavcan::protocol::SoftwareVersion get_uavcan_software_version()
+{
+	return uavcan::protocol::SoftwareVersion();
+}
+
+std::uint32_t get_inherited_can_bus_bit_rate()
+{
+	return 1000000;
+}
+
+uavcan::NodeID get_inherited_node_id()
+{
+	return uavcan::NodeID();
+}
+
+void init_bootloader_interface() { }
+
+}
+
+namespace
+{
+
+std::uint16_t float_to_float16(float x)
+{
+	// Enough for the setpoints: zero and the normal numbers, truncated
+	std::uint32_t bits = 0;
+	std::memcpy(&bits, &x, sizeof(bits));
+	const std::uint16_t sign = std::uint16_t((bits >> 16) & 0x8000U);
+	const int exponent = int((bits >> 23) & 0xFFU) - 127 + 15;
+	if (exponent <= 0) {
+		return sign;
+	}
+	return std::uint16_t(sign | (std::min(exponent, 30) << 10) | ((bits >> 13) & 0x3FFU));
+}
+
+/**
+ * The flight controller and the ESC on the virtual bus
+ */
+struct Bench
+{
+	VirtualBus bus;
+	Endpoint fc;
+	VirtualDriver esc_driver;
+	uavcan_node::Node esc;
+	std::uint8_t tid_setpoint = 0;
+	std::uint8_t tid_readiness = 0;
+	std::uint8_t tid_command = 0;
+
+	Bench()
+		: fc(bus, 0, FlightControllerNodeID)
+		, esc_driver(bus, 1)
+		, esc(esc_driver, _clock)
+	{
+		CHECK(configSet("uavcan_node_id", ESCNodeID) == 0);
+		CHECK(configSet("esc_index", ESCIndex) == 0);
+		CHECK(configSet("cy_sp_id", SetpointSubjectID) == 0);
+		CHECK(configSet("cy_rdy_id", ReadinessSubjectID) == 0);
+		CHECK(configSet("cy_fb_id", FeedbackSubjectID) == 0);
+		esc.init();
+		CHECK(esc.hasNodeID() && (esc.getNodeID() == ESCNodeID));
+		_motor = MotorStub();
+	}
+
+	/// Transmits and receives everything that is pending; the node polls the readiness timeout like its thread
+	void spin()
+	{
+		for (int round = 0; round < 3; round++) {
+			fc.transport.spin(_clock.getMonotonic());
+			esc.spin(_clock.getMonotonic());
+		}
+		esc.pollReadinessTimeout(_clock.getMonotonic());
+	}
+
+	void publishReadiness(std::uint8_t readiness)
+	{
+		CHECK(send(fc, cyphal::TransferKind::Message, ReadinessSubjectID, cyphal::NodeIDUnset, tid_readiness,
+		           std::vector<std::uint8_t>(1, readiness)) == 0);
+		tid_readiness = (tid_readiness + 1) & cyphal::TransferIDMask;
+	}
+
+	void publishSetpoint(const std::vector<float>& values)
+	{
+		std::vector<std::uint8_t> payload;
+		for (float x : values) {
+			const std::uint16_t h = float_to_float16(x);
+			payload.push_back(std::uint8_t(h));
+			payload.push_back(std::uint8_t(h >> 8));
+		}
+		CHECK(send(fc, cyphal::TransferKind::Message, SetpointSubjectID, cyphal::NodeIDUnset, tid_setpoint,
+		           payload) == 0);
+		tid_setpoint = (tid_setpoint + 1) & cyphal::TransferIDMask;
+	}
+
+	void executeCommand(std::uint16_t command)
+	{
+		const std::vector<std::uint8_t> payload = { std::uint8_t(command), std::uint8_t(command >> 8), 0 };
+		CHECK(send(fc, cyphal::TransferKind::Request, ExecuteCommandServiceID, ESCNodeID, tid_command, payload) == 0);
+		tid_command = (tid_command + 1) & cyphal::TransferIDMask;
+	}
+
+	const ReceivedTransfer* lastFeedback() const
+	{
+		for (auto it = fc.recorder.received.rbegin(); it != fc.recorder.received.rend(); ++it) {
+			if ((it->transfer.kind == cyphal::TransferKind::Message) && (it->transfer.port_id == FeedbackSubjectID)) {
+				return &*it;
+			}
+		}
+		return nullptr;
+	}
+};
+
+void test_setpoint()
+{
+	Bench b;
+	b.publishReadiness(3);
+	b.spin();
+
+	// The element of the ESC index is applied with cmd_ttl_ms; the feedback reports the demand
+	b.publishSetpoint({ 0.25F, 0.5F, 0.75F });
+	b.spin();
+	CHECK(_motor.num_setpoints == 1);
+	CHECK(_motor.duty_cycle == 0.5F);
+	CHECK(_motor.ttl_ms == int(CmdTTLMSec));
+	const ReceivedTransfer* fb = b.lastFeedback();
+	CHECK(fb != nullptr);
+	if (fb != nullptr) {
+		CHECK(fb->transfer.remote_node_id == ESCNodeID);
+		CHECK(fb->payload == std::vector<std::uint8_t>({ 3, 0, 50 }));
+	}
+
+	// The setpoint is limited to 1; a missing element is zero, which stops the motor, like a negative one
+	b.publishSetpoint({ 0.0F, 1.5F });
+	b.spin();
+	CHECK(_motor.duty_cycle == 1.0F);
+	b.publishSetpoint({ 0.5F });
+	b.spin();
+	CHECK(_motor.num_stops == 1);
+	b.publishSetpoint({ 0.5F, -0.5F });
+	b.spin();
+	CHECK(_motor.num_stops == 2);
+	CHECK(_motor.num_setpoints == 2);
+}
+
+void test_readiness()
+{
+	Bench b;
+
+	// Standby does not let the motor run
+	b.publishReadiness(2);
+	b.publishSetpoint({ 0.5F, 0.5F });
+	b.spin();
+	CHECK(_motor.num_setpoints == 0);
+	CHECK(_motor.num_stops == 1);
+
+	// Engaged, then back to standby
+	b.publishReadiness(3);
+	b.publishSetpoint({ 0.5F, 0.5F });
+	b.spin();
+	CHECK(_motor.num_setpoints == 1);
+	b.publishReadiness(2);
+	b.spin();
+	CHECK(_motor.num_stops == 2);
+
+	// The motor is stopped when the readiness is not published anymore
+	b.publishReadiness(3);
+	b.publishSetpoint({ 0.5F, 0.5F });
+	b.spin();
+	CHECK(_motor.num_setpoints == 2);
+	for (unsigned i = 0; i < 120; i++) {
+		_clock.advance(10000);
+		b.publishSetpoint({ 0.5F, 0.5F });
+		b.spin();
+	}
+	CHECK(_motor.num_setpoints < 2 + 101);
+	CHECK(_motor.duty_cycle == 0.0F);
+	CHECK(_motor.num_stops > 2);
+}
+
+void test_emergency_stop()
+{
+	Bench b;
+	b.publishReadiness(3);
+	b.publishSetpoint({ 0.5F, 0.5F });
+	b.spin();
+	CHECK(_motor.duty_cycle == 0.5F);
+
+	b.executeCommand(65531);
+	b.spin();
+	CHECK(_motor.num_stops == 1);
+	CHECK(_motor.duty_cycle == 0.0F);
+	const auto& response = b.fc.recorder.received.back();
+	CHECK(response.transfer.kind == cyphal::TransferKind::Response);
+	CHECK(response.transfer.port_id == ExecuteCommandServiceID);
+	CHECK(response.payload == std::vector<std::uint8_t>(1, 0));
+}
+
+void test_failover()
+{
+	Bench b;
+
+	const unsigned period_usec = 2500;
+	const unsigned num_setpoints = 1200;
+	const unsigned cut_at = 400;
+	const unsigned reconnect_at = 800;
+	const unsigned readiness_every = 40;    // 10 Hz
+
+	// The interface that the node locked onto is cut, then reconnected. Consecutive setpoints differ,
+	// so that a duplicate would be visible at the motor interface.
+	for (unsigned i = 0; i < num_setpoints; i++) {
+		if (i == cut_at) {
+			b.bus.connected[0] = false;
+		}
+		if (i == reconnect_at) {
+			b.bus.connected[0] = true;
+		}
+		if ((i % readiness_every) == 0) {
+			b.publishReadiness(3);
+		}
+		b.publishSetpoint({ 0.0F, 0.25F + float(i % 32) / 64.0F });
+		b.spin();
+		_clock.advance(period_usec);
+	}
+
+	std::uint64_t max_gap_usec = 0;
+	unsigned num_duplicates = 0;
+	for (std::size_t k = 1; k < _motor.setpoint_ts.size(); k++) {
+		max_gap_usec = std::max(max_gap_usec, _motor.setpoint_ts[k] - _motor.setpoint_ts[k - 1]);
+		num_duplicates += (_motor.setpoints[k] == _motor.setpoints[k - 1]) ? 1 : 0;
+	}
+	const unsigned num_lost = num_setpoints - std::min(num_setpoints, _motor.num_setpoints);
+
+	// The other interface is accepted on the first missed setpoint; the motor is never stopped
+	CHECK(num_duplicates == 0);
+	CHECK(_motor.num_stops == 0);
+	CHECK(_motor.num_setpoints <= num_setpoints);
+	CHECK(num_lost <= 1);
+	CHECK(max_gap_usec <= (2 * period_usec));
+
+	std::printf("Node failover at %u Hz: %u of %u setpoints lost, longest interval %.1f ms at the motor, "
+	            "cmd_ttl_ms %u\n", 1000000 / period_usec, num_lost, num_setpoints, max_gap_usec / 1000.0, CmdTTLMSec);
+}
+
+/**
+ * Host CPU time from the start of the spin of the node to motor_set_duty_cycle(), with both interfaces delivering
+ * every frame. It includes the reception and the deduplication of the frames and the decoding of the setpoint.
+ */
+void measure()
+{
+	Bench b;
+	b.publishReadiness(3);
+	b.spin();
+
+	const unsigned num_setpoints = 200000;
+	std::vector<double> latency_ns;
+	latency_ns.reserve(num_setpoints);
+	for (unsigned i = 0; i < num_setpoints; i++) {
+		if ((i % 40) == 0) {
+			b.publishReadiness(3);
+		}
+		b.publishSetpoint({ 0.0F, 0.25F + float(i % 32) / 64.0F, 0.0F, 0.0F });
+		b.fc.transport.spin(_clock.getMonotonic());
+		const unsigned num_received = _motor.num_setpoints;
+		const auto started = std::chrono::steady_clock::now();
+		b.esc.spin(_clock.getMonotonic());
+		if (_motor.num_setpoints > num_received) {
+			latency_ns.push_back(std::chrono::duration<double, std::nano>(_motor.last_setpoint_host_ts -
+			                                                               started).count());
+		}
+		b.fc.transport.spin(_clock.getMonotonic());
+		b.fc.recorder.received.clear();
+		_clock.advance(2500);
+	}
+	CHECK(latency_ns.size() == num_setpoints);
+
+	std::sort(latency_ns.begin(), latency_ns.end());
+	double sum = 0;
+	for (double x : latency_ns) {
+		sum += x;
+	}
+	std::printf("Node RAM: %u bytes (the transport included)\n", unsigned(sizeof(uavcan_node::Node)));
+	std::printf("Host CPU time from the RX spin to motor_set_duty_cycle(): mean %.0f ns, 99th percentile %.0f ns\n",
+	            sum / double(latency_ns.size()), latency_ns.at(latency_ns.size() * 99 / 100));
+}
+
+}
+
+int main()
+{
+	test_setpoint();
+	test_readiness();
+	test_emergency_stop();
+	test_failover();
+	measure();
+
+	if (_num_failures > 0) {
+		std::printf("%u checks failed\n", _num_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Tests of the Cyphal/CAN transport of the firmware on a virtual redundant CAN bus.
+ *
+ * The transport is built from the unmodified firmware sources against the subset of the libuavcan driver interface
+ * in stubs/. Several transport instances are connected to the virtual bus of virtual_bus.hpp with two interfaces,
+ * each of which can be cut. The tests cover single and multi-frame transfers, messages and services, deduplication
+ * of the redundant interfaces, late copies of past transfers, the failover, the CRC check, anonymous transfers and
+ * the TX queue limits.
+ *
+ * The failover test streams setpoints at 400 Hz with the transfer ID timeout of the setpoint subject of the node
+ * (CommandTransferIDTimeoutMSec in cyphal_node.cpp) and reports the setpoints lost and the longest interval between
+ * the accepted ones; the interface is switched on the first missed transfer, like in UAVCAN v0, so at most one
+ * setpoint may be lost. Finally the static RAM footprint of the transport and its host CPU time per received
+ * setpoint are printed. The same figures of the whole node are printed by test_node.cpp.
+ *
+ * Usage:
+ *   ./test_transport
+ * The exit code is non-zero if any check fails.
+ */
+
+#include "virtual_bus.hpp"
+#include <chrono>
+
+namespace
+{
+
+std::vector<std::uint8_t> make_payload(unsigned size, unsigned seed)
+{
+	std::vector<std::uint8_t> out(size);
+	for (unsigned i = 0; i < size; i++) {
+		out[i] = std::uint8_t(seed * 31 + i * 7);
+	}
+	return out;
+}
+
+void test_round_trip()
+{
+	Network net;
+	Endpoint& a = net.add(10);
+	Endpoint& b = net.add(20);
+
+	// Single and multi-frame messages, including the frame size boundaries and the largest payload
+	const unsigned sizes[] = { 0, 1, 7, 8, 13, 14, 15, 100, cyphal::Transport::MaxPayloadSize };
+	std::uint8_t tid = 0;
+	for (unsigned size : sizes) {
+		const auto payload = make_payload(size, size);
+		CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, tid, payload) == 0);
+		net.spin();
+		CHECK(b.recorder.received.size() == 1);
+		if (b.recorder.received.size() == 1) {
+			const auto& r = b.recorder.received[0];
+			CHECK(r.transfer.kind == cyphal::TransferKind::Message);
+			CHECK(r.transfer.priority == cyphal::Priority::High);
+			CHECK(r.transfer.port_id == 1234);
+			CHECK(r.transfer.remote_node_id == 10);
+			CHECK(r.transfer.transfer_id == tid);
+			CHECK(r.payload == payload);
+		}
+		b.recorder.received.clear();
+		tid = (tid + 1) & cyphal::TransferIDMask;
+	}
+
+	// Service request and response; the third node must not receive them
+	Endpoint& c = net.add(30);
+	const auto request = make_payload(20, 1);
+	const auto response = make_payload(5, 2);
+	CHECK(send(a, cyphal::TransferKind::Request, 384, 20, 3, request) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 1);
+	if (b.recorder.received.size() == 1) {
+		CHECK(b.recorder.received[0].transfer.kind == cyphal::TransferKind::Request);
+		CHECK(b.recorder.received[0].transfer.port_id == 384);
+		CHECK(b.recorder.received[0].transfer.remote_node_id == 10);
+		CHECK(b.recorder.received[0].payload == request);
+	}
+	CHECK(send(b, cyphal::TransferKind::Response, 384, 10, 3, response) == 0);
+	net.spin();
+	CHECK(a.recorder.received.size() == 1);
+	if (a.recorder.received.size() == 1) {
+		CHECK(a.recorder.received[0].transfer.kind == cyphal::TransferKind::Response);
+		CHECK(a.recorder.received[0].transfer.remote_node_id == 20);
+		CHECK(a.recorder.received[0].transfer.transfer_id == 3);
+		CHECK(a.recorder.received[0].payload == response);
+	}
+	CHECK(c.recorder.received.empty());
+	b.recorder.received.clear();
+
+	// Unsubscribed subjects are ignored; longer payloads are truncated to the extent
+	CHECK(send(a, cyphal::TransferKind::Message, 7000, cyphal::NodeIDUnset, 4, make_payload(3, 3)) == 0);
+	b.recorder.extent = 10;
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 5, make_payload(50, 4)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 1);
+	if (b.recorder.received.size() == 1) {
+		const auto expected = make_payload(50, 4);
+		CHECK(b.recorder.received[0].payload == std::vector<std::uint8_t>(expected.begin(), expected.begin() + 10));
+	}
+
+	CHECK(a.transport.getPerfCounters().errors == 0);
+	CHECK(b.transport.getPerfCounters().errors == 0);
+}
+
+void test_deduplication()
+{
+	Network net;
+	Endpoint& a = net.add(10);
+	Endpoint& b = net.add(20);
+
+	// Every transfer arrives via both interfaces but is accepted once; repeated transfer IDs are dropped
+	for (unsigned i = 0; i < 100; i++) {
+		CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, std::uint8_t(i & 31),
+		           make_payload(i % 40, i)) == 0);
+		net.spin();
+		_clock.advance(1000);
+	}
+	CHECK(b.recorder.received.size() == 100);
+	CHECK(b.transport.getPerfCounters().frames_rx[0] == b.transport.getPerfCounters().frames_rx[1]);
+	CHECK(b.transport.getPerfCounters().frames_rx[0] > 100);
+
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 99 & 31, make_payload(3, 0)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 100);
+}
+
+void test_late_copies()
+{
+	Network net;
+	Endpoint& a = net.add(10);
+	Endpoint& b = net.add(20);
+
+	// The receiver locks onto the interface 0 at 100 Hz
+	for (unsigned i = 0; i < 10; i++) {
+		net.bus.connected[1] = false;
+		CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, std::uint8_t(i),
+		           make_payload(3, i)) == 0);
+		net.spin();
+		_clock.advance(10000);
+	}
+	CHECK(b.recorder.received.size() == 10);
+
+	// Copies of the past transfers arrive late via the interface 1; they are not accepted again
+	net.bus.connected[0] = false;
+	net.bus.connected[1] = true;
+	for (unsigned i = 7; i < 10; i++) {
+		CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, std::uint8_t(i),
+		           make_payload(3, i)) == 0);
+	}
+	net.spin();
+	CHECK(b.recorder.received.size() == 10);
+
+	// A new transfer via the interface 1 is accepted, because the interface 0 has missed it
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 10, make_payload(3, 10)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 11);
+	CHECK(b.recorder.received.back().transfer.transfer_id == 10);
+
+	// Before the interval elapses, a new transfer via the other interface is not accepted
+	net.bus.connected[0] = true;
+	net.bus.connected[1] = false;
+	_clock.advance(2000);
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 11, make_payload(3, 11)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 11);
+}
+
+void test_failover()
+{
+	Network net;
+	Endpoint& fc = net.add(10);
+	Endpoint& esc = net.add(20);
+
+	const unsigned period_usec = 2500;
+	const unsigned num_setpoints = 1200;
+	const unsigned cut_at = 400;
+	const unsigned reconnect_at = 800;
+
+	// The interface that the receiver locked onto is cut, then reconnected
+	std::vector<std::uint64_t> accepted_at;
+	unsigned num_duplicates = 0;
+	std::vector<bool> seen(num_setpoints, false);
+	for (unsigned i = 0; i < num_setpoints; i++) {
+		if (i == cut_at) {
+			net.bus.connected[0] = false;
+		}
+		if (i == reconnect_at) {
+			net.bus.connected[0] = true;
+		}
+		auto payload = make_payload(8, 0);
+		std::memcpy(payload.data(), &i, sizeof(i));
+		CHECK(send(fc, cyphal::TransferKind::Message, SetpointSubjectID, cyphal::NodeIDUnset, std::uint8_t(i & 31),
+		           payload) == 0);
+		const std::size_t num_received = esc.recorder.received.size();
+		net.spin();
+		for (std::size_t k = num_received; k < esc.recorder.received.size(); k++) {
+			unsigned index = 0;
+			std::memcpy(&index, esc.recorder.received[k].payload.data(), sizeof(index));
+			num_duplicates += seen.at(index) ? 1 : 0;
+			seen.at(index) = true;
+			accepted_at.push_back(_clock.getMonotonic().toUSec());
+		}
+		_clock.advance(period_usec);
+	}
+
+	std::uint64_t max_gap_usec = 0;
+	for (std::size_t k = 1; k < accepted_at.size(); k++) {
+		max_gap_usec = std::max(max_gap_usec, accepted_at[k] - accepted_at[k - 1]);
+	}
+	const unsigned num_lost = unsigned(std::count(seen.begin(), seen.end(), false));
+
+	// The other interface is accepted on the first missed transfer; nothing is lost on reconnection
+	CHECK(num_duplicates == 0);
+	CHECK(max_gap_usec <= (2 * period_usec));
+	CHECK(num_lost <= 1);
+	CHECK(std::none_of(seen.begin() + reconnect_at, seen.end(), [](bool x) { return !x; }));
+
+	std::printf("Failover at %u Hz: %u of %u setpoints lost, longest interval %.1f ms, cmd_ttl_ms %u\n",
+	            1000000 / period_usec, num_lost, num_setpoints, max_gap_usec / 1000.0, CmdTTLMSec);
+}
+
+void test_crc()
+{
+	Network net;
+	net.bus.connected[1] = false;           // Otherwise the copy from the other interface could be accepted
+	Endpoint& a = net.add(10);
+	Endpoint& b = net.add(20);
+
+	net.bus.corrupt_next_frames = 1;
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 0, make_payload(30, 0)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.empty());
+	CHECK(b.transport.getPerfCounters().errors == 1);
+
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 1, make_payload(30, 0)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 1);
+}
+
+void test_anonymous_and_foreign_frames()
+{
+	Network net;
+	Endpoint& a = net.add(cyphal::NodeIDUnset);
+	Endpoint& b = net.add(20);
+
+	// Anonymous nodes can only send single frame messages. Anonymous transfers have no session, so they are
+	// received once per interface; the node doesn't subscribe to any anonymous messages.
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 0, make_payload(7, 0)) == 0);
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 1, make_payload(8, 0)) < 0);
+	CHECK(send(a, cyphal::TransferKind::Request, 384, 20, 2, make_payload(1, 0)) < 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == NumIfaces);
+	for (const auto& r : b.recorder.received) {
+		CHECK(r.transfer.remote_node_id == cyphal::NodeIDUnset);
+		CHECK(r.payload == make_payload(7, 0));
+	}
+
+	// UAVCAN v0 frames (the toggle bit of the first frame is cleared) and standard frames are ignored
+	uavcan::CanFrame frame;
+	frame.id = uavcan::CanFrame::FlagEFF | (4U << 26) | (3U << 21) | (1234U << 8) | 10U;
+	frame.data[0] = 0xC0;
+	frame.dlc = 1;
+	net.endpoints[0]->driver.getIface(0)->send(frame, _clock.getMonotonic(), 0);
+	frame.id = 0x123;
+	frame.data[0] = 0xE0;
+	net.endpoints[0]->driver.getIface(0)->send(frame, _clock.getMonotonic(), 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == NumIfaces);
+}
+
+void test_tx_queue()
+{
+	Network net;
+	Endpoint& a = net.add(10);
+	Endpoint& b = net.add(20);
+
+	// Without spinning, the queue fills up; a multi-frame transfer that doesn't fit is rejected as a whole
+	unsigned num_sent = 0;
+	while (send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, std::uint8_t(num_sent & 31),
+	            make_payload(3, 0)) == 0) {
+		num_sent++;
+	}
+	CHECK(num_sent == cyphal::Transport::TxQueueCapacity);
+	CHECK(a.transport.getPerfCounters().tx_queue_overflows == 1);
+
+	// The frames that are not transmitted before their deadline are discarded
+	_clock.advance(200000);
+	net.spin();
+	CHECK(b.recorder.received.empty());
+	CHECK(a.transport.getPerfCounters().errors == cyphal::Transport::TxQueueCapacity * NumIfaces);
+
+	CHECK(send(a, cyphal::TransferKind::Message, 1234, cyphal::NodeIDUnset, 0, make_payload(100, 0)) == 0);
+	net.spin();
+	CHECK(b.recorder.received.size() == 1);
+}
+
+/**
+ * Host CPU time per received setpoint, with both interfaces delivering every frame. This is the transport's
+ * share of the RX-to-PWM latency; it is only indicative of the cost on the target.
+ */
+void measure()
+{
+	Network net;
+	Endpoint& fc = net.add(10);
+	Endpoint& esc = net.add(20);
+
+	const unsigned num_setpoints = 200000;
+	const auto payload = make_payload(8, 0);        // 4 channels of float16, like the UDRAL setpoint
+	double spin_ns = 0;
+	for (unsigned i = 0; i < num_setpoints; i++) {
+		CHECK(send(fc, cyphal::TransferKind::Message, SetpointSubjectID, cyphal::NodeIDUnset, std::uint8_t(i & 31),
+		           payload) == 0);
+		fc.transport.spin(_clock.getMonotonic());
+		const auto started = std::chrono::steady_clock::now();
+		esc.transport.spin(_clock.getMonotonic());
+		spin_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+		_clock.advance(2500);
+	}
+	CHECK(esc.recorder.received.size() >= num_setpoints);
+
+	std::printf("Transport RAM: %u bytes (%u RX sessions of %u bytes, %u TX queues of %u frames)\n",
+	            unsigned(sizeof(cyphal::Transport)), cyphal::Transport::NumRxSessions,
+	            cyphal::Transport::MaxPayloadSize + 2, unsigned(uavcan::MaxCanIfaces),
+	            cyphal::Transport::TxQueueCapacity);
+	std::printf("Host CPU time per setpoint received via both interfaces: %.0f ns\n", spin_ns / num_setpoints);
+}
+
+}
+
+int main()
+{
+	test_round_trip();
+	test_deduplication();
+	test_late_copies();
+	test_failover();
+	test_crc();
+	test_anonymous_and_foreign_frames();
+	test_tx_queue();
+	measure();
+
+	if (_num_failures > 0) {
+		std::printf("%u checks failed\n", _num_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
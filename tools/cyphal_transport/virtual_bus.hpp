@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Virtual redundant CAN bus for the host tests of the Cyphal/CAN node; see test_transport.cpp and test_node.cpp.
+ *
+ * Every endpoint is connected to all interfaces of the bus, each of which can be cut. The bus runs in virtual time,
+ * frames are delivered instantly.
+ */
+
+#pragma once
+
+#include <transport.hpp>
+#include <uavcan/driver/system_clock.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#define CHECK(x)                check((x), #x, __LINE__)
+
+namespace
+{
+
+constexpr unsigned NumIfaces = 2;
+constexpr unsigned MaxEndpoints = 4;
+constexpr unsigned CommandTransferIDTimeoutMSec = 50;   ///< Same as in cyphal_node.cpp
+constexpr unsigned CmdTTLMSec = 200;                    ///< Default of cmd_ttl_ms
+constexpr std::uint16_t SetpointSubjectID = 100;
+
+unsigned _num_failures;
+
+void check(bool ok, const char* what, int line)
+{
+	if (!ok) {
+		std::fprintf(stderr, "FAILED at line %i: %s\n", line, what);
+		_num_failures++;
+	}
+}
+
+/*
+ * Virtual time
+ */
+class VirtualClock : public uavcan::ISystemClock
+{
+	std::uint64_t usec_ = 1000000;
+
+public:
+	uavcan::MonotonicTime getMonotonic() const override { return uavcan::MonotonicTime::fromUSec(usec_); }
+	uavcan::UtcTime getUtc() const override { return uavcan::UtcTime::fromUSec(usec_); }
+
+	void advanceTo(uavcan::MonotonicTime ts) { usec_ = std::max(usec_, ts.toUSec()); }
+	void advance(std::uint64_t usec) { usec_ += usec; }
+} _clock;
+
+/*
+ * Virtual bus with redundant interfaces; every endpoint is connected to all of them
+ */
+class VirtualBus;
+
+class VirtualIface : public uavcan::ICanIface
+{
+	friend class VirtualBus;
+
+	struct RxItem
+	{
+		uavcan::CanFrame frame;
+		uavcan::MonotonicTime ts;
+	};
+
+	VirtualBus& bus_;
+	const unsigned endpoint_;
+	const unsigned index_;
+	std::deque<RxItem> rx_;
+
+public:
+	VirtualIface(VirtualBus& bus, unsigned endpoint, unsigned index)
+		: bus_(bus)
+		, endpoint_(endpoint)
+		, index_(index)
+	{ }
+
+	std::int16_t send(const uavcan::CanFrame& frame, uavcan::MonotonicTime tx_deadline,
+	                  uavcan::CanIOFlags flags) override;
+
+	std::int16_t receive(uavcan::CanFrame& out_frame, uavcan::MonotonicTime& out_ts_monotonic,
+	                     uavcan::UtcTime& out_ts_utc, uavcan::CanIOFlags& out_flags) override
+	{
+		if (rx_.empty()) {
+			return 0;
+		}
+		out_frame = rx_.front().frame;
+		out_ts_monotonic = rx_.front().ts;
+		out_ts_utc = uavcan::UtcTime::fromUSec(rx_.front().ts.toUSec());
+		out_flags = 0;
+		rx_.pop_front();
+		return 1;
+	}
+
+	std::uint64_t getErrorCount() const override { return 0; }
+
+	bool hasRx() const { return !rx_.empty(); }
+};
+
+class VirtualDriver : public uavcan::ICanDriver
+{
+	VirtualIface* ifaces_[NumIfaces];
+
+public:
+	VirtualDriver(VirtualBus& bus, unsigned endpoint);
+
+	~VirtualDriver()
+	{
+		for (auto* iface : ifaces_) {
+			delete iface;
+		}
+	}
+
+	uavcan::ICanIface* getIface(std::uint8_t iface_index) override
+	{
+		return (iface_index < NumIfaces) ? ifaces_[iface_index] : nullptr;
+	}
+
+	std::uint8_t getNumIfaces() const override { return NumIfaces; }
+
+	std::int16_t select(uavcan::CanSelectMasks& inout_masks,
+	                    const uavcan::CanFrame* (& pending_tx)[uavcan::MaxCanIfaces],
+	                    uavcan::MonotonicTime blocking_deadline) override
+	{
+		(void)pending_tx;
+		std::uint8_t read = 0;
+		for (unsigned i = 0; i < NumIfaces; i++) {
+			if (ifaces_[i]->hasRx()) {
+				read |= std::uint8_t(1U << i);
+			}
+		}
+		inout_masks.read &= read;
+		// The mailboxes are always free; nothing to wait for means that the deadline is reached
+		if ((inout_masks.read == 0) && (inout_masks.write == 0)) {
+			_clock.advanceTo(blocking_deadline);
+		}
+		return std::int16_t(__builtin_popcount(inout_masks.read | inout_masks.write));
+	}
+};
+
+class VirtualBus
+{
+	friend class VirtualIface;
+
+	VirtualIface* ifaces_[MaxEndpoints][NumIfaces] = {};
+	unsigned num_endpoints_ = 0;
+
+public:
+	bool connected[NumIfaces];
+	unsigned corrupt_next_frames = 0;       ///< Flip a payload bit in this many subsequent frames
+	std::uint64_t frames_delivered = 0;
+
+	VirtualBus() { std::fill(std::begin(connected), std::end(connected), true); }
+
+	unsigned attach(VirtualIface* const (&ifaces)[NumIfaces])
+	{
+		for (unsigned i = 0; i < NumIfaces; i++) {
+			ifaces_[num_endpoints_][i] = ifaces[i];
+		}
+		return num_endpoints_++;
+	}
+};
+
+std::int16_t VirtualIface::send(const uavcan::CanFrame& frame, uavcan::MonotonicTime tx_deadline,
+                                uavcan::CanIOFlags flags)
+{
+	(void)tx_deadline;
+	(void)flags;
+	if (!bus_.connected[index_]) {
+		return 1;               // The frame is transmitted, but nobody receives it
+	}
+	RxItem item;
+	item.frame = frame;
+	item.ts = _clock.getMonotonic();
+	if ((bus_.corrupt_next_frames > 0) && (frame.dlc > 1)) {
+		bus_.corrupt_next_frames--;
+		item.frame.data[0] ^= 1;
+	}
+	for (unsigned e = 0; e < bus_.num_endpoints_; e++) {
+		if (e != endpoint_) {
+			bus_.ifaces_[e][index_]->rx_.push_back(item);
+			bus_.frames_delivered++;
+		}
+	}
+	return 1;
+}
+
+VirtualDriver::VirtualDriver(VirtualBus& bus, unsigned endpoint)
+{
+	for (unsigned i = 0; i < NumIfaces; i++) {
+		ifaces_[i] = new VirtualIface(bus, endpoint, i);
+	}
+	(void)bus.attach(ifaces_);
+}
+
+/*
+ * Transfer handler that records everything it receives
+ */
+struct ReceivedTransfer
+{
+	cyphal::Transfer transfer;
+	std::vector<std::uint8_t> payload;
+};
+
+class Recorder : public cyphal::ITransferHandler
+{
+public:
+	unsigned extent = cyphal::Transport::MaxPayloadSize;
+	std::vector<ReceivedTransfer> received;
+
+	unsigned getExtent(cyphal::TransferKind kind, std::uint16_t port_id) const override
+	{
+		(void)kind;
+		return (port_id == 7000) ? 0 : extent;          // Subject 7000 is not subscribed
+	}
+
+	unsigned getTransferIDTimeoutMSec(cyphal::TransferKind kind, std::uint16_t port_id) const override
+	{
+		return ((kind == cyphal::TransferKind::Message) && (port_id == SetpointSubjectID)) ?
+		       CommandTransferIDTimeoutMSec : 2000;
+	}
+
+	void handleTransfer(const cyphal::Transfer& transfer) override
+	{
+		ReceivedTransfer r;
+		r.transfer = transfer;
+		r.payload.assign(transfer.payload, transfer.payload + transfer.payload_size);
+		r.transfer.payload = nullptr;
+		received.push_back(r);
+	}
+};
+
+struct Endpoint
+{
+	VirtualDriver driver;
+	Recorder recorder;
+	cyphal::Transport transport;
+
+	Endpoint(VirtualBus& bus, unsigned index, std::uint8_t node_id)
+		: driver(bus, index)
+		, transport(driver, _clock, recorder)
+	{
+		transport.setNodeID(node_id);
+	}
+};
+
+struct Network
+{
+	VirtualBus bus;
+	std::vector<Endpoint*> endpoints;
+
+	~Network()
+	{
+		for (auto* e : endpoints) {
+			delete e;
+		}
+	}
+
+	Endpoint& add(std::uint8_t node_id)
+	{
+		endpoints.push_back(new Endpoint(bus, unsigned(endpoints.size()), node_id));
+		return *endpoints.back();
+	}
+
+	/// Transmits and receives everything that is pending
+	void spin()
+	{
+		for (int round = 0; round < 3; round++) {
+			for (auto* e : endpoints) {
+				e->transport.spin(_clock.getMonotonic());
+			}
+		}
+	}
+};
+
+int send(Endpoint& from, cyphal::TransferKind kind, std::uint16_t port_id, std::uint8_t remote_node_id,
+         std::uint8_t transfer_id, const std::vector<std::uint8_t>& payload)
+{
+	cyphal::Transfer tr;
+	tr.kind = kind;
+	tr.priority = cyphal::Priority::High;
+	tr.port_id = port_id;
+	tr.remote_node_id = remote_node_id;
+	tr.transfer_id = transfer_id;
+	tr.payload = payload.data();
+	tr.payload_size = unsigned(payload.size());
+	return from.transport.send(tr, _clock.getMonotonic() + uavcan::MonotonicDuration::fromMSec(100));
+}
+
+}
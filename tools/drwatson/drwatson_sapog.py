@@ -21,16 +21,19 @@ import sys
 sys.path.insert(1, os.path.join(sys.path[0], 'pyuavcan'))
 
 from drwatson import init, run, make_api_context_with_user_provided_credentials, execute_shell_command,\
-    info, error, input, CLIWaitCursor, download, abort, glob_one, download_newest, open_serial_port,\
+    info, error, input, CLIWaitCursor, download, abort, download_newest, open_serial_port,\
     enforce, SerialCLI, BackgroundSpinner, fatal, BackgroundDelay, imperative, \
     load_firmware_via_gdb, convert_units_from_to, BackgroundCLIListener
+import glob
 import logging
+import subprocess
+import threading
 import time
 import yaml
 import binascii
 import uavcan
 from base64 import b64decode, b64encode
-from contextlib import closing, contextmanager
+from contextlib import closing, ExitStack
 from functools import partial
 
 
@@ -48,6 +51,18 @@ TEMPERATURE_RANGE_DEGC = 10, 80
 ESC_ERROR_LIMIT = 1000
 STARTUP_DUTY_CYCLE = 0.001
 STABILITY_TEST_DUTY_CYCLES = [0.3, 0.6]
+STABILITY_TEST_DURATION = 5
+
+# Timeouts of the conditions that are polled while the test is running
+NODE_DISCOVERY_TIMEOUT = 10
+NODE_INIT_TIMEOUT = 10
+MOTOR_START_TIMEOUT = 10
+MOTOR_STOP_TIMEOUT = 5
+NODE_STATUS_TIMEOUT = 3
+SLCAN_DAEMON_EXIT_TIMEOUT = 3
+
+# The RawCommand array can address at most this many ESC
+MAX_DEVICES = 20
 
 
 logger = logging.getLogger('main')
@@ -60,6 +75,12 @@ instructions with the manufacturing doc pack.''',
             lambda p: p.add_argument('iface', help='CAN interface or device path, e.g. "can0", "/dev/ttyACM0", etc.'),
             lambda p: p.add_argument('--firmware', '-f', help='location of the firmware file (if not provided, ' +
                                      'the firmware will be downloaded from Zubax Robotics file server)'),
+            lambda p: p.add_argument('--count', '-n', type=int, default=1,
+                                     help='number of devices tested concurrently on the same CAN bus; '
+                                          'each device needs its own debug probe (default 1)'),
+            lambda p: p.add_argument('--uavcan-only', action='store_true',
+                                     help='run only the UAVCAN test of already programmed devices, without '
+                                          'debug probes and signing; e.g. against simulate_nodes.py on vcan0'),
             require_root=True)
 
 info('''
@@ -71,7 +92,8 @@ Usage instructions:
 1.2. SocketCAN-compatible adapters. In this case it is recommended to use
      8devices USB2CAN. Correct interface name would be "can0".
 
-2. Connect exactly one DroneCode Probe to this computer.
+2. Connect one DroneCode Probe per tested device to this computer.
+   The number of devices tested at once is set with --count.
    For more info refer to https://kb.zubax.com/x/iIAh.
 
 3. Follow the instructions printed in green. If you have any questions,
@@ -80,7 +102,84 @@ Usage instructions:
 ''')
 
 
-def wait_for_boot():
+class Device:
+    """
+    One device under test. A failure of a device is recorded here instead of aborting the test,
+    so that the other devices tested concurrently are not affected.
+    """
+    def __init__(self, index, gdb_port=None, cli_port=None):
+        self.index = index
+        self.gdb_port = gdb_port
+        self.cli_port = cli_port
+        self.io = None
+        self.cli = None
+        self.product_id = None
+        self.unique_id = None
+        self.node_id = None
+        self.failure = None
+        self.started_at = time.monotonic()
+        self.finished_at = None
+
+    @property
+    def ok(self):
+        return self.failure is None
+
+    def fail(self, message):
+        if self.ok:
+            error('%s FAILED: %s', self, message)
+            self.failure = message
+            self.finished_at = time.monotonic()
+
+    def finish(self):
+        if self.finished_at is None:
+            self.finished_at = time.monotonic()
+
+    def __str__(self):
+        out = 'Device %d' % self.index
+        if self.node_id is not None:
+            out += ' (node %d)' % self.node_id
+        return out
+
+
+def for_each_device(devices, function):
+    """Invokes the function concurrently for every device that hasn't failed yet; exceptions fail the device."""
+    def target(d):
+        try:
+            function(d)
+        except Exception as ex:
+            logger.info('%s: exception', d, exc_info=True)
+            d.fail(str(ex) or repr(ex))
+
+    threads = [threading.Thread(target=target, args=(d,), daemon=True) for d in devices if d.ok]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+
+def poll_until(condition, timeout, period=0.05):
+    """Used instead of fixed delays. Returns False if the condition was not met in time."""
+    deadline = time.monotonic() + timeout
+    while not condition():
+        if time.monotonic() >= deadline:
+            return False
+        time.sleep(period)
+    return True
+
+
+def find_debug_probes():
+    """Returns (GDB port, CLI port) per probe. The ports of the same probe differ only in the interface suffix."""
+    gdb_ports = sorted(glob.glob(DEBUGGER_PORT_GDB_GLOB))
+    enforce(len(gdb_ports) == args.count, 'Expected %d debug probes, found %d: %r',
+            args.count, len(gdb_ports), gdb_ports)
+    cli_ports = set(glob.glob(DEBUGGER_PORT_CLI_GLOB))
+    probes = [(p, p[:-len('-if00')] + '-if02') for p in gdb_ports]
+    for _, cli_port in probes:
+        enforce(cli_port in cli_ports, 'Debug probe CLI port not found: %r', cli_port)
+    return probes
+
+
+def wait_for_boot(device):
     def handle_serial_port_hanging():
         fatal('DRWATSON HAS DETECTED A PROBLEM WITH CONNECTED HARDWARE AND NEEDS TO TERMINATE.\n'
               'A serial port operation has timed out. This usually indicates a problem with the connected '
@@ -89,7 +188,7 @@ def wait_for_boot():
               use_abort=True)
 
     with BackgroundDelay(BOOT_TIMEOUT * 5, handle_serial_port_hanging):
-        with open_serial_port(DEBUGGER_PORT_CLI_GLOB) as p:
+        with open_serial_port(device.cli_port) as p:
             try:
                 serial_cli = SerialCLI(p)
                 boot_deadline = time.monotonic() + BOOT_TIMEOUT
@@ -100,15 +199,15 @@ def wait_for_boot():
                     timed_out, line = serial_cli.read_line(END_OF_BOOT_LOG_TIMEOUT)
 
                     if not timed_out:
-                        cli_logger.info(repr(line))
+                        cli_logger.info('%s: %r', device, line)
 
                         if PRODUCT_NAME.lower() in line.lower() and 'bootloader' not in line.lower():
-                            info('Boot confirmed')
+                            info('%s: boot confirmed', device)
                             boot_notification_received = True
 
                         if 'error' in line.lower() or 'fail' in line.lower():
                             failure_notification_received = True
-                            error('Boot error: %r', line)
+                            error('%s: boot error: %r', device, line)
                     else:
                         if failure_notification_received:
                             abort('Device failed to start up normally; see the log for details')
@@ -129,7 +228,15 @@ def wait_for_boot():
           'adapter (disconnect from USB and from the device!) or reboot the VM.')
 
 
-def test_uavcan():
+def test_uavcan(devices):
+    """
+    Tests all devices concurrently on the same bus. The nodes are matched with the devices by unique ID;
+    if the devices are not known yet (UAVCAN only mode), they are created from the discovered nodes.
+    All ESC have the default index, so they receive the same commands, but their status is checked separately.
+    A device that fails keeps receiving the commands until the end of the test.
+    Returns the list of tested devices.
+    """
+    started_at = time.monotonic()
     node_info = uavcan.protocol.GetNodeInfo.Response()
     node_info.name = 'com.zubax.drwatson.sapog'
 
@@ -146,78 +253,113 @@ def test_uavcan():
             except uavcan.UAVCANException:
                 logger.error('Node spin failure', exc_info=True)
 
-        @contextmanager
-        def time_limit(timeout, error_fmt, *args):
-            aborter = n.defer(timeout, partial(abort, error_fmt, *args))
-            yield
-            aborter.remove()
+        def spin_until(condition, timeout):
+            deadline = time.monotonic() + timeout
+            while not condition():
+                if time.monotonic() >= deadline:
+                    return False
+                safe_spin(0.05)
+            return True
+
+        def active():
+            return [d for d in devices if d.ok]
 
         try:
             # Dynamic node ID allocation
             nsmon = uavcan.app.node_monitor.NodeMonitor(n)
             alloc = uavcan.app.dynamic_node_id.CentralizedServer(n, nsmon)
 
-            info('Waiting for the node to show up on the CAN bus...')
-            with time_limit(10, 'The node did not show up in time. Check CAN interface and crystal oscillator.'):
-                while True:
-                    safe_spin(1)
-                    target_nodes = list(nsmon.find_all(lambda e: e.info and e.info.name.decode() == PRODUCT_NAME))
-                    if len(target_nodes) == 1:
-                        break
-                    if len(target_nodes) > 1:
-                        abort('Expected to find exactly one target node, found more: %r', target_nodes)
-
-            node_id = target_nodes[0].node_id
-            info('Node %r initialized', node_id)
-            for nd in target_nodes:
+            # Local time of the latest NodeStatus, to detect when a node is back after reconnection
+            status_timestamps = {}
+            n.add_handler(uavcan.protocol.NodeStatus,
+                          lambda e: status_timestamps.__setitem__(e.transfer.source_node_id, time.monotonic()))
+
+            def find_target_nodes():
+                return {e.info.hardware_version.unique_id.to_bytes(): e.node_id
+                        for e in nsmon.find_all(lambda e: e.info and e.info.name.decode() == PRODUCT_NAME)}
+
+            info('Waiting for %d nodes to show up on the CAN bus...', args.count)
+            spin_until(lambda: len(find_target_nodes()) >= args.count, NODE_DISCOVERY_TIMEOUT)
+            target_nodes = find_target_nodes()
+            for nd in nsmon.find_all(lambda _: True):
                 logger.info('Discovered node %r', nd)
 
-            def request(what):
-                response_event = None
-
-                def cb(e):
-                    nonlocal response_event
-                    if not e:
-                        abort('Request has timed out: %r', what)
-                    response_event = e
-
-                n.request(what, node_id, cb)
-                while response_event is None:
-                    safe_spin(0.1)
-                return response_event.response
-
-            # Starting the node and checking its self-reported diag outputs
-            def wait_for_init():
-                with time_limit(10, 'The node did not complete initialization in time'):
-                    while True:
-                        safe_spin(1)
-                        if nsmon.exists(node_id) and nsmon.get(node_id).status.mode == \
-                                uavcan.protocol.NodeStatus().MODE_OPERATIONAL:
-                            break
-
-            def check_status():
-                status = nsmon.get(node_id).status
+            if devices is None:
+                enforce(len(target_nodes) > 0, 'No nodes found. Check CAN interface and crystal oscillator.')
+                devices = [Device(i + 1) for i in range(len(target_nodes))]
+                for d, (unique_id, node_id) in zip(devices, sorted(target_nodes.items(), key=lambda x: x[1])):
+                    d.unique_id = unique_id
+                    d.started_at = started_at       # The discovery is a part of the test time
+                if len(devices) != args.count:
+                    error('Expected %d nodes, found %d', args.count, len(devices))
+
+            for d in devices:
+                d.node_id = target_nodes.get(d.unique_id)
+                if d.node_id is None:
+                    d.fail('The node did not show up in time. Check CAN interface and crystal oscillator.')
+                else:
+                    info('%s initialized, unique ID %s', d, binascii.hexlify(d.unique_id).decode())
+
+            unexpected = set(target_nodes.values()) - set(d.node_id for d in devices)
+            if unexpected:
+                error('Ignoring unexpected nodes %r; are there other devices on the bus?', sorted(unexpected))
+
+            # Starting the nodes and checking their self-reported diag outputs
+            def is_operational(d):
+                return nsmon.exists(d.node_id) and \
+                    nsmon.get(d.node_id).status.mode == uavcan.protocol.NodeStatus().MODE_OPERATIONAL
+
+            def check_status(d):
+                status = nsmon.get(d.node_id).status
                 enforce(status.mode == uavcan.protocol.NodeStatus().MODE_OPERATIONAL,
                         'Unexpected operating mode')
                 enforce(status.health == uavcan.protocol.NodeStatus().HEALTH_OK,
                         'Bad node health')
 
-            info('Waiting for the node to complete initialization...')
-            wait_for_init()
-            check_status()
+            def check_all(check, *check_args):
+                for d in active():
+                    try:
+                        check(d, *check_args)
+                    except Exception as ex:
+                        logger.info('%s: check failed', d, exc_info=True)
+                        d.fail(str(ex) or repr(ex))
+
+            info('Waiting for the nodes to complete initialization...')
+            spin_until(lambda: all(map(is_operational, active())), NODE_INIT_TIMEOUT)
+            for d in active():
+                if not is_operational(d):
+                    d.fail('The node did not complete initialization in time')
+            check_all(check_status)
+
+            # The requests are sent to all nodes at once; the callback receives None on timeout
+            def request_all(make_request, description):
+                responses = {}
+                pending = active()
+                for d in pending:
+                    n.request(make_request(), d.node_id, partial(responses.__setitem__, d.index))
+                spin_until(lambda: len(responses) == len(pending), 10)
+                for d in pending:
+                    event = responses.get(d.index)
+                    if not event:
+                        d.fail('Request has timed out: %s' % description)
+                    responses[d.index] = event.response if event else None
+                return responses
 
             info('Resetting the configuration to factory defaults...')
-            enforce(request(uavcan.protocol.param.ExecuteOpcode.Request(
-                                opcode=uavcan.protocol.param.ExecuteOpcode.Request().OPCODE_ERASE)).ok,
-                    'The node refused to reset configuration to factory defaults')
+            responses = request_all(lambda: uavcan.protocol.param.ExecuteOpcode.Request(
+                                        opcode=uavcan.protocol.param.ExecuteOpcode.Request().OPCODE_ERASE),
+                                    'configuration reset')
+            for d in active():
+                if not responses[d.index].ok:
+                    d.fail('The node refused to reset configuration to factory defaults')
 
             col_esc_status = uavcan.app.message_collector.MessageCollector(n, uavcan.equipment.esc.Status, timeout=10)
 
-            def check_everything(check_rotation=False):
-                check_status()
+            def check_everything(d, check_rotation=False):
+                check_status(d)
 
                 try:
-                    m = col_esc_status[node_id].message
+                    m = col_esc_status[d.node_id].message
                 except KeyError:
                     abort('Rock is dead.')
                 else:
@@ -231,10 +373,16 @@ def test_uavcan():
                     enforce(TEMPERATURE_RANGE_DEGC[0] <= temp_degc <= TEMPERATURE_RANGE_DEGC[1],
                             'Invalid temperature: %r degC', temp_degc)
 
+            def get_rpm(d):
+                try:
+                    return col_esc_status[d.node_id].message.rpm
+                except KeyError:
+                    return 0
+
             # Testing before the motor is started
-            imperative('CAUTION: THE MOTOR WILL START IN 2 SECONDS, KEEP CLEAR')
+            imperative('CAUTION: THE MOTORS WILL START IN 2 SECONDS, KEEP CLEAR')
             safe_spin(2)
-            check_everything()
+            check_all(check_everything)
 
             # Starting the motor
             esc_raw_command_bitlen = \
@@ -244,40 +392,46 @@ def test_uavcan():
             def do_publish(duty_cycle, check_rotation):
                 command_value = int(duty_cycle * (2 ** (esc_raw_command_bitlen - 1)))
                 n.broadcast(uavcan.equipment.esc.RawCommand(cmd=[command_value]))
-                check_everything(check_rotation)
+                check_all(check_everything, check_rotation)
 
-            info('Starting the motor')
+            info('Starting the motors')
             publisher = n.periodic(0.01, partial(do_publish, STARTUP_DUTY_CYCLE, False))
-            safe_spin(5)
+            spin_until(lambda: all(get_rpm(d) > 100 for d in active()), MOTOR_START_TIMEOUT)
             publisher.remove()
 
             info('Checking stability...')
             for dc in STABILITY_TEST_DUTY_CYCLES:
                 info('Setting duty cycle %d%%...', int(dc * 100))
                 publisher = n.periodic(0.01, partial(do_publish, dc, True))
-                safe_spin(5)
+                safe_spin(STABILITY_TEST_DURATION)
                 publisher.remove()
 
             info('Stopping...')
-            latest_status = col_esc_status[node_id].message
-            safe_spin(1)
-            check_everything()
+            latest_status = {d.index: col_esc_status[d.node_id].message for d in active()}
+            spin_until(lambda: all(get_rpm(d) == 0 for d in active()), MOTOR_STOP_TIMEOUT)
+            for d in active():
+                if get_rpm(d) != 0:
+                    d.fail('The motor did not stop')
+            check_all(check_everything)
 
             # Final results
-            info('Validate the latest ESC status variables (units are SI):\n%s', uavcan.to_yaml(latest_status))
+            for d in active():
+                info('%s: validate the latest ESC status variables (units are SI):\n%s',
+                     d, uavcan.to_yaml(latest_status[d.index]))
 
             # Testing CAN2
             with BackgroundSpinner(safe_spin, 0.1):
-                input('1. Disconnect CAN1 and connect to CAN2\n'
+                input('1. Disconnect CAN1 and connect to CAN2 on every device\n'
                       '2. Terminate CAN2\n'
                       '3. Press ENTER')
 
-            safe_spin(1)
-            try:
-                check_status()
-            except Exception as ex:
-                logger.info('CAN2 test failed', exc_info=True)
-                abort('CAN2 test failed [%r]', ex)
+            reconnected_at = time.monotonic()
+            spin_until(lambda: all(status_timestamps.get(d.node_id, 0) > reconnected_at for d in active()),
+                       NODE_STATUS_TIMEOUT)
+            for d in active():
+                if status_timestamps.get(d.node_id, 0) <= reconnected_at:
+                    d.fail('CAN2 test failed: the node is not responding')
+            check_all(check_status)
 
             # Testing LED
             info('Testing LED')
@@ -286,12 +440,14 @@ def test_uavcan():
                 rgb = uavcan.equipment.indication.RGB565(red=0b11111, green=0b111111, blue=0b11111)
                 slc = uavcan.equipment.indication.SingleLightCommand(light_id=0, color=rgb)
                 n.broadcast(uavcan.equipment.indication.LightsCommand(commands=[slc]))
-                check_everything()
+                check_all(check_everything)
 
             publisher = n.periodic(0.1, set_led)
             with BackgroundSpinner(safe_spin, 0.1):
-                if not input('Is the LED glowing bright white?', yes_no=True, default_answer=True):
-                    abort('LED is not working properly')
+                if not input('Is the LED glowing bright white on every device?', yes_no=True, default_answer=True):
+                    # The command is broadcast, so the faulty device cannot be told apart
+                    for d in active():
+                        d.fail('LED is not working properly on some of the devices; retest them one by one')
             publisher.remove()
 
         except Exception:
@@ -299,6 +455,8 @@ def test_uavcan():
                 logger.info('UAVCAN test failed; last known state of the device node: %r' % nsmon.get(nid))
             raise
 
+    return devices
+
 
 def read_zubax_id(cli):
     zubax_id_lines = cli.write_line_and_read_output_lines_until_timeout('zubax_id')
@@ -315,15 +473,19 @@ def read_zubax_id(cli):
 def init_can_iface():
     if '/' not in args.iface:
         logger.debug('Using iface %r as SocketCAN', args.iface)
-        execute_shell_command('ifconfig %s down && ip link set %s up type can bitrate %d sample-point 0.875',
-                              args.iface, args.iface, CAN_BITRATE)
+        if args.iface.startswith('vcan'):
+            execute_shell_command('ip link set %s up', args.iface)
+        else:
+            execute_shell_command('ifconfig %s down && ip link set %s up type can bitrate %d sample-point 0.875',
+                                  args.iface, args.iface, CAN_BITRATE)
         return args.iface
     else:
         logger.debug('Using iface %r as SLCAN', args.iface)
 
         # We don't want the SLCAN daemon to interfere...
         execute_shell_command('killall -INT slcand &> /dev/null', ignore_failure=True)
-        time.sleep(1)
+        poll_until(lambda: subprocess.call(['pgrep', '-x', 'slcand'], stdout=subprocess.DEVNULL) != 0,
+                   SLCAN_DAEMON_EXIT_TIMEOUT)
 
         # Making sure the interface can be open
         with open(args.iface, 'bw') as _f:
@@ -335,9 +497,9 @@ def init_can_iface():
 def check_interfaces():
     ok = True
 
-    def test_serial_port(glob, name):
+    def test_serial_port(port, name):
         try:
-            with open_serial_port(glob):
+            with open_serial_port(port):
                 info('%s port is OK', name)
                 return True
         except Exception:
@@ -345,8 +507,14 @@ def check_interfaces():
             return False
 
     info('Checking interfaces...')
-    ok = test_serial_port(DEBUGGER_PORT_GDB_GLOB, 'GDB') and ok
-    ok = test_serial_port(DEBUGGER_PORT_CLI_GLOB, 'CLI') and ok
+    if not args.uavcan_only:
+        try:
+            for gdb_port, cli_port in find_debug_probes():
+                ok = test_serial_port(gdb_port, 'GDB ' + gdb_port) and ok
+                ok = test_serial_port(cli_port, 'CLI ' + cli_port) and ok
+        except Exception as ex:
+            error('%s', ex)
+            ok = False
     try:
         init_can_iface()
         info('CAN interface is OK')
@@ -360,8 +528,37 @@ def check_interfaces():
               'If this application is running on a virtual machine, make sure that hardware '
               'sharing is configured correctly.')
 
+
+def report(devices, started_at):
+    """Logs the outcome and the test time of every device; a failure of any device fails the batch."""
+    elapsed = time.monotonic() - started_at
+    for d in devices:
+        d.finish()
+        info('%s %s: %s in %.1f s', d, binascii.hexlify(d.unique_id or b'').decode(),
+             'OK' if d.ok else 'FAILED (%s)' % d.failure, d.finished_at - d.started_at)
+    info('%d devices tested in %.1f s, %.1f s per device', len(devices), elapsed, elapsed / max(len(devices), 1))
+
+    failed = [d for d in devices if not d.ok]
+    if failed:
+        abort('%d of %d devices failed: %s', len(failed), len(devices),
+              ', '.join('%s: %s' % (d, d.failure) for d in failed))
+
+
+enforce(1 <= args.count <= MAX_DEVICES, 'The number of devices must be in [1, %d]', MAX_DEVICES)
+
 check_interfaces()
 
+if args.uavcan_only:
+    while True:
+        input('Connect %d programmed devices with motors WITHOUT ANY LOAD ATTACHED, then press ENTER.\n'
+              'CAUTION: THE MOTORS WILL SPIN' % args.count)
+        started_at = time.monotonic()
+        try:
+            report(test_uavcan(None), started_at)
+        except Exception as ex:
+            logger.info('UAVCAN test failed', exc_info=True)
+            error('%s', ex)
+
 licensing_api = make_api_context_with_user_provided_credentials()
 
 with CLIWaitCursor():
@@ -373,72 +570,109 @@ with CLIWaitCursor():
     assert 30 < (len(firmware_data) / 1024) <= 240, 'Invalid firmware size'
 
 
-def process_one_device(set_device_info):
-    out = input('1. Connect DroneCode Probe to the debug connector.\n'
-                '2. Connect CAN to the first CAN1 connector on the device; terminate the other CAN1 connector.\n'
+def process_devices(set_device_info):
+    out = input('1. Connect a DroneCode Probe to the debug connector of every device (%d in total).\n'
+                '2. Connect all devices to the same CAN bus via their CAN1 connectors; terminate both ends.\n'
                 '4. Connect an appropriate power supply (see the hardware specs for requirements).\n'
                 '   Make sure the motor leads are NOT CONNECTED to anything.\n'
                 '5. If you want to skip firmware upload, type F.\n'
-                '6. Press ENTER.')
+                '6. Press ENTER.' % args.count)
+
+    started_at = time.monotonic()
+    devices = [Device(i + 1, gdb, cli) for i, (gdb, cli) in enumerate(find_debug_probes())]
 
     skip_fw_upload = 'f' in out.lower()
     if not skip_fw_upload:
         info('Loading the firmware')
-        with CLIWaitCursor():
+
+        def load(d):
             load_firmware_via_gdb(firmware_data,
                                   toolchain_prefix=TOOLCHAIN_PREFIX,
                                   load_offset=FLASH_OFFSET,
-                                  gdb_port=glob_one(DEBUGGER_PORT_GDB_GLOB),
+                                  gdb_port=d.gdb_port,
                                   gdb_monitor_scan_command='swdp_scan')
-    else:
-        info('Firmware upload skipped, rebooting the device')
-        with open_serial_port(DEBUGGER_PORT_CLI_GLOB) as io:
-            SerialCLI(io, 0.1).write_line_and_read_output_lines_until_timeout('reboot')
 
-    info('Waiting for the device to boot...')
-    wait_for_boot()
-
-    with open_serial_port(DEBUGGER_PORT_CLI_GLOB) as io:
-        info('Identifying the connected device...')
-        cli = SerialCLI(io, 0.1)
-        cli.flush_input(0.5)
+        with CLIWaitCursor():
+            for_each_device(devices, load)
+    else:
+        info('Firmware upload skipped, rebooting the devices')
+
+        def reboot(d):
+            with open_serial_port(d.cli_port) as io:
+                SerialCLI(io, 0.1).write_line_and_read_output_lines_until_timeout('reboot')
+
+        for_each_device(devices, reboot)
+
+    info('Waiting for the devices to boot...')
+    for_each_device(devices, wait_for_boot)
+
+    with ExitStack() as ports:
+        for d in devices:
+            if d.ok:
+                d.io = ports.enter_context(open_serial_port(d.cli_port))
+                d.cli = SerialCLI(d.io, 0.1)
+
+        def identify(d):
+            d.cli.flush_input(0.5)
+            zubax_id = read_zubax_id(d.cli)
+            d.unique_id = b64decode(zubax_id['hw_unique_id'])
+            d.product_id = zubax_id['product_id']
+
+        info('Identifying the connected devices...')
+        for_each_device(devices, identify)
+        for d in devices:
+            if d.ok:
+                set_device_info(d.product_id, d.unique_id)
+
+        with ExitStack() as listeners:
+            for d in devices:
+                if d.ok:
+                    listeners.enter_context(BackgroundCLIListener(d.io, partial(cli_logger.info, '%s: %r', d)))
+            input('Connect a motor WITHOUT ANY LOAD ATTACHED to every ESC, then press ENTER.\n'
+                  'CAUTION: THE MOTORS WILL SPIN')
+            test_uavcan(devices)
+
+        # Signing is fast, and the licensing API is not meant to be used from several threads
+        for d in devices:
+            if d.ok:
+                try:
+                    sign(d)
+                    d.finish()
+                except Exception as ex:
+                    logger.info('%s: signing failed', d, exc_info=True)
+                    d.fail(str(ex) or repr(ex))
 
-        zubax_id = read_zubax_id(cli)
-        unique_id = b64decode(zubax_id['hw_unique_id'])
-        product_id = zubax_id['product_id']
-        set_device_info(product_id, unique_id)
+    report(devices, started_at)
 
-        with BackgroundCLIListener(io, lambda line: cli_logger.info(repr(line))):
-            input('Connect a motor WITHOUT ANY LOAD ATTACHED to the ESC, then press ENTER.\n'
-                  'CAUTION: THE MOTOR WILL SPIN')
-            test_uavcan()
 
-        try:
-            # Using first command to get rid of any garbage lingering in the buffers
-            cli.write_line_and_read_output_lines_until_timeout('systime')
-        except Exception:
-            pass
+def sign(device):
+    cli = device.cli
+    try:
+        # Using first command to get rid of any garbage lingering in the buffers
+        cli.write_line_and_read_output_lines_until_timeout('systime')
+    except Exception:
+        pass
 
-        # Getting the signature
-        info('Requesting signature for unique ID %s', binascii.hexlify(unique_id).decode())
-        gensign_response = licensing_api.generate_signature(unique_id, PRODUCT_NAME)
-        if gensign_response.new:
-            info('New signature has been generated')
-        else:
-            info('This particular device has been signed earlier, reusing existing signature')
-        base64_signature = b64encode(gensign_response.signature).decode()
-        logger.info('Generated signature in Base64: %s', base64_signature)
+    # Getting the signature
+    info('%s: requesting signature for unique ID %s', device, binascii.hexlify(device.unique_id).decode())
+    gensign_response = licensing_api.generate_signature(device.unique_id, PRODUCT_NAME)
+    if gensign_response.new:
+        info('New signature has been generated')
+    else:
+        info('This particular device has been signed earlier, reusing existing signature')
+    base64_signature = b64encode(gensign_response.signature).decode()
+    logger.info('Generated signature in Base64: %s', base64_signature)
 
-        # Installing the signature; this may fail if the device has been signed earlier - the failure will be ignored
-        out = cli.write_line_and_read_output_lines_until_timeout('zubax_id %s', base64_signature)
-        logger.debug('Signature installation response (may fail, which is OK): %r', out)
+    # Installing the signature; this may fail if the device has been signed earlier - the failure will be ignored
+    out = cli.write_line_and_read_output_lines_until_timeout('zubax_id %s', base64_signature)
+    logger.debug('Signature installation response (may fail, which is OK): %r', out)
 
-        # Reading the signature back and verifying it
-        installed_signature = read_zubax_id(cli)['hw_signature']
-        logger.info('Installed signature in Base64: %s', installed_signature)
-        enforce(b64decode(installed_signature) == gensign_response.signature,
-                'Written signature does not match the generated signature')
+    # Reading the signature back and verifying it
+    installed_signature = read_zubax_id(cli)['hw_signature']
+    logger.info('Installed signature in Base64: %s', installed_signature)
+    enforce(b64decode(installed_signature) == gensign_response.signature,
+            'Written signature does not match the generated signature')
 
-        info('Signature has been installed and verified')
+    info('%s: signature has been installed and verified', device)
 
-run(licensing_api, process_one_device)
+run(licensing_api, process_devices)
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Simulates several Sapog ESC nodes on a CAN interface, to validate the UAVCAN part of the production test
+without hardware. The nodes report the status, accept the configuration reset, and "spin" the motor according
+to the RawCommand addressed to their ESC index. Faults can be injected to check that a failure of one device
+doesn't affect the others.
+
+Example:
+  sudo ip link add dev vcan0 type vcan && sudo ip link set vcan0 up
+  ./simulate_nodes.py vcan0 --count 4 --no-start 2
+  sudo ./drwatson_sapog.py vcan0 --count 4 --uavcan-only
+"""
+
+import os
+import sys
+sys.path.insert(1, os.path.join(sys.path[0], 'pyuavcan'))
+
+import argparse
+import time
+import uavcan
+
+PRODUCT_NAME = 'io.px4.sapog'
+STATUS_PERIOD = 0.1
+COMMAND_TTL = 0.3
+MAX_RPM = 12000
+TEMPERATURE_KELVIN = 300.0
+
+
+class SimulatedESC:
+    def __init__(self, iface, index, node_id, can_start):
+        self.can_start = can_start
+        self.duty_cycle = 0.0
+        self.command_timestamp = 0.0
+
+        node_info = uavcan.protocol.GetNodeInfo.Response()
+        node_info.name = PRODUCT_NAME
+        node_info.hardware_version.unique_id.from_bytes(bytes([index] * 16))
+
+        self.node = uavcan.make_node(iface, node_id=node_id, node_info=node_info,
+                                     mode=uavcan.protocol.NodeStatus().MODE_OPERATIONAL)
+        self.node.add_handler(uavcan.equipment.esc.RawCommand, self._on_raw_command)
+        self.node.add_handler(uavcan.protocol.param.ExecuteOpcode,
+                              lambda e: uavcan.protocol.param.ExecuteOpcode.Response(ok=True))
+        self.node.periodic(STATUS_PERIOD, self._publish_status)
+
+    def _on_raw_command(self, e):
+        # All simulated nodes have the default ESC index 0, like the devices after the configuration reset
+        if len(e.message.cmd) > 0:
+            self.duty_cycle = max(e.message.cmd[0], 0) / 8191
+            self.command_timestamp = time.monotonic()
+
+    def _publish_status(self):
+        if time.monotonic() - self.command_timestamp > COMMAND_TTL:
+            self.duty_cycle = 0.0
+        spinning = self.can_start and self.duty_cycle > 0
+        self.node.broadcast(uavcan.equipment.esc.Status(
+            error_count=0,
+            voltage=16.0,
+            current=(0.5 + 10 * self.duty_cycle) if spinning else 0.0,
+            temperature=TEMPERATURE_KELVIN,
+            rpm=int(max(self.duty_cycle * MAX_RPM, 500)) if spinning else 0,
+            power_rating_pct=int(self.duty_cycle * 100) + 1 if spinning else 0,
+            esc_index=0))
+
+    def spin(self):
+        self.node.spin(0)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('iface', help='CAN interface, e.g. "vcan0"')
+    parser.add_argument('--count', '-n', type=int, default=2, help='number of simulated nodes (default 2)')
+    parser.add_argument('--first-node-id', type=int, default=100, help='node ID of the first node (default 100)')
+    parser.add_argument('--no-start', type=int, action='append', default=[],
+                        help='1-based number of the node which motor will not start; can be repeated')
+    args = parser.parse_args()
+
+    escs = [SimulatedESC(args.iface, i + 1, args.first_node_id + i, (i + 1) not in args.no_start)
+            for i in range(args.count)]
+    print('Simulating %d nodes with IDs %d..%d' % (args.count, args.first_node_id, args.first_node_id + args.count - 1))
+
+    try:
+        while True:
+            for esc in escs:
+                esc.spin()
+            time.sleep(0.001)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,112 @@
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Stand-in of the DrWatson framework for the host test of the UAVCAN only mode of drwatson_sapog.py.
+The operator prompts are answered by the test through answer_input; the messages are recorded in the log.
+Everything related to the debug probes, the firmware and the licensing server is unavailable.
+"""
+
+import argparse
+import threading
+
+log = []                    # (level, message)
+answer_input = None         # Callable(prompt, yes_no) returning the answer
+
+
+class AbortException(Exception):
+    pass
+
+
+def _record(level, fmt, *args):
+    message = fmt % args if args else fmt
+    log.append((level, message))
+    print('%-10s %s' % (level, message), flush=True)
+
+
+def info(fmt, *args):
+    _record('INFO', fmt, *args)
+
+
+def error(fmt, *args):
+    _record('ERROR', fmt, *args)
+
+
+def imperative(fmt, *args):
+    _record('IMPERATIVE', fmt, *args)
+
+
+def abort(fmt, *args):
+    raise AbortException(fmt % args if args else fmt)
+
+
+def fatal(fmt, *args, use_abort=False):
+    raise SystemExit(fmt % args if args else fmt)
+
+
+def enforce(condition, fmt, *args):
+    if not condition:
+        abort(fmt, *args)
+
+
+def input(prompt, yes_no=False, default_answer=False):
+    _record('INPUT', prompt)
+    return answer_input(prompt, yes_no)
+
+
+def init(description, *arg_initializers, require_root=False):
+    parser = argparse.ArgumentParser(description=description)
+    for initializer in arg_initializers:
+        initializer(parser)
+    return parser.parse_args()
+
+
+def execute_shell_command(fmt, *args, ignore_failure=False):
+    _record('SHELL', fmt, *args)
+
+
+def convert_units_from_to(value, from_unit, to_unit):
+    assert (from_unit, to_unit) == ('Kelvin', 'Celsius')
+    return value - 273.15
+
+
+class BackgroundSpinner:
+    """Invokes the function in a background thread while the operator is being prompted"""
+    def __init__(self, function, *args):
+        self._function = function
+        self._args = args
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+
+    def _run(self):
+        while not self._stop.is_set():
+            self._function(*self._args)
+
+    def __enter__(self):
+        self._thread.start()
+        return self
+
+    def __exit__(self, *_):
+        self._stop.set()
+        self._thread.join()
+
+
+def _unavailable(*_args, **_kwargs):
+    raise NotImplementedError('Not available in the host test')
+
+
+run = make_api_context_with_user_provided_credentials = download = download_newest = open_serial_port = \
+    load_firmware_via_gdb = _unavailable
+CLIWaitCursor = SerialCLI = BackgroundDelay = BackgroundCLIListener = _unavailable
@@ -0,0 +1,376 @@
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Stand-in of the subset of pyuavcan (v0) that drwatson_sapog.py and simulate_nodes.py use, for the host test when
+the pyuavcan submodule is not available. The nodes exchange the transfers via the virtual CAN buses of python-can,
+which connect the bus instances of the same channel within one process.
+
+Every transfer is one oversized CAN frame: the CAN ID has the UAVCAN v0 layout (priority, data type ID,
+source node ID, service request/response and destination), but the payload is pickled instead of being serialized
+by DSDL, and it is not split into 8 byte frames. The data types only have the fields used by the scripts.
+"""
+
+import time
+import pickle
+from types import SimpleNamespace
+
+import can
+
+DEFAULT_PRIORITY = 16
+NODE_STATUS_PERIOD = 1.0            # MAX_BROADCASTING_PERIOD_MS of NodeStatus
+SERVICE_TIMEOUT = 1.0               # Default service timeout of pyuavcan
+NODE_OFFLINE_TIMEOUT = 3.0          # OFFLINE_TIMEOUT_MS of NodeStatus
+GET_NODE_INFO_RETRY_PERIOD = 1.0
+
+
+class UAVCANException(Exception):
+    pass
+
+
+class _Array(list):
+    def __init__(self, bitlen, values=()):
+        super().__init__(values)
+        self.bitlen = bitlen
+
+
+class _UniqueID:
+    def __init__(self):
+        self._value = bytes(16)
+
+    def from_bytes(self, value):
+        self._value = bytes(value)
+
+    def to_bytes(self):
+        return self._value
+
+
+class _Compound:
+    """Fields are {name: default factory}; unknown fields are rejected, like in pyuavcan"""
+    DATA_TYPE_ID = None
+    FIELDS = {}
+
+    def __init__(self, **kwargs):
+        for name, factory in self.FIELDS.items():
+            object.__setattr__(self, name, factory())
+        for name, value in kwargs.items():
+            setattr(self, name, value)
+
+    def __setattr__(self, name, value):
+        if name not in self.FIELDS:
+            raise AttributeError('No field %r in %s' % (name, type(self).__name__))
+        current = getattr(self, name)
+        if isinstance(current, _Array):
+            value = _Array(current.bitlen, value)
+        elif isinstance(current, bytes) and isinstance(value, str):
+            value = value.encode()
+        object.__setattr__(self, name, value)
+
+    def __repr__(self):
+        return '%s(%s)' % (type(self).__name__, ', '.join('%s=%r' % (k, getattr(self, k)) for k in self.FIELDS))
+
+
+class NodeStatus(_Compound):
+    DATA_TYPE_ID = 341
+    HEALTH_OK = 0
+    MODE_OPERATIONAL = 0
+    MODE_INITIALIZATION = 1
+    FIELDS = {'uptime_sec': int, 'health': int, 'mode': int, 'sub_mode': int, 'vendor_specific_status_code': int}
+
+
+class HardwareVersion(_Compound):
+    FIELDS = {'major': int, 'minor': int, 'unique_id': _UniqueID}
+
+
+class GetNodeInfo:
+    DATA_TYPE_ID = 1
+
+    class Request(_Compound):
+        FIELDS = {}
+
+    class Response(_Compound):
+        FIELDS = {'status': NodeStatus, 'hardware_version': HardwareVersion, 'name': bytes}
+
+
+class ExecuteOpcode:
+    DATA_TYPE_ID = 10
+
+    class Request(_Compound):
+        OPCODE_SAVE = 0
+        OPCODE_ERASE = 1
+        FIELDS = {'opcode': int, 'argument': int}
+
+    class Response(_Compound):
+        FIELDS = {'argument': int, 'ok': bool}
+
+
+class RawCommand(_Compound):
+    DATA_TYPE_ID = 1030
+    FIELDS = {'cmd': lambda: _Array(14)}
+
+
+class Status(_Compound):
+    DATA_TYPE_ID = 1034
+    FIELDS = {'error_count': int, 'voltage': float, 'current': float, 'temperature': float, 'rpm': int,
+              'power_rating_pct': int, 'esc_index': int}
+
+
+class RGB565(_Compound):
+    FIELDS = {'red': int, 'green': int, 'blue': int}
+
+
+class SingleLightCommand(_Compound):
+    FIELDS = {'light_id': int, 'color': RGB565}
+
+
+class LightsCommand(_Compound):
+    DATA_TYPE_ID = 1081
+    FIELDS = {'commands': lambda: _Array(0)}
+
+
+def _get_service_type(payload):
+    for t in (GetNodeInfo, ExecuteOpcode):
+        if isinstance(payload, (t.Request, t.Response)):
+            return t
+    return None
+
+
+def get_fields(obj):
+    return {k: getattr(obj, k) for k in obj.FIELDS}
+
+
+def get_uavcan_data_type(value):
+    return SimpleNamespace(value_type=SimpleNamespace(bitlen=value.bitlen))
+
+
+def to_yaml(obj):
+    return '\n'.join('%s: %r' % (k, v) for k, v in get_fields(obj).items())
+
+
+class _Handle:
+    def __init__(self, collection, item):
+        self._collection = collection
+        self._item = item
+
+    def remove(self):
+        if self._item in self._collection:
+            self._collection.remove(self._item)
+
+
+class Node:
+    """
+    Transfers are dispatched and the timers are invoked only from spin(), like in pyuavcan; the NodeStatus of the
+    node is broadcast every NODE_STATUS_PERIOD, and GetNodeInfo requests are served automatically.
+    """
+    def __init__(self, iface, node_id, node_info, mode):
+        self._bus = can.Bus(interface='virtual', channel=iface)
+        self.node_id = node_id
+        self.node_info = node_info
+        self.mode = mode
+        self._started_at = time.monotonic()
+        self._handlers = []             # [data type, callback]
+        self._timers = []               # [next time, period, callback]
+        self._pending = {}              # (server node ID, transfer ID): [deadline, callback]
+        self._transfer_ids = {}
+        self.periodic(NODE_STATUS_PERIOD, self._send_node_status)
+        self.add_handler(GetNodeInfo, self._on_get_node_info)
+
+    def close(self):
+        self._bus.shutdown()
+
+    def add_handler(self, data_type, callback):
+        item = [data_type, callback]
+        self._handlers.append(item)
+        return _Handle(self._handlers, item)
+
+    def periodic(self, period, callback):
+        item = [time.monotonic() + period, period, callback]
+        self._timers.append(item)
+        return _Handle(self._timers, item)
+
+    def _make_status(self):
+        return NodeStatus(uptime_sec=int(time.monotonic() - self._started_at), mode=self.mode)
+
+    def _send_node_status(self):
+        self.broadcast(self._make_status())
+
+    def _on_get_node_info(self, _event):
+        self.node_info.status = self._make_status()
+        return self.node_info
+
+    def _send(self, data_type_id, service, destination, transfer_id, payload):
+        if service is None:
+            can_id = (DEFAULT_PRIORITY << 24) | (data_type_id << 8) | self.node_id
+        else:
+            can_id = (DEFAULT_PRIORITY << 24) | ((data_type_id & 0xFF) << 16) | (service << 15) | \
+                (destination << 8) | 0x80 | self.node_id
+        data = pickle.dumps((transfer_id, payload))
+        self._bus.send(can.Message(arbitration_id=can_id, is_extended_id=True, data=data))
+
+    def _next_transfer_id(self, key):
+        tid = self._transfer_ids.get(key, 0)
+        self._transfer_ids[key] = (tid + 1) % 32
+        return tid
+
+    def broadcast(self, payload):
+        self._send(payload.DATA_TYPE_ID, None, None, self._next_transfer_id(type(payload)), payload)
+
+    def request(self, payload, destination, callback, timeout=SERVICE_TIMEOUT):
+        data_type = _get_service_type(payload)
+        tid = self._next_transfer_id((data_type, destination))
+        self._pending[(destination, tid)] = [time.monotonic() + timeout, callback]
+        self._send(data_type.DATA_TYPE_ID, 1, destination, tid, payload)
+
+    def _dispatch(self, msg):
+        can_id = msg.arbitration_id
+        source = can_id & 0x7F
+        tid, payload = pickle.loads(bytes(msg.data))
+        transfer = SimpleNamespace(source_node_id=source, transfer_id=tid, ts_monotonic=time.monotonic())
+        if not can_id & 0x80:
+            event = SimpleNamespace(message=payload, transfer=transfer, node=self)
+            for data_type, callback in list(self._handlers):
+                if isinstance(payload, data_type):
+                    callback(event)
+            return
+
+        if (can_id >> 8) & 0x7F != self.node_id:
+            return
+        if can_id & (1 << 15):
+            data_type = _get_service_type(payload)
+            event = SimpleNamespace(request=payload, transfer=transfer, node=self)
+            for t, callback in list(self._handlers):
+                if t is data_type:
+                    response = callback(event)
+                    if response is not None:
+                        self._send(data_type.DATA_TYPE_ID, 0, source, tid, response)
+        else:
+            pending = self._pending.pop((source, tid), None)
+            if pending:
+                pending[1](SimpleNamespace(response=payload, transfer=transfer))
+
+    def _run_timers(self):
+        now = time.monotonic()
+        for item in list(self._timers):
+            if item in self._timers and now >= item[0]:
+                item[0] = max(item[0] + item[1], now)
+                item[2]()
+        for key, (deadline, callback) in list(self._pending.items()):
+            if now >= deadline:
+                del self._pending[key]
+                callback(None)
+
+    def spin(self, timeout=None):
+        deadline = time.monotonic() + (timeout if timeout is not None else float('inf'))
+        while True:
+            msg = self._bus.recv(timeout=0)
+            while msg is not None:
+                self._dispatch(msg)
+                msg = self._bus.recv(timeout=0)
+            self._run_timers()
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return
+            msg = self._bus.recv(timeout=min(remaining, 0.001))
+            if msg is not None:
+                self._dispatch(msg)
+
+
+def make_node(iface, node_id=None, node_info=None, mode=NodeStatus.MODE_OPERATIONAL, bitrate=None):
+    return Node(iface, node_id, node_info or GetNodeInfo.Response(), mode)
+
+
+class NodeMonitor:
+    """Requests GetNodeInfo from every node that shows up; the nodes are removed when their NodeStatus stops"""
+    class Entry:
+        def __init__(self, node_id):
+            self.node_id = node_id
+            self.status = None
+            self.info = None
+            self.monotonic_timestamp = None
+            self.info_requested_at = None
+
+        def __repr__(self):
+            return 'Entry(node_id=%r, status=%r, info=%r)' % (self.node_id, self.status, self.info)
+
+    def __init__(self, node):
+        self._node = node
+        self._entries = {}
+        node.add_handler(NodeStatus, self._on_node_status)
+
+    def _on_node_status(self, e):
+        entry = self._entries.setdefault(e.transfer.source_node_id, NodeMonitor.Entry(e.transfer.source_node_id))
+        entry.status = e.message
+        entry.monotonic_timestamp = e.transfer.ts_monotonic
+        now = time.monotonic()
+        if entry.info is None and (entry.info_requested_at is None or
+                                   now - entry.info_requested_at > GET_NODE_INFO_RETRY_PERIOD):
+            entry.info_requested_at = now
+
+            def on_response(event):
+                if event:
+                    entry.info = event.response
+
+            self._node.request(GetNodeInfo.Request(), entry.node_id, on_response)
+
+    def _expire(self):
+        now = time.monotonic()
+        for node_id in [k for k, v in self._entries.items() if now - v.monotonic_timestamp > NODE_OFFLINE_TIMEOUT]:
+            del self._entries[node_id]
+
+    def find_all(self, predicate):
+        self._expire()
+        return [e for e in self._entries.values() if predicate(e)]
+
+    def exists(self, node_id):
+        self._expire()
+        return node_id in self._entries
+
+    def get(self, node_id):
+        self._expire()
+        return self._entries[node_id]
+
+    def get_all_node_id(self):
+        self._expire()
+        return list(self._entries)
+
+
+class CentralizedServer:
+    """The simulated nodes have static node IDs, so there is nothing to allocate"""
+    def __init__(self, node, node_monitor):
+        pass
+
+
+class MessageCollector:
+    """The latest message per source node ID; KeyError if there was none within the timeout"""
+    def __init__(self, node, data_type, timeout):
+        self._timeout = timeout
+        self._events = {}
+        node.add_handler(data_type, lambda e: self._events.__setitem__(e.transfer.source_node_id, e))
+
+    def __getitem__(self, node_id):
+        event = self._events[node_id]
+        if time.monotonic() - event.transfer.ts_monotonic > self._timeout:
+            raise KeyError(node_id)
+        return event
+
+
+protocol = SimpleNamespace(NodeStatus=NodeStatus, GetNodeInfo=GetNodeInfo,
+                           param=SimpleNamespace(ExecuteOpcode=ExecuteOpcode))
+equipment = SimpleNamespace(esc=SimpleNamespace(RawCommand=RawCommand, Status=Status),
+                            indication=SimpleNamespace(RGB565=RGB565, SingleLightCommand=SingleLightCommand,
+                                                       LightsCommand=LightsCommand))
+app = SimpleNamespace(node_monitor=SimpleNamespace(NodeMonitor=NodeMonitor),
+                      dynamic_node_id=SimpleNamespace(CentralizedServer=CentralizedServer),
+                      message_collector=SimpleNamespace(MessageCollector=MessageCollector))
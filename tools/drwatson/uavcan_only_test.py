@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Host test of the UAVCAN only mode of drwatson_sapog.py against the nodes of simulate_nodes.py.
+
+Both scripts run unmodified in this process, on a virtual CAN bus of python-can. The DrWatson framework and pyuavcan
+are replaced with the stand-ins from standins/, see there for what they do and don't model. The operator prompts are
+answered immediately, so the reported times are the time of the automated part of the UAVCAN test only: they don't
+include flashing, booting, identification, signing, and the operator.
+
+For every scenario, one batch is tested; the outcome of every device and the time per device are checked and
+printed. The exit code is non-zero if any scenario fails.
+
+Examples:
+  ./uavcan_only_test.py
+  ./uavcan_only_test.py fault
+"""
+
+import os
+import re
+import sys
+import time
+import runpy
+import argparse
+import threading
+import importlib.util
+
+DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(DIR, 'standins'))
+
+import drwatson
+
+IFACE = 'vcan0'
+FIRST_NODE_ID = 100
+
+# Name, number of devices, simulated nodes which motor will not start, expected failures {device: message}
+SCENARIOS = [
+    ('single', 1, [], {}),
+    ('batch4', 4, [], {}),
+    ('batch8', 8, [], {}),
+    ('fault', 4, [2], {2: 'Could not start the motor'}),
+]
+
+
+class BatchDone(BaseException):
+    """Ends the endless loop of the UAVCAN only mode; BaseException is not caught by the loop"""
+    pass
+
+
+def load_simulator():
+    spec = importlib.util.spec_from_file_location('simulate_nodes', os.path.join(DIR, 'simulate_nodes.py'))
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def run_scenario(simulator, count, no_start):
+    escs = [simulator.SimulatedESC(IFACE, i + 1, FIRST_NODE_ID + i, (i + 1) not in no_start) for i in range(count)]
+    stop = threading.Event()
+
+    def spin_escs():
+        while not stop.is_set():
+            for esc in escs:
+                esc.spin()
+            time.sleep(0.001)
+
+    batches = []
+
+    def answer_input(prompt, _yes_no):
+        if prompt.startswith('Connect'):
+            if batches:
+                raise BatchDone()
+            batches.append(time.monotonic())
+        return True if _yes_no else ''
+
+    del drwatson.log[:]
+    drwatson.answer_input = answer_input
+    sys.argv = ['drwatson_sapog.py', IFACE, '--count', str(count), '--uavcan-only']
+    thread = threading.Thread(target=spin_escs, daemon=True)
+    thread.start()
+    try:
+        runpy.run_path(os.path.join(DIR, 'drwatson_sapog.py'), run_name='__main__')
+    except BatchDone:
+        pass
+    finally:
+        stop.set()
+        thread.join()
+        for esc in escs:
+            esc.node.close()
+
+    # Outcomes and times from the report of the batch
+    outcomes = {}
+    per_device = None
+    for _, message in drwatson.log:
+        m = re.match(r'Device (\d+) \(node \d+\) [0-9a-f]*: (OK|FAILED \((.*)\)) in ([\d.]+) s$', message)
+        if m:
+            outcomes[int(m.group(1))] = (m.group(3), float(m.group(4)))
+        m = re.match(r'\d+ devices tested in ([\d.]+) s, ([\d.]+) s per device$', message)
+        if m:
+            per_device = float(m.group(1)), float(m.group(2))
+    return outcomes, per_device
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('prefix', nargs='?', default='', help='run only the scenarios whose names start with this')
+    args = parser.parse_args()
+
+    simulator = load_simulator()
+    scenarios = [s for s in SCENARIOS if s[0].startswith(args.prefix)]
+    results = []
+    for name, count, no_start, expected in scenarios:
+        outcomes, per_device = run_scenario(simulator, count, no_start)
+        errors = []
+        if per_device is None:
+            errors.append('the batch was not reported')
+        if sorted(outcomes) != list(range(1, count + 1)):
+            errors.append('reported devices %r' % sorted(outcomes))
+        for index, (failure, _) in sorted(outcomes.items()):
+            if (failure is None) != (index not in expected) or (failure and expected[index] not in failure):
+                errors.append('device %d: %s, expected %s' % (index, failure or 'OK', expected.get(index, 'OK')))
+        results.append((name, count, outcomes, per_device, errors))
+
+    for name, count, outcomes, per_device, errors in results:
+        batch, unit = per_device or (0, 0)
+        print('%-8s %-4s devices=%d failed=%d batch=%.1fs per_device=%.1fs device_times=%s' %
+              (name, 'FAIL' if errors else 'OK', count, sum(1 for f, _ in outcomes.values() if f), batch, unit,
+               ','.join('%.1f' % t for _, t in (outcomes[k] for k in sorted(outcomes)))))
+        for e in errors:
+            print('    ' + e)
+
+    num_failed = sum(1 for r in results if r[4])
+    print('%d of %d scenarios failed' % (num_failed, len(results)))
+    return 1 if num_failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Generates a binary patch that converts one firmware image into another.
+The patch can be served to the node instead of the full image via the standard UAVCAN firmware update protocol;
+the application detects the patch by its signature and reconstructs the new image in the staging area.
+The patch is only applicable to the exact base image it was generated against; this is verified by the node
+using the image CRC from the application descriptor.
+"""
+
+import argparse
+import struct
+import sys
+
+PATCH_SIGNATURE = b'SPDelta0'
+APP_DESCRIPTOR_SIGNATURE = b'APDesc00'
+
+OPCODE_END = 0
+OPCODE_COPY = 1
+OPCODE_INSERT = 2
+
+BLOCK_SIZE = 16
+MIN_COPY_SIZE = 12          # Shorter matches are cheaper to insert than to copy
+
+
+def read_image_crc(image):
+    pos = image.find(APP_DESCRIPTOR_SIGNATURE)
+    if pos < 0:
+        raise ValueError('The base image does not contain the application descriptor')
+    crc, = struct.unpack_from('<Q', image, pos + len(APP_DESCRIPTOR_SIGNATURE))
+    if crc == 0:
+        raise ValueError('The image CRC is not set; use the post-processed binary')
+    return crc
+
+
+def index_blocks(base):
+    index = {}
+    for offset in range(0, len(base) - BLOCK_SIZE + 1):
+        index.setdefault(base[offset:offset + BLOCK_SIZE], offset)
+    return index
+
+
+def find_match(base, index, target, pos):
+    base_offset = index.get(target[pos:pos + BLOCK_SIZE])
+    if base_offset is None:
+        return None, 0
+    length = BLOCK_SIZE
+    while (pos + length < len(target)) and (base_offset + length < len(base)) and \
+            (target[pos + length] == base[base_offset + length]):
+        length += 1
+    return base_offset, length
+
+
+def make_delta(base, target):
+    out = bytearray(PATCH_SIGNATURE)
+    out += struct.pack('<QI', read_image_crc(base), len(target))
+
+    index = index_blocks(base)
+    literal = bytearray()
+
+    def flush_literal():
+        if literal:
+            out.extend(struct.pack('<BI', OPCODE_INSERT, len(literal)))
+            out.extend(literal)
+            literal.clear()
+
+    pos = 0
+    while pos < len(target):
+        base_offset, length = find_match(base, index, target, pos)
+        if length >= MIN_COPY_SIZE:
+            flush_literal()
+            out += struct.pack('<BII', OPCODE_COPY, base_offset, length)
+            pos += length
+        else:
+            literal.append(target[pos])
+            pos += 1
+
+    flush_literal()
+    out += struct.pack('<B', OPCODE_END)
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('base', help='currently installed image, post-processed binary (*.application.bin)')
+    parser.add_argument('target', help='new image, post-processed binary (*.application.bin)')
+    parser.add_argument('output', help='output patch file')
+    args = parser.parse_args()
+
+    with open(args.base, 'rb') as f:
+        base = f.read()
+    with open(args.target, 'rb') as f:
+        target = f.read()
+
+    try:
+        read_image_crc(target)
+        patch = make_delta(base, target)
+    except ValueError as ex:
+        print(ex, file=sys.stderr)
+        return 1
+
+    with open(args.output, 'wb') as f:
+        f.write(patch)
+
+    print('Patch size %d bytes, %.1f%% of the new image' % (len(patch), 100.0 * len(patch) / max(len(target), 1)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Compares the efficiency of FOC and six-step commutation at the same cruise operating point in simulation.
+
+The same motor model is run by the FOC simulator (sim.c) and by the six-step simulator of tools/rtctl_sweep.
+For each of them, the duty cycle is bisected until the mean rotor speed matches the cruise speed, so that both
+deliver the same propeller power; the efficiency is the propeller power over the supply power at that point.
+By default, the cruise speed is 70% of the six-step speed at 100% duty cycle, i.e. about half of the max thrust.
+
+Both inverter models are averaged over the PWM period and have no switching losses; the six-step model
+includes the freewheeling diodes, the FOC model does not need them because all phases are driven. Neither
+model has iron losses. The numbers show the difference of the commutation schemes in the copper losses only;
+they are not a substitute for a measurement on the hardware, which is still outstanding.
+The exit code is non-zero if either scheme can not hold the cruise speed.
+
+Examples:
+  make
+  ./compare_efficiency.py
+  ./compare_efficiency.py --motor highkv --rpm 9000
+"""
+
+import os
+import sys
+import argparse
+import subprocess
+
+TOOLS_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, os.path.join(TOOLS_DIR, 'rtctl_sweep'))
+
+import sweep
+
+FOC_SIM = os.path.join(TOOLS_DIR, 'foc_sim', 'sim')
+
+RPM_TOLERANCE = 0.005
+BISECTION_STEPS = 16
+
+
+def parse_metrics(line):
+    return {k: float(v) if v not in ('ok', 'exit', 'failed') else v
+            for k, v in (item.split('=') for item in line.split()[1:])}
+
+
+def run(args):
+    proc = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    lines = [x for x in proc.stdout.splitlines() if x.startswith(('TRIAL ', 'RESULT '))]
+    if not lines:
+        raise RuntimeError('Simulator failed: %s' % proc.stderr.strip())
+    return lines[-1]
+
+
+def run_six_step(model, duty, hold):
+    """Returns (mean RPM, efficiency), or None if the motor did not hold the speed."""
+    line = run([sweep.SIM, 'trials=1', 'seed=1', 'dc_steps=1', 'dc_end=%f' % duty, 'hold=%f' % hold] +
+               ['%s=%s' % kv for kv in sorted(model.items())])
+    m = parse_metrics(line.split(None, 1)[1])
+    if not m['started'] or m['desync']:
+        return None
+    return m['mean_rpm'], m['efficiency']
+
+
+def run_foc(model, duty, hold, rpm):
+    """The rotor starts at the cruise speed, the FOC logic takes over from there."""
+    line = run([FOC_SIM, 'rpm=%f' % rpm, 'duty=%f' % duty, 'time=%f' % hold, 'settle=%f' % (hold / 2),
+                'max_err=180'] + ['%s=%s' % kv for kv in sorted(model.items())])
+    m = parse_metrics(line)
+    if m['result'] != 'ok':
+        return None
+    return m['mean_rpm'], m['efficiency']
+
+
+def find_operating_point(evaluate, rpm):
+    """Bisects the duty cycle; the speed grows with the duty cycle in both schemes. Returns (duty, RPM, eff)."""
+    lo, hi = 0.0, 1.0
+    best = None
+    for _ in range(BISECTION_STEPS):
+        duty = (lo + hi) / 2
+        result = evaluate(duty)
+        if result is None or result[0] < rpm:
+            lo = duty       # A failure means that the duty cycle is too low to keep the motor running
+        else:
+            hi = duty
+        if result is not None and (best is None or abs(result[0] - rpm) < abs(best[1] - rpm)):
+            best = (duty, result[0], result[1])
+        if best is not None and abs(best[1] - rpm) <= rpm * RPM_TOLERANCE:
+            break
+    if best is None or abs(best[1] - rpm) > rpm * RPM_TOLERANCE:
+        return None
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--motor', default='default', choices=sorted(sweep.MOTORS), help='motor model of sweep.py')
+    parser.add_argument('--rpm', type=float, help='cruise speed, RPM')
+    parser.add_argument('--hold', type=float, default=1.0, help='seconds at each duty cycle, the second half is measured')
+    args = parser.parse_args()
+
+    if not os.path.isfile(sweep.SIM) or not os.path.isfile(FOC_SIM):
+        print('The simulators are not built, run make first', file=sys.stderr)
+        return 1
+
+    model = sweep.MOTORS[args.motor]
+    rpm = args.rpm
+    if rpm is None:
+        full = run_six_step(model, 1.0, args.hold)
+        if full is None:
+            print('Six-step commutation does not run at 100% duty cycle', file=sys.stderr)
+            return 1
+        rpm = round(full[0] * 0.7, -1)
+
+    points = [
+        ('six-step', find_operating_point(lambda d: run_six_step(model, d, args.hold), rpm)),
+        ('foc', find_operating_point(lambda d: run_foc(model, d, args.hold, rpm), rpm)),
+    ]
+
+    print('motor=%s cruise_rpm=%.0f' % (args.motor, rpm))
+    for name, point in points:
+        if point is None:
+            print('%-9s does not hold the cruise speed' % name)
+        else:
+            print('%-9s duty=%.3f mean_rpm=%.0f efficiency=%.4f' % ((name,) + point))
+
+    if any(p is None for _, p in points):
+        return 1
+    print('difference=%+.2f%% points (FOC minus six-step)' % ((points[1][1][2] - points[0][1][2]) * 100))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
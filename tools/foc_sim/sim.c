@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Runs the sensorless FOC logic against a simulated motor and reports how well the flux observer tracks the rotor.
+ *
+ * motor_foc.c is built unmodified. The PWM and ADC driver stubs are connected to a model of the inverter and
+ * of a three phase PMSM with sinusoidal back EMF driving a propeller:
+ *   - Each phase is connected to the positive rail while the PWM counter is below its PWM value, like in
+ *     motor_pwm_set_duties_from_isr(); the phase voltages are averaged over the PWM period, so the current
+ *     ripple is not modelled.
+ *   - The input current is sampled at the auxiliary and the main ADC triggers. The sampled value is the sum of
+ *     the currents of the phases connected to the positive rail at the trigger point, clipped at zero because
+ *     the current sense amplifier is unidirectional.
+ *   - A sample is corrupted if a PWM edge is closer to the trigger than the amplifier settling time, or falls
+ *     within the ADC sample; such samples are counted if the FOC logic uses them.
+ *
+ * The simulated rotor starts at the requested speed, and the FOC logic takes over with the requested error of
+ * the initial angle, like at the handover from six-step commutation in motor_rtctl.c.
+ *
+ * Usage:
+ *   ./sim [name=value ...]
+ *
+ * Names starting with "mot_" are the firmware configuration parameters; other names define the motor model
+ * and the test, see the tables below. By default, the FOC motor parameters are derived from the model.
+ * The output is one line of metrics:
+ *   RESULT result=<ok|exit|failed> t=<s> rpm=<RPM> angle_err_rms=<deg> angle_err_max=<deg> bad_samples=<count>
+ *          mean_rpm=<RPM> efficiency=<0..1>
+ * The angle errors, the mean speed and the efficiency are evaluated after the settling time. The efficiency is
+ * the energy delivered to the propeller over the energy taken from the supply, like in tools/rtctl_sweep; the
+ * inverter is lossless, so it only accounts for the copper losses and the friction. The exit code is non-zero if the FOC logic did not
+ * keep control until the end of the test, or the maximum angle error exceeds max_err.
+ */
+
+#include <foc.h>
+#include <adc.h>
+#include <pwm.h>
+#include <timer.h>
+#include <zubax_chibios/config/config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define PWM_TIMER_FREQUENCY     72000000
+#define ADC_REF_VOLTAGE         3.3
+#define ADC_RESOLUTION          12
+#define VOLTAGE_DIVIDER_RTOP    10.0
+#define VOLTAGE_DIVIDER_RBOT    1.3
+#define CURRENT_AMP_GAIN        10.0
+#define CURRENT_SHUNT           1e-3
+
+#define NUM_SUBSTEPS            8
+
+uint32_t stub_primask;
+
+struct named_value
+{
+	const char* name;
+	double* value;
+};
+
+/*
+ * Configuration parameters read by the FOC logic; negative motor parameters are derived from the model
+ */
+static struct
+{
+	const char* name;
+	float value;
+} _config[] = {
+	{ "mot_foc_enable",    1 },
+	{ "mot_foc_r_mohm",    -1 },
+	{ "mot_foc_l_uh",      -1 },
+	{ "mot_foc_flux_uwb",  -1 },
+	{ "mot_foc_cp_max",    500 },
+	{ "mot_foc_obs_sh",    6 },
+	{ "mot_pwm_hz",        60000 }
+};
+#define NUM_CONFIG_PARAMS   ((int)(sizeof(_config) / sizeof(_config[0])))
+
+/*
+ * Motor model; the defaults are the same as in tools/rtctl_sweep
+ */
+static struct
+{
+	double vbus;            ///< Volt
+	double r;               ///< Ohm, phase
+	double l;               ///< Henry, phase
+	double kv;              ///< RPM/V
+	double poles;
+	double j;               ///< kg*m^2, rotor and propeller
+	double kprop;           ///< N*m*s^2, propeller torque per squared angular velocity
+	double tfric;           ///< N*m
+	double noise;           ///< ADC LSB, amplitude of the uniform noise
+	double deadtime;        ///< Nanosecond, delays the current sense amplifier settling
+} _model = {
+	12.0, 0.1, 30e-6, 700, 14, 2e-5, 2.5e-7, 0.005, 3, 500
+};
+
+static const struct named_value MODEL_PARAMS[] = {
+	{ "vbus", &_model.vbus },
+	{ "r", &_model.r },
+	{ "l", &_model.l },
+	{ "kv", &_model.kv },
+	{ "poles", &_model.poles },
+	{ "j", &_model.j },
+	{ "kprop", &_model.kprop },
+	{ "tfric", &_model.tfric },
+	{ "noise", &_model.noise },
+	{ "deadtime", &_model.deadtime }
+};
+
+/*
+ * Test definition
+ */
+static struct
+{
+	double rpm;             ///< Mechanical RPM at the handover
+	double duty;            ///< Duty cycle after the handover
+	double angle_err;       ///< Degree, error of the angle passed to motor_foc_start_from_isr()
+	double time;            ///< Second
+	double settle;          ///< Second, the angle errors are not evaluated before that
+	double max_err;         ///< Degree, maximum angle error for the test to pass
+	double seed;
+} _test = {
+	5000, 0.5, 10, 1.0, 0.1, 30, 1
+};
+
+static const struct named_value TEST_PARAMS[] = {
+	{ "rpm", &_test.rpm },
+	{ "duty", &_test.duty },
+	{ "angle_err", &_test.angle_err },
+	{ "time", &_test.time },
+	{ "settle", &_test.settle },
+	{ "max_err", &_test.max_err },
+	{ "seed", &_test.seed }
+};
+
+/*
+ * Simulation state
+ */
+static uint32_t _adc_period;
+static int _pwm_top;
+static int _current_settling;
+static int _current_sample;
+static uint32_t _random_state = 1;
+
+static int _pwm_vals[MOTOR_NUM_PHASES];
+static int _adc_trigger_aux;
+static int _adc_trigger;
+static bool _pwm_active;
+
+static struct
+{
+	double current[MOTOR_NUM_PHASES];       ///< Ampere, into the motor
+	double angle;                           ///< Electrical radian
+	double speed;                           ///< Electrical radian per second
+	double energy_in;                       ///< Joule, from the supply
+	double energy_out;                      ///< Joule, delivered to the propeller
+} _motor;
+
+static double _pole_pairs;
+static double _flux;                        ///< Weber, phase flux linkage
+
+
+static void die(const char* msg, const char* arg)
+{
+	fprintf(stderr, "ERROR: %s%s\n", msg, arg);
+	exit(2);
+}
+
+static double random_uniform(void)   ///< xorshift32, in order to be reproducible regardless of the C library
+{
+	_random_state ^= _random_state << 13;
+	_random_state ^= _random_state >> 17;
+	_random_state ^= _random_state << 5;
+	return _random_state / 4294967296.0;
+}
+
+static int volts_to_raw(double volts)
+{
+	const double raw = volts * (VOLTAGE_DIVIDER_RBOT / (VOLTAGE_DIVIDER_RTOP + VOLTAGE_DIVIDER_RBOT)) /
+	                   ADC_REF_VOLTAGE * (1 << ADC_RESOLUTION);
+	return (int)raw;
+}
+
+static int amperes_to_raw(double amperes)
+{
+	return (int)(amperes * CURRENT_SHUNT * CURRENT_AMP_GAIN / ADC_REF_VOLTAGE * (1 << ADC_RESOLUTION));
+}
+
+static int add_adc_noise(int raw)
+{
+	raw += (int)lround((random_uniform() * 2.0 - 1.0) * _model.noise);
+	return (raw < 0) ? 0 : ((raw >= (1 << ADC_RESOLUTION)) ? ((1 << ADC_RESOLUTION) - 1) : raw);
+}
+
+/*
+ * Stubs
+ */
+float configGet(const char* name)
+{
+	for (int i = 0; i < NUM_CONFIG_PARAMS; i++) {
+		if (!strcmp(_config[i].name, name)) {
+			return _config[i].value;
+		}
+	}
+	die("Unknown parameter requested: ", name);
+	return 0;
+}
+
+const char* configNameByIndex(int index)
+{
+	return (index >= 0 && index < NUM_CONFIG_PARAMS) ? _config[index].name : NULL;
+}
+
+void chSysHalt(const char* reason) { die("Halted: ", reason); }
+
+uint32_t motor_adc_sampling_period_hnsec(void) { return _adc_period; }
+int motor_pwm_get_top(void) { return _pwm_top; }
+int motor_pwm_get_current_settling_ticks(void) { return _current_settling; }
+int motor_pwm_get_current_window_ticks(void) { return _current_settling + _current_sample; }
+
+void motor_pwm_set_duties_from_isr(const int pwm_vals[MOTOR_NUM_PHASES], int adc_trigger_aux, int adc_trigger)
+{
+	memcpy(_pwm_vals, pwm_vals, sizeof(_pwm_vals));
+
+	// Same limits as in motor_pwm.c
+	adc_trigger_aux = (adc_trigger_aux < 1) ? 1 : adc_trigger_aux;
+	adc_trigger = (adc_trigger > _pwm_top) ? _pwm_top : adc_trigger;
+	adc_trigger = (adc_trigger < adc_trigger_aux) ? adc_trigger_aux : adc_trigger;
+	_adc_trigger_aux = adc_trigger_aux;
+	_adc_trigger = adc_trigger;
+	_pwm_active = true;
+}
+
+float motor_adc_convert_input_voltage(int raw)
+{
+	return raw * (ADC_REF_VOLTAGE / (1 << ADC_RESOLUTION)) *
+	       ((VOLTAGE_DIVIDER_RTOP + VOLTAGE_DIVIDER_RBOT) / VOLTAGE_DIVIDER_RBOT);
+}
+
+float motor_adc_convert_input_current(int raw)
+{
+	return raw * (ADC_REF_VOLTAGE / (1 << ADC_RESOLUTION)) / CURRENT_AMP_GAIN / CURRENT_SHUNT;
+}
+
+/*
+ * Motor model
+ */
+static double bemf(int phase)
+{
+	return -_flux * _motor.speed * sin(_motor.angle - phase * (2.0 * M_PI / 3.0));
+}
+
+/**
+ * All phases are always driven, so the neutral point voltage follows from the zero sum of the phase currents.
+ */
+static void update_motor(double dt)
+{
+	double voltage[MOTOR_NUM_PHASES];
+	double emf[MOTOR_NUM_PHASES];
+	double neutral = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		voltage[i] = _pwm_active ? (_model.vbus * _pwm_vals[i] / (_pwm_top + 1)) : 0;
+		emf[i] = bemf(i);
+		neutral += (voltage[i] - emf[i]) / MOTOR_NUM_PHASES;
+	}
+
+	double torque = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		if (_pwm_active) {
+			_motor.current[i] += (voltage[i] - neutral - emf[i] - _model.r * _motor.current[i]) / _model.l * dt;
+		}
+		torque += -_pole_pairs * _flux * sin(_motor.angle - i * (2.0 * M_PI / 3.0)) * _motor.current[i];
+		_motor.energy_in += voltage[i] * _motor.current[i] * dt;
+	}
+
+	const double omega = _motor.speed / _pole_pairs;
+	const double sign = (omega >= 0) ? 1.0 : -1.0;
+	const double load = sign * (_model.kprop * omega * omega + _model.tfric);
+	_motor.energy_out += _model.kprop * omega * omega * fabs(omega) * dt;
+
+	_motor.speed += (torque - load) / _model.j * dt * _pole_pairs;
+	_motor.angle = fmod(_motor.angle + _motor.speed * dt + 2.0 * M_PI, 2.0 * M_PI);
+}
+
+/**
+ * Runs the model for the given number of PWM ticks.
+ */
+static void advance_ticks(int ticks)
+{
+	const double dt = ticks / (double)PWM_TIMER_FREQUENCY / NUM_SUBSTEPS;
+	for (int i = 0; i < NUM_SUBSTEPS && ticks > 0; i++) {
+		update_motor(dt);
+	}
+}
+
+/**
+ * Input current as seen by the unidirectional current sense amplifier at the given PWM counter value.
+ */
+static double get_input_current(int counter)
+{
+	double current = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		if (counter < _pwm_vals[i]) {
+			current += _motor.current[i];
+		}
+	}
+	return fmax(current, 0);
+}
+
+/**
+ * Whether the FOC logic will use the sample at this trigger; the condition is the same as in motor_foc.c.
+ */
+static bool is_window_used(int first_edge, int second_edge)
+{
+	return (second_edge - first_edge) >= (_current_settling + _current_sample);
+}
+
+static bool is_sample_corrupted(int trigger)
+{
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		if ((_pwm_vals[i] > (trigger - _current_settling)) && (_pwm_vals[i] < (trigger + _current_sample))) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Test
+ */
+static uint16_t get_rotor_angle(void)
+{
+	return (uint16_t)(int32_t)lround(_motor.angle / (2.0 * M_PI) * 65536.0);
+}
+
+static double get_rotor_rpm(void)
+{
+	return fabs(_motor.speed) / (2.0 * M_PI) * 60.0 / _pole_pairs;
+}
+
+/**
+ * Simulates one PWM period with the ADC samples, returns the result of the FOC update.
+ */
+static enum motor_foc_result run_pwm_period(unsigned* inout_bad_samples)
+{
+	int sorted[MOTOR_NUM_PHASES];
+	memcpy(sorted, _pwm_vals, sizeof(sorted));
+	for (int i = 1; i < MOTOR_NUM_PHASES; i++) {
+		for (int k = i; k > 0 && sorted[k] < sorted[k - 1]; k--) {
+			const int tmp = sorted[k];
+			sorted[k] = sorted[k - 1];
+			sorted[k - 1] = tmp;
+		}
+	}
+
+	struct motor_adc_sample sample;
+	memset(&sample, 0, sizeof(sample));
+
+	advance_ticks(_adc_trigger_aux);
+	sample.input_current_aux = add_adc_noise(amperes_to_raw(get_input_current(_adc_trigger_aux)));
+	if (is_window_used(sorted[0], sorted[1]) && is_sample_corrupted(_adc_trigger_aux)) {
+		(*inout_bad_samples)++;
+	}
+
+	advance_ticks(_adc_trigger - _adc_trigger_aux);
+	sample.input_current = add_adc_noise(amperes_to_raw(get_input_current(_adc_trigger)));
+	sample.input_voltage = add_adc_noise(volts_to_raw(_model.vbus));
+	if (is_window_used(sorted[1], sorted[2]) && is_sample_corrupted(_adc_trigger)) {
+		(*inout_bad_samples)++;
+	}
+
+	advance_ticks(_pwm_top + 1 - _adc_trigger);
+	return motor_foc_update_from_isr(&sample);
+}
+
+static int run_test(void)
+{
+	static const char* const RESULT_NAMES[] = { "ok", "exit", "failed" };
+
+	memset(&_motor, 0, sizeof(_motor));
+	_motor.angle = random_uniform() * 2.0 * M_PI;
+	_motor.speed = _test.rpm / 60.0 * 2.0 * M_PI * _pole_pairs;
+
+	const double period = (_pwm_top + 1) / (double)PWM_TIMER_FREQUENCY;
+	const uint32_t comm_period = (uint32_t)(HNSEC_PER_SEC / (fabs(_motor.speed) / (2.0 * M_PI) * 6.0));
+	const uint16_t initial_error = (uint16_t)(int32_t)lround(_test.angle_err / 360.0 * 65536.0);
+
+	motor_foc_set_duty_cycle(_test.duty);
+	motor_foc_start_from_isr((uint16_t)(get_rotor_angle() + initial_error), comm_period,
+	                         (_motor.speed >= 0) ? 1 : -1);
+
+	const unsigned num_periods = (unsigned)(_test.time / period);
+	const unsigned settle_periods = (unsigned)(_test.settle / period);
+
+	enum motor_foc_result result = MOTOR_FOC_RESULT_OK;
+	unsigned bad_samples = 0;
+	unsigned i = 0;
+	double err_sq_sum = 0;
+	double err_max = 0;
+	unsigned num_errors = 0;
+	double rpm_sum = 0;
+	double energy_in_at_settle = 0;
+	double energy_out_at_settle = 0;
+
+	for (i = 0; (i < num_periods) && (result == MOTOR_FOC_RESULT_OK); i++) {
+		if (i == settle_periods) {
+			energy_in_at_settle = _motor.energy_in;
+			energy_out_at_settle = _motor.energy_out;
+		}
+		result = run_pwm_period(&bad_samples);
+		if (i >= settle_periods) {
+			const int16_t error = (int16_t)(motor_foc_get_angle() - get_rotor_angle());
+			const double error_deg = error / 65536.0 * 360.0;
+			err_sq_sum += error_deg * error_deg;
+			err_max = fmax(err_max, fabs(error_deg));
+			num_errors++;
+			rpm_sum += get_rotor_rpm();
+		}
+	}
+
+	const double err_rms = (num_errors > 0) ? sqrt(err_sq_sum / num_errors) : NAN;
+	const double mean_rpm = (num_errors > 0) ? (rpm_sum / num_errors) : NAN;
+	const double efficiency = (num_errors > 0) ?
+		((_motor.energy_out - energy_out_at_settle) / (_motor.energy_in - energy_in_at_settle)) : NAN;
+	printf("RESULT result=%s t=%.4f rpm=%.0f angle_err_rms=%.2f angle_err_max=%.2f bad_samples=%u "
+	       "mean_rpm=%.0f efficiency=%.4f\n",
+	       RESULT_NAMES[result], i * period, get_rotor_rpm(), err_rms, (num_errors > 0) ? err_max : NAN,
+	       bad_samples, mean_rpm, efficiency);
+
+	const bool passed = (result == MOTOR_FOC_RESULT_OK) && (i == num_periods) && (err_max <= _test.max_err);
+	return passed ? 0 : 1;
+}
+
+/*
+ * Command line
+ */
+static bool set_named_value(const struct named_value* table, int len, const char* name, double value)
+{
+	for (int i = 0; i < len; i++) {
+		if (!strcmp(table[i].name, name)) {
+			*table[i].value = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void parse_argument(const char* arg)
+{
+	char name[32] = "";
+	double value = 0;
+	if (sscanf(arg, "%31[^=]=%lf", name, &value) != 2) {
+		die("Expected name=value, got: ", arg);
+	}
+
+	for (int i = 0; i < NUM_CONFIG_PARAMS; i++) {
+		if (!strcmp(_config[i].name, name)) {
+			_config[i].value = value;
+			return;
+		}
+	}
+	if (!set_named_value(MODEL_PARAMS, sizeof(MODEL_PARAMS) / sizeof(MODEL_PARAMS[0]), name, value) &&
+	    !set_named_value(TEST_PARAMS, sizeof(TEST_PARAMS) / sizeof(TEST_PARAMS[0]), name, value)) {
+		die("Unknown name: ", name);
+	}
+}
+
+static void set_default_config(const char* name, double value)
+{
+	for (int i = 0; i < NUM_CONFIG_PARAMS; i++) {
+		if (!strcmp(_config[i].name, name) && (_config[i].value < 0)) {
+			_config[i].value = (float)round(value);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		parse_argument(argv[i]);
+	}
+	if (_model.poles < 2 || _model.l <= 0 || _model.j <= 0 || _test.rpm <= 0) {
+		die("Invalid motor model or test definition", "");
+	}
+
+	_pole_pairs = floor(_model.poles / 2);
+	_flux = 1.0 / (sqrt(3.0) * _pole_pairs * _model.kv * 2.0 * M_PI / 60.0);  // KV is line-to-line
+	_pwm_top = PWM_TIMER_FREQUENCY / (int)configGet("mot_pwm_hz") - 1;
+	_adc_period = HNSEC_PER_SEC / (PWM_TIMER_FREQUENCY / (_pwm_top + 1));
+	_random_state = (uint32_t)_test.seed * 2654435761U + 1U;
+
+	// Same as in motor_pwm.c and motor_adc.c
+	_current_settling = (int)((1500 + _model.deadtime) * 1e-9 * PWM_TIMER_FREQUENCY);
+	_current_sample = (int)(1170 * 1e-9 * PWM_TIMER_FREQUENCY);
+
+	set_default_config("mot_foc_r_mohm", _model.r * 1e3);
+	set_default_config("mot_foc_l_uh", _model.l * 1e6);
+	set_default_config("mot_foc_flux_uwb", _flux * 1e6);
+
+	motor_foc_init();
+	if (!motor_foc_is_enabled()) {
+		die("FOC is disabled", "");
+	}
+	return run_test();
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Tests of the phase current reconstruction of the sinusoidal commutation: the shaping of the PWM values that
+ * makes room for two input current samples per PWM period, and the recovery of the phase currents from these
+ * samples, down to the RMS values reported by motor_foc_get_phase_currents().
+ *
+ * The source is included in order to reach the static functions. The samples are synthesized from known phase
+ * currents in the same way as the DC link current sense amplifier produces them; see sim.c.
+ *
+ * Usage:
+ *   ./test_current_sampling
+ * The exit code is non-zero if any check fails.
+ */
+
+#include "motor_foc.c"
+
+#define PWM_TIMER_FREQUENCY     72000000
+#define PWM_FREQUENCY           60000
+#define CURRENT_MA_PER_LSB      20          ///< Raw ADC units are converted with this scale
+
+#define CHECK(x)                check((x), #x, __LINE__)
+
+uint32_t stub_primask;
+
+static int _pwm_vals[MOTOR_NUM_PHASES];
+static int _adc_trigger_aux;
+static int _adc_trigger;
+static unsigned _num_failures;
+static uint32_t _random_state = 1;
+
+
+static void check(bool ok, const char* what, int line)
+{
+	if (!ok) {
+		fprintf(stderr, "FAILED at line %i: %s\n", line, what);
+		_num_failures++;
+	}
+}
+
+static uint32_t random_u32(void)
+{
+	_random_state ^= _random_state << 13;
+	_random_state ^= _random_state >> 17;
+	_random_state ^= _random_state << 5;
+	return _random_state;
+}
+
+/*
+ * Stubs
+ */
+float configGet(const char* name)
+{
+	return !strcmp(name, "mot_foc_enable") ? 1 : 100;
+}
+
+void chSysHalt(const char* reason)
+{
+	fprintf(stderr, "Halted: %s\n", reason);
+	exit(2);
+}
+
+uint32_t motor_adc_sampling_period_hnsec(void) { return HNSEC_PER_SEC / PWM_FREQUENCY; }
+int motor_pwm_get_top(void) { return PWM_TIMER_FREQUENCY / PWM_FREQUENCY - 1; }
+int motor_pwm_get_current_settling_ticks(void) { return 144; }       // 1.5 usec + 0.5 usec of dead time
+int motor_pwm_get_current_window_ticks(void) { return 144 + 84; }    // Plus one ADC sample
+float motor_adc_convert_input_voltage(int raw) { return raw / 100.0F; }
+float motor_adc_convert_input_current(int raw) { return raw * (CURRENT_MA_PER_LSB / 1000.0F); }
+
+void motor_pwm_set_duties_from_isr(const int pwm_vals[MOTOR_NUM_PHASES], int adc_trigger_aux, int adc_trigger)
+{
+	memcpy(_pwm_vals, pwm_vals, sizeof(_pwm_vals));
+	_adc_trigger_aux = adc_trigger_aux;
+	_adc_trigger = adc_trigger;
+}
+
+/*
+ * Helpers
+ */
+static void sort3(const int in[MOTOR_NUM_PHASES], int out[MOTOR_NUM_PHASES])
+{
+	memcpy(out, in, sizeof(int) * MOTOR_NUM_PHASES);
+	for (int i = 1; i < MOTOR_NUM_PHASES; i++) {
+		for (int k = i; k > 0 && out[k] < out[k - 1]; k--) {
+			const int tmp = out[k];
+			out[k] = out[k - 1];
+			out[k - 1] = tmp;
+		}
+	}
+}
+
+/**
+ * The phases connected to the positive rail at the given PWM counter value, seen by the unidirectional amplifier.
+ */
+static int sample_input_current_raw(const int32_t currents_ma[MOTOR_NUM_PHASES], int counter)
+{
+	int32_t current = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		if (counter < _pwm_vals[i]) {
+			current += currents_ma[i];
+		}
+	}
+	return (current > 0) ? (current / CURRENT_MA_PER_LSB) : 0;
+}
+
+static void reset(void)
+{
+	motor_foc_start_from_isr(0, 1000, 1);
+	memset(_pwm_vals, 0, sizeof(_pwm_vals));
+}
+
+/*
+ * Tests
+ */
+/**
+ * Any set of PWM values must yield two usable windows with the ADC triggers inside, and the shift of the edges
+ * must be compensated in the following periods.
+ */
+static void test_window_shaping(void)
+{
+	const int window = _params.current_window;
+	const int pwm_min = _params.pwm_margin;
+	const int pwm_max = _params.pwm_top - _params.pwm_margin;
+
+	for (int iteration = 0; iteration < 100000; iteration++) {
+		reset();
+
+		/*
+		 * The output of update_voltage() is centered, but the carry shifts it; small differences are more likely,
+		 * these are the interesting cases
+		 */
+		const int spread = 1 + (int)(random_u32() % (uint32_t)((iteration % 2) ? (window * 3) : _params.pwm_top));
+		int requested[MOTOR_NUM_PHASES];
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			requested[i] = (int)(random_u32() % (uint32_t)spread);
+		}
+		const int center = ((iteration % 4) < 2) ? (_params.pwm_top / 2) :
+		                   (pwm_min + (int)(random_u32() % (uint32_t)(pwm_max - pwm_min)));
+		const int offset = (MIN(MIN(requested[0], requested[1]), requested[2]) +
+		                    MAX(MAX(requested[0], requested[1]), requested[2])) / 2;
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			requested[i] = MIN(MAX(center + requested[i] - offset, pwm_min), pwm_max);
+		}
+
+		int sum_applied[MOTOR_NUM_PHASES] = { 0 };
+		static const int NUM_PERIODS = 16;
+		for (int period = 0; period < NUM_PERIODS; period++) {
+			int pwm_vals[MOTOR_NUM_PHASES];
+			memcpy(pwm_vals, requested, sizeof(pwm_vals));
+			int trigger_aux = 0;
+			const int trigger = shape_current_sampling_windows(pwm_vals, &trigger_aux);
+
+			int sorted[MOTOR_NUM_PHASES];
+			sort3(pwm_vals, sorted);
+			for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+				CHECK((pwm_vals[i] >= pwm_min) && (pwm_vals[i] <= pwm_max));
+				CHECK(abs(_state.pwm_carry[i]) <= window);
+				sum_applied[i] += pwm_vals[i];
+			}
+
+			// The PWM range is much wider than two windows, so both windows must always be usable
+			CHECK(_state.sampled_phase_low >= 0);
+			CHECK(_state.sampled_phase_high >= 0);
+
+			// The samples that are used must be entirely within their windows
+			if (_state.sampled_phase_low >= 0) {
+				CHECK(pwm_vals[_state.sampled_phase_low] == sorted[0]);
+				CHECK(trigger_aux == (sorted[0] + _params.current_settling));
+				CHECK((trigger_aux + window - _params.current_settling) <= sorted[1]);
+			}
+			if (_state.sampled_phase_high >= 0) {
+				CHECK(pwm_vals[_state.sampled_phase_high] == sorted[2]);
+				CHECK(trigger == (sorted[1] + _params.current_settling));
+				CHECK((trigger + window - _params.current_settling) <= sorted[2]);
+			}
+		}
+
+		/*
+		 * The average line-to-line voltages are preserved up to the carry left over after the last period,
+		 * unless there is no room to move the edges apart without hitting the rails, which costs some modulation.
+		 */
+		const bool full_voltage = (MIN(MIN(requested[0], requested[1]), requested[2]) < (pwm_min + window)) ||
+		                          (MAX(MAX(requested[0], requested[1]), requested[2]) > (pwm_max - window));
+		for (int i = 1; (i < MOTOR_NUM_PHASES) && !full_voltage; i++) {
+			const int expected = (requested[i] - requested[0]) * NUM_PERIODS;
+			const int actual = (sum_applied[i] + _state.pwm_carry[i]) - (sum_applied[0] + _state.pwm_carry[0]);
+			CHECK(abs(actual - expected) <= 2);
+		}
+	}
+}
+
+/**
+ * Balanced sinusoidal currents in phase with the voltage vector; the samples are synthesized from the shaped PWM
+ * values, so the phases that are sampled change every 60 degrees.
+ */
+static void test_reconstruction(void)
+{
+	static const int32_t AMPLITUDE_MA = 10000;
+	static const int PERIODS_PER_REVOLUTION = 360;
+
+	reset();
+
+	double max_error_ma = 0;
+	unsigned num_checked = 0;
+
+	for (int period = 0; period < 20000; period++) {
+		const double angle = 2.0 * M_PI * period / PERIODS_PER_REVOLUTION;
+
+		int32_t currents[MOTOR_NUM_PHASES];
+		int pwm_vals[MOTOR_NUM_PHASES];
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			const double phase = cos(angle - i * (2.0 * M_PI / 3.0));
+			currents[i] = (int32_t)lround(AMPLITUDE_MA * phase);
+			pwm_vals[i] = _params.pwm_top / 2 + (int)lround(phase * _params.pwm_top * 0.3);
+		}
+
+		int trigger_aux = 0;
+		_adc_trigger = shape_current_sampling_windows(pwm_vals, &trigger_aux);
+		_adc_trigger_aux = trigger_aux;
+		memcpy(_pwm_vals, pwm_vals, sizeof(_pwm_vals));
+
+		struct motor_adc_sample sample;
+		memset(&sample, 0, sizeof(sample));
+		sample.input_current_aux = sample_input_current_raw(currents, _adc_trigger_aux);
+		sample.input_current = sample_input_current_raw(currents, _adc_trigger);
+
+		_state.period_counter++;
+		update_phase_currents(&sample);
+
+		// Only two fresh phases per period; the third one is derived, so it is exact with fresh data only
+		const double expected_alpha = AMPLITUDE_MA * cos(angle);
+		const double expected_beta = AMPLITUDE_MA * sin(angle);
+		if (period > CURRENT_MAX_AGE_PERIODS) {
+			const double error = hypot(_state.i_alpha - expected_alpha, _state.i_beta - expected_beta);
+			max_error_ma = fmax(max_error_ma, error);
+			num_checked++;
+		}
+	}
+
+	// One LSB per sample plus the Q15 rounding
+	CHECK(num_checked > 0);
+	CHECK(max_error_ma < (3 * CURRENT_MA_PER_LSB));
+
+	float rms[MOTOR_NUM_PHASES] = { 0 };
+	motor_foc_get_phase_currents(rms);
+	const float expected_rms = AMPLITUDE_MA / 1000.0F / sqrtf(2.0F);
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		CHECK(fabsf(rms[i] - expected_rms) < (expected_rms * 0.02F));
+	}
+
+	printf("Reconstruction: max vector error %.0f mA, RMS A/B/C %.3f %.3f %.3f A, expected %.3f A\n",
+	       max_error_ma, rms[0], rms[1], rms[2], expected_rms);
+}
+
+/**
+ * If one of the windows is unusable for too long, the phase currents must not be updated from the stale data.
+ */
+static void test_stale_samples(void)
+{
+	reset();
+
+	struct motor_adc_sample sample;
+	memset(&sample, 0, sizeof(sample));
+	sample.input_current_aux = 100;
+	sample.input_current = 200;
+
+	// Valid data first
+	_state.sampled_phase_low = 1;
+	_state.sampled_phase_high = 0;
+	_state.period_counter++;
+	update_phase_currents(&sample);
+	CHECK(_state.phase_currents[0] == 200 * CURRENT_MA_PER_LSB);
+	CHECK(_state.phase_currents[1] == -100 * CURRENT_MA_PER_LSB);
+	CHECK(_state.phase_currents[2] == -100 * CURRENT_MA_PER_LSB);
+	const int32_t alpha = _state.i_alpha;
+	const int32_t beta = _state.i_beta;
+
+	// The aux window is lost; phase 0 stays fresh, and phase 1 is still used until it becomes too old
+	_state.sampled_phase_low = -1;
+	for (int i = 0; i < CURRENT_MAX_AGE_PERIODS; i++) {
+		sample.input_current = 300 + i;
+		_state.period_counter++;
+		update_phase_currents(&sample);
+	}
+	CHECK(_state.i_alpha != alpha);
+	CHECK(_state.i_beta != beta);
+
+	const int32_t last_alpha = _state.i_alpha;
+	const int32_t last_beta = _state.i_beta;
+	for (int i = 0; i < 3; i++) {
+		sample.input_current = 400 + i;
+		_state.period_counter++;
+		update_phase_currents(&sample);
+	}
+	CHECK(_state.i_alpha == last_alpha);
+	CHECK(_state.i_beta == last_beta);
+}
+
+int main(void)
+{
+	motor_foc_init();
+
+	test_window_shaping();
+	test_reconstruction();
+	test_stale_samples();
+
+	if (_num_failures > 0) {
+		printf("%u checks failed\n", _num_failures);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Replays a trace of the six-step commutation logic recorded by the firmware, and verifies that the
+ * commutation decisions made on the host are bit-exact with the recorded ones.
+ *
+ * The realtime motor control logic is built from the unmodified firmware sources against a set of stubs,
+ * which feed it with the recorded ADC samples, timer callbacks and duty cycle updates. The sources are
+ * included into this file in order to restore the control state from the snapshot saved at the trigger.
+ * The logic records its own trace while being replayed; the replay passes if both traces are identical.
+ *
+ * Usage:
+ *   Firmware CLI:  m trace arm <delay since start, ms>
+ *                  <start the motor, then stop it>
+ *                  m trace
+ *   Host:          ./replay trace.txt
+ *
+ * The trace is the output of "m trace"; lines that don't belong to the trace are ignored, so the whole
+ * CLI session log can be passed as is.
+ *
+ * "make check" replays the reference traces in traces/, which are recorded by the simulator of tools/rtctl_sweep
+ * from the same sources: spinup.txt from the start of the motor, running_sync.txt past the transition to the
+ * running state, with scheduled duty cycle updates.
+ */
+
+#include "motor_rtctl.c"
+#include "motor_trace.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_CONFIG_PARAMS   64
+#define MAX_PARAM_NAME_LEN  32
+#define PWM_VAL_QUEUE_LEN   4
+#define CONTEXT_RECORDS     5
+
+static const char* const RECORD_TYPE_NAMES[] = { "ADC", "TIMER", "DUTY", "ZC", "STEP", "END" };
+
+uint32_t stub_primask;
+
+static struct
+{
+	char name[MAX_PARAM_NAME_LEN];
+	float value;
+} _config[MAX_CONFIG_PARAMS];
+static int _num_config_params;
+
+static uint64_t _trigger_timestamp;
+static int64_t _snapshot[MOTOR_TRACE_MAX_SNAPSHOT_LEN];
+static unsigned _snapshot_len;
+static unsigned _snapshot_len_loaded;
+static uint32_t _adc_sampling_period;
+static int _pwm_top;
+
+static struct motor_trace_record _recorded[MOTOR_TRACE_MAX_RECORDS];
+static unsigned _num_recorded;
+
+static uint64_t _now;
+static struct motor_adc_sample _last_sample;
+
+/// motor_rtctl_set_duty_cycle*() convert the duty cycle to the PWM value; the values are taken from the trace
+static int _pwm_val_queue[PWM_VAL_QUEUE_LEN];
+static unsigned _pwm_val_queue_len;
+
+
+static void die(const char* msg, const char* arg)
+{
+	fprintf(stderr, "ERROR: %s%s\n", msg, arg);
+	exit(2);
+}
+
+static void push_pwm_val(int pwm_val)
+{
+	if (_pwm_val_queue_len >= PWM_VAL_QUEUE_LEN) {
+		die("PWM value queue overflow", "");
+	}
+	_pwm_val_queue[_pwm_val_queue_len++] = pwm_val;
+}
+
+/*
+ * Stubs
+ */
+float configGet(const char* name)
+{
+	for (int i = 0; i < _num_config_params; i++) {
+		if (!strcmp(_config[i].name, name)) {
+			return _config[i].value;
+		}
+	}
+	die("Parameter is missing from the trace: ", name);
+	return 0;
+}
+
+const char* configNameByIndex(int index)
+{
+	return (index >= 0 && index < _num_config_params) ? _config[index].name : NULL;
+}
+
+void chSysSuspend(void) { }
+void chSysEnable(void) { }
+void chSysHalt(const char* reason) { die("Halted: ", reason); }
+tprio_t chThdSetPriority(tprio_t prio) { return prio; }
+
+int motor_pwm_init(void) { return 0; }
+uint32_t motor_adc_sampling_period_hnsec(void) { return _adc_sampling_period; }
+void motor_pwm_manip(const enum motor_pwm_phase_manip command[MOTOR_NUM_PHASES]) { (void)command; }
+void motor_pwm_set_freewheeling(void) { }
+void motor_pwm_emergency(void) { }
+void motor_pwm_set_step_from_isr(const struct motor_pwm_commutation_step* step, int pwm_val)
+{
+	(void)step;
+	(void)pwm_val;
+}
+int motor_pwm_get_top(void) { return _pwm_top; }
+void motor_pwm_beep(int frequency, int duration_msec)
+{
+	(void)frequency;
+	(void)duration_msec;
+}
+
+int motor_pwm_compute_pwm_val(float duty_cycle)
+{
+	(void)duty_cycle;
+	if (_pwm_val_queue_len == 0) {
+		die("Unexpected PWM value computation", "");
+	}
+	const int out = _pwm_val_queue[0];
+	memmove(&_pwm_val_queue[0], &_pwm_val_queue[1], sizeof(_pwm_val_queue[0]) * --_pwm_val_queue_len);
+	return out;
+}
+
+int motor_adc_init(float current_shunt_resistance) { (void)current_shunt_resistance; return 0; }
+void motor_adc_enable_from_isr(void) { }
+void motor_adc_disable_from_isr(void) { }
+void motor_adc_set_current_sampling_mode(bool enabled) { (void)enabled; }
+struct motor_adc_sample motor_adc_get_last_sample(void) { return _last_sample; }
+float motor_adc_convert_input_voltage(int raw) { return raw; }
+float motor_adc_convert_input_current(int raw) { return raw; }
+
+void motor_timer_init(void) { }
+uint64_t motor_timer_hnsec(void) { return _now; }
+void motor_timer_set_relative(int64_t delay_hnsec) { (void)delay_hnsec; }
+int64_t motor_timer_set_absolute(uint64_t timestamp_hnsec) { return (int64_t)(timestamp_hnsec - _now); }
+void motor_timer_cancel(void) { }
+
+/// The trace ends at the handover, so only the handover decision is reproduced
+void motor_foc_init(void) { }
+bool motor_foc_is_enabled(void) { return configGet("mot_foc_enable") != 0; }
+uint32_t motor_foc_get_handover_comm_period_hnsec(void) { return configGet("mot_foc_cp_max") * HNSEC_PER_USEC; }
+void motor_foc_set_duty_cycle(float duty_cycle) { (void)duty_cycle; }
+void motor_foc_start_from_isr(uint16_t angle, uint32_t comm_period, int direction)
+{
+	(void)angle;
+	(void)comm_period;
+	(void)direction;
+}
+enum motor_foc_result motor_foc_update_from_isr(const struct motor_adc_sample* sample)
+{
+	(void)sample;
+	return MOTOR_FOC_RESULT_FAILED;
+}
+uint16_t motor_foc_get_angle(void) { return 0; }
+uint32_t motor_foc_get_comm_period_hnsec(void) { return 0; }
+int motor_foc_get_input_current_raw(void) { return 0; }
+void motor_foc_get_phase_currents(float out_currents[3]) { memset(out_currents, 0, sizeof(float) * 3); }
+void motor_foc_print_debug_info(void) { }
+
+void motor_forced_rotation_detector_init(void) { }
+void motor_forced_rotation_detector_reset(void) { }
+void motor_forced_rotation_detector_update_from_adc_callback(
+	const struct motor_pwm_commutation_step comm_table[MOTOR_NUM_COMMUTATION_STEPS],
+	const struct motor_adc_sample* adc_sample)
+{
+	(void)comm_table;
+	(void)adc_sample;
+}
+enum motor_rtctl_forced_rotation motor_forced_rotation_detector_get_state(void)
+{
+	return MOTOR_RTCTL_FORCED_ROT_NONE;
+}
+
+/*
+ * Trace loading
+ */
+static void load_trace(FILE* f)
+{
+	bool have_trigger = false;
+	char line[256];
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (line[0] == 'T' && line[1] == ' ') {
+			char timestamp[32] = "";
+			unsigned long adc_period = 0;
+			if (sscanf(line + 2, "%31s %lu %i %u", timestamp, &adc_period, &_pwm_top, &_snapshot_len) != 4 ||
+			    _snapshot_len > MOTOR_TRACE_MAX_SNAPSHOT_LEN) {
+				die("Malformed trigger line: ", line);
+			}
+			_trigger_timestamp = strtoull(timestamp, NULL, 16);
+			_adc_sampling_period = adc_period;
+			have_trigger = true;
+
+		} else if (line[0] == 'S' && line[1] == ' ') {
+			if (_snapshot_len_loaded >= _snapshot_len) {
+				die("Too many snapshot values", "");
+			}
+			_snapshot[_snapshot_len_loaded++] = (int64_t)strtoull(line + 2, NULL, 16);
+
+		} else if (line[0] == 'P' && line[1] == ' ') {
+			if (_num_config_params >= MAX_CONFIG_PARAMS) {
+				die("Too many parameters", "");
+			}
+			if (sscanf(line + 2, "%31s %f", _config[_num_config_params].name,
+			           &_config[_num_config_params].value) != 2) {
+				die("Malformed parameter line: ", line);
+			}
+			_num_config_params++;
+
+		} else if (line[0] == 'R' && line[1] == ' ') {
+			if (_num_recorded >= MOTOR_TRACE_MAX_RECORDS) {
+				die("Too many records; rebuild with larger MOTOR_TRACE_MAX_RECORDS", "");
+			}
+			struct motor_trace_record* const rec = &_recorded[_num_recorded];
+			unsigned type = 0, flags = 0, v[MOTOR_TRACE_NUM_VALUES] = {0};
+			long timestamp = 0;
+			if (sscanf(line + 2, "%u %u %li %u %u %u %u %u", &type, &flags, &timestamp,
+			           &v[0], &v[1], &v[2], &v[3], &v[4]) != 8 || type > MOTOR_TRACE_END) {
+				die("Malformed record line: ", line);
+			}
+			rec->type = type;
+			rec->flags = flags;
+			rec->timestamp = timestamp;
+			for (int i = 0; i < MOTOR_TRACE_NUM_VALUES; i++) {
+				rec->values[i] = v[i];
+			}
+			_num_recorded++;
+
+		} else if (line[0] == 'E' && (line[1] == '\n' || line[1] == '\r' || line[1] == '\0')) {
+			break;
+		}
+	}
+
+	if (!have_trigger || _num_recorded == 0) {
+		die("The trace is empty", "");
+	}
+	if (_snapshot_len_loaded != _snapshot_len) {
+		die("The snapshot is incomplete", "");
+	}
+}
+
+/*
+ * Replay
+ */
+static uint64_t get_deadline(const struct motor_trace_record* rec)
+{
+	uint64_t out = 0;
+	for (int i = 0; i < 4; i++) {
+		out |= ((uint64_t)rec->values[1 + i]) << (16 * i);
+	}
+	return out;
+}
+
+static bool is_trace_finished(void)
+{
+	const struct motor_trace_record* records = NULL;
+	const unsigned num = motor_trace_get_records(&records);
+	return (num > 0) && (records[num - 1].type == MOTOR_TRACE_END);
+}
+
+static void replay_input(const struct motor_trace_record* rec)
+{
+	_now = _trigger_timestamp + (int64_t)rec->timestamp;
+
+	switch (rec->type) {
+	case MOTOR_TRACE_ADC_SAMPLE: {
+		struct motor_adc_sample sample;
+		memset(&sample, 0, sizeof(sample));
+		sample.timestamp = _now;
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			sample.phase_values[i] = rec->values[i];
+		}
+		sample.input_voltage = rec->values[3];
+		sample.input_current = rec->values[4];
+		_last_sample = sample;
+		motor_adc_sample_callback(&sample);
+		break;
+	}
+	case MOTOR_TRACE_TIMER: {
+		motor_timer_callback(_now);
+		break;
+	}
+	case MOTOR_TRACE_DUTY_CYCLE: {
+		push_pwm_val((int16_t)rec->values[0]);
+		const uint64_t deadline = get_deadline(rec);
+		if (deadline == 0) {
+			motor_rtctl_set_duty_cycle(0.0F);
+		} else {
+			motor_rtctl_set_duty_cycle_at(0.0F, deadline);
+		}
+		break;
+	}
+	case MOTOR_TRACE_END: {
+		if ((rec->values[0] == MOTOR_TRACE_END_STOP) && !is_trace_finished()) {
+			motor_rtctl_stop();
+		}
+		break;
+	}
+	default: {
+		break;     // Decisions are not inputs
+	}
+	}
+}
+
+static void restore_snapshot(void)
+{
+	unsigned index = 0;
+
+	memset(&_state, 0, sizeof(_state));
+	memset(&_diag, 0, sizeof(_diag));
+	memset(&_scheduled_duty_cycle, 0, sizeof(_scheduled_duty_cycle));
+
+	const bool reverse = _snapshot[index++] != 0;
+	_state.comm_table = reverse ? COMMUTATION_TABLE_REVERSE : COMMUTATION_TABLE_FORWARD;
+	_state.comm_table_zc_angles = reverse ? COMMUTATION_TABLE_REVERSE_ZC_ANGLES : COMMUTATION_TABLE_FORWARD_ZC_ANGLES;
+
+#define X(var)      if (index < _snapshot_len) { (var) = _snapshot[index]; } index++;
+	TRACE_SNAPSHOT_SCALARS(X)
+#undef X
+#define X(arr)      for (unsigned i = 0; i < sizeof(arr) / sizeof(arr[0]); i++) { \
+	                    if (index < _snapshot_len) { (arr)[i] = _snapshot[index]; } index++; }
+	TRACE_SNAPSHOT_ARRAYS(X)
+#undef X
+
+	if (index != _snapshot_len) {
+		die("Snapshot length mismatch; the trace was recorded by an incompatible firmware", "");
+	}
+}
+
+static void print_record(const char* prefix, unsigned index, const struct motor_trace_record* rec)
+{
+	printf("%s %5u %-5s flags=%-2u t=%-10li %5u %5u %5u %5u %5u\n", prefix, index,
+	       (rec->type <= MOTOR_TRACE_END) ? RECORD_TYPE_NAMES[rec->type] : "?",
+	       rec->flags, (long)rec->timestamp,
+	       rec->values[0], rec->values[1], rec->values[2], rec->values[3], rec->values[4]);
+}
+
+static bool records_equal(const struct motor_trace_record* a, const struct motor_trace_record* b)
+{
+	return (a->timestamp == b->timestamp) &&
+	       (a->type == b->type) &&
+	       (a->flags == b->flags) &&
+	       (memcmp(a->values, b->values, sizeof(a->values)) == 0);
+}
+
+int main(int argc, char* argv[])
+{
+	FILE* f = stdin;
+	if (argc > 1) {
+		f = fopen(argv[1], "r");
+		if (f == NULL) {
+			die("Could not open ", argv[1]);
+		}
+	}
+	load_trace(f);
+
+	printf("Loaded %u records, %u snapshot values, %i parameters\n",
+	       _num_recorded, _snapshot_len, _num_config_params);
+
+	/*
+	 * Initialization, then the control state is restored from the snapshot as if the motor was running
+	 */
+	const struct motor_rtctl_hardware_info hw_info = { .current_shunt_resistance = 0.001F };
+	_now = _trigger_timestamp;
+	if (motor_rtctl_init(&hw_info) != 0) {
+		die("Init failed", "");
+	}
+	motor_rtctl_confirm_initialization();
+
+	restore_snapshot();
+
+	motor_trace_arm(0);
+	motor_trace_start(_trigger_timestamp);
+	trace_check_trigger(_trigger_timestamp);
+
+	if ((_trace.snapshot_len != _snapshot_len) ||
+	    (memcmp(_trace.snapshot, _snapshot, sizeof(_snapshot[0]) * _snapshot_len) != 0)) {
+		die("The snapshot could not be restored; the trace was recorded by an incompatible firmware", "");
+	}
+
+	for (unsigned i = 0; i < _num_recorded; i++) {
+		replay_input(&_recorded[i]);
+	}
+
+	/*
+	 * Verification
+	 */
+	const struct motor_trace_record* replayed = NULL;
+	const unsigned num_replayed = motor_trace_get_records(&replayed);
+
+	unsigned counts[MOTOR_TRACE_END + 1] = {0};
+	for (unsigned i = 0; i < _num_recorded; i++) {
+		counts[_recorded[i].type]++;
+	}
+	printf("Recorded: %u ADC samples, %u timer callbacks, %u duty cycle updates, %u ZC, %u steps\n",
+	       counts[MOTOR_TRACE_ADC_SAMPLE], counts[MOTOR_TRACE_TIMER], counts[MOTOR_TRACE_DUTY_CYCLE],
+	       counts[MOTOR_TRACE_ZC], counts[MOTOR_TRACE_STEP]);
+
+	for (unsigned i = 0; i < _num_recorded; i++) {
+		if ((i < num_replayed) && records_equal(&_recorded[i], &replayed[i])) {
+			continue;
+		}
+		printf("MISMATCH at record %u\n", i);
+		for (unsigned k = (i > CONTEXT_RECORDS) ? (i - CONTEXT_RECORDS) : 0; k < i; k++) {
+			print_record("       ", k, &_recorded[k]);
+		}
+		print_record("expect ", i, &_recorded[i]);
+		if (i < num_replayed) {
+			print_record("actual ", i, &replayed[i]);
+		} else {
+			printf("actual  the replayed trace ended after %u records\n", num_replayed);
+		}
+		return 1;
+	}
+
+	if (num_replayed != _num_recorded) {
+		printf("MISMATCH: %u extra records replayed\n", num_replayed - _num_recorded);
+		print_record("actual ", _num_recorded, &replayed[_num_recorded]);
+		return 1;
+	}
+
+	printf("OK: all %u records are bit-exact\n", _num_recorded);
+	return 0;
+}
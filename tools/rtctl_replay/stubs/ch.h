@@ -0,0 +1,18 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Minimal ChibiOS API needed to build the realtime motor control logic on the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef int tprio_t;
+
+#define HIGHPRIO    255
+
+void chSysSuspend(void);
+void chSysEnable(void);
+void chSysHalt(const char* reason);
+tprio_t chThdSetPriority(tprio_t prio);
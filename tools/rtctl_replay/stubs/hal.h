@@ -0,0 +1,21 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Minimal HAL and CMSIS API needed to build the realtime motor control logic on the host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+extern uint32_t stub_primask;
+
+static inline uint32_t __get_PRIMASK(void)
+{
+	return stub_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+	stub_primask = primask;
+}
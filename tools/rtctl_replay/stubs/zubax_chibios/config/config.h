@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * The configuration parameters are loaded from the trace, see replay.c.
+ */
+
+#pragma once
+
+#define CONFIG_PARAM_INT(name, default_, min, max)
+#define CONFIG_PARAM_FLOAT(name, default_, min, max)
+#define CONFIG_PARAM_BOOL(name, default_)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+float configGet(const char* name);
+const char* configNameByIndex(int index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Regression scenarios of the motor control logic, evaluated with the simulator of sweep.py.
+
+Every scenario runs the simulator with a motor model and a set of parameters, and checks the metrics of sweep.py
+against the bounds of the scenario. Some scenarios are controls that show that the scenario is hard enough to be
+meaningful, i.e. that the feature under test makes a difference; their bounds are the other way around.
+The exit code is non-zero if any scenario is out of its bounds.
+
+Examples:
+  make
+  ./regress.py
+  ./regress.py shaper
+"""
+
+import os
+import sys
+import argparse
+from concurrent.futures import ThreadPoolExecutor
+
+import sweep
+
+# Setpoint steps through the limiters of motor.c; the adaptive acceleration limiter stays disabled
+# (mot_acc_scl_min=1, the default), so that the setpoint shaper is evaluated alone
+SETPOINT_STEPS = {'control': 1, 'dc_rate': 1000, 'dc_steps': 2, 'hold': 1, 'mot_acc_scl_min': 1}
+
+# Duty cycle levels from 0.02 to 0.1, held for 0.5 s each
+LOW_SPEED_LEVELS = {'dc_end': 0.1, 'dc_steps': 5, 'hold': 0.5, 'dc_rate': 0.05}
+
+# Duty cycle levels up to 100%, held for 1 s each, so that the neutral voltage compensation has time to converge
+NEUTRAL_LEVELS = {'hold': 1}
+
+# Name, motor model, parameters, trials, bounds {metric: (min, max)}
+SCENARIOS = [
+    ('shaper_control_lowkv', 'lowkv', dict(SETPOINT_STEPS), 20,
+     {'desync': (0.5, 1)}),
+    ('shaper_lowkv', 'lowkv', dict(SETPOINT_STEPS, mot_sp_v_rate=20, mot_sp_v_accel=200), 20,
+     {'start': (1, 1), 'desync': (0, 0)}),
+    ('shaper_highkv', 'highkv', dict(SETPOINT_STEPS, mot_sp_v_rate=20, mot_sp_v_accel=200), 20,
+     {'start': (1, 1), 'desync': (0, 0)}),
+    # Scheduled setpoints are applied within one ADC sampling period (16.7 usec at 60 kHz) past the scheduled time,
+    # plus the IRQ latency, regardless of the commutation period; in the ramp, the setpoints arrive faster than the
+    # scheduling delay and must not postpone each other indefinitely. The large steps may throw the logic into the
+    # sync recovery, where the setpoint waits for the next commutation. The skew between the nodes of a bus is
+    # checked by skew.py
+    ('sync_steps', 'highkv', dict(dc_rate=1000, sync_delay=2000), 10,
+     {'desync': (0, 0), 'sync_applied': (4, 4), 'sync_lag_cp': (0, 1.1)}),
+    ('sync_ramp', 'highkv', dict(sync_delay=5000), 5,
+     {'desync': (0, 0), 'sync_applied': (100, 1000), 'sync_lag': (0, 20)}),
+    # The levels go down to about 120 RPM, a third of the lowest speed of the ZC detector (mot_comm_per_max), and back
+    # up through the handover; the ramp is slow because the averaged comm period lags behind a fast deceleration,
+    # which the simulator would take for a loss of sync
+    ('low_speed_control', 'default', dict(LOW_SPEED_LEVELS), 3,
+     {'desync': (1, 1)}),
+    ('low_speed', 'default', dict(LOW_SPEED_LEVELS, mot_ls_cp_max=20000), 3,
+     {'desync': (0, 0), 'min_rpm': (0, 200)}),
+    # ZC timing error against the true BEMF zero crossings with unequal phases; the learned compensation must remove
+    # most of it, and must not make it worse with equal phases
+    ('neutral_control', 'default', dict(NEUTRAL_LEVELS, asym=1), 3,
+     {'desync': (0, 0), 'zc_err': (1, 10)}),
+    ('neutral_comp', 'default', dict(NEUTRAL_LEVELS, asym=1, mot_neutral_comp=1), 3,
+     {'desync': (0, 0), 'zc_err': (0, 0.4)}),
+    ('neutral_comp_symmetric', 'default', dict(NEUTRAL_LEVELS, mot_neutral_comp=1), 3,
+     {'desync': (0, 0), 'zc_err': (0, 0.3)}),
+    # The step responses of the bench scenarios of firmware/src/motor/bench.c; the settling time of the first step of
+    # the RPM scenario includes the spin-up, where the RPM controller starts with an empty integrator
+    ('bench_dc', 'default', dict(bench='dc'), 3,
+     {'start': (1, 1), 'desync': (0, 0), 'overshoot': (0, 3), 'settling': (0, 0.6)}),
+    ('bench_dc_small', 'default', dict(bench='dc_small'), 3,
+     {'start': (1, 1), 'desync': (0, 0), 'overshoot': (0, 3), 'settling': (0, 0.6)}),
+    ('bench_rpm', 'default', dict(bench='rpm'), 3,
+     {'start': (1, 1), 'desync': (0, 0), 'overshoot': (0, 3), 'settling': (0, 1.2)}),
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('prefix', nargs='?', default='', help='run only the scenarios whose names start with this')
+    parser.add_argument('--jobs', '-j', type=int, default=os.cpu_count(), help='parallel simulator processes')
+    args = parser.parse_args()
+
+    if not os.path.isfile(sweep.SIM):
+        print('The simulator is not built, run make first', file=sys.stderr)
+        return 1
+
+    scenarios = [s for s in SCENARIOS if s[0].startswith(args.prefix)]
+    with ThreadPoolExecutor(max_workers=max(args.jobs, 1)) as executor:
+        futures = [executor.submit(sweep.evaluate, params, {}, sweep.MOTORS[motor], trials, 1)
+                   for _, motor, params, trials, _ in scenarios]
+
+        num_failed = 0
+        for (name, motor, params, trials, bounds), future in zip(scenarios, futures):
+            metrics = future.result()
+            failed = [m for m, (lo, hi) in sorted(bounds.items()) if not (lo <= metrics[m] <= hi)]
+            num_failed += 1 if failed else 0
+            extra = [m for m in sorted(bounds) if m not in [name for name, _, _ in sweep.METRICS]]
+            print('%-24s %-4s %s' % (name, 'FAIL' if failed else 'OK',
+                                     '  '.join(['%s=%s' % (m, fmt % metrics[m]) for m, fmt, _ in sweep.METRICS] +
+                                               ['%s=%s' % (m, metrics[m]) for m in extra])))
+            for m in failed:
+                print('    %s is out of [%s; %s]' % (m, bounds[m][0], bounds[m][1]))
+
+    print('%d of %d scenarios failed' % (num_failed, len(scenarios)))
+    return 1 if num_failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,1355 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Runs the six-step commutation logic against a simulated motor and reports how it performed; this is the
+ * backend of the parameter sweep implemented in sweep.py.
+ *
+ * The realtime motor control logic is built from the unmodified firmware sources. The stubs of the PWM,
+ * ADC and timer drivers are connected to an averaged model of the inverter and a three phase PMSM with
+ * sinusoidal back EMF, driving a propeller. The model includes the freewheeling diodes, so that the
+ * demagnetization after commutation and the BEMF outside of the supply range look like on the real hardware.
+ *
+ * Each trial starts the motor from a random rotor angle, like motor.c does, waits for it to enter the
+ * running state, then ramps the duty cycle up to 100% in several steps. Each step is held for a while;
+ * the input and output power are integrated over the second half of the hold.
+ *
+ * With control=1, the ramped duty cycle is a setpoint which passes through the setpoint shaper and the limiters
+ * of motor.c, including the adaptive acceleration limiter if it is enabled (mot_acc_scl_min < 1), before it reaches
+ * the realtime logic; with dc_rate high enough, the levels become setpoint steps, which is how the shaper and
+ * the limiters are evaluated.
+ *
+ * With sync_delay > 0, every new setpoint is scheduled with motor_rtctl_set_duty_cycle_at() sync_delay
+ * microseconds ahead, with the same rules as motor_set_duty_cycle_at(); the lag between the scheduled time and
+ * the commutation step that applied the setpoint is measured, in microseconds and in commutation periods.
+ * The lag is measured for the setpoints that were applied before the next one was scheduled, i.e. not in ramps
+ * faster than the commutation; sync_applied is the number of scheduled times that were reached.
+ *
+ * With bus_period > 0, the duty cycle is sent in frames on a simulated bus instead, and each frame is scheduled
+ * sync_delay microseconds past its RX timestamp, like esc_controller.cpp does with cmd_sync_us; with sync_delay=0
+ * the frames are applied as soon as the callback gets them. Every applied frame prints the time when it should
+ * have been applied and the time when the realtime logic applied it, in microseconds of the simulated time:
+ *   SYNC <frame> deadline=<usec> applied=<usec>
+ * skew.py runs several simulator processes as the nodes of one bus and compares the times of the same frames.
+ *
+ * The duty cycle levels are spread evenly up to dc_end, the motor is ramped from the startup duty cycle down or up
+ * to the first level. With a small dc_end, the levels go below the range of the ZC detector, which is how
+ * the low speed mode (mot_ls_cp_max) is evaluated; min_rpm is the lowest speed held in sync. mean_rpm is the
+ * average speed over the same windows as the efficiency, so that it can be compared with tools/foc_sim.
+ *
+ * With asym > 0, the phases of the model are made unequal: the winding resistances differ by +30% and -20%,
+ * the voltage dividers by +2% and -1.5%, the ADC channels have +6 and -4 LSB offsets, and 1% of the PWM voltage
+ * couples into the floating phase; asym scales all of these. The ZC timestamps detected by the realtime logic
+ * are taken from its trace hooks (the probes below, which pass the records on to motor_trace.c) and compared against
+ * the true zero crossings of the BEMF of the floating phase; zc_err is the RMS error in electrical degrees. This is how
+ * the neutral voltage compensation (mot_neutral_comp) is evaluated.
+ *
+ * With trace >= 0, the first trial is recorded by motor_trace.c like "m trace arm <trace>" does on the firmware, and
+ * the trace is printed after its TRIAL line in the format of "m trace"; this is how the reference traces of
+ * tools/rtctl_replay are made. The recording starts trace milliseconds after the start of the motor.
+ *
+ * Usage:
+ *   ./sim [name=value ...] [bench=<scenario>]
+ *
+ * With bench=<scenario>, the trials run a scenario of the bench command of the firmware (bench.c) instead of the
+ * duty cycle levels: the setpoints of the steps are passed through the same logic as in motor.c, i.e. the setpoint
+ * shapers, the RPM controller (rpmctl.c), and the limiters, and they are refreshed every 10 ms like the console
+ * does. The response is recorded and evaluated by bench.c, so the numbers are comparable with the bench;
+ * the first step includes the spin-up. A desync is what the firmware takes for one, i.e. the realtime logic
+ * leaving the running state, and it ends the trial. The time when the commutation did not match the rotor speed
+ * is reported separately as out_of_sync, because the averaged comm period lags behind a hard deceleration, e.g.
+ * when the RPM controller starts with an empty integrator. Each step of each trial prints one line:
+ *   STEP <trial> <step> kind=<dc|rpm> setpoint=<value> ramp=<0|1> rpm_from=<RPM> rpm_to=<RPM> rise=<s>
+ *        overshoot=<%> settling=<s> peak_current=<A> desyncs=<count> zc_failures=<count> out_of_sync=<s>
+ *
+ * Names starting with "mot_" and "rpmctl_" are the firmware configuration parameters; other names define the
+ * motor model and the test, see the tables below. Each trial prints one line of metrics:
+ *   TRIAL <index> started=<0|1> t_running=<s> max_rpm=<RPM> efficiency=<0..1> desync=<0|1>
+ *         zc_failures=<count> steps=<count> sync_applied=<count> sync_lag=<usec> sync_lag_cp=<periods>
+ *         min_rpm=<RPM> mean_rpm=<RPM> zc_err=<deg>
+ * Values that could not be measured in the trial are printed as "nan".
+ */
+
+#include <api.h>
+#include <adc.h>
+#include <pwm.h>
+#include <timer.h>
+#include <foc.h>
+#include <forced_rotation_detection.h>
+#include <trace.h>
+#include <zubax_chibios/config/config.h>
+#include <dc_limiter.h>
+#include <setpoint_shaper.h>
+#include <rpmctl.h>
+#include <bench.h>
+#include <motor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+// The probes below chain to the recorder, see trace_add_record_from_isr()
+#define motor_trace_add_from_isr    trace_add_record_from_isr
+#include "motor_trace.c"
+#undef motor_trace_add_from_isr
+
+#define PWM_TIMER_FREQUENCY     72000000
+#define ADC_REF_VOLTAGE         3.3
+#define ADC_RESOLUTION          12
+#define VOLTAGE_DIVIDER_RTOP    10.0
+#define VOLTAGE_DIVIDER_RBOT    1.3
+#define CURRENT_AMP_GAIN        10.0
+#define CURRENT_SHUNT           1e-3
+
+#define MAX_SUBSTEP_HNSEC       20
+#define THREAD_PERIOD_HNSEC     HNSEC_PER_MSEC
+#define SYNC_TOLERANCE          0.1
+#define SYNC_LOSS_TIMEOUT_MSEC  20
+#define SYNC_LOSS_TIMEOUT_STEPS 6           ///< At low speed, the timeout is one electrical revolution
+#define TRIAL_TIMEOUT_SEC       30
+
+uint32_t stub_primask;
+
+struct named_value
+{
+	const char* name;
+	double* value;
+};
+
+/*
+ * Configuration parameters read by the realtime logic and by the startup code in motor.c
+ */
+static struct
+{
+	const char* name;
+	float value;
+} _config[] = {
+	{ "mot_tim_adv_min",   5 },
+	{ "mot_tim_adv_max",   15 },
+	{ "mot_tim_cp_max",    300 },
+	{ "mot_tim_cp_min",    600 },
+	{ "mot_blank_usec",    40 },
+	{ "mot_bemf_win_den",  4 },
+	{ "mot_bemf_range",    90 },
+	{ "mot_zc_fails_max",  100 },
+	{ "mot_comm_per_max",  4000 },
+	{ "mot_ls_cp_max",     0 },
+	{ "mot_neutral_comp",  0 },
+	{ "mot_spup_st_cp",    100000 },
+	{ "mot_spup_to_ms",    5000 },
+	{ "mot_spup_blnk_pm",  100 },
+	{ "mot_spup_vramp_t",  3.0F },
+	{ "mot_v_spinup",      0.5F },
+	{ "mot_v_min",         2.5F },
+	{ "mot_foc_enable",    0 },
+	{ "mot_foc_cp_max",    500 },
+	{ "mot_pwm_hz",        60000 },
+	{ "mot_dc_accel",      0.09F },
+	{ "mot_dc_slope",      5.0F },
+	{ "mot_i_max",         20.0F },
+	{ "mot_i_max_p",       0.2F },
+	{ "mot_lpf_freq",      20.0F },
+	{ "mot_acc_scl_min",   1 },
+	{ "mot_acc_i_knee",    0.6F },
+	{ "mot_acc_recov",     2.0F },
+	{ "mot_sp_v_rate",     0 },
+	{ "mot_sp_v_accel",    0 },
+	{ "mot_sp_rpm_rate",   0 },
+	{ "mot_sp_rpm_accel",  0 },
+	{ "mot_rpm_min",       1000 },
+	{ "rpmctl_p",          0.0001F },
+	{ "rpmctl_d",          0 },
+	{ "rpmctl_i",          0.001F }
+};
+#define NUM_CONFIG_PARAMS   ((int)(sizeof(_config) / sizeof(_config[0])))
+
+/*
+ * Motor model; the defaults roughly describe a 700 KV multirotor motor with a 10" propeller
+ */
+static struct
+{
+	double vbus;            ///< Volt
+	double r;               ///< Ohm, phase
+	double l;               ///< Henry, phase
+	double kv;              ///< RPM/V
+	double poles;
+	double j;               ///< kg*m^2, rotor and propeller
+	double kprop;           ///< N*m*s^2, propeller torque per squared angular velocity
+	double tfric;           ///< N*m
+	double vdiode;          ///< Volt, forward voltage of the freewheeling diodes
+	double noise;           ///< ADC LSB, amplitude of the uniform noise
+	double latency;         ///< Microsecond, max timer IRQ latency
+	double asym;            ///< Scale of the phase asymmetry, see above; 0 - symmetric phases
+} _model = {
+	12.0, 0.1, 30e-6, 700, 14, 2e-5, 2.5e-7, 0.005, 0.7, 3, 2, 0
+};
+
+static const struct named_value MODEL_PARAMS[] = {
+	{ "vbus", &_model.vbus },
+	{ "r", &_model.r },
+	{ "l", &_model.l },
+	{ "kv", &_model.kv },
+	{ "poles", &_model.poles },
+	{ "j", &_model.j },
+	{ "kprop", &_model.kprop },
+	{ "tfric", &_model.tfric },
+	{ "vdiode", &_model.vdiode },
+	{ "noise", &_model.noise },
+	{ "latency", &_model.latency },
+	{ "asym", &_model.asym }
+};
+
+/*
+ * Phase asymmetry at asym=1
+ */
+static const double ASYM_R[MOTOR_NUM_PHASES] = { 0.0, 0.3, -0.2 };         ///< Relative winding resistance error
+static const double ASYM_GAIN[MOTOR_NUM_PHASES] = { 0.0, 0.02, -0.015 };   ///< Relative voltage divider error
+static const double ASYM_OFFSET[MOTOR_NUM_PHASES] = { 6, -4, 0 };          ///< ADC LSB
+#define ASYM_COUPLING           0.01
+
+/*
+ * Test definition
+ */
+static struct
+{
+	double trials;
+	double seed;
+	double dc_rate;         ///< Duty cycle per second
+	double dc_steps;        ///< Number of duty cycle levels up to 100%
+	double hold;            ///< Second, duration of each level
+	double control;         ///< 1 - pass the duty cycle through the limiters of motor.c
+	double sync_delay;      ///< Microsecond, apply the setpoints this much later; 0 - immediately
+	double dc_end;          ///< Duty cycle of the last level
+	double bus_period;      ///< Microsecond, period of the setpoint frames on the bus; 0 - no bus, see above
+	double rx_jitter;       ///< Microsecond, max latency of the CAN RX interrupt that timestamps a frame
+	double cb_delay;        ///< Microsecond, max delay from the reception to the subscriber callback
+	double trace;           ///< Millisecond, record the first trial this long after the start; negative - no trace
+} _test = {
+	5, 1, 1.0, 4, 0.2, 0, 0, 1.0, 0, 5, 1000, -1
+};
+
+static const struct named_value TEST_PARAMS[] = {
+	{ "trials", &_test.trials },
+	{ "seed", &_test.seed },
+	{ "dc_rate", &_test.dc_rate },
+	{ "dc_steps", &_test.dc_steps },
+	{ "hold", &_test.hold },
+	{ "control", &_test.control },
+	{ "sync_delay", &_test.sync_delay },
+	{ "dc_end", &_test.dc_end },
+	{ "bus_period", &_test.bus_period },
+	{ "rx_jitter", &_test.rx_jitter },
+	{ "cb_delay", &_test.cb_delay },
+	{ "trace", &_test.trace }
+};
+
+/*
+ * Simulation state
+ */
+static uint64_t _now;
+static uint64_t _timer_deadline;
+static bool _timer_armed;
+static uint32_t _adc_period;
+static bool _adc_enabled;
+static int _pwm_top;
+static uint32_t _random_state = 1;
+
+static const struct motor_pwm_commutation_step* _step;
+static int _pwm_val;
+static unsigned _num_steps;
+static struct motor_adc_sample _last_sample;
+
+static struct
+{
+	double current[MOTOR_NUM_PHASES];       ///< Ampere, into the motor
+	bool clamped_high[MOTOR_NUM_PHASES];    ///< Which diode conducts the current of a non-driven phase
+	double angle;                           ///< Electrical radian
+	double speed;                           ///< Electrical radian per second
+	double energy_in;                       ///< Joule, from the supply
+	double energy_out;                      ///< Joule, delivered to the propeller
+} _motor;
+
+static double _pole_pairs;
+static double _flux;                        ///< Weber, phase flux linkage
+static double _phase_r[MOTOR_NUM_PHASES];   ///< Ohm
+
+/*
+ * Scheduled setpoints, see sync_delay
+ */
+static struct
+{
+	float duty_cycle;                       ///< Latest setpoint
+	uint64_t apply_at;                      ///< Same as setpoint_apply_at in motor.c
+	uint64_t deadline;                      ///< Of the setpoint being measured; zero if none
+	int pwm_val;                            ///< Of the setpoint being measured
+	unsigned num_applied;                   ///< Scheduled times reached by the control thread
+	unsigned num_measured;                  ///< Setpoints applied before the next one was scheduled
+	double lag_max;                         ///< Microsecond
+	double lag_cp_max;                      ///< Commutation periods
+} _sync;
+
+/*
+ * Setpoint frames on the bus, see bus_period
+ */
+#define BUS_DITHER              0.02F
+
+static struct
+{
+	unsigned frame;                         ///< Index of the next frame
+	uint64_t rx_timestamp;                  ///< Of the next frame
+	uint64_t callback_at;                   ///< Of the next frame; zero if there is no bus
+	unsigned measured_frame;
+	uint64_t deadline;                      ///< Of the frame being measured; zero if none
+	int pwm_val;                            ///< Of the frame being measured
+} _bus;
+
+/*
+ * ZC timing of the current commutation step, see asym
+ */
+static struct
+{
+	uint64_t true_zc;                       ///< Zero crossing of the BEMF of the floating phase; zero if not yet
+	uint64_t detected_zc;                   ///< Reported by the realtime logic; zero if not yet or measured
+	int floating;                           ///< Phase whose BEMF is tracked; -1 if none
+	double prev_emf;
+	double sum_sq;                          ///< Electrical degree squared
+	unsigned count;
+} _zc;
+
+static bool is_measuring(void);
+
+
+static void die(const char* msg, const char* arg)
+{
+	fprintf(stderr, "ERROR: %s%s\n", msg, arg);
+	exit(2);
+}
+
+static double random_uniform(void)   ///< xorshift32, in order to be reproducible regardless of the C library
+{
+	_random_state ^= _random_state << 13;
+	_random_state ^= _random_state >> 17;
+	_random_state ^= _random_state << 5;
+	return _random_state / 4294967296.0;
+}
+
+static int volts_to_raw(double volts)
+{
+	const double raw = volts * (VOLTAGE_DIVIDER_RBOT / (VOLTAGE_DIVIDER_RTOP + VOLTAGE_DIVIDER_RBOT)) /
+	                   ADC_REF_VOLTAGE * (1 << ADC_RESOLUTION);
+	return (int)raw;
+}
+
+static int amperes_to_raw(double amperes)
+{
+	return (int)(amperes * CURRENT_SHUNT * CURRENT_AMP_GAIN / ADC_REF_VOLTAGE * (1 << ADC_RESOLUTION));
+}
+
+static int add_adc_noise(int raw)
+{
+	raw += (int)lround((random_uniform() * 2.0 - 1.0) * _model.noise);
+	return (raw < 0) ? 0 : ((raw >= (1 << ADC_RESOLUTION)) ? ((1 << ADC_RESOLUTION) - 1) : raw);
+}
+
+/*
+ * Stubs
+ */
+float configGet(const char* name)
+{
+	for (int i = 0; i < NUM_CONFIG_PARAMS; i++) {
+		if (!strcmp(_config[i].name, name)) {
+			return _config[i].value;
+		}
+	}
+	die("Unknown parameter requested: ", name);
+	return 0;
+}
+
+const char* configNameByIndex(int index)
+{
+	return (index >= 0 && index < NUM_CONFIG_PARAMS) ? _config[index].name : NULL;
+}
+
+void chSysSuspend(void) { }
+void chSysEnable(void) { }
+void chSysHalt(const char* reason) { die("Halted: ", reason); }
+tprio_t chThdSetPriority(tprio_t prio) { return prio; }
+
+int motor_pwm_init(void) { return 0; }
+uint32_t motor_adc_sampling_period_hnsec(void) { return _adc_period; }
+void motor_pwm_manip(const enum motor_pwm_phase_manip command[MOTOR_NUM_PHASES]) { (void)command; }
+void motor_pwm_set_freewheeling(void) { _step = NULL; }
+void motor_pwm_emergency(void) { _step = NULL; }
+
+static void measure_sync_lag(int pwm_val)
+{
+	if ((_bus.deadline > 0) && (_now >= _bus.deadline) && (pwm_val == _bus.pwm_val)) {
+		printf("SYNC %u deadline=%.1f applied=%.1f\n", _bus.measured_frame,
+		       _bus.deadline / (double)HNSEC_PER_USEC, _now / (double)HNSEC_PER_USEC);
+		_bus.deadline = 0;
+	}
+
+	if ((_sync.deadline > 0) && (_now >= _sync.deadline) && (pwm_val == _sync.pwm_val)) {
+		const double lag = (_now - _sync.deadline) / (double)HNSEC_PER_USEC;
+		const uint32_t comm_period = motor_rtctl_get_comm_period_hnsec();
+		_sync.lag_max = fmax(_sync.lag_max, lag);
+		if (comm_period > 0) {
+			_sync.lag_cp_max = fmax(_sync.lag_cp_max, lag * HNSEC_PER_USEC / comm_period);
+		}
+		_sync.num_measured++;
+		_sync.deadline = 0;
+	}
+}
+
+void motor_pwm_set_step_from_isr(const struct motor_pwm_commutation_step* step, int pwm_val)
+{
+	if ((step == _step) && (pwm_val != _pwm_val)) {
+		_pwm_val = pwm_val;         // The PWM value is updated within the step, see motor_rtctl.c
+		measure_sync_lag(pwm_val);
+		return;
+	}
+
+	_step = step;
+	_pwm_val = pwm_val;
+	_num_steps++;
+
+	_zc.true_zc = 0;
+	_zc.detected_zc = 0;
+	_zc.floating = -1;
+
+	measure_sync_lag(pwm_val);
+}
+int motor_pwm_get_top(void) { return _pwm_top; }
+void motor_pwm_beep(int frequency, int duration_msec)
+{
+	(void)frequency;
+	(void)duration_msec;
+}
+
+/// Same as in motor_pwm.c
+int motor_pwm_compute_pwm_val(float duty_cycle)
+{
+	const float abs_duty_cycle = fabsf(duty_cycle);
+	const int int_duty_cycle = (abs_duty_cycle > 0.999F) ? _pwm_top : (int)(abs_duty_cycle * _pwm_top);
+	if (duty_cycle >= 0) {
+		return _pwm_top - ((_pwm_top - int_duty_cycle) / 2) + 1;
+	}
+	return (_pwm_top - int_duty_cycle) / 2;
+}
+
+int motor_adc_init(float current_shunt_resistance) { (void)current_shunt_resistance; return 0; }
+void motor_adc_enable_from_isr(void) { _adc_enabled = true; }
+void motor_adc_disable_from_isr(void) { _adc_enabled = false; }
+void motor_adc_set_current_sampling_mode(bool enabled) { (void)enabled; }
+struct motor_adc_sample motor_adc_get_last_sample(void) { return _last_sample; }
+
+float motor_adc_convert_input_voltage(int raw)
+{
+	return raw * (ADC_REF_VOLTAGE / (1 << ADC_RESOLUTION)) *
+	       ((VOLTAGE_DIVIDER_RTOP + VOLTAGE_DIVIDER_RBOT) / VOLTAGE_DIVIDER_RBOT);
+}
+
+float motor_adc_convert_input_current(int raw)
+{
+	return raw * (ADC_REF_VOLTAGE / (1 << ADC_RESOLUTION)) / CURRENT_AMP_GAIN / CURRENT_SHUNT;
+}
+
+void motor_timer_init(void) { }
+uint64_t motor_timer_hnsec(void) { return _now; }
+
+void motor_timer_set_relative(int64_t delay_hnsec)
+{
+	_timer_deadline = _now + ((delay_hnsec > 0) ? delay_hnsec : 0);
+	_timer_armed = true;
+}
+
+int64_t motor_timer_set_absolute(uint64_t timestamp_hnsec)
+{
+	const int64_t delta = (int64_t)(timestamp_hnsec - _now);
+	motor_timer_set_relative(delta);
+	return delta;
+}
+
+void motor_timer_cancel(void) { _timer_armed = false; }
+
+void motor_foc_init(void) { }
+bool motor_foc_is_enabled(void) { return false; }
+uint32_t motor_foc_get_handover_comm_period_hnsec(void) { return 0; }
+void motor_foc_set_duty_cycle(float duty_cycle) { (void)duty_cycle; }
+void motor_foc_start_from_isr(uint16_t angle, uint32_t comm_period, int direction)
+{
+	(void)angle;
+	(void)comm_period;
+	(void)direction;
+}
+enum motor_foc_result motor_foc_update_from_isr(const struct motor_adc_sample* sample)
+{
+	(void)sample;
+	return MOTOR_FOC_RESULT_FAILED;
+}
+uint16_t motor_foc_get_angle(void) { return 0; }
+uint32_t motor_foc_get_comm_period_hnsec(void) { return 0; }
+int motor_foc_get_input_current_raw(void) { return 0; }
+void motor_foc_get_phase_currents(float out_currents[3]) { memset(out_currents, 0, sizeof(float) * 3); }
+void motor_foc_print_debug_info(void) { }
+
+void motor_forced_rotation_detector_init(void) { }
+void motor_forced_rotation_detector_reset(void) { }
+void motor_forced_rotation_detector_update_from_adc_callback(
+	const struct motor_pwm_commutation_step comm_table[MOTOR_NUM_COMMUTATION_STEPS],
+	const struct motor_adc_sample* adc_sample)
+{
+	(void)comm_table;
+	(void)adc_sample;
+}
+enum motor_rtctl_forced_rotation motor_forced_rotation_detector_get_state(void)
+{
+	return MOTOR_RTCTL_FORCED_ROT_NONE;
+}
+
+/*
+ * Trace probes
+ */
+static void measure_zc(void)
+{
+	const uint32_t comm_period = motor_rtctl_get_comm_period_hnsec();
+	if ((_zc.true_zc > 0) && (_zc.detected_zc > 0) && (comm_period > 0)) {
+		if (is_measuring()) {
+			const double error = ((double)_zc.detected_zc - (double)_zc.true_zc) / comm_period * 60.0;
+			_zc.sum_sq += error * error;
+			_zc.count++;
+		}
+		_zc.detected_zc = 0;
+	}
+}
+
+struct motor_trace_record* motor_trace_add_from_isr(enum motor_trace_record_type type, uint64_t timestamp,
+                                                    unsigned flags)
+{
+	if (type == MOTOR_TRACE_ZC) {
+		_zc.detected_zc = timestamp;
+		measure_zc();
+	}
+	return trace_add_record_from_isr(type, timestamp, flags);
+}
+
+/*
+ * Motor model
+ */
+static double bemf(int phase)
+{
+	return -_flux * _motor.speed * sin(_motor.angle - phase * (2.0 * M_PI / 3.0));
+}
+
+/// Relative duty cycles of the high side switches
+static void get_high_side_duty_cycles(double out[MOTOR_NUM_PHASES])
+{
+	memset(out, 0, sizeof(double) * MOTOR_NUM_PHASES);
+	if (_step != NULL) {
+		const double duty = fmin(_pwm_val / (double)_pwm_top, 1.0);
+		out[_step->positive] = duty;
+		out[_step->negative] = 1.0 - duty;      // Complementary PWM, see motor_pwm_set_step_from_isr()
+	}
+}
+
+static bool is_driven(int phase)
+{
+	return (_step != NULL) && ((phase == _step->positive) || (phase == _step->negative));
+}
+
+static void update_motor(double dt)
+{
+	double emf[MOTOR_NUM_PHASES];
+	double voltage[MOTOR_NUM_PHASES];
+	double high_side[MOTOR_NUM_PHASES];
+	bool conducting[MOTOR_NUM_PHASES];
+
+	get_high_side_duty_cycles(high_side);
+
+	/*
+	 * Terminal voltages averaged over the PWM period. A non-driven phase conducts through the freewheeling
+	 * diodes while its current decays, or when its voltage goes beyond the supply rails.
+	 */
+	int num_conducting = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		emf[i] = bemf(i);
+		conducting[i] = is_driven(i) || (_motor.current[i] != 0);
+		if (is_driven(i)) {
+			voltage[i] = _model.vbus * high_side[i];
+		} else if (conducting[i]) {
+			_motor.clamped_high[i] = _motor.current[i] < 0;
+			voltage[i] = _motor.clamped_high[i] ? (_model.vbus + _model.vdiode) : -_model.vdiode;
+		}
+		num_conducting += conducting[i] ? 1 : 0;
+	}
+
+	double neutral = 0;
+	for (int pass = 0; pass < 2 && num_conducting >= 2; pass++) {
+		neutral = 0;
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			neutral += conducting[i] ? (voltage[i] - emf[i]) : 0;
+		}
+		neutral /= num_conducting;
+
+		if (num_conducting == MOTOR_NUM_PHASES) {
+			break;
+		}
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			const double open_voltage = emf[i] + neutral;
+			if (!conducting[i] && ((open_voltage > _model.vbus + _model.vdiode) || (open_voltage < -_model.vdiode))) {
+				conducting[i] = true;
+				_motor.clamped_high[i] = open_voltage > 0;
+				voltage[i] = _motor.clamped_high[i] ? (_model.vbus + _model.vdiode) : -_model.vdiode;
+				num_conducting++;
+			}
+		}
+	}
+
+	/*
+	 * Phase currents; a diode can't conduct in the opposite direction
+	 */
+	double supply_current = 0;
+	double torque = 0;
+	if (num_conducting >= 2) {
+		double residual = 0;
+		int num_adjustable = 0;
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			if (!conducting[i]) {
+				continue;
+			}
+			const double di = (voltage[i] - neutral - emf[i] - _phase_r[i] * _motor.current[i]) / _model.l * dt;
+			const double current = _motor.current[i] + di;
+			if (!is_driven(i) && (_motor.clamped_high[i] ? (current > 0) : (current < 0))) {
+				residual += current;
+				_motor.current[i] = 0;
+			} else {
+				_motor.current[i] = current;
+				num_adjustable++;
+			}
+		}
+		for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+			if (conducting[i] && (_motor.current[i] != 0) && (num_adjustable > 0)) {
+				_motor.current[i] += residual / num_adjustable;
+			}
+		}
+	} else {
+		memset(_motor.current, 0, sizeof(_motor.current));
+	}
+
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		if (is_driven(i)) {
+			supply_current += high_side[i] * _motor.current[i];
+		} else if (_motor.current[i] != 0 && _motor.clamped_high[i]) {
+			supply_current += _motor.current[i];
+		}
+		torque += -_pole_pairs * _flux * sin(_motor.angle - i * (2.0 * M_PI / 3.0)) * _motor.current[i];
+	}
+
+	/*
+	 * Mechanics
+	 */
+	const double omega = _motor.speed / _pole_pairs;
+	const double prop_torque = _model.kprop * omega * omega;
+	double next_omega = omega;
+	if (omega == 0 && fabs(torque) <= _model.tfric) {
+		next_omega = 0;                                          // Static friction
+	} else {
+		const double sign = (omega != 0) ? ((omega > 0) ? 1.0 : -1.0) : ((torque > 0) ? 1.0 : -1.0);
+		next_omega = omega + (torque - sign * (prop_torque + _model.tfric)) / _model.j * dt;
+		if ((omega != 0) && ((next_omega > 0) != (omega > 0))) {
+			next_omega = 0;                                      // Friction can't reverse the rotation
+		}
+	}
+
+	_motor.speed = next_omega * _pole_pairs;
+	_motor.angle = fmod(_motor.angle + _motor.speed * dt, 2.0 * M_PI);
+
+	_motor.energy_in += _model.vbus * supply_current * dt;
+	_motor.energy_out += prop_torque * fabs(omega) * dt;
+}
+
+/**
+ * The BEMF of the floating phase is interpolated linearly between the simulation steps.
+ */
+static void track_true_zc(uint64_t dt)
+{
+	if ((_step == NULL) || (_zc.true_zc > 0)) {
+		return;
+	}
+	const double emf = bemf(_step->floating);
+	if ((_zc.floating == _step->floating) && ((emf < 0) != (_zc.prev_emf < 0))) {
+		_zc.true_zc = _now - (uint64_t)lround(dt * emf / (emf - _zc.prev_emf));
+		measure_zc();
+	}
+	_zc.floating = _step->floating;
+	_zc.prev_emf = emf;
+}
+
+static void advance_time(uint64_t timestamp)
+{
+	while (_now < timestamp) {
+		const uint64_t dt = ((timestamp - _now) > MAX_SUBSTEP_HNSEC) ? MAX_SUBSTEP_HNSEC : (timestamp - _now);
+		update_motor(dt / (double)HNSEC_PER_SEC);
+		_now += dt;
+		track_true_zc(dt);
+	}
+}
+
+/**
+ * The ADC is sampled in the middle of the PWM pulse, when the positive phase is connected to the supply and
+ * the negative phase is connected to the ground.
+ */
+static void sample_adc(void)
+{
+	struct motor_adc_sample sample;
+	memset(&sample, 0, sizeof(sample));
+	sample.timestamp = _now;
+
+	double emf[MOTOR_NUM_PHASES];
+	double emf_min = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		emf[i] = bemf(i);
+		emf_min = fmin(emf_min, emf[i]);
+	}
+
+	double input_current = 0;
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		double voltage = 0;
+		if (_step != NULL && i == _step->positive) {
+			voltage = _model.vbus;
+			input_current += _motor.current[i];
+		} else if (_step != NULL && i == _step->negative) {
+			voltage = 0;
+		} else if (_motor.current[i] != 0) {
+			voltage = _motor.clamped_high[i] ? (_model.vbus + _model.vdiode) : -_model.vdiode;
+			input_current += _motor.clamped_high[i] ? _motor.current[i] : 0;
+		} else if (_step != NULL) {
+			// The driven phases and their resistances form a divider that sets the neutral point
+			const int p = _step->positive;
+			const int n = _step->negative;
+			const double neutral = (_model.vbus - emf[p] - emf[n] -
+			                        _phase_r[p] * _motor.current[p] - _phase_r[n] * _motor.current[n]) / 2.0;
+			const double duty = fmin(_pwm_val / (double)_pwm_top, 1.0);
+			voltage = emf[i] + neutral + ASYM_COUPLING * _model.asym * _model.vbus * (duty - 0.5);
+		} else {
+			voltage = emf[i] - emf_min;
+		}
+		const double raw = volts_to_raw(voltage * (1.0 + ASYM_GAIN[i] * _model.asym)) + ASYM_OFFSET[i] * _model.asym;
+		sample.phase_values[i] = add_adc_noise((int)lround(raw));
+	}
+
+	sample.input_voltage = add_adc_noise(volts_to_raw(_model.vbus));
+	sample.input_current = add_adc_noise(amperes_to_raw(input_current));
+
+	_last_sample = sample;
+	if (_adc_enabled) {
+		motor_adc_sample_callback(&sample);
+	}
+}
+
+/*
+ * Test
+ */
+struct trial_result
+{
+	bool started;
+	double t_running;
+	double max_rpm;
+	double efficiency;
+	bool desync;
+	uint64_t zc_failures;
+	unsigned steps;
+	unsigned sync_applied;
+	double sync_lag;
+	double sync_lag_cp;
+	double min_rpm;
+	double mean_rpm;
+	double zc_err;
+};
+
+enum trial_phase
+{
+	TRIAL_STARTING,
+	TRIAL_RAMPING,
+	TRIAL_HOLDING,
+	TRIAL_DONE
+};
+
+static struct
+{
+	enum trial_phase phase;
+	uint64_t started_at;
+	uint64_t hold_started_at;
+	float duty_cycle;
+	int level;
+	unsigned out_of_sync_msec;
+	bool measuring;
+	double energy_in_at_start;
+	double energy_out_at_start;
+	double energy_in;
+	double energy_out;
+	double rpm_sum;
+	unsigned rpm_samples;
+	unsigned num_steps_at_start;
+} _trial;
+
+/*
+ * Bench scenario, see bench=
+ */
+#define BENCH_UPDATE_PERIOD_MS  10          ///< Same as in the bench command
+#define BENCH_SETTLE_BAND       0.05F
+
+static const struct bench_scenario* _bench_scenario;
+
+static struct
+{
+	unsigned trial;
+	unsigned step;
+	uint64_t step_started_at;
+	unsigned next_update_ms;
+	float setpoint;
+	bool running;
+	unsigned out_of_sync_msec;              ///< Of the current step
+	struct bench_recorder recorder;
+} _bench;
+
+/**
+ * True in the second half of the hold of each level.
+ */
+static bool is_measuring(void)
+{
+	return _trial.measuring;
+}
+
+static double get_rotor_rpm(void)
+{
+	return fabs(_motor.speed) / (2.0 * M_PI) * 60.0 / _pole_pairs;
+}
+
+/**
+ * The motor is in sync if the commutation rate matches the rotor speed, and the rotor turns in the right
+ * direction. The commutation table is forward; see get_rotation_direction() in motor_rtctl.c.
+ */
+static bool is_in_sync(void)
+{
+	const uint32_t comm_period = motor_rtctl_get_comm_period_hnsec();
+	if (comm_period == 0 || _motor.speed >= 0) {
+		return false;
+	}
+	const double comm_rpm = HNSEC_PER_SEC / (comm_period * 6.0) * 60.0 / _pole_pairs;
+	const double rotor_rpm = get_rotor_rpm();
+	return fabs(comm_rpm - rotor_rpm) <= (rotor_rpm * SYNC_TOLERANCE);
+}
+
+/**
+ * The speed ripple within a revolution is not a loss of sync, hence the timeout is not shorter than a revolution.
+ */
+static unsigned get_sync_loss_timeout_msec(void)
+{
+	const unsigned revolution_msec = motor_rtctl_get_comm_period_hnsec() * SYNC_LOSS_TIMEOUT_STEPS / HNSEC_PER_MSEC;
+	return (revolution_msec > SYNC_LOSS_TIMEOUT_MSEC) ? revolution_msec : SYNC_LOSS_TIMEOUT_MSEC;
+}
+
+/*
+ * Limiters of motor.c; the firmware runs them at the same rate as the simulated control thread
+ */
+static struct
+{
+	float dc_actual;
+	float input_voltage;
+	float input_current;
+	float filtered_input_current_for_limiter;
+	int limit_mask;
+	struct dc_limiter dc_limiter;
+	struct setpoint_shaper voltage_shaper;
+	struct setpoint_shaper rpm_shaper;
+} _control;
+
+static struct dc_limiter_params _dc_limiter_params;        ///< Read once, like in motor.c
+
+static float lowpass(float xold, float xnew, float tau, float dt)
+{
+	return (dt * xnew + tau * xold) / (dt + tau);
+}
+
+static unsigned comm_period_to_rpm(uint32_t comm_period_hnsec)    ///< Same as in motor.c
+{
+	if (comm_period_hnsec == 0) {
+		return 0;
+	}
+	const uint32_t x = (120ULL * (uint64_t)HNSEC_PER_SEC) / ((unsigned)_model.poles * 6);
+	return x / comm_period_hnsec;
+}
+
+/**
+ * The shapers and the limiters start from the actual state of the motor, the filters are not affected.
+ */
+static void control_reset(float duty_cycle)
+{
+	_control.dc_actual = duty_cycle;
+	_control.limit_mask = 0;
+	dc_limiter_reset(&_control.dc_limiter, motor_rtctl_get_zc_failures_since_start());
+	setpoint_shaper_reset(&_control.voltage_shaper, duty_cycle * _model.vbus);
+	setpoint_shaper_reset(&_control.rpm_shaper, (float)comm_period_to_rpm(motor_rtctl_get_comm_period_hnsec()));
+	rpmctl_reset();
+}
+
+/**
+ * Same as update_filters() in motor.c.
+ */
+static void control_update_filters(void)
+{
+	const float dt = THREAD_PERIOD_HNSEC / (float)HNSEC_PER_SEC;
+	float voltage = 0, current = 0;
+	motor_rtctl_get_input_voltage_current(&voltage, &current);
+	_control.input_voltage = voltage;
+	_control.input_current = lowpass(_control.input_current, current, 1.0F / configGet("mot_lpf_freq"), dt);
+	_control.filtered_input_current_for_limiter =
+		lowpass(_control.filtered_input_current_for_limiter, _control.input_current, 1.0F, dt);
+}
+
+/**
+ * Same as the limiters in update_control() in motor.c.
+ */
+static float control_apply_limiters(float new_duty_cycle)
+{
+	const struct dc_limiter_input input = {
+		THREAD_PERIOD_HNSEC / (float)HNSEC_PER_SEC,
+		_control.dc_actual,
+		_control.input_voltage,
+		_control.input_current,
+		_control.filtered_input_current_for_limiter,
+		motor_rtctl_get_zc_failures_since_start(),
+		motor_rtctl_get_comm_period_hnsec()
+	};
+	_control.dc_actual = dc_limiter_update(&_control.dc_limiter, &_dc_limiter_params, &input,
+	                                       new_duty_cycle, &_control.limit_mask);
+	return _control.dc_actual;
+}
+
+/**
+ * Same as update_control_open_loop() in motor.c followed by the limiters; the filters are updated too.
+ */
+static float control_update(float new_duty_cycle)
+{
+	const float dt = THREAD_PERIOD_HNSEC / (float)HNSEC_PER_SEC;
+	control_update_filters();
+
+	const struct setpoint_shaper_limits voltage_shaper_limits = {
+		configGet("mot_sp_v_rate"),
+		configGet("mot_sp_v_accel")
+	};
+	setpoint_shaper_update(&_control.voltage_shaper, &voltage_shaper_limits,
+	                       new_duty_cycle * _control.input_voltage, dt);
+	new_duty_cycle = fmaxf(_control.voltage_shaper.value / _control.input_voltage,
+	                       configGet("mot_v_min") / _control.input_voltage);
+
+	return control_apply_limiters(new_duty_cycle);
+}
+
+/**
+ * Same as update_control_rpm() in motor.c followed by the limiters; the filters are updated too.
+ */
+static float control_update_rpm(float rpm_setpoint)
+{
+	const float dt = THREAD_PERIOD_HNSEC / (float)HNSEC_PER_SEC;
+	control_update_filters();
+
+	rpm_setpoint = fmaxf(rpm_setpoint, configGet("mot_rpm_min"));
+	const struct setpoint_shaper_limits rpm_shaper_limits = {
+		configGet("mot_sp_rpm_rate"),
+		configGet("mot_sp_rpm_accel")
+	};
+	setpoint_shaper_update(&_control.rpm_shaper, &rpm_shaper_limits, rpm_setpoint, dt);
+
+	const struct rpmctl_input input = {
+		_control.limit_mask,
+		dt,
+		(float)comm_period_to_rpm(motor_rtctl_get_comm_period_hnsec()),
+		_control.rpm_shaper.value
+	};
+	return control_apply_limiters(rpmctl_update(&input));
+}
+
+/**
+ * Same as the end of update_control() in motor.c, with the setpoints that change scheduled like
+ * motor_set_duty_cycle_at() does.
+ */
+static void set_duty_cycle(float duty_cycle)
+{
+	if (_test.sync_delay <= 0) {
+		motor_rtctl_set_duty_cycle(duty_cycle);
+		return;
+	}
+
+	if (duty_cycle != _sync.duty_cycle) {
+		const uint64_t apply_at = _now + (uint64_t)(_test.sync_delay * HNSEC_PER_USEC);
+		if ((_sync.apply_at == 0) || (apply_at < _sync.apply_at)) {
+			_sync.apply_at = apply_at;
+			_sync.deadline = apply_at;          // The setpoint being measured, if any, is superseded
+		}
+		_sync.duty_cycle = duty_cycle;
+		_sync.pwm_val = motor_pwm_compute_pwm_val(duty_cycle);
+	}
+
+	if (_sync.apply_at > _now) {
+		motor_rtctl_set_duty_cycle_at(duty_cycle, _sync.apply_at);
+	} else {
+		if (_sync.apply_at > 0) {
+			_sync.apply_at = 0;
+			_sync.num_applied++;
+		}
+		motor_rtctl_set_duty_cycle(duty_cycle);
+	}
+}
+
+static void schedule_next_frame(void)
+{
+	const uint64_t period = (uint64_t)(_test.bus_period * HNSEC_PER_USEC);
+	_bus.frame++;
+	_bus.rx_timestamp = _trial.started_at + period * _bus.frame +
+	                    (uint64_t)(random_uniform() * _test.rx_jitter * HNSEC_PER_USEC);
+	_bus.callback_at = _bus.rx_timestamp + (uint64_t)(random_uniform() * _test.cb_delay * HNSEC_PER_USEC);
+}
+
+/**
+ * Every frame carries the duty cycle of the trial with an alternating offset, so that each frame is a step which
+ * all controllers must apply at the same instant. The frames are sent at the same times in every simulator process,
+ * because the first trial starts at the same time. A frame is timestamped in the RX interrupt, then the callback
+ * passes it to the control thread, which it releases at once, like esc_controller.cpp and motor.c do.
+ * The frames are ignored until the motor is running.
+ */
+static void receive_frame(void)
+{
+	if ((_trial.phase == TRIAL_RAMPING) || (_trial.phase == TRIAL_HOLDING)) {
+		float duty_cycle = _trial.duty_cycle + ((_bus.frame % 2) ? BUS_DITHER : -BUS_DITHER);
+		duty_cycle = (duty_cycle > 1.0F) ? 1.0F : ((duty_cycle < BUS_DITHER) ? BUS_DITHER : duty_cycle);
+
+		// Same as compute_setpoint_application_time() in esc_controller.cpp; a late frame is applied immediately
+		const uint64_t apply_at = _bus.rx_timestamp + (uint64_t)(_test.sync_delay * HNSEC_PER_USEC);
+		if (apply_at > _now) {
+			motor_rtctl_set_duty_cycle_at(duty_cycle, apply_at);
+		} else {
+			motor_rtctl_set_duty_cycle(duty_cycle);
+		}
+		_bus.measured_frame = _bus.frame;
+		_bus.deadline = (apply_at > _now) ? apply_at : _now;
+		_bus.pwm_val = motor_pwm_compute_pwm_val(duty_cycle);
+	}
+	schedule_next_frame();
+}
+
+/**
+ * Invoked from the simulated control thread. Returns false when the trial is finished.
+ */
+static bool update_trial(struct trial_result* result)
+{
+	const enum motor_rtctl_state state = motor_rtctl_get_state();
+
+	if (_trial.phase == TRIAL_STARTING) {
+		if (state == MOTOR_RTCTL_STATE_RUNNING) {
+			result->started = true;
+			result->t_running = (_now - _trial.started_at) / (double)HNSEC_PER_SEC;
+			_trial.duty_cycle = configGet("mot_v_min") / _model.vbus;
+			_trial.phase = TRIAL_RAMPING;
+			_trial.num_steps_at_start = _num_steps;
+			control_reset(_trial.duty_cycle);
+		}
+		return state != MOTOR_RTCTL_STATE_IDLE;
+	}
+
+	if (state != MOTOR_RTCTL_STATE_RUNNING) {
+		result->desync = true;
+		return false;
+	}
+
+	if (is_in_sync()) {
+		_trial.out_of_sync_msec = 0;
+		result->max_rpm = fmax(result->max_rpm, get_rotor_rpm());
+		if (_trial.measuring) {
+			result->min_rpm = fmin(result->min_rpm, get_rotor_rpm());
+			_trial.rpm_sum += get_rotor_rpm();
+			_trial.rpm_samples++;
+			result->mean_rpm = _trial.rpm_sum / _trial.rpm_samples;
+		}
+	} else if (++_trial.out_of_sync_msec >= get_sync_loss_timeout_msec()) {
+		result->desync = true;
+		return false;
+	}
+
+	const float level = (float)_test.dc_end * (_trial.level + 1) / (float)_test.dc_steps;
+
+	if (_trial.phase == TRIAL_RAMPING) {
+		const float step = _test.dc_rate * THREAD_PERIOD_HNSEC / HNSEC_PER_SEC;
+		if (fabsf(level - _trial.duty_cycle) <= step) {
+			_trial.duty_cycle = level;
+			_trial.phase = TRIAL_HOLDING;
+			_trial.hold_started_at = _now;
+		} else {
+			_trial.duty_cycle += (level > _trial.duty_cycle) ? step : -step;
+		}
+	} else {
+		const double held = (_now - _trial.hold_started_at) / (double)HNSEC_PER_SEC;
+		if (!_trial.measuring && (held >= _test.hold / 2)) {
+			_trial.measuring = true;
+			_trial.energy_in_at_start = _motor.energy_in;
+			_trial.energy_out_at_start = _motor.energy_out;
+		}
+		if (held >= _test.hold) {
+			_trial.measuring = false;
+			_trial.energy_in += _motor.energy_in - _trial.energy_in_at_start;
+			_trial.energy_out += _motor.energy_out - _trial.energy_out_at_start;
+			result->efficiency = _trial.energy_out / _trial.energy_in;
+
+			if (++_trial.level >= (int)_test.dc_steps) {
+				_trial.phase = TRIAL_DONE;
+				return false;
+			}
+			_trial.phase = TRIAL_RAMPING;
+		}
+	}
+
+	if (_test.bus_period <= 0) {
+		set_duty_cycle(_test.control ? control_update(_trial.duty_cycle) : _trial.duty_cycle);
+	}
+	return true;
+}
+
+static void finish_bench_step(void)
+{
+	const struct bench_step* const step = &_bench_scenario->steps[_bench.step];
+	struct bench_metrics m;
+	bench_compute_metrics(&_bench.recorder, BENCH_SETTLE_BAND, &m);
+	printf("STEP %u %u kind=%s setpoint=%g ramp=%i rpm_from=%.0f rpm_to=%.0f rise=%.3f overshoot=%.1f settling=%.3f "
+	       "peak_current=%.1f desyncs=%u zc_failures=%u out_of_sync=%.3f\n",
+	       _bench.trial, _bench.step, (step->kind == BENCH_SETPOINT_DC) ? "dc" : "rpm", step->setpoint,
+	       step->ramp_ms > 0, m.rpm_initial, m.rpm_final, m.rise_time, m.overshoot_pct, m.settling_time,
+	       m.peak_current, m.num_desyncs, (unsigned)m.num_zc_failures, _bench.out_of_sync_msec / 1e3);
+}
+
+/**
+ * Same as update_trial(), for the bench scenarios. The recorder is updated like in the control thread of motor.c.
+ */
+static bool update_bench(struct trial_result* result)
+{
+	const enum motor_rtctl_state state = motor_rtctl_get_state();
+	const struct bench_step* const step = &_bench_scenario->steps[_bench.step];
+	const unsigned elapsed_ms = (unsigned)((_now - _bench.step_started_at) / HNSEC_PER_MSEC);
+
+	if (elapsed_ms >= _bench.next_update_ms) {
+		_bench.setpoint = bench_get_setpoint(_bench_scenario, _bench.step, elapsed_ms);
+		_bench.next_update_ms += BENCH_UPDATE_PERIOD_MS;
+	}
+
+	bool keep_going = true;
+	if (state == MOTOR_RTCTL_STATE_RUNNING) {
+		if (!_bench.running) {
+			_bench.running = true;
+			result->started = true;
+			result->t_running = (_now - _trial.started_at) / (double)HNSEC_PER_SEC;
+			_trial.num_steps_at_start = _num_steps;
+			control_reset(configGet("mot_v_min") / _model.vbus);
+		}
+
+		// The loss of sync is reported, not taken for a desync, see bench= above
+		if (is_in_sync()) {
+			result->max_rpm = fmax(result->max_rpm, get_rotor_rpm());
+		} else {
+			_bench.out_of_sync_msec++;
+		}
+
+		set_duty_cycle((step->kind == BENCH_SETPOINT_DC) ? control_update(_bench.setpoint) :
+		               control_update_rpm(_bench.setpoint));
+	} else {
+		control_update_filters();
+		if (_bench.running || (state == MOTOR_RTCTL_STATE_IDLE)) {
+			result->desync = _bench.running;
+			keep_going = false;
+		}
+	}
+
+	bench_recorder_push(&_bench.recorder, _now, comm_period_to_rpm(motor_rtctl_get_comm_period_hnsec()),
+	                    _control.input_current, state == MOTOR_RTCTL_STATE_RUNNING,
+	                    motor_rtctl_get_zc_failures_since_start());
+
+	if (keep_going && (elapsed_ms + 1 < (unsigned)(step->ramp_ms + step->hold_ms))) {
+		return true;
+	}
+	finish_bench_step();
+	if (!keep_going || (++_bench.step >= _bench_scenario->num_steps)) {
+		return false;
+	}
+	_bench.step_started_at = _now;
+	_bench.next_update_ms = 0;
+	_bench.out_of_sync_msec = 0;
+	bench_recorder_reset(&_bench.recorder);
+	return true;
+}
+
+static struct trial_result run_trial(unsigned index)
+{
+	struct trial_result result;
+	memset(&result, 0, sizeof(result));
+	result.t_running = NAN;
+	result.max_rpm = NAN;
+	result.efficiency = NAN;
+	result.min_rpm = NAN;
+	result.mean_rpm = NAN;
+
+	memset(&_motor, 0, sizeof(_motor));
+	memset(&_trial, 0, sizeof(_trial));
+	memset(&_sync, 0, sizeof(_sync));
+	memset(&_bus, 0, sizeof(_bus));
+	memset(&_zc, 0, sizeof(_zc));
+	memset(&_control, 0, sizeof(_control));
+	memset(&_bench, 0, sizeof(_bench));
+	_zc.floating = -1;
+	_bench.trial = index;
+	_bench.step_started_at = _now;
+	bench_recorder_reset(&_bench.recorder);
+	_motor.angle = random_uniform() * 2.0 * M_PI;
+	_trial.started_at = _now;
+	_num_steps = 0;
+
+	motor_rtctl_start(configGet("mot_v_spinup") / _model.vbus, configGet("mot_v_min") / _model.vbus,
+	                  configGet("mot_spup_vramp_t"), false, 0);
+
+	const uint64_t deadline = _now + TRIAL_TIMEOUT_SEC * HNSEC_PER_SEC;
+	uint64_t next_adc = _now + _adc_period;
+	uint64_t next_thread = _now + THREAD_PERIOD_HNSEC;
+	if (_test.bus_period > 0) {
+		schedule_next_frame();
+	}
+
+	bool running = true;
+	while (running && (_now < deadline)) {
+		uint64_t t = (next_adc < next_thread) ? next_adc : next_thread;
+		if (_timer_armed && (_timer_deadline < t)) {
+			t = _timer_deadline;
+		}
+		if ((_bus.callback_at > 0) && (_bus.callback_at < t)) {
+			t = _bus.callback_at;
+		}
+		advance_time(t);
+
+		if ((_bus.callback_at > 0) && (_now >= _bus.callback_at)) {
+			receive_frame();
+			continue;
+		}
+
+		if (_timer_armed && (_now >= _timer_deadline)) {
+			_timer_armed = false;
+			advance_time(_now + (uint64_t)(random_uniform() * _model.latency * HNSEC_PER_USEC));
+			motor_timer_callback(_now);
+			continue;
+		}
+		if (_now >= next_adc) {
+			next_adc += _adc_period;
+			sample_adc();
+		}
+		if (_now >= next_thread) {
+			next_thread += THREAD_PERIOD_HNSEC;
+			running = (_bench_scenario != NULL) ? update_bench(&result) : update_trial(&result);
+		}
+	}
+
+	motor_rtctl_stop();
+	_timer_armed = false;
+
+	result.zc_failures = motor_rtctl_get_zc_failures_since_start();
+	result.steps = result.started ? (_num_steps - _trial.num_steps_at_start) : 0;
+	result.sync_applied = _sync.num_applied;
+	result.sync_lag = (_sync.num_measured > 0) ? _sync.lag_max : NAN;
+	result.sync_lag_cp = (_sync.num_measured > 0) ? _sync.lag_cp_max : NAN;
+	result.zc_err = (_zc.count > 0) ? sqrt(_zc.sum_sq / _zc.count) : NAN;
+	return result;
+}
+
+/*
+ * Command line
+ */
+static bool set_named_value(const struct named_value* table, int len, const char* name, double value)
+{
+	for (int i = 0; i < len; i++) {
+		if (!strcmp(table[i].name, name)) {
+			*table[i].value = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void parse_argument(const char* arg)
+{
+	if (!strncmp(arg, "bench=", 6)) {
+		_bench_scenario = bench_find_scenario(arg + 6);
+		if (_bench_scenario == NULL) {
+			die("Unknown bench scenario: ", arg + 6);
+		}
+		return;
+	}
+
+	char name[32] = "";
+	double value = 0;
+	if (sscanf(arg, "%31[^=]=%lf", name, &value) != 2) {
+		die("Expected name=value, got: ", arg);
+	}
+
+	for (int i = 0; i < NUM_CONFIG_PARAMS; i++) {
+		if (!strcmp(_config[i].name, name)) {
+			_config[i].value = value;
+			return;
+		}
+	}
+	if (!set_named_value(MODEL_PARAMS, sizeof(MODEL_PARAMS) / sizeof(MODEL_PARAMS[0]), name, value) &&
+	    !set_named_value(TEST_PARAMS, sizeof(TEST_PARAMS) / sizeof(TEST_PARAMS[0]), name, value)) {
+		die("Unknown name: ", name);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++) {
+		parse_argument(argv[i]);
+	}
+	if (_test.dc_steps < 1 || _test.dc_end <= 0 || _test.dc_end > 1 || _model.poles < 2 || _model.l <= 0 ||
+	    _model.j <= 0) {
+		die("Invalid motor model or test definition", "");
+	}
+
+	_pole_pairs = floor(_model.poles / 2);
+	_flux = 1.0 / (sqrt(3.0) * _pole_pairs * _model.kv * 2.0 * M_PI / 60.0);  // KV is line-to-line
+	for (int i = 0; i < MOTOR_NUM_PHASES; i++) {
+		_phase_r[i] = _model.r * (1.0 + ASYM_R[i] * _model.asym);
+	}
+	_pwm_top = PWM_TIMER_FREQUENCY / (int)configGet("mot_pwm_hz") - 1;
+	_adc_period = HNSEC_PER_SEC / (PWM_TIMER_FREQUENCY / (_pwm_top + 1));
+	_random_state = (uint32_t)_test.seed * 2654435761U + 1U;
+	_now = HNSEC_PER_SEC;
+
+	const struct motor_rtctl_hardware_info hw_info = { .current_shunt_resistance = CURRENT_SHUNT };
+	if ((motor_rtctl_init(&hw_info) != 0) || (rpmctl_init() != 0)) {
+		die("Init failed", "");
+	}
+	dc_limiter_configure(&_dc_limiter_params);
+	motor_rtctl_confirm_initialization();
+
+	if (_test.trace >= 0) {
+		motor_trace_arm((uint32_t)(_test.trace * HNSEC_PER_MSEC));
+	}
+
+	for (int i = 0; i < (int)_test.trials; i++) {
+		const struct trial_result r = run_trial((unsigned)i);
+		printf("TRIAL %i started=%i t_running=%.4f max_rpm=%.0f efficiency=%.4f desync=%i zc_failures=%llu steps=%u "
+		       "sync_applied=%u sync_lag=%.1f sync_lag_cp=%.3f min_rpm=%.0f mean_rpm=%.0f zc_err=%.2f\n",
+		       i, r.started, r.t_running, r.max_rpm, r.efficiency, r.desync,
+		       (unsigned long long)r.zc_failures, r.steps, r.sync_applied, r.sync_lag, r.sync_lag_cp,
+		       r.min_rpm, r.mean_rpm, r.zc_err);
+		if ((i == 0) && (_test.trace >= 0)) {
+			motor_trace_print();
+		}
+		fflush(stdout);
+	}
+	return 0;
+}
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Measures the skew between ESCs that apply the same setpoint frames from a simulated bus.
+
+Every node is a simulator process (see bus_period in sim.c) with its own random seed, so the rotor angles, the
+start-up, the RX interrupt latency and the callback delay differ between the nodes, while the frames are sent at the
+same times. The skew of a frame is the spread of the times when the nodes applied it. Each motor model is run with
+the setpoints scheduled cmd_sync_us past the RX timestamp, and with cmd_sync_us=0 as the control, where the frames are
+applied as soon as they reach the control thread.
+The exit code is non-zero if the max skew with the scheduled setpoints exceeds the bound, or too few frames
+were applied by all nodes.
+
+Examples:
+  make
+  ./skew.py
+  ./skew.py --motor highkv --nodes 8 --cmd-sync-us 2000
+"""
+
+import os
+import sys
+import argparse
+import subprocess
+from concurrent.futures import ThreadPoolExecutor
+
+import sweep
+
+# Duty cycle 0.5 held for 1 s; the frames are applied between the spin-up and the end of the hold
+TEST = {'trials': 1, 'dc_steps': 1, 'dc_end': 0.5, 'hold': 1, 'bus_period': 2500}
+
+MIN_FRAMES = 100
+
+
+def run_node(model, params, seed):
+    """Returns {frame: (deadline, applied)}, microseconds."""
+    args = [sweep.SIM, 'seed=%d' % seed]
+    args += ['%s=%s' % kv for kv in sorted(model.items())]
+    args += ['%s=%s' % kv for kv in sorted(params.items())]
+    proc = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError('Simulator failed: %s' % proc.stderr.strip())
+
+    frames = {}
+    for line in proc.stdout.splitlines():
+        if line.startswith('SYNC '):
+            fields = line.split()
+            values = {k: float(v) for k, v in (item.split('=') for item in fields[2:])}
+            frames[int(fields[1])] = (values['deadline'], values['applied'])
+        elif line.startswith('TRIAL ') and ' desync=1' in line:
+            raise RuntimeError('Node %d lost sync' % seed)
+    return frames
+
+
+def evaluate(executor, model, params, nodes):
+    """Returns (number of frames applied by all nodes, mean skew, max skew, max lag past the deadline)."""
+    results = list(executor.map(lambda seed: run_node(model, params, seed), range(1, nodes + 1)))
+    common = sorted(set.intersection(*[set(r) for r in results]))
+    skews = [max(r[f][1] for r in results) - min(r[f][1] for r in results) for f in common]
+    lags = [r[f][1] - r[f][0] for r in results for f in common]
+    if not common:
+        return 0, float('nan'), float('nan'), float('nan')
+    return len(common), sum(skews) / len(skews), max(skews), max(lags)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--motor', action='append', choices=sorted(sweep.MOTORS),
+                        help='motor model of sweep.py; all of them by default')
+    parser.add_argument('--nodes', type=int, default=4, help='number of ESCs on the bus')
+    parser.add_argument('--cmd-sync-us', type=float, default=1500, help='same as the cmd_sync_us parameter')
+    parser.add_argument('--max-skew', type=float, default=30, help='bound of the skew, microseconds')
+    args = parser.parse_args()
+
+    if not os.path.isfile(sweep.SIM):
+        print('The simulator is not built, run make first', file=sys.stderr)
+        return 1
+
+    num_failed = 0
+    with ThreadPoolExecutor(max_workers=os.cpu_count()) as executor:
+        for motor in (args.motor or sorted(sweep.MOTORS)):
+            for sync_delay in (args.cmd_sync_us, 0):
+                params = dict(TEST, sync_delay=sync_delay)
+                frames, mean_skew, max_skew, max_lag = evaluate(executor, sweep.MOTORS[motor], params, args.nodes)
+                checked = sync_delay > 0
+                failed = checked and ((frames < MIN_FRAMES) or not (max_skew <= args.max_skew))
+                num_failed += 1 if failed else 0
+                print('%-8s cmd_sync_us=%-5.0f %-4s frames=%-4d skew_mean=%.1f skew_max=%.1f lag_max=%.1f' %
+                      (motor, sync_delay, ('FAIL' if failed else 'OK') if checked else '-',
+                       frames, mean_skew, max_skew, max_lag))
+
+    print('skew bound %.0f usec, %d nodes; %d cases failed' % (args.max_skew, args.nodes, num_failed))
+    return 1 if num_failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
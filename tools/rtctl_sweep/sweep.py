@@ -0,0 +1,287 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Sweeps the parameters of the six-step commutation logic on the host. Every parameter set is evaluated by
+running the realtime motor control logic against a simulated motor (see sim.c); the sets are evaluated in
+parallel, one simulator process per CPU core. The parameter sets are either a grid, or a random sample.
+
+Metrics of a parameter set, over several trials which start from random rotor angles:
+  start     fraction of trials where the motor reached the running state
+  t_run     mean time from the start to the running state, seconds
+  rpm       mean max RPM at which the motor stayed in sync
+  eff       mean efficiency, i.e. the propeller power over the supply power, of the trials without desync
+  desync    fraction of the started trials where the motor lost sync or stopped
+
+A parameter set is Pareto-optimal if no other set is at least as good in all metrics and better in at least
+one of them. The Pareto-optimal sets are printed together with the firmware defaults for reference.
+All trials use the same random seeds, so that the differences between the sets are not masked by the noise.
+
+Examples:
+  make
+  ./sweep.py --random 300
+  ./sweep.py --motor lowkv --grid mot_tim_adv_max=5:29:4 --grid mot_blank_usec=20:100:20
+  ./sweep.py --random 300 --model kv=920 --set mot_v_min=2 --range mot_blank_usec=20:60 --csv sweep.csv
+  ./sweep.py --motor lowkv --set control=1 --set dc_rate=1000 --set hold=2 --grid mot_acc_scl_min=0.1:1:0.3
+"""
+
+import os
+import sys
+import csv
+import math
+import random
+import argparse
+import itertools
+import subprocess
+from concurrent.futures import ThreadPoolExecutor
+
+SIM = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'sim')
+
+# Motor models, see sim.c for the units and the default values
+MOTORS = {
+    'default': {},
+    'highkv': {'kv': 1400, 'vbus': 16, 'r': 0.06, 'l': 12e-6, 'j': 5e-6, 'kprop': 4.5e-8, 'tfric': 0.003},
+    'lowkv': {'kv': 340, 'vbus': 22.2, 'r': 0.08, 'l': 60e-6, 'poles': 28, 'j': 2e-4, 'kprop': 1.9e-6,
+              'tfric': 0.01},
+}
+
+# Default sampling ranges; integer bounds mean that the parameter is an integer
+SPACE = {
+    'mot_tim_adv_min': (0, 20),
+    'mot_tim_adv_max': (0, 29),
+    'mot_blank_usec': (10, 150),
+    'mot_bemf_win_den': (3, 8),
+    'mot_bemf_range': (10, 100),
+    'mot_zc_fails_max': (6, 300),
+    'mot_spup_st_cp': (10000, 300000),
+    'mot_spup_blnk_pm': (1, 300),
+    'mot_spup_vramp_t': (0.1, 5.0),
+}
+
+# Name, format, True if greater is better
+METRICS = [
+    ('start', '%.2f', True),
+    ('t_run', '%.3f', False),
+    ('rpm', '%.0f', True),
+    ('eff', '%.3f', True),
+    ('desync', '%.2f', False),
+]
+
+
+def parse_assignment(text, convert=float):
+    name, sep, value = text.partition('=')
+    if not sep or not name:
+        raise argparse.ArgumentTypeError('expected NAME=VALUE, got %r' % text)
+    try:
+        return name, convert(value)
+    except ValueError as ex:
+        raise argparse.ArgumentTypeError('invalid value of %s: %s' % (name, ex))
+
+
+def parse_number(text):
+    value = float(text)
+    return int(value) if value.is_integer() and '.' not in text and 'e' not in text.lower() else value
+
+
+def parse_bounds(text):
+    items = [parse_number(x) for x in text.split(':')]
+    if len(items) not in (2, 3) or items[0] > items[1] or (len(items) == 3 and items[2] <= 0):
+        raise ValueError('expected LO:HI or LO:HI:STEP')
+    return items
+
+
+def make_grid(grid):
+    names = [name for name, _ in grid]
+    axes = []
+    for _, bounds in grid:
+        lo, hi = bounds[0], bounds[1]
+        if len(bounds) > 2:
+            step = bounds[2]
+        elif isinstance(lo, int) and isinstance(hi, int):
+            step = max((hi - lo) // 4, 1)
+        else:
+            step = (hi - lo) / 4
+        count = int(math.floor((hi - lo) / step + 1e-9)) + 1
+        axes.append([type(lo + step)(lo + step * i) for i in range(count)])
+    return [dict(zip(names, values)) for values in itertools.product(*axes)]
+
+
+def make_random_sample(count, space, rng):
+    sets = []
+    for _ in range(count):
+        params = {}
+        for name, (lo, hi) in sorted(space.items()):
+            if isinstance(lo, int) and isinstance(hi, int):
+                params[name] = rng.randint(lo, hi)
+            else:
+                params[name] = round(rng.uniform(lo, hi), 3)
+        sets.append(params)
+    return sets
+
+
+def fix_constraints(params):
+    lo, hi = params.get('mot_tim_adv_min'), params.get('mot_tim_adv_max')
+    if lo is not None and hi is not None and lo > hi:
+        params['mot_tim_adv_min'], params['mot_tim_adv_max'] = hi, lo
+    return params
+
+
+def mean(values):
+    values = [x for x in values if not math.isnan(x)]
+    return sum(values) / len(values) if values else float('nan')
+
+
+def evaluate(params, fixed, model, trials, seed):
+    args = [SIM, 'trials=%d' % trials, 'seed=%d' % seed]
+    args += ['%s=%s' % kv for kv in sorted(model.items())]
+    args += ['%s=%s' % kv for kv in sorted(fixed.items())]
+    args += ['%s=%s' % kv for kv in sorted(params.items())]
+    proc = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    if proc.returncode != 0:
+        raise RuntimeError('Simulator failed: %s' % proc.stderr.strip())
+
+    results = []
+    steps = []
+    for line in proc.stdout.splitlines():
+        if line.startswith('TRIAL '):
+            results.append({k: float(v) for k, v in (item.split('=') for item in line.split()[2:])})
+        elif line.startswith('STEP '):
+            steps.append({k: v for k, v in (item.split('=') for item in line.split()[3:])})
+    if len(results) != trials:
+        raise RuntimeError('Simulator produced %d trials instead of %d' % (len(results), trials))
+
+    started = [r for r in results if r['started']]
+    return {
+        'start': len(started) / len(results),
+        't_run': mean([r['t_running'] for r in started]),
+        'rpm': mean([r['max_rpm'] for r in started]),
+        'eff': mean([r['efficiency'] for r in started if not r['desync']]),
+        'desync': (sum(r['desync'] for r in started) / len(started)) if started else float('nan'),
+        'sync_applied': min([r['sync_applied'] for r in started], default=float('nan')),
+        'sync_lag': max([r['sync_lag'] for r in started if not r['desync'] and not math.isnan(r['sync_lag'])],
+                        default=float('nan')),
+        'sync_lag_cp': max([r['sync_lag_cp'] for r in started if not r['desync'] and not math.isnan(r['sync_lag_cp'])],
+                           default=float('nan')),
+        'min_rpm': max([r['min_rpm'] for r in started if not r['desync']], default=float('nan')),
+        'zc_err': max([r['zc_err'] for r in started if not r['desync']], default=float('nan')),
+        # Of the bench scenario steps; the settling time of a ramp includes the ramp, so it is not counted
+        'overshoot': max([float(s['overshoot']) for s in steps], default=float('nan')),
+        'settling': max([float(s['settling']) for s in steps if s['ramp'] == '0'], default=float('nan')),
+    }
+
+
+def dominates(a, b):
+    """The metrics are compared at the printed resolution, the differences below it are noise"""
+    better = False
+    for name, fmt, greater_is_better in METRICS:
+        x, y = float(fmt % a[name]), float(fmt % b[name])
+        x, y = (x, y) if greater_is_better else (y, x)
+        if x < y:
+            return False
+        better = better or x > y
+    return better
+
+
+def find_pareto_front(evaluated):
+    valid = [e for e in evaluated if not any(math.isnan(e['metrics'][name]) for name, _, _ in METRICS)]
+    return [e for e in valid if not any(dominates(o['metrics'], e['metrics']) for o in valid if o is not e)]
+
+
+def print_table(rows, param_names):
+    header = ['#'] + [name for name, _, _ in METRICS] + param_names
+    table = [header]
+    for e in rows:
+        row = [str(e['index'])]
+        row += [fmt % e['metrics'][name] for name, fmt, _ in METRICS]
+        row += [str(e['params'].get(name, '-')) for name in param_names]
+        table.append(row)
+    widths = [max(len(row[i]) for row in table) for i in range(len(header))]
+    for row in table:
+        print('  '.join(cell.rjust(width) for cell, width in zip(row, widths)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    mode = parser.add_mutually_exclusive_group(required=True)
+    mode.add_argument('--random', type=int, metavar='N', help='evaluate N random parameter sets')
+    mode.add_argument('--grid', action='append', metavar='NAME=LO:HI[:STEP]',
+                      type=lambda x: parse_assignment(x, parse_bounds),
+                      help='grid axis, can be repeated; the default step gives 5 points')
+    parser.add_argument('--range', action='append', default=[], metavar='NAME=LO:HI',
+                        type=lambda x: parse_assignment(x, parse_bounds),
+                        help='sampling range of a parameter for --random, can be repeated')
+    parser.add_argument('--set', action='append', default=[], metavar='NAME=VALUE', type=parse_assignment,
+                        help='fixed parameter value, can be repeated')
+    parser.add_argument('--motor', choices=sorted(MOTORS), default='default', help='motor model')
+    parser.add_argument('--model', action='append', default=[], metavar='NAME=VALUE', type=parse_assignment,
+                        help='motor model override, e.g. "kv=920"; can be repeated')
+    parser.add_argument('--trials', type=int, default=5, help='trials per parameter set (default 5)')
+    parser.add_argument('--jobs', '-j', type=int, default=os.cpu_count(), help='parallel simulator processes')
+    parser.add_argument('--seed', type=int, default=1, help='random seed of the sampling and the simulation')
+    parser.add_argument('--csv', help='write all evaluated sets into this CSV file')
+    args = parser.parse_args()
+
+    if not os.path.isfile(SIM):
+        print('The simulator is not built, run make first', file=sys.stderr)
+        return 1
+
+    fixed = dict(args.set)
+    model = dict(MOTORS[args.motor])
+    model.update(args.model)
+
+    if args.grid:
+        sets = make_grid(args.grid)
+    else:
+        space = {name: bounds for name, bounds in SPACE.items() if name not in fixed}
+        space.update({name: tuple(bounds[:2]) for name, bounds in args.range})
+        sets = make_random_sample(args.random, space, random.Random(args.seed))
+    sets = [{}] + [fix_constraints(s) for s in sets]    # The first one is the firmware defaults
+
+    print('Evaluating %d parameter sets, %d trials each, %d jobs' % (len(sets), args.trials, args.jobs),
+          file=sys.stderr)
+
+    evaluated = []
+    with ThreadPoolExecutor(max_workers=max(args.jobs, 1)) as executor:
+        futures = [executor.submit(evaluate, s, fixed, model, args.trials, args.seed) for s in sets]
+        for index, (params, future) in enumerate(zip(sets, futures)):
+            evaluated.append({'index': index, 'params': params, 'metrics': future.result()})
+            print('\r%d/%d' % (index + 1, len(sets)), end='', file=sys.stderr, flush=True)
+    print(file=sys.stderr)
+
+    param_names = sorted(set(itertools.chain(*(s.keys() for s in sets))))
+    front = find_pareto_front(evaluated)
+    front_indices = set(e['index'] for e in front)
+
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.writer(f)
+            writer.writerow(['index', 'pareto'] + [name for name, _, _ in METRICS] + param_names)
+            for e in evaluated:
+                writer.writerow([e['index'], int(e['index'] in front_indices)] + [e['metrics'][name] for name, _, _ in METRICS] +
+                                [e['params'].get(name, '') for name in param_names])
+
+    print('Motor model: %s %s' % (args.motor, ' '.join('%s=%s' % kv for kv in sorted(model.items()))))
+    if fixed:
+        print('Fixed: %s' % ' '.join('%s=%s' % kv for kv in sorted(fixed.items())))
+    print('\nFirmware defaults:')
+    print_table(evaluated[:1], param_names)
+    print('\nPareto-optimal sets (%d of %d):' % (len(front), len(evaluated)))
+    print_table(sorted(front, key=lambda e: (-e['metrics']['start'], -e['metrics']['eff'])), param_names)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
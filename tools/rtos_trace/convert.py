@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Converts the dump of the thread and interrupt tracer (firmware built with RTOS_TRACE=1, CLI command "trace")
+into the JSON trace event format, which can be opened in Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+The dump is read from a file, or captured directly from the CLI serial port.
+
+The trace contains one track per thread and per interrupt, where the slices include the time spent in the
+nested interrupts, and the CPU track, where every slice is attributed exclusively to whatever was executing.
+The summary of the exclusive CPU time is printed, which shows who steals time from whom.
+
+Examples:
+  ./convert.py --port /dev/ttyUSB0 -o trace.json
+  ./convert.py dump.txt -o trace.json
+"""
+
+import sys
+import json
+import argparse
+import collections
+
+# Exception number -> name; the IRQs used by the firmware are annotated with their purpose
+EXCEPTION_NAMES = {
+    2: 'NMI', 3: 'HardFault', 11: 'SVCall', 14: 'PendSV', 15: 'SysTick',
+    16 + 11: 'DMA1_Channel1', 16 + 14: 'DMA1_Channel4',
+    16 + 18: 'ADC1_2 (motor ADC)',
+    16 + 19: 'CAN1_TX', 16 + 20: 'CAN1_RX0', 16 + 21: 'CAN1_RX1', 16 + 22: 'CAN1_SCE',
+    16 + 24: 'TIM1_BRK', 16 + 25: 'TIM1_UP', 16 + 26: 'TIM1_TRG_COM', 16 + 27: 'TIM1_CC',
+    16 + 28: 'TIM2', 16 + 29: 'TIM3 (LED)', 16 + 30: 'TIM4 (motor event timer)',
+    16 + 37: 'USART1 (CLI)',
+    16 + 50: 'TIM5 (RC PWM input)', 16 + 54: 'TIM6 (motor timestamp)', 16 + 55: 'TIM7 (UAVCAN clock)',
+    16 + 63: 'CAN2_TX', 16 + 64: 'CAN2_RX0', 16 + 65: 'CAN2_RX1', 16 + 66: 'CAN2_SCE',
+}
+
+UNKNOWN_THREAD = 0xFF
+PID = 1
+CPU_TID = 0
+THREAD_TID_BASE = 1
+IRQ_TID_BASE = 1000
+
+
+class Dump:
+    def __init__(self):
+        self.clock = None
+        self.num_lost = 0
+        self.threads = {}
+        self.records = []       # (cycles, event, id, arg)
+
+
+def parse(lines):
+    dump = None
+    for line in lines:
+        fields = line.strip().split()
+        if not fields:
+            continue
+        if fields[0] == 'rtos_trace':
+            dump = Dump()
+            header = dict(x.split('=', 1) for x in fields[1:])
+            dump.clock = int(header['clock'])
+            dump.num_lost = int(header['lost'])
+        elif dump is None:
+            continue            # Anything before the dump, e.g. the echo of the command
+        elif fields[0] == 'end':
+            return dump
+        elif fields[0] == 'thread':
+            dump.threads[int(fields[1])] = ' '.join(fields[3:])
+        else:
+            dump.records.append((int(fields[0], 16), fields[1], int(fields[2]), int(fields[3])))
+    if dump is None:
+        raise ValueError('No trace in the input')
+    raise ValueError('The trace is truncated')
+
+
+def capture(port, baudrate, timeout):
+    import serial
+    with serial.Serial(port, baudrate, timeout=timeout) as ser:
+        ser.reset_input_buffer()
+        ser.write(b'\r\ntrace dump\r\n')
+        lines = []
+        while True:
+            line = ser.readline().decode('utf8', 'replace')
+            if not line:
+                raise IOError('Timed out while reading the trace')
+            lines.append(line)
+            if line.strip() == 'end' and any(x.startswith('rtos_trace') for x in lines):
+                return lines
+
+
+def thread_name(dump, thread_id):
+    if thread_id == UNKNOWN_THREAD:
+        return 'other threads'
+    return dump.threads.get(thread_id, 'thread %d' % thread_id)
+
+
+def exception_name(number):
+    return EXCEPTION_NAMES.get(number, 'IRQ %d' % (number - 16) if number >= 16 else 'exception %d' % number)
+
+
+def convert(dump):
+    """
+    Returns the trace events, the duration of the trace, the exclusive CPU time per thread and per interrupt,
+    and the statistics of the interrupts; the times are in seconds.
+    The cycle counter wraps around every minute, which is much longer than the gaps between the records.
+    """
+    events = []
+    exclusive = collections.defaultdict(float)
+    irq_stats = collections.defaultdict(lambda: {'count': 0, 'max': 0.0})
+
+    def to_us(cycles):
+        return cycles * 1e6 / dump.clock
+
+    def add_slice(tid, name, start, end):
+        if end > start:
+            events.append({'name': name, 'ph': 'X', 'pid': PID, 'tid': tid,
+                           'ts': to_us(start), 'dur': to_us(end - start)})
+
+    time = 0
+    prev_cycles = dump.records[0][0] if dump.records else 0
+    current_thread = None
+    thread_started_at = 0
+    irq_stack = []              # (exception, entered at)
+    segment_started_at = 0
+
+    def close_segment(now):
+        # Exclusive attribution of the time since the previous event
+        if irq_stack:
+            name = exception_name(irq_stack[-1][0])
+        elif current_thread is not None:
+            name = thread_name(dump, current_thread)
+        else:
+            name = None
+        if name is not None:
+            exclusive[name] += (now - segment_started_at) / dump.clock
+            add_slice(CPU_TID, name, segment_started_at, now)
+
+    for cycles, event, ident, arg in dump.records:
+        time += (cycles - prev_cycles) & 0xFFFFFFFF
+        prev_cycles = cycles
+        close_segment(time)
+        segment_started_at = time
+
+        if event == 'S':
+            if current_thread is None:
+                current_thread = arg        # The thread which was running since the beginning of the trace
+            add_slice(THREAD_TID_BASE + current_thread, thread_name(dump, current_thread), thread_started_at, time)
+            current_thread = ident
+            thread_started_at = time
+        elif event == 'I':
+            irq_stack.append((ident, time))
+        elif event == 'i':
+            # An exit without an enter means that the interrupt was entered before the beginning of the trace
+            if irq_stack and irq_stack[-1][0] == ident:
+                number, entered_at = irq_stack.pop()
+                add_slice(IRQ_TID_BASE + number, exception_name(number), entered_at, time)
+                stats = irq_stats[exception_name(number)]
+                stats['count'] += 1
+                stats['max'] = max(stats['max'], (time - entered_at) / dump.clock)
+        else:
+            raise ValueError('Unknown event %r' % event)
+
+    if current_thread is not None:
+        add_slice(THREAD_TID_BASE + current_thread, thread_name(dump, current_thread), thread_started_at, time)
+
+    metadata = [{'name': 'process_name', 'ph': 'M', 'pid': PID, 'args': {'name': 'sapog'}},
+                {'name': 'thread_name', 'ph': 'M', 'pid': PID, 'tid': CPU_TID, 'args': {'name': 'CPU'}}]
+    for tid in sorted(set(e['tid'] for e in events)):
+        if tid >= IRQ_TID_BASE:
+            name = exception_name(tid - IRQ_TID_BASE)
+        elif tid >= THREAD_TID_BASE:
+            name = thread_name(dump, tid - THREAD_TID_BASE)
+        else:
+            continue
+        metadata.append({'name': 'thread_name', 'ph': 'M', 'pid': PID, 'tid': tid, 'args': {'name': name}})
+        metadata.append({'name': 'thread_sort_index', 'ph': 'M', 'pid': PID, 'tid': tid, 'args': {'sort_index': tid}})
+
+    return metadata + events, time / dump.clock, exclusive, irq_stats
+
+
+def print_summary(duration, exclusive, irq_stats):
+    print('Duration %.3f ms' % (duration * 1e3))
+    print('%-32s %8s %8s %8s %10s' % ('', 'CPU, %', 'count', 'mean, us', 'max, us'))
+    for name, seconds in sorted(exclusive.items(), key=lambda x: -x[1]):
+        stats = irq_stats.get(name)
+        if stats and stats['count'] > 0:
+            print('%-32s %8.2f %8d %8.2f %10.2f' % (name, seconds / duration * 100, stats['count'],
+                                                   seconds / stats['count'] * 1e6, stats['max'] * 1e6))
+        else:
+            print('%-32s %8.2f' % (name, seconds / duration * 100))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('dump', nargs='?', help='file with the dump; "-" for stdin')
+    parser.add_argument('--port', help='capture the dump from this CLI serial port instead')
+    parser.add_argument('--baudrate', type=int, default=115200, help='CLI baud rate (default 115200)')
+    parser.add_argument('--timeout', type=float, default=5, help='serial port read timeout, s (default 5)')
+    parser.add_argument('--output', '-o', help='JSON trace output file')
+    parser.add_argument('--save-dump', help='save the captured dump into this file')
+    args = parser.parse_args()
+
+    if args.port:
+        lines = capture(args.port, args.baudrate, args.timeout)
+        if args.save_dump:
+            with open(args.save_dump, 'w') as f:
+                f.writelines(lines)
+    elif args.dump == '-':
+        lines = sys.stdin.readlines()
+    elif args.dump:
+        with open(args.dump) as f:
+            lines = f.readlines()
+    else:
+        parser.error('either the dump file or the serial port must be specified')
+
+    dump = parse(lines)
+    if dump.num_lost:
+        print('%d older records were overwritten in the ring buffer' % dump.num_lost)
+
+    events, duration, exclusive, irq_stats = convert(dump)
+    if duration > 0:
+        print_summary(duration, exclusive, irq_stats)
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump({'traceEvents': events, 'displayTimeUnit': 'ns'}, f)
+        print('Open %s in https://ui.perfetto.dev' % args.output)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
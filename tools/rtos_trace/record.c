@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Records a trace with the unmodified tracer of the firmware (rtos_trace.c) on the host, and dumps it with the
+ * CLI command of the firmware. The threads and the interrupts follow a fixed script, so that the expected output
+ * of convert.py is known; see test_convert.py, which checks convert.py against the dumps recorded by this program
+ * (test_dumps/).
+ *
+ * The cycle counter starts shortly before it wraps around. Scenarios:
+ *   basic      Four threads, nested interrupts, and an ignored interrupt; fits into the buffer.
+ *   overflow   Twice as many thread switches as the buffer holds, so that the older records are overwritten.
+ *
+ * Usage:
+ *   ./record basic > test_dumps/basic.txt
+ */
+
+#include "rtos_trace.c"
+#include <stdio.h>
+#include <string.h>
+
+#define CYCLES_PER_USEC     (STM32_SYSCLK / 1000000)
+#define INITIAL_CYCCNT      0xFFFF0000U
+
+#define EXC_SYSTICK         15
+#define EXC_ADC             (16 + 18)
+#define EXC_TIM2            (16 + 28)
+#define EXC_TIM4            (16 + 30)
+#define EXC_USART1          (16 + 37)
+
+struct stub_core_debug stub_core_debug;
+struct stub_dwt stub_dwt;
+uint32_t stub_primask;
+uint32_t stub_ipsr;
+
+enum thread_index
+{
+	MAIN,
+	MOTOR,
+	UAVCAN,
+	IDLE,
+	NUM_THREADS
+};
+
+static thread_t _threads[NUM_THREADS] = {
+	{ "main" },
+	{ "motor" },
+	{ "uavcan" },
+	{ "idle" }
+};
+
+static enum thread_index _current = MAIN;
+
+
+static void advance(unsigned usec)
+{
+	if (stub_dwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) {
+		stub_dwt.CYCCNT += usec * CYCLES_PER_USEC;
+	}
+}
+
+static void switch_to(enum thread_index next)
+{
+	rtos_trace_context_switch(&_threads[next], &_threads[_current]);
+	_current = next;
+}
+
+static void irq_enter(unsigned exception)
+{
+	stub_ipsr = exception;
+	rtos_trace_irq_enter();
+}
+
+static void irq_exit(unsigned exception, unsigned preempted_exception)
+{
+	stub_ipsr = exception;
+	rtos_trace_irq_exit();
+	stub_ipsr = preempted_exception;
+}
+
+static void cli(const char* arg0, const char* arg1)
+{
+	const char* argv[] = { arg0, arg1 };
+	rtos_trace_execute_cli_command((arg1 != NULL) ? 2 : 1, argv);
+}
+
+/**
+ * Exclusive times, us: motor 150, TIM4 15, ADC 5, uavcan 270, USART1 30, idle 596, SysTick 4, main 20.
+ * Total 1090 us.
+ */
+static void run_basic(void)
+{
+	cli("ignore", "44");                // TIM2, counted as the idle thread
+
+	switch_to(MOTOR);
+	advance(100);
+	irq_enter(EXC_TIM4);
+	advance(10);
+	irq_enter(EXC_ADC);
+	advance(5);
+	irq_exit(EXC_ADC, EXC_TIM4);
+	advance(5);
+	irq_exit(EXC_TIM4, 0);
+	advance(50);
+
+	switch_to(UAVCAN);
+	advance(200);
+	irq_enter(EXC_USART1);
+	advance(30);
+	irq_exit(EXC_USART1, 0);
+	advance(70);
+
+	switch_to(IDLE);
+	advance(500);
+	irq_enter(EXC_SYSTICK);
+	advance(4);
+	irq_exit(EXC_SYSTICK, 0);
+	advance(50);
+	irq_enter(EXC_TIM2);
+	advance(3);
+	irq_exit(EXC_TIM2, 0);
+	advance(43);
+
+	switch_to(MAIN);
+	advance(20);
+	switch_to(IDLE);
+}
+
+/**
+ * Each iteration adds two records: motor 10 us, idle 90 us.
+ */
+static void run_overflow(void)
+{
+	for (unsigned i = 0; i < RTOS_TRACE_MAX_RECORDS; i++) {
+		switch_to(MOTOR);
+		advance(10);
+		switch_to(IDLE);
+		advance(90);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	void (*scenario)(void) = NULL;
+	if (argc == 2 && !strcmp(argv[1], "basic")) {
+		scenario = run_basic;
+	} else if (argc == 2 && !strcmp(argv[1], "overflow")) {
+		scenario = run_overflow;
+	} else {
+		fprintf(stderr, "Usage: %s basic|overflow\n", argv[0]);
+		return 2;
+	}
+
+	// The IDs are assigned in the order of the first switch; registered in advance to make them fixed
+	for (unsigned i = 0; i < NUM_THREADS; i++) {
+		rtos_trace_get_thread_id(&_threads[i]);
+	}
+
+	stub_dwt.CYCCNT = INITIAL_CYCCNT;
+	rtos_trace_init();
+
+	scenario();
+
+	cli("dump", NULL);
+	return 0;
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Minimal ChibiOS API needed to build the tracer on the host.
+ */
+
+#pragma once
+
+typedef struct
+{
+	const char* name;
+} thread_t;
+
+static inline const char* chRegGetThreadNameX(const thread_t* tp)
+{
+	return tp->name;
+}
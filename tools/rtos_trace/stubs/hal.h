@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Minimal HAL and CMSIS API needed to build the tracer on the host; the registers are set by record.c.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define STM32_SYSCLK                    72000000
+
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+
+struct stub_core_debug
+{
+	uint32_t DEMCR;
+};
+
+struct stub_dwt
+{
+	uint32_t CTRL;
+	uint32_t CYCCNT;
+};
+
+extern struct stub_core_debug stub_core_debug;
+extern struct stub_dwt stub_dwt;
+extern uint32_t stub_primask;
+extern uint32_t stub_ipsr;
+
+#define CoreDebug                       (&stub_core_debug)
+#define DWT                             (&stub_dwt)
+
+static inline uint32_t __get_PRIMASK(void)
+{
+	return stub_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+	stub_primask = primask;
+}
+
+static inline uint32_t __get_IPSR(void)
+{
+	return stub_ipsr;
+}
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Tests of convert.py against the dumps recorded by the tracer of the firmware built on the host (record.c):
+the parser, the exclusive CPU time and the interrupt statistics, the trace events, the overwritten records,
+and the command line. If the host build is available, its output is checked against the recorded dumps, so that
+they don't go stale when the tracer changes.
+
+Example:
+  make check
+"""
+
+import os
+import re
+import sys
+import json
+import tempfile
+import unittest
+import subprocess
+
+import convert
+
+DIR = os.path.dirname(os.path.abspath(__file__))
+SCRIPT = os.path.join(DIR, 'convert.py')
+RECORD = os.path.join(DIR, 'record')
+
+US = 1e-6
+
+# Expected exclusive time in the basic scenario, see record.c
+BASIC_EXCLUSIVE = {
+    'motor': 150 * US,
+    'TIM4 (motor event timer)': 15 * US,
+    'ADC1_2 (motor ADC)': 5 * US,
+    'uavcan': 270 * US,
+    'USART1 (CLI)': 30 * US,
+    'idle': 596 * US,
+    'SysTick': 4 * US,
+    'main': 20 * US,
+}
+BASIC_DURATION = 1090 * US
+
+
+def load(name):
+    with open(os.path.join(DIR, 'test_dumps', name + '.txt')) as f:
+        return f.readlines()
+
+
+def without_addresses(lines):
+    """The addresses of the threads differ from run to run"""
+    return [re.sub(r'^(thread \d+) \S+', r'\1 ADDRESS', x) for x in lines]
+
+
+class TestParse(unittest.TestCase):
+    def test_basic(self):
+        dump = convert.parse(load('basic'))
+        self.assertEqual(dump.clock, 72000000)
+        self.assertEqual(dump.num_lost, 0)
+        self.assertEqual(dump.threads, {0: 'main', 1: 'motor', 2: 'uavcan', 3: 'idle'})
+        self.assertEqual(len(dump.records), 13)
+        self.assertEqual(dump.records[0], (0xFFFF0000, 'S', 1, 0))
+        # The ignored TIM2 is not recorded
+        self.assertNotIn(16 + 28, [r[2] for r in dump.records if r[1] in 'Ii'])
+
+    def test_surrounding_lines_ignored(self):
+        lines = ['ch> trace\n', 'garbage 1 2\n'] + load('basic') + ['ch> \n']
+        self.assertEqual(convert.parse(lines).records, convert.parse(load('basic')).records)
+
+    def test_truncated(self):
+        with self.assertRaises(ValueError):
+            convert.parse(load('basic')[:-1])
+
+    def test_no_trace(self):
+        with self.assertRaises(ValueError):
+            convert.parse(['ch> trace\n', 'RTOS trace is disabled; rebuild with RTOS_TRACE=1\n'])
+
+
+class TestConvert(unittest.TestCase):
+    def setUp(self):
+        self.events, self.duration, self.exclusive, self.irq_stats = convert.convert(convert.parse(load('basic')))
+
+    def test_exclusive(self):
+        # Includes the wrap-around of the cycle counter
+        self.assertAlmostEqual(self.duration, BASIC_DURATION)
+        self.assertEqual(sorted(self.exclusive), sorted(BASIC_EXCLUSIVE))
+        for name, seconds in BASIC_EXCLUSIVE.items():
+            self.assertAlmostEqual(self.exclusive[name], seconds, msg=name)
+
+    def test_irq_stats(self):
+        # The maximum is inclusive of the nested interrupts
+        for name, count, longest in [('TIM4 (motor event timer)', 1, 20 * US), ('ADC1_2 (motor ADC)', 1, 5 * US)]:
+            self.assertEqual(self.irq_stats[name]['count'], count)
+            self.assertAlmostEqual(self.irq_stats[name]['max'], longest)
+        self.assertEqual(self.irq_stats['SysTick']['count'], 1)
+
+    def test_cpu_track(self):
+        slices = [e for e in self.events if e['ph'] == 'X' and e['tid'] == convert.CPU_TID]
+        self.assertAlmostEqual(sum(e['dur'] for e in slices), BASIC_DURATION / US)
+        for a, b in zip(slices, slices[1:]):
+            self.assertAlmostEqual(a['ts'] + a['dur'], b['ts'])
+
+    def test_thread_and_irq_tracks(self):
+        def slices(name):
+            return [(round(e['ts']), round(e['dur'])) for e in self.events
+                    if e['ph'] == 'X' and e['tid'] != convert.CPU_TID and e['name'] == name]
+        # The thread slices include the interrupts
+        self.assertEqual(slices('motor'), [(0, 170)])
+        self.assertEqual(slices('uavcan'), [(170, 300)])
+        self.assertEqual(slices('idle'), [(470, 600)])
+        self.assertEqual(slices('TIM4 (motor event timer)'), [(100, 20)])
+        self.assertEqual(slices('ADC1_2 (motor ADC)'), [(110, 5)])
+
+    def test_metadata(self):
+        names = {e['tid']: e['args']['name'] for e in self.events if e['name'] == 'thread_name'}
+        self.assertEqual(names[convert.CPU_TID], 'CPU')
+        self.assertEqual(names[convert.THREAD_TID_BASE + 1], 'motor')
+        self.assertEqual(names[convert.IRQ_TID_BASE + 16 + 30], 'TIM4 (motor event timer)')
+
+    def test_exit_without_enter(self):
+        # The interrupt was entered before the beginning of the trace; the time until its exit is not attributed
+        lines = ['rtos_trace clock=1000000 records=3 lost=0\n', 'thread 0 0 main\n',
+                 '00000000 i 46 0\n', '0000000a S 0 1\n', '00000014 S 1 0\n', 'end\n']
+        _, duration, exclusive, irq_stats = convert.convert(convert.parse(lines))
+        self.assertAlmostEqual(duration, 20 * US)
+        self.assertEqual(list(exclusive), ['main'])
+        self.assertAlmostEqual(exclusive['main'], 10 * US)
+        self.assertEqual(dict(irq_stats), {})
+
+
+class TestOverflow(unittest.TestCase):
+    def test_overwritten(self):
+        dump = convert.parse(load('overflow'))
+        self.assertEqual(len(dump.records), 64)
+        self.assertEqual(dump.num_lost, 64)
+
+        # The trace starts in the middle of the scenario, with the thread that was running before the first record
+        _, duration, exclusive, _ = convert.convert(dump)
+        self.assertAlmostEqual(duration, (31 * 100 + 10) * US)
+        self.assertAlmostEqual(exclusive['motor'], 32 * 10 * US)
+        self.assertAlmostEqual(exclusive['idle'], 31 * 90 * US)
+
+
+@unittest.skipUnless(os.path.isfile(RECORD), 'The host build of the tracer is not available, run make first')
+class TestHostBuild(unittest.TestCase):
+    def test_dumps_up_to_date(self):
+        for name in ('basic', 'overflow'):
+            proc = subprocess.run([RECORD, name], stdout=subprocess.PIPE, universal_newlines=True, check=True)
+            self.assertEqual(without_addresses(proc.stdout.splitlines(True)), without_addresses(load(name)),
+                             'test_dumps/%s.txt is stale, re-record it with record.c' % name)
+
+
+class TestCommandLine(unittest.TestCase):
+    def test_convert(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            output = os.path.join(tmp, 'trace.json')
+            proc = subprocess.run([sys.executable, SCRIPT, os.path.join(DIR, 'test_dumps', 'overflow.txt'),
+                                   '-o', output], stdout=subprocess.PIPE, universal_newlines=True, check=True)
+            self.assertIn('64 older records were overwritten', proc.stdout)
+            self.assertIn('Duration 3.110 ms', proc.stdout)
+            with open(output) as f:
+                trace = json.load(f)
+        self.assertEqual(trace['displayTimeUnit'], 'ns')
+        self.assertTrue(any(e['ph'] == 'X' and e['name'] == 'motor' for e in trace['traceEvents']))
+
+    def test_no_input(self):
+        proc = subprocess.run([sys.executable, SCRIPT], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        self.assertNotEqual(proc.returncode, 0)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 PX4 Development Team
+ *
+ * Tests of the frame encoding of the serial telemetry: the CRC, the byte order of the fields, the rounding and
+ * the saturation of the values to the range of the fields.
+ *
+ * Usage:
+ *   ./test_frame
+ * The exit code is non-zero if any check fails.
+ */
+
+#include <serial_telemetry.hpp>
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(x)                check((x), #x, __LINE__)
+
+namespace
+{
+
+unsigned num_failures;
+
+void check(bool ok, const char* what, int line)
+{
+	if (!ok) {
+		std::fprintf(stderr, "FAILED at line %i: %s\n", line, what);
+		num_failures++;
+	}
+}
+
+unsigned get_u16(const serial_telemetry::Frame& frame, unsigned offset)
+{
+	return (unsigned(frame[offset]) << 8) | frame[offset + 1];
+}
+
+void test_crc()
+{
+	// Check value of CRC-8 with poly 0x07, init 0, no reflection, no final XOR
+	const char* const check_input = "123456789";
+	CHECK(serial_telemetry::crc8(reinterpret_cast<const std::uint8_t*>(check_input), 9) == 0xF4);
+
+	CHECK(serial_telemetry::crc8(nullptr, 0) == 0);
+
+	const std::uint8_t zero = 0;
+	CHECK(serial_telemetry::crc8(&zero, 1) == 0);
+
+	// Appending the CRC to the data yields zero
+	std::uint8_t data[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0 };
+	data[4] = serial_telemetry::crc8(data, 4);
+	CHECK(serial_telemetry::crc8(data, 5) == 0);
+}
+
+void test_byte_order()
+{
+	serial_telemetry::Snapshot snap;
+	snap.temperature_degC = 42.0F;
+	snap.voltage = 16.8F;
+	snap.current = 12.34F;
+	snap.consumption_mAh = 567.0F;
+	snap.electrical_rpm = 123456;
+
+	const auto frame = serial_telemetry::encode_frame(snap);
+	const std::uint8_t expected[serial_telemetry::FrameSize - 1] = {
+		0x2A,                   // 42 degC
+		0x06, 0x90,             // 1680 * 0.01 V
+		0x04, 0xD2,             // 1234 * 0.01 A
+		0x02, 0x37,             // 567 mAh
+		0x04, 0xD3              // 1235 * 100 eRPM
+	};
+	CHECK(std::memcmp(frame.data(), expected, sizeof(expected)) == 0);
+	CHECK(frame[serial_telemetry::FrameSize - 1] == serial_telemetry::crc8(expected, sizeof(expected)));
+}
+
+void test_rounding()
+{
+	serial_telemetry::Snapshot snap;
+	snap.voltage = 0.004F;
+	snap.current = 0.006F;
+	snap.consumption_mAh = 2.5F;
+	snap.electrical_rpm = 149;
+
+	const auto frame = serial_telemetry::encode_frame(snap);
+	CHECK(get_u16(frame, 1) == 0);
+	CHECK(get_u16(frame, 3) == 1);
+	CHECK(get_u16(frame, 5) == 3);          // Half away from zero
+	CHECK(get_u16(frame, 7) == 1);
+
+	snap.electrical_rpm = 150;
+	CHECK(get_u16(serial_telemetry::encode_frame(snap), 7) == 2);
+}
+
+void test_saturation()
+{
+	serial_telemetry::Snapshot snap;
+	snap.temperature_degC = -20.0F;
+	snap.voltage = -1.0F;
+	snap.current = -5.0F;
+	snap.consumption_mAh = -0.4F;
+	snap.electrical_rpm = 0;
+
+	auto frame = serial_telemetry::encode_frame(snap);
+	for (unsigned i = 0; i < (serial_telemetry::FrameSize - 1); i++) {
+		CHECK(frame[i] == 0);
+	}
+	CHECK(frame[serial_telemetry::FrameSize - 1] == 0);
+
+	snap.temperature_degC = 300.0F;
+	snap.voltage = 1000.0F;
+	snap.current = 655.36F;
+	snap.consumption_mAh = 1e6F;
+	snap.electrical_rpm = 0xFFFFFFFFU;
+
+	frame = serial_telemetry::encode_frame(snap);
+	CHECK(frame[0] == 255);
+	CHECK(get_u16(frame, 1) == 65535);
+	CHECK(get_u16(frame, 3) == 65535);
+	CHECK(get_u16(frame, 5) == 65535);
+	CHECK(get_u16(frame, 7) == 65535);
+	CHECK(frame[serial_telemetry::FrameSize - 1] == serial_telemetry::crc8(frame.data(), serial_telemetry::FrameSize - 1));
+
+	// The largest value that fits
+	snap.current = 655.35F;
+	snap.electrical_rpm = 6553549;
+	frame = serial_telemetry::encode_frame(snap);
+	CHECK(get_u16(frame, 3) == 65535);
+	CHECK(get_u16(frame, 7) == 65535);
+}
+
+}
+
+int main()
+{
+	test_crc();
+	test_byte_order();
+	test_rounding();
+	test_saturation();
+
+	if (num_failures > 0) {
+		std::printf("%u checks failed\n", num_failures);
+		return 1;
+	}
+	std::printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2026 PX4 Development Team
+#
+# This program is free software: you can redistribute it and/or modify it under the terms of the
+# GNU General Public License as published by the Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+# without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+# See the GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License along with this program.
+# If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+Computes the thrust linearization table (configuration parameters thr_lut_0 ... thr_lut_8) from bench data.
+
+Bench procedure:
+ 1. Mount the motor with the propeller on a thrust stand.
+ 2. Sweep the setpoint across the operating range using the CLI commands "dc <duty cycle>" or "rpm <rpm>",
+    in the same mode that will be used by the flight controller. Wait until the thrust settles at every point.
+ 3. Record the setpoint and the measured thrust into a CSV file, one "setpoint,thrust" pair per line.
+    Any thrust unit can be used. The more points, the better; at least one per table segment is recommended.
+ 4. Run this script on the file; for the RPM mode, pass the value of thr_rpm_max via --rpm-max.
+ 5. Execute the printed commands in the CLI, set thr_lin_en to 1, and restart the node.
+
+Thrust at zero setpoint is assumed to be zero.
+"""
+
+import argparse
+import csv
+import sys
+
+TABLE_SIZE = 9
+OUTPUT_SCALE = 10000
+
+
+def load_points(path):
+    points = [(0.0, 0.0)]
+    with open(path) as f:
+        for row in csv.reader(f):
+            if not row or row[0].strip().startswith('#'):
+                continue
+            try:
+                points.append((float(row[0]), float(row[1])))
+            except ValueError:
+                continue            # Header
+    points.sort()
+
+    # The thrust curve must be monotonic; measurement noise is suppressed by keeping the running maximum
+    result = []
+    for setpoint, thrust in points:
+        if result and thrust <= result[-1][1]:
+            continue
+        result.append((setpoint, thrust))
+    return result
+
+
+def invert(points, thrust):
+    """Finds the setpoint that yields the specified thrust using linear interpolation."""
+    for (s0, t0), (s1, t1) in zip(points, points[1:]):
+        if t0 <= thrust <= t1:
+            return s0 + (s1 - s0) * (thrust - t0) / (t1 - t0)
+    return points[-1][0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('input', help='CSV file with setpoint,thrust pairs')
+    parser.add_argument('--rpm-max', type=float,
+                        help='value of thr_rpm_max; if specified, setpoints are RPM, otherwise duty cycle')
+    args = parser.parse_args()
+
+    points = load_points(args.input)
+    if len(points) < 3:
+        print('Not enough valid points', file=sys.stderr)
+        return 1
+
+    full_scale = args.rpm_max if args.rpm_max else 1.0
+    max_thrust = points[-1][1]
+    if points[-1][0] < full_scale * 0.95:
+        print('Warning: the sweep does not cover the full range; full thrust will map to the highest setpoint measured',
+              file=sys.stderr)
+
+    for i in range(TABLE_SIZE):
+        setpoint = invert(points, max_thrust * i / (TABLE_SIZE - 1))
+        value = int(round(min(max(setpoint / full_scale, 0.0), 1.0) * OUTPUT_SCALE))
+        print('cfg set thr_lut_%d %d' % (i, value))
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())